@@ -32,6 +32,7 @@
 #ifndef __CHECKSUM_H__
 #define __CHECKSUM_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 /*!
@@ -47,4 +48,27 @@ extern uint32_t memcpy_checksum(void *__restrict __dst,
 /*! @cond */
 __THROW __nonnull((2)) /*! @endcond */ ;
 
+/*!
+ * @brief Compute the CRC32C (Castagnoli) of a buffer
+ * @param __crc [in] CRC of the preceding data, 0 to start
+ * @param __buf [in] Data reference
+ * @param __n [in] Number of bytes to compute
+ * @return 32-bit CRC value, pass it back in to continue the computation
+ */
+extern uint32_t crc32c(uint32_t __crc, const void *__buf, size_t __n)
+/*! @cond */
+__THROW __nonnull((2)) /*! @endcond */ ;
+
+/*!
+ * @brief Continue a CRC32C over a run of identical bytes, e.g. the erased
+ *        (0xFF) contents of a hole in a sparse image
+ * @param __crc [in] CRC of the preceding data, 0 to start
+ * @param __c [in] Byte value
+ * @param __n [in] Number of bytes
+ * @return 32-bit CRC value
+ */
+extern uint32_t crc32c_fill(uint32_t __crc, uint8_t __c, size_t __n)
+/*! @cond */
+__THROW /*! @endcond */ ;
+
 #endif				/* __CHECKSUM_H__ */
@@ -201,6 +201,21 @@ enum ecc_bitfields
 /*! @cond */
 	 __nonnull((1, 3)) /*! @endcond */ ;
 
+/*!
+ * @brief Check the 8-bit P8 ECC value of every 9-bytes of the source
+ *        buffer, without copying or correcting anything
+ * @param __src [in] Source buffer
+ * @param __src_sz [in] Source buffer size (in bytes), trailing bytes short
+ *        of a whole 9-byte word are ignored
+ * @param __count [out] If not NULL, the number of words found CLEAN,
+ *        CORRECTED (i.e. correctable) and UNCORRECTABLE, indexed by status
+ * @return The worst status found: CLEAN, CORRECTED or UNCORRECTABLE
+ */
+  extern ecc_status_t p8_ecc_check(const void *__src, size_t __src_sz,
+				   size_t __count[3])
+/*! @cond */
+	 __nonnull((1)) /*! @endcond */ ;
+
 /*!
  * @brief Hexdump the contents of a memory buffer to an output stream.
  *        This is a buck-standard hexdump except it issolates the P8 ECC
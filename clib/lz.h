@@ -0,0 +1,81 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/lz.h $                                                   */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*! @file lz.h
+ *  @brief Fast LZ77 block codec
+ *  @details Byte oriented LZ77 in the LZ4 style: each sequence is a token
+ *           byte (4 bit literal length, 4 bit match length), the literal
+ *           bytes, then a 16 bit little-endian match distance.  Lengths that
+ *           do not fit in the token continue in extra bytes of 255.  The
+ *           last sequence of a block carries literals only.  Long runs of
+ *           one byte value (e.g. erased flash) become a single match with
+ *           a distance of 1.
+ *  @date 2026
+ */
+
+#ifndef __LZ_H__
+#define __LZ_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LZ_MIN_MATCH		4	/*!< Shortest match encoded */
+#define LZ_MAX_DISTANCE		65535	/*!< Farthest match reference */
+
+/*!
+ * @brief Worst case compressed size of an @em n byte block
+ */
+#define LZ_BOUND(n)		((n) + (n) / 255 + 16)
+
+/*!
+ * @brief Compress a block
+ * @param __src [in] Data reference
+ * @param __n [in] Number of bytes
+ * @param __dst [out] Compressed data
+ * @param __cap [in] Size of the @em __dst buffer
+ * @return Compressed size, or 0 if the result would not fit in @em __cap
+ *         bytes (i.e. the caller should store the block uncompressed)
+ */
+extern size_t lz_compress(const void *__src, size_t __n, void *__dst,
+			  size_t __cap)
+/*! @cond */
+__THROW __nonnull((1, 3)) /*! @endcond */ ;
+
+/*!
+ * @brief Decompress a block
+ * @param __src [in] Compressed data
+ * @param __n [in] Number of compressed bytes
+ * @param __dst [out] Data reference
+ * @param __cap [in] Size of the @em __dst buffer
+ * @return Decompressed size, or -1 if @em __src is malformed or would
+ *         overrun @em __dst
+ */
+extern ssize_t lz_decompress(const void *__src, size_t __n, void *__dst,
+			     size_t __cap)
+/*! @cond */
+__THROW __nonnull((1, 3)) /*! @endcond */ ;
+
+#endif				/* __LZ_H__ */
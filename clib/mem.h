@@ -0,0 +1,62 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/mem.h $                                                  */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*! @file mem.h
+ *  @brief Vectorized memory scan helpers
+ *  @date 2026
+ */
+
+#ifndef __MEM_H__
+#define __MEM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * @brief Locate the first byte that differs between two memory areas
+ * @param __s1 [in] First memory reference
+ * @param __s2 [in] Second memory reference
+ * @param __n [in] Number of bytes to compare
+ * @return Offset of the first differing byte, or @em __n if the areas
+ *         are identical
+ */
+extern size_t memdiff(const void *__s1, const void *__s2, size_t __n)
+/*! @cond */
+__THROW __nonnull((1, 2)) /*! @endcond */ ;
+
+/*!
+ * @brief Locate the first byte of a memory area that is not equal to a
+ *        fill value
+ * @param __s [in] Memory reference
+ * @param __c [in] Fill value (converted to unsigned char)
+ * @param __n [in] Number of bytes to scan
+ * @return Offset of the first byte not equal to @em __c, or @em __n if
+ *         every byte matches
+ */
+extern size_t memfilled(const void *__s, int __c, size_t __n)
+/*! @cond */
+__THROW __nonnull((1)) /*! @endcond */ ;
+
+#endif				/* __MEM_H__ */
@@ -0,0 +1,98 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/sha256.h $                                               */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*! @file sha256.h
+ *  @brief SHA-256 message digest (FIPS 180-4)
+ *  @date 2026
+ */
+
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_SIZE		32	/*!< Digest size in bytes */
+#define SHA256_BLOCK_SIZE	64	/*!< Message block size in bytes */
+
+/*!
+ * @brief Running SHA-256 computation
+ */
+typedef struct sha256 sha256_t;
+struct sha256 {
+	uint32_t state[8];
+	uint64_t count;			/*!< Bytes hashed so far */
+	uint8_t buf[SHA256_BLOCK_SIZE];	/*!< Partial block */
+};
+
+/*!
+ * @brief Start a SHA-256 computation
+ * @param __self [in] sha256 object
+ */
+extern void sha256_init(sha256_t * __self)
+/*! @cond */
+__THROW __nonnull((1)) /*! @endcond */ ;
+
+/*!
+ * @brief Hash more data
+ * @param __self [in] sha256 object
+ * @param __buf [in] Data reference
+ * @param __n [in] Number of bytes
+ */
+extern void sha256_update(sha256_t * __self, const void *__buf, size_t __n)
+/*! @cond */
+__THROW __nonnull((1)) /*! @endcond */ ;
+
+/*!
+ * @brief Hash a run of identical bytes, e.g. the erased (0xFF) contents of
+ *        a hole in a sparse image
+ * @param __self [in] sha256 object
+ * @param __c [in] Byte value
+ * @param __n [in] Number of bytes
+ */
+extern void sha256_fill(sha256_t * __self, uint8_t __c, size_t __n)
+/*! @cond */
+__THROW __nonnull((1)) /*! @endcond */ ;
+
+/*!
+ * @brief Finish the computation
+ * @param __self [in] sha256 object
+ * @param __md [out] SHA256_SIZE byte digest
+ */
+extern void sha256_final(sha256_t * __self, uint8_t * __md)
+/*! @cond */
+__THROW __nonnull((1, 2)) /*! @endcond */ ;
+
+/*!
+ * @brief Hash a buffer in one call
+ * @param __buf [in] Data reference
+ * @param __n [in] Number of bytes
+ * @param __md [out] SHA256_SIZE byte digest
+ */
+extern void sha256(const void *__buf, size_t __n, uint8_t * __md)
+/*! @cond */
+__THROW __nonnull((3)) /*! @endcond */ ;
+
+#endif				/* __SHA256_H__ */
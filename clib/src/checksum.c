@@ -25,10 +25,130 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "assert.h"
+#include "attribute.h"
 #include "checksum.h"
 
+#define CRC32C_POLY	0x82F63B78	/* reflected */
+
+/*
+ * CRC32C is computed with the CPU's crc32c instruction where there is one
+ * (x86 SSE4.2, ARMv8 CRC), else slice-by-8: eight table lookups per 8 bytes
+ * of input, independent of the host byte order.
+ */
+static uint32_t crc32c_table[8][256];
+
+static uint32_t __crc32c_sw(uint32_t crc, const uint8_t * p, size_t n)
+{
+	while (n && ((uintptr_t)p & 7)) {
+		crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+		n--;
+	}
+
+	while (8 <= n) {
+		uint32_t lo = crc ^ (p[0] | p[1] << 8 | p[2] << 16 |
+				     (uint32_t)p[3] << 24);
+		uint32_t hi = p[4] | p[5] << 8 | p[6] << 16 |
+		    (uint32_t)p[7] << 24;
+
+		crc = crc32c_table[7][lo & 0xFF] ^
+		    crc32c_table[6][(lo >> 8) & 0xFF] ^
+		    crc32c_table[5][(lo >> 16) & 0xFF] ^
+		    crc32c_table[4][lo >> 24] ^
+		    crc32c_table[3][hi & 0xFF] ^
+		    crc32c_table[2][(hi >> 8) & 0xFF] ^
+		    crc32c_table[1][(hi >> 16) & 0xFF] ^
+		    crc32c_table[0][hi >> 24];
+
+		p += 8;
+		n -= 8;
+	}
+
+	while (n--)
+		crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+
+	return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__ ((target("sse4.2")))
+static uint32_t __crc32c_hw(uint32_t crc, const uint8_t * p, size_t n)
+{
+	while (n && ((uintptr_t)p & 7)) {
+		crc = __builtin_ia32_crc32qi(crc, *p++);
+		n--;
+	}
+
+	uint64_t crc64 = crc;
+	for (; 8 <= n; p += 8, n -= 8)
+		crc64 = __builtin_ia32_crc32di(crc64, *(const uint64_t *)p);
+	crc = crc64;
+
+	while (n--)
+		crc = __builtin_ia32_crc32qi(crc, *p++);
+
+	return crc;
+}
+
+static bool __crc32c_hw_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(__aarch64__) && defined(__GNUC__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+
+__attribute__ ((target("+crc")))
+static uint32_t __crc32c_hw(uint32_t crc, const uint8_t * p, size_t n)
+{
+	while (n && ((uintptr_t)p & 7)) {
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+		n--;
+	}
+
+	for (; 8 <= n; p += 8, n -= 8)
+		crc = __builtin_aarch64_crc32cx(crc, *(const uint64_t *)p);
+
+	while (n--)
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+
+	return crc;
+}
+
+static bool __crc32c_hw_supported(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+#else
+#define __crc32c_hw		__crc32c_sw
+#define __crc32c_hw_supported()	false
+#endif
+
+static uint32_t (*__crc32c)(uint32_t, const uint8_t *, size_t) = __crc32c_sw;
+
+static void __crc32c_init(void) __constructor;
+static void __crc32c_init(void)
+{
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+		for (int j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+		crc32c_table[0][i] = crc;
+	}
+
+	for (uint32_t i = 0; i < 256; i++)
+		for (int k = 1; k < 8; k++)
+			crc32c_table[k][i] = (crc32c_table[k - 1][i] >> 8) ^
+			    crc32c_table[0][crc32c_table[k - 1][i] & 0xFF];
+
+	if (__crc32c_hw_supported())
+		__crc32c = __crc32c_hw;
+}
+
 uint32_t memcpy_checksum(void *__restrict __dst, const void *__restrict __src,
 			 size_t __n)
 {
@@ -48,3 +168,22 @@ uint32_t memcpy_checksum(void *__restrict __dst, const void *__restrict __src,
 
 	return (sum[0] << 24) | (sum[1] << 16) | (sum[2] << 8) | sum[3];
 }
+
+uint32_t crc32c(uint32_t __crc, const void *__buf, size_t __n)
+{
+	return ~__crc32c(~__crc, __buf, __n);
+}
+
+uint32_t crc32c_fill(uint32_t __crc, uint8_t __c, size_t __n)
+{
+	uint8_t buf[4096];
+	memset(buf, __c, sizeof buf);
+
+	while (0 < __n) {
+		size_t n = __n < sizeof buf ? __n : sizeof buf;
+		__crc = crc32c(__crc, buf, n);
+		__n -= n;
+	}
+
+	return __crc;
+}
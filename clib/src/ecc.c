@@ -445,6 +445,34 @@ ecc_status_t p8_ecc_remove (void *__restrict __dst, size_t __dst_sz,
         return remove_ecc(__src, __src_sz, __dst, __dst_sz, false);
 }
 
+ecc_status_t p8_ecc_check(const void *__src, size_t __src_sz,
+			  size_t __count[3])
+{
+        const uint8_t *src = __src;
+        ecc_status_t rc = CLEAN;
+
+        for (size_t i = 0; i + 9 <= __src_sz; i += 9)
+        {
+                uint64_t data;
+                memcpy(&data, src + i, sizeof(data));
+
+                uint8_t bad_bit = verify_ecc(be64toh(data), src[i + 8]);
+
+                ecc_status_t status = CLEAN;
+                if (bad_bit == UE)
+                        status = UNCORRECTABLE;
+                else if (bad_bit != GD)
+                        status = CORRECTED;
+
+                if (rc < status)
+                        rc = status;
+                if (__count != NULL)
+                        __count[status]++;
+        }
+
+        return rc;
+}
+
 void p8_ecc_dump(FILE * __out, uint32_t __addr,
                  void *__restrict __buf, size_t __buf_sz)
 {
@@ -44,7 +44,8 @@
 
 #include "err.h"
 
-static list_t *__err_key = 0;
+/* pending errors, one stack per thread */
+static __thread list_t __err_list = INIT_LIST;
 
 static const char *__err_type_name[] = {
 	[ERR_NONE] = "none",
@@ -68,34 +69,21 @@ void err_delete(err_t * self)
 
 err_t *err_get(void)
 {
-	list_t *list = __err_key;
+	list_t *list = &__err_list;
 
-	err_t *self = NULL;
+	if (list->node.next == NULL || list_empty(list))
+		return NULL;
 
-	if (list != NULL) {
-		self = container_of(list_remove_tail(list), err_t, node);
-
-		if (list_empty(list)) {
-			free(list), list = NULL;
-			__err_key = list;
-		}
-	}
-
-	return self;
+	return container_of(list_remove_tail(list), err_t, node);
 }
 
 void err_put(err_t * self)
 {
 	assert(self != NULL);
 
-	list_t *list = __err_key;
-	if (list == NULL) {
-		list = (list_t *) malloc(sizeof(*list));
-		assert(list != NULL);
-
+	list_t *list = &__err_list;
+	if (list->node.next == NULL)
 		list_init(list);
-		__err_key = list;
-	}
 
 	list_add_head(list, &self->node);
 
@@ -0,0 +1,208 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/src/lz.c $                                               */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "assert.h"
+#include "attribute.h"
+#include "lz.h"
+
+#define HASH_BITS	13
+#define TOKEN_MAX	15
+
+static inline uint32_t load32(const uint8_t * p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t hash(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/* bytes needed for the length extension of 'len' */
+static inline size_t ext_size(size_t len)
+{
+	return len < TOKEN_MAX ? 0 : (len - TOKEN_MAX) / 255 + 1;
+}
+
+static uint8_t *ext_put(uint8_t * op, size_t len)
+{
+	if (len < TOKEN_MAX)
+		return op;
+
+	for (len -= TOKEN_MAX; 255 <= len; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+
+	return op;
+}
+
+/* emit 'lit' literals at 'anchor', then a match unless 'mlen' is 0 */
+static uint8_t *emit(uint8_t * op, uint8_t * oend, const uint8_t * anchor,
+		     size_t lit, size_t dist, size_t mlen)
+{
+	size_t need = 1 + ext_size(lit) + lit;
+	if (mlen != 0)
+		need += 2 + ext_size(mlen - LZ_MIN_MATCH);
+	if ((size_t)(oend - op) < need)
+		return NULL;
+
+	size_t m = mlen ? mlen - LZ_MIN_MATCH : 0;
+	*op++ = (lit < TOKEN_MAX ? lit : TOKEN_MAX) << 4 |
+		(m < TOKEN_MAX ? m : TOKEN_MAX);
+
+	op = ext_put(op, lit);
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	if (mlen != 0) {
+		*op++ = dist & 0xFF;
+		*op++ = dist >> 8;
+		op = ext_put(op, m);
+	}
+
+	return op;
+}
+
+size_t lz_compress(const void *src, size_t n, void *dst, size_t cap)
+{
+	const uint8_t *base = src, *ip = base, *anchor = base;
+	const uint8_t *end = base + n;
+	uint8_t *op = dst, *oend = op + cap;
+
+	uint32_t table[1 << HASH_BITS];
+	memset(table, 0, sizeof(table));
+
+	while (LZ_MIN_MATCH <= end - ip) {
+		uint32_t seq = load32(ip);
+		uint32_t h = hash(seq);
+
+		const uint8_t *ref = base + table[h];
+		table[h] = ip - base;
+
+		if (ref < ip && ip - ref <= LZ_MAX_DISTANCE &&
+		    load32(ref) == seq) {
+			const uint8_t *m = ip + LZ_MIN_MATCH;
+			const uint8_t *r = ref + LZ_MIN_MATCH;
+
+			while (8 <= end - m) {
+				uint64_t a, b;
+				memcpy(&a, m, sizeof(a));
+				memcpy(&b, r, sizeof(b));
+				if (a != b)
+					break;
+				m += 8, r += 8;
+			}
+			while (m < end && *m == *r)
+				m++, r++;
+
+			op = emit(op, oend, anchor, ip - anchor, ip - ref,
+				  m - ip);
+			if (op == NULL)
+				return 0;
+
+			ip = anchor = m;
+			continue;
+		}
+
+		/* step faster through data that will not compress */
+		ip += 1 + ((ip - anchor) >> 6);
+	}
+
+	op = emit(op, oend, anchor, end - anchor, 0, 0);
+	if (op == NULL)
+		return 0;
+
+	return op - (uint8_t *)dst;
+}
+
+static inline int ext_get(const uint8_t ** ip, const uint8_t * iend,
+			  size_t * len)
+{
+	if (*len < TOKEN_MAX)
+		return 0;
+
+	uint8_t b;
+	do {
+		if (*ip == iend)
+			return -1;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+
+	return 0;
+}
+
+ssize_t lz_decompress(const void *src, size_t n, void *dst, size_t cap)
+{
+	const uint8_t *ip = src, *iend = ip + n;
+	uint8_t *op = dst, *oend = op + cap;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+
+		size_t lit = token >> 4;
+		if (ext_get(&ip, iend, &lit) < 0)
+			return -1;
+		if ((size_t)(iend - ip) < lit || (size_t)(oend - op) < lit)
+			return -1;
+
+		memcpy(op, ip, lit);
+		ip += lit, op += lit;
+
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		size_t dist = ip[0] | ip[1] << 8;
+		ip += 2;
+
+		size_t mlen = token & TOKEN_MAX;
+		if (ext_get(&ip, iend, &mlen) < 0)
+			return -1;
+		mlen += LZ_MIN_MATCH;
+
+		if (dist == 0 || (size_t)(op - (uint8_t *)dst) < dist ||
+		    (size_t)(oend - op) < mlen)
+			return -1;
+
+		const uint8_t *ref = op - dist;
+		if (dist == 1)
+			memset(op, *ref, mlen);
+		else if (mlen <= dist)
+			memcpy(op, ref, mlen);
+		else
+			for (size_t i = 0; i < mlen; i++)
+				op[i] = ref[i];
+		op += mlen;
+	}
+
+	return op - (uint8_t *)dst;
+}
@@ -0,0 +1,110 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/src/mem.c $                                              */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *   File: mem.c
+ * Author:
+ *  Descr: Vectorized memory scan helpers
+ *   Note: Uses GCC generic vectors so the compiler emits SSE/AVX, VMX or
+ *         NEON as available.  Vectors are loaded with memcpy(), so any
+ *         alignment works without a separate head.  Bytes are compared
+ *         one at a time only for the tail shorter than a 64 byte stride
+ *         and to find the first mismatch within a dirty stride.
+ *   Date: 10/19/2026
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mem.h"
+
+typedef uint64_t vec_t __attribute__ ((vector_size(16)));
+
+#define VEC_SIZE	sizeof(vec_t)
+#define VEC_STRIDE	(4 * VEC_SIZE)
+
+static inline vec_t vec_load(const uint8_t * p)
+{
+	vec_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static inline int vec_zero(vec_t v)
+{
+	uint64_t r = 0;
+	for (size_t i = 0; i < VEC_SIZE / sizeof(uint64_t); i++)
+		r |= v[i];
+	return r == 0;
+}
+
+size_t memdiff(const void *__s1, const void *__s2, size_t __n)
+{
+	const uint8_t *a = __s1, *b = __s2;
+	size_t i = 0;
+
+	/* 64 bytes per iteration, stop at the first dirty stride */
+	for (; i + VEC_STRIDE <= __n; i += VEC_STRIDE) {
+		vec_t x = (vec_load(a + i) ^ vec_load(b + i)) |
+		    (vec_load(a + i + VEC_SIZE) ^ vec_load(b + i + VEC_SIZE)) |
+		    (vec_load(a + i + 2 * VEC_SIZE) ^
+		     vec_load(b + i + 2 * VEC_SIZE)) |
+		    (vec_load(a + i + 3 * VEC_SIZE) ^
+		     vec_load(b + i + 3 * VEC_SIZE));
+		if (!vec_zero(x))
+			break;
+	}
+
+	for (; i < __n; i++)
+		if (a[i] != b[i])
+			break;
+
+	return i;
+}
+
+size_t memfilled(const void *__s, int __c, size_t __n)
+{
+	const uint8_t *a = __s;
+	uint8_t c = (uint8_t) __c;
+	size_t i = 0;
+
+	vec_t f;
+	memset(&f, c, sizeof f);
+
+	for (; i + VEC_STRIDE <= __n; i += VEC_STRIDE) {
+		vec_t x = (vec_load(a + i) ^ f) |
+		    (vec_load(a + i + VEC_SIZE) ^ f) |
+		    (vec_load(a + i + 2 * VEC_SIZE) ^ f) |
+		    (vec_load(a + i + 3 * VEC_SIZE) ^ f);
+		if (!vec_zero(x))
+			break;
+	}
+
+	for (; i < __n; i++)
+		if (a[i] != c)
+			break;
+
+	return i;
+}
@@ -0,0 +1,167 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/src/sha256.c $                                           */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "assert.h"
+#include "attribute.h"
+#include "sha256.h"
+
+static const uint32_t K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(uint32_t * state, const uint8_t * p)
+{
+	uint32_t w[64];
+
+	for (int i = 0; i < 16; i++, p += 4)
+		w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+		       (uint32_t)p[2] << 8 | (uint32_t)p[3];
+
+	for (int i = 16; i < 64; i++) {
+		uint32_t s0 = ROR(w[i-15], 7) ^ ROR(w[i-15], 18) ^
+			      (w[i-15] >> 3);
+		uint32_t s1 = ROR(w[i-2], 17) ^ ROR(w[i-2], 19) ^
+			      (w[i-2] >> 10);
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (int i = 0; i < 64; i++) {
+		uint32_t t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) +
+			      ((e & f) ^ (~e & g)) + K[i] + w[i];
+		uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) +
+			      ((a & b) ^ (a & c) ^ (b & c));
+
+		h = g, g = f, f = e, e = d + t1;
+		d = c, c = b, b = a, a = t1 + t2;
+	}
+
+	state[0] += a, state[1] += b, state[2] += c, state[3] += d;
+	state[4] += e, state[5] += f, state[6] += g, state[7] += h;
+}
+
+void sha256_init(sha256_t * self)
+{
+	static const uint32_t H[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	memcpy(self->state, H, sizeof(H));
+	self->count = 0;
+}
+
+void sha256_update(sha256_t * self, const void *buf, size_t n)
+{
+	const uint8_t *p = buf;
+	size_t used = self->count % SHA256_BLOCK_SIZE;
+
+	self->count += n;
+
+	if (used != 0) {
+		size_t len = SHA256_BLOCK_SIZE - used;
+		if (n < len) {
+			memcpy(self->buf + used, p, n);
+			return;
+		}
+		memcpy(self->buf + used, p, len);
+		sha256_block(self->state, self->buf);
+		p += len, n -= len;
+	}
+
+	for (; SHA256_BLOCK_SIZE <= n; p += SHA256_BLOCK_SIZE,
+	     n -= SHA256_BLOCK_SIZE)
+		sha256_block(self->state, p);
+
+	memcpy(self->buf, p, n);
+}
+
+void sha256_fill(sha256_t * self, uint8_t c, size_t n)
+{
+	uint8_t run[1024];
+	memset(run, c, sizeof(run));
+
+	while (0 < n) {
+		size_t len = n < sizeof(run) ? n : sizeof(run);
+		sha256_update(self, run, len);
+		n -= len;
+	}
+}
+
+void sha256_final(sha256_t * self, uint8_t * md)
+{
+	uint64_t bits = self->count * 8;
+	size_t used = self->count % SHA256_BLOCK_SIZE;
+
+	self->buf[used++] = 0x80;
+	if (SHA256_BLOCK_SIZE - 8 < used) {
+		memset(self->buf + used, 0, SHA256_BLOCK_SIZE - used);
+		sha256_block(self->state, self->buf);
+		used = 0;
+	}
+	memset(self->buf + used, 0, SHA256_BLOCK_SIZE - 8 - used);
+
+	for (int i = 0; i < 8; i++)
+		self->buf[SHA256_BLOCK_SIZE - 1 - i] = bits >> (i * 8);
+	sha256_block(self->state, self->buf);
+
+	for (int i = 0; i < 8; i++) {
+		md[i * 4 + 0] = self->state[i] >> 24;
+		md[i * 4 + 1] = self->state[i] >> 16;
+		md[i * 4 + 2] = self->state[i] >> 8;
+		md[i * 4 + 3] = self->state[i];
+	}
+}
+
+void sha256(const void *buf, size_t n, uint8_t * md)
+{
+	sha256_t ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, buf, n);
+	sha256_final(&ctx, md);
+}
@@ -0,0 +1,198 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/src/workq.c $                                            */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *   File: workq.c
+ * Author:
+ *  Descr: Fixed size worker thread pool
+ *   Date: 10/19/2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attribute.h"
+#include "list.h"
+#include "err.h"
+
+#include "workq.h"
+
+typedef struct workq_job workq_job_t;
+struct workq_job {
+	list_node_t node;
+	workq_func_t func;
+	void *arg;
+};
+
+struct workq {
+	pthread_mutex_t lock;
+	pthread_cond_t work;	/* signalled when a job is queued */
+	pthread_cond_t idle;	/* signalled when a job completes */
+
+	list_t jobs;
+	list_t errors;		/* raised by failed jobs, see workq_wait() */
+	size_t pending;		/* queued + running */
+	bool failed;
+	bool stop;
+
+	size_t nr_threads;
+	pthread_t threads[];
+};
+
+static void *__worker(void *__arg)
+{
+	workq_t *self = (workq_t *) __arg;
+
+	pthread_mutex_lock(&self->lock);
+
+	for (;;) {
+		while (list_empty(&self->jobs) && self->stop == false)
+			pthread_cond_wait(&self->work, &self->lock);
+
+		if (list_empty(&self->jobs))
+			break;
+
+		workq_job_t *job = container_of(list_remove_head(&self->jobs),
+						workq_job_t, node);
+
+		pthread_mutex_unlock(&self->lock);
+		int rc = job->func(job->arg);
+		free(job);
+		pthread_mutex_lock(&self->lock);
+
+		/* errors are per thread, hand them to the waiter */
+		err_t *err;
+		while ((err = err_get()) != NULL)
+			list_add_tail(&self->errors, &err->node);
+
+		if (rc < 0)
+			self->failed = true;
+		if (--self->pending == 0)
+			pthread_cond_broadcast(&self->idle);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+
+	return NULL;
+}
+
+workq_t *workq_create(size_t __threads)
+{
+	if (__threads == 0)
+		__threads = 1;
+
+	workq_t *self = malloc(sizeof(*self) + __threads * sizeof(pthread_t));
+	if (self == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+	memset(self, 0, sizeof(*self));
+
+	pthread_mutex_init(&self->lock, NULL);
+	pthread_cond_init(&self->work, NULL);
+	pthread_cond_init(&self->idle, NULL);
+	list_init(&self->jobs);
+	list_init(&self->errors);
+
+	for (size_t i = 0; i < __threads; i++) {
+		int rc = pthread_create(&self->threads[i], NULL, __worker,
+					self);
+		if (rc != 0) {
+			ERRNO(rc);
+			workq_delete(self);
+			return NULL;
+		}
+		self->nr_threads++;
+	}
+
+	return self;
+}
+
+int workq_add(workq_t * self, workq_func_t func, void *arg)
+{
+	assert(self != NULL);
+	assert(func != NULL);
+
+	workq_job_t *job = malloc(sizeof(*job));
+	if (job == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+	job->func = func;
+	job->arg = arg;
+
+	pthread_mutex_lock(&self->lock);
+	list_add_tail(&self->jobs, &job->node);
+	self->pending++;
+	pthread_cond_signal(&self->work);
+	pthread_mutex_unlock(&self->lock);
+
+	return 0;
+}
+
+int workq_wait(workq_t * self)
+{
+	assert(self != NULL);
+
+	pthread_mutex_lock(&self->lock);
+	while (0 < self->pending)
+		pthread_cond_wait(&self->idle, &self->lock);
+	int rc = self->failed ? -1 : 0;
+	self->failed = false;
+
+	while (list_empty(&self->errors) == false)
+		err_put(container_of(list_remove_head(&self->errors), err_t,
+				     node));
+	pthread_mutex_unlock(&self->lock);
+
+	return rc;
+}
+
+int workq_delete(workq_t * self)
+{
+	assert(self != NULL);
+
+	int rc = workq_wait(self);
+
+	pthread_mutex_lock(&self->lock);
+	self->stop = true;
+	pthread_cond_broadcast(&self->work);
+	pthread_mutex_unlock(&self->lock);
+
+	for (size_t i = 0; i < self->nr_threads; i++)
+		pthread_join(self->threads[i], NULL);
+
+	pthread_cond_destroy(&self->idle);
+	pthread_cond_destroy(&self->work);
+	pthread_mutex_destroy(&self->lock);
+
+	free(self);
+
+	return rc;
+}
@@ -0,0 +1,81 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: clib/workq.h $                                                */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*! @file workq.h
+ *  @brief Fixed size worker thread pool
+ *  @details Jobs run in the order they are added; callers that want a
+ *           particular schedule (e.g. longest job first) sort before adding.
+ *  @date 2026
+ */
+
+#ifndef __WORKQ_H__
+#define __WORKQ_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct workq workq_t;		//!< Alias for the @em workq class
+typedef int (*workq_func_t) (void *);	//!< Job function, negative on failure
+
+/*!
+ * @brief Create a work queue and start its worker threads
+ * @param __threads [in] Number of worker threads (at least one)
+ * @return Pointer to a workq object on success, NULL otherwise
+ */
+extern workq_t *workq_create(size_t __threads);
+
+/*!
+ * @brief Queue a job for execution on one of the worker threads
+ * @param __self [in] workq object @em self pointer
+ * @param __func [in] Job function
+ * @param __arg [in] Argument passed to @em __func
+ * @return 0 on success, non-0 otherwise
+ */
+extern int workq_add(workq_t * __self, workq_func_t __func, void *__arg)
+/*! @cond */
+__nonnull((1, 2)) /*! @endcond */ ;
+
+/*!
+ * @brief Wait for every queued job to complete
+ * @details Errors raised on the worker threads are moved to the calling
+ *          thread's error stack.
+ * @param __self [in] workq object @em self pointer
+ * @return 0 if all jobs succeeded, -1 if at least one job failed
+ */
+extern int workq_wait(workq_t * __self)
+/*! @cond */
+__nonnull((1)) /*! @endcond */ ;
+
+/*!
+ * @brief Wait for outstanding jobs, stop the worker threads and free the
+ *        work queue
+ * @param __self [in] workq object @em self pointer
+ * @return 0 if all jobs succeeded, -1 if at least one job failed
+ */
+extern int workq_delete(workq_t * __self)
+/*! @cond */
+__nonnull((1)) /*! @endcond */ ;
+
+#endif				/* __WORKQ_H__ */
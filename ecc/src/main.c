@@ -47,12 +47,19 @@
 #include <clib/attribute.h>
 #include <clib/misc.h>
 #include <clib/min.h>
+#include <clib/max.h>
 #include <clib/ecc.h>
 #include <clib/err.h>
+#include <clib/raii.h>
+
+#include <ffs/libffs.h>
 
 #include "main.h"
 
 #define ECC_SIZE	8
+#define ECC_CHUNK_SIZE	4096
+#define ECC_BATCH	16	// chunks per request w/o --queue-depth
+#define ECC_DEPTH_MAX	16384	// io engine staging pool (64MiB) / chunk
 
 args_t args;
 
@@ -95,6 +102,12 @@ static void usage(const char *short_name, bool verbose)
 	if (verbose)
 		fprintf(e, "\n    Specifies the output file path name.\n\n");
 
+	fprintf(e, "  -q, --queue-depth <value>\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Read and write with io_uring, keeping up to <value> 4KB requests in\n"
+			"    flight (falls back to pread/pwrite).\n\n");
+
 	fprintf(e, "  -h, --help\n");
 	if (verbose)
 		fprintf(e, "\n    Write this help text to stderr and exit\n");
@@ -132,6 +145,9 @@ static int process_argument(args_t * args, int opt, const char *optarg)
 	case o_OUTPUT:		/* offset */
 		args->file = strdup(optarg);
 		break;
+	case o_DEPTH:		/* queue-depth */
+		args->depth = strdup(optarg);
+		break;
 	case f_FORCE:		/* force */
 		args->force = (flag_t) opt;
 		break;
@@ -267,6 +283,40 @@ static int validate_args(args_t * args)
 	return 0;
 }
 
+static int open_io(args_t * args, FILE * file, ffs_io_t ** io)
+{
+	assert(args != NULL);
+	assert(file != NULL);
+
+	uint32_t depth = 0;
+
+	if (args->depth != NULL) {
+		char *end = NULL;
+
+		errno = 0;
+		unsigned long value = strtoul(args->depth, &end, 0);
+		if (errno != 0 || *end != '\0' || ECC_DEPTH_MAX < value) {
+			UNEXPECTED("invalid --queue-depth specified '%s', "
+				   "must be 0..%d", args->depth,
+				   ECC_DEPTH_MAX);
+			return -1;
+		}
+		depth = value;
+	}
+
+	*io = __ffs_io_create(fileno(file), depth, ECC_CHUNK_SIZE);
+	if (*io == NULL)
+		return -1;
+
+	if (args->verbose == f_VERBOSE && 0 < depth &&
+	    __ffs_io_depth(*io) == 0)
+		fprintf(stderr, "%s: io_uring unavailable, using "
+			"pread/pwrite\n", args->short_name);
+
+	/* chunks staged per request, as many as the engine keeps in flight */
+	return max(__ffs_io_depth(*io), (uint32_t)ECC_BATCH);
+}
+
 static int command_inject(args_t * args)
 {
 	assert(args != NULL);
@@ -282,78 +332,75 @@ static int command_inject(args_t * args)
 		return -1;
 	}
 
-	FILE *i = fopen(args->path, "r");
+	RAII(FILE*, i, fopen(args->path, "r"), fclose);
 	if (i == NULL) {
 		ERRNO(errno);
 		return-1;
 	}
 
-	FILE *o = fopen(args->file, "w");
+	RAII(FILE*, o, fopen(args->file, "w"), fclose);
 	if (o == NULL) {
 		ERRNO(errno);
 		return -1;
 	}
 
-#define INPUT_SIZE		(4096 - (4096 / ECC_SIZE))
-	char input[INPUT_SIZE];	// 4KB less 512 ECC bytes
-#undef INPUT_SIZE
-
-	size_t count = 0;
-	while (count < st.st_size) {
-		clearerr(i);
+	RAII(ffs_io_t*, in, NULL, __ffs_io_delete);
+	RAII(ffs_io_t*, out, NULL, __ffs_io_delete);
 
-		size_t rc = fread(input, 1, sizeof input, i);
-		if (rc == 0) {
-			int err = ferror(i);
-			if (err) {
-				ERRNO(errno);
-				return -1;
-			} else
-				break;
-		}
-
-		count += rc;
+	int nr = open_io(args, i, &in);
+	if (nr < 0 || open_io(args, o, &out) < 0)
+		return -1;
 
+#define INPUT_SIZE		(4096 - (4096 / ECC_SIZE))
 #define OUTPUT_SIZE		4096
-		char output[OUTPUT_SIZE];
-#undef OUTPUT_SIZE
-
-		memset(output + sizeof input, 0, sizeof output - sizeof input);
-
-		rc = (rc + 7) & ~7;	// 8-byte alignment
+	/* 'nr' chunks of 4KB less 512 ECC bytes per engine request */
+	RAII(char*, input, malloc(nr * INPUT_SIZE), free);
+	RAII(char*, output, malloc(nr * OUTPUT_SIZE), free);
+	if (input == NULL || output == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
 
-		ssize_t injected_size = 0;
-		if (args->p8 == f_P8)
-			injected_size =
-			    p8_ecc_inject(output, sizeof output, input, rc);
-		else
-			injected_size =
-			    sfc_ecc_inject(output, sizeof output, input, rc);
-		if (injected_size < 0) {
-			ERRNO(errno);
+	off_t in_off = 0, out_off = 0;
+	while (in_off < st.st_size) {
+		ssize_t rc = __ffs_io_pread(in, input, nr * INPUT_SIZE,
+					    in_off);
+		if (rc < 0)
 			return -1;
-		}
-
-		clearerr(o);
-		rc = fwrite(output, 1, injected_size, o);
-		if (rc == 0) {
-			int err = ferror(o);
-			if (err) {
+		if (rc == 0)
+			break;
+
+		in_off += rc;
+
+		size_t len = 0;
+		for (ssize_t pos = 0; pos < rc; pos += INPUT_SIZE) {
+			size_t size = min((ssize_t)INPUT_SIZE, rc - pos);
+			size_t aligned = (size + 7) & ~7;	// 8-byte alignment
+
+			memset(input + pos + size, 0, aligned - size);
+
+			ssize_t injected_size = 0;
+			if (args->p8 == f_P8)
+				injected_size = p8_ecc_inject(output + len,
+					OUTPUT_SIZE, input + pos, aligned);
+			else
+				injected_size = sfc_ecc_inject(output + len,
+					OUTPUT_SIZE, input + pos, aligned);
+			if (injected_size < 0) {
 				ERRNO(errno);
 				return -1;
 			}
+
+			len += injected_size;
 		}
-	}
 
-	if (fclose(i) == EOF) {
-		ERRNO(errno);
-		return -1;
-	}
+		if (__ffs_io_pwrite(out, output, len, out_off) < 0)
+			return -1;
 
-	if (fclose(o) == EOF) {
-		ERRNO(errno);
-		return -1;
+		out_off += len;
 	}
+#undef OUTPUT_SIZE
+#undef INPUT_SIZE
 
 	return 0;
 }
@@ -373,72 +420,71 @@ static int command_remove(args_t * args)
 		return -1;
 	}
 
-	FILE *i = fopen(args->path, "r");
+	RAII(FILE*, i, fopen(args->path, "r"), fclose);
 	if (i == NULL) {
 		ERRNO(errno);
 		return -1;
 	}
 
-	FILE *o = fopen(args->file, "w");
+	RAII(FILE*, o, fopen(args->file, "w"), fclose);
 	if (o == NULL) {
 		ERRNO(errno);
 		return -1;
 	}
 
-#define INPUT_SIZE		4086
-	char input[INPUT_SIZE];	// multiple of 9-bytes
-#undef INPUT_SIZE
-
-	size_t count = 0;
-	while (count < st.st_size) {
-		clearerr(i);
-
-		size_t rc = fread(input, 1, sizeof input, i);
-		if (rc == 0) {
-			int err = ferror(i);
-			if (err) {
-				ERRNO(errno);
-				return -1;
-			} else
-				break;
-		}
+	RAII(ffs_io_t*, in, NULL, __ffs_io_delete);
+	RAII(ffs_io_t*, out, NULL, __ffs_io_delete);
 
-		count += rc;
+	int nr = open_io(args, i, &in);
+	if (nr < 0 || open_io(args, o, &out) < 0)
+		return -1;
 
-    char output[(((sizeof input)/(ECC_SIZE+1))*ECC_SIZE) ];
+#define INPUT_SIZE		4086	// multiple of 9-bytes
+#define OUTPUT_SIZE		((INPUT_SIZE / (ECC_SIZE + 1)) * ECC_SIZE)
+	RAII(char*, input, malloc(nr * INPUT_SIZE), free);
+	RAII(char*, output, malloc(nr * OUTPUT_SIZE), free);
+	if (input == NULL || output == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
 
-		ssize_t removed_size;
-		if (args->p8 == f_P8)
-			removed_size =
-			    p8_ecc_remove_size(output, sizeof output, input, rc);
-		else
-			removed_size =
-			    sfc_ecc_remove(output, sizeof output, input, rc);
-		if (removed_size < 0) {
-			ERRNO(errno);
+	off_t in_off = 0, out_off = 0;
+	while (in_off < st.st_size) {
+		ssize_t rc = __ffs_io_pread(in, input, nr * INPUT_SIZE,
+					    in_off);
+		if (rc < 0)
 			return -1;
-		}
-
-		clearerr(o);
-		rc = fwrite(output, 1, removed_size, o);
-		if (rc == 0) {
-			int err = ferror(o);
-			if (err) {
+		if (rc == 0)
+			break;
+
+		in_off += rc;
+
+		size_t len = 0;
+		for (ssize_t pos = 0; pos < rc; pos += INPUT_SIZE) {
+			size_t size = min((ssize_t)INPUT_SIZE, rc - pos);
+
+			ssize_t removed_size;
+			if (args->p8 == f_P8)
+				removed_size = p8_ecc_remove_size(output + len,
+					OUTPUT_SIZE, input + pos, size);
+			else
+				removed_size = sfc_ecc_remove(output + len,
+					OUTPUT_SIZE, input + pos, size);
+			if (removed_size < 0) {
 				ERRNO(errno);
 				return -1;
 			}
+
+			len += removed_size;
 		}
-	}
 
-	if (fclose(i) == EOF) {
-		ERRNO(errno);
-		return -1;
-	}
+		if (__ffs_io_pwrite(out, output, len, out_off) < 0)
+			return -1;
 
-	if (fclose(o) == EOF) {
-		ERRNO(errno);
-		return -1;
+		out_off += len;
 	}
+#undef OUTPUT_SIZE
+#undef INPUT_SIZE
 
 	return 0;
 }
@@ -522,22 +568,24 @@ static int process_args(args_t * args)
 {
 	assert(args != NULL);
 
+	int rc = 0;
+
 	switch (args->cmd) {
 	case c_INJECT:
-		command_inject(args);
+		rc = command_inject(args);
 		break;
 	case c_REMOVE:
-		command_remove(args);
+		rc = command_remove(args);
 		break;
 	case c_HEXDUMP:
-		command_hexdump(args);
+		rc = command_hexdump(args);
 		break;
 	default:
 		UNEXPECTED("NOT IMPLEMENTED YET => '%c'", args->cmd);
 		return -1;
 	}
 
-	return 0;
+	return rc;
 }
 
 static void args_dump(args_t * args)
@@ -548,6 +596,7 @@ static void args_dump(args_t * args)
 	printf("path[%s]\n", args->path);
 	printf("cmd[%d]\n", args->cmd);
 	printf("output[%s]\n", args->file);
+	printf("depth[%s]\n", args->depth);
 	printf("force[%d]\n", args->force);
 	printf("p8[%d]\n", args->p8);
 	printf("verbose[%d]\n", args->force);
@@ -562,6 +611,7 @@ int main(int argc, char *argv[])
 		{"hexdump", required_argument, NULL, c_HEXDUMP},
 		/* options */
 		{"output", required_argument, NULL, o_OUTPUT},
+		{"queue-depth", required_argument, NULL, o_DEPTH},
 		/* flags */
 		{"force", no_argument, NULL, f_FORCE},
 		{"p8", no_argument, NULL, f_P8},
@@ -570,7 +620,7 @@ int main(int argc, char *argv[])
 		{0, 0, 0, 0}
 	};
 
-	static const char *short_opts = "I:R:H:o:fpvh";
+	static const char *short_opts = "I:R:H:o:q:fpvh";
 
 	int rc = EXIT_FAILURE;
 
@@ -45,6 +45,7 @@ typedef enum {
 typedef enum {
     o_ERROR = 0,
     o_OUTPUT = 'o',
+    o_DEPTH = 'q',
 } option_t;
 
 typedef enum {
@@ -66,6 +67,7 @@ typedef struct {
 
     /* options */
     const char * file;
+    const char * depth;
 
     /* flags */
     flag_t force, p8, verbose;
@@ -33,13 +33,13 @@
 
 CP=cp
 RM=rm
-FFS=ffs
+FPART=fpart
 FCP=fcp
 MKDIR=mkdir
 GREP=grep
 HEAD=head
-HEX=hexdump
-CRC=crc32
+HEX="od -An -tx1 -v"
+CRC=cksum
 DD=dd
 DIFF=diff
 CAT=cat
@@ -51,6 +51,7 @@ COPY=copy.nor
 TMP=/tmp/fcp.$$
 URANDOM=/dev/urandom
 POFFSET="0x00000,0x10000"
+WORD=8		# user word, 0..2 are maintained by fcp
 
 FAIL=1
 PASS=0
@@ -95,9 +96,14 @@ function size()
 	fi
 }
 
+function checksum()
+{
+	${CRC} < ${1} | cut -f 1 -d ' '
+}
+
 function crc()
 {
-	local crc=$(${CRC} ${2})
+	local crc=$(checksum ${2})
 	if [[ ${1} == ${crc} ]]; then
 		echo "[PASSED] crc: '${2}' ===> expect=${1}, actual=${crc}"
 	else
@@ -115,15 +121,15 @@ function setup()
 	pass ${MKDIR} -p ${TMP}
 	pass ${RM} -f ${target}
 
-	pass ${FFS} -t ${target} -s 64M -b 64K -p 0x3F0000 -C
-	pass ${FFS} -t ${target} -s 64M -b 64K -p 0x7F0000 -C
+	pass ${FPART} -t ${target} -s 64M -b 64K -p 0x3F0000 -C
+	pass ${FPART} -t ${target} -s 64M -b 64K -p 0x7F0000 -C
 
 	for ((j=0; j<2; j++)); do
 		local name="logical${j}"
 		local base=$((${j}*$MB*4))
 
-		pass ${FFS} -t ${target} -n ${name} -g 0 -l -A
-		pass ${FFS} -t ${target} -n ${name} -L > ${output}
+		pass ${FPART} -t ${target} -n ${name} -g 0 -l -A
+		pass ${FPART} -t ${target} -n ${name} -L > ${output}
 
 		pass ${GREP} ${name} ${output} > /dev/null
 		pass ${GREP} "l-----" ${output} > /dev/null
@@ -138,10 +144,10 @@ function setup()
 				local size=$MB
 			fi
 
-			pass ${FFS} -t ${target} -o ${offset} -s ${size} \
+			pass ${FPART} -t ${target} -o ${offset} -s ${size} \
 			     -g 0 -n ${full} -a ${i} -A
 
-			pass ${FFS} -t ${target} -n ${full} -L > ${output}
+			pass ${FPART} -t ${target} -n ${full} -L > ${output}
 			pass ${GREP} ${full} ${output} > /dev/null
 			pass ${GREP} "d-----" ${output} > /dev/null
 
@@ -172,10 +178,10 @@ function erase()
 
 		pass ${FCP} ${target}:${full} -E ${i}
 		pass ${FCP} -T ${target}:${full}
-		pass ${FCP} -R ${target}:${full} - | ${HEX} -C > ${output}
+		pass ${FCP} -R ${target}:${full} - | ${HEX} > ${output}
 
 		local p=$(printf "%2.2x %2.2x %2.2x %2.2x" $i $i $i $i)
-		pass ${GREP} \"${p} ${p}\" ${output}
+		pass ${GREP} \"${p} ${p}\" ${output} > /dev/null
 
 		pass ${RM} -f ${output}
 	done
@@ -212,22 +218,21 @@ function write()
 			pass ${DD} if=${URANDOM} of=${input} bs=${block} \
 			     count=${c} 2> /dev/null
 
-			pass ${CRC} ${input} > ${output}
-			local crc=$(${CAT} ${output})
+			local crc=$(checksum ${input})
 			local full=${name}0/entry${i}
 
 			pass ${FCP} ${target}:${full} -E 0x00
 			pass ${FCP} -W ${input} ${target}:${full}
-			pass ${FCP} ${target}:${full} -U 0=${crc}
+			pass ${FCP} ${target}:${full} -U ${WORD}=${crc}
 			pass ${FCP} ${target}:${full} -R - -f | cat > ${output}
 
 			size $((${c}*${block})) ${output}
 			crc  ${crc} ${output}
 
 			local crc=$(printf "%x" ${crc})
-			pass "${FCP} ${target}:${full} -o 0x3F0000 -U 0 | \
+			pass "${FCP} ${target}:${full} -o 0x3F0000 -U ${WORD} | \
 			     ${GREP} ${crc}" > /dev/null
-			pass "${FCP} ${target}:${full} -o 0x7F0000 -U 0 | \
+			pass "${FCP} ${target}:${full} -o 0x7F0000 -U ${WORD} | \
 			     ${GREP} ${crc}" > /dev/null
 
 			pass ${RM} -f ${input} ${output}
@@ -262,14 +267,14 @@ function copy()
 
 		for ((c=1; c<=${count}; c++)); do
 			pass ${DD} if=${URANDOM} of=${input} bs=${block} count=${c} 2> /dev/null
-			local crc=$(${CRC} ${input})
+			local crc=$(checksum ${input})
 
 			local name="logical0/entry${i}"
 
 			pass ${FCP} ${src}:${name} -E 0x00
 			pass ${FCP} ${input} ${src}:${name} -W
 			pass ${FCP} ${src}:${name} ${output}.src -f -R
-			pass ${FCP} ${src}:${name} -U 0 0=${crc}
+			pass ${FCP} ${src}:${name} -U ${WORD} ${WORD}=${crc}
 
 			pass ${FCP} ${src}:${name} ${dst}:${name} -C -v -f
 			pass ${FCP} ${src}:${name} ${dst}:${name} -M -v
@@ -282,9 +287,9 @@ function copy()
 			pass ${DIFF} ${output}.src ${output}.dst
 
 			local crc=$(printf "%x" ${crc})
-			pass "${FCP} ${dst}:${name} -o 0x3F0000 -U 0 | \
+			pass "${FCP} ${dst}:${name} -o 0x3F0000 -U ${WORD} | \
 				${GREP} ${crc}" > /dev/null
-			pass "${FCP} ${dst}:${name} -o 0x7F0000 -U 0 | \
+			pass "${FCP} ${dst}:${name} -o 0x7F0000 -U ${WORD} | \
 				${GREP} ${crc}" > /dev/null
 
 			pass ${RM} -f ${input}* ${output}*
@@ -294,7 +299,476 @@ function copy()
 	pass ${FCP} ${src}":logical0" ${src}":logical1" -C -v # logical mirror
 	pass ${FCP} ${src}":logical1" ${dst}":logical1" -C -v # logical copy
 
-	expect 2 ${DIFF} ${src} ${dst}
+	fail ${DIFF} ${src} ${dst} > /dev/null
+}
+
+function queue()
+{
+	local target=${TMP}/${TARGET}
+	local name="logical0/entry0"
+
+	local input=${TMP}/queue.in
+	local output=${TMP}/queue.out
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=1000 2> /dev/null
+
+	for depth in 0 1 64; do
+		pass ${FCP} ${target}:${name} -E 0xff -q ${depth}
+		pass ${FCP} ${input} ${target}:${name} -W -q ${depth}
+		pass ${FCP} ${target}:${name} ${output} -R -f -q ${depth}
+		pass ${DIFF} ${input} ${output}
+		pass ${RM} -f ${output}
+	done
+
+	fail ${FCP} ${target}:${name} ${output} -R -f -q bogus
+
+	pass ${RM} -f ${input}
+}
+
+function backup()
+{
+	local target=${TMP}/${TARGET}
+	local copy=${TMP}/${COPY}
+	local offset="0x3F0000,0x7F0000"
+
+	local input=${TMP}/backup.in
+
+	# both tables list the partitions, each one must record the CRC
+	for ((i=0; i<4; i++)); do
+		local name="logical1/entry${i}"
+
+		pass ${DD} if=${URANDOM} of=${input} bs=${KB} \
+		     count=$((100+${i})) 2> /dev/null
+		pass ${FCP} -o ${offset} ${input} ${target}:${name} -W
+	done
+	pass ${FPART} -t ${target} -p ${offset} --verify
+	pass ${FCP} -o ${offset} ${target} -V
+
+	pass ${FCP} -o ${offset} ${target}:logical1/entry0 -E 0xff
+	pass ${FPART} -t ${target} -p ${offset} --verify
+
+	pass ${CP} ${target} ${copy}
+	pass ${FCP} -o ${offset} ${target}:logical0/entry0 -E 0x00
+	pass ${FCP} -o ${offset} ${target} ${copy} -C -j 2
+	pass ${FPART} -t ${copy} -p ${offset} --verify
+	pass ${FCP} -o ${offset} ${copy} -V
+
+	pass ${RM} -f ${input} ${copy}
+}
+
+function jobs()
+{
+	local src=${TMP}/${TARGET}
+	local dst=${TMP}/${COPY}
+	local offset="0x3F0000,0x7F0000"
+
+	local input=${TMP}/jobs.in
+
+	pass ${CP} ${src} ${dst}
+
+	for ((i=0; i<4; i++)); do
+		pass ${DD} if=${URANDOM} of=${input} bs=${KB} \
+		     count=$((200+${i}*10)) 2> /dev/null
+		pass ${FCP} -o ${offset} ${input} ${src}:logical0/entry${i} -W
+	done
+
+	for j in 0 1 2 4; do
+		pass ${FCP} -o ${offset} ${dst}:logical0 -E 0xff
+		pass ${FCP} -o ${offset} ${src}:logical0 ${dst}:logical0 \
+		     -C -j ${j}
+		pass ${FCP} -o ${offset} ${src}:logical0 ${dst}:logical0 \
+		     -M -j ${j}
+	done
+
+	pass ${FCP} -o ${offset} ${dst}:logical0/entry2 -E 0x00
+	fail ${FCP} -o ${offset} ${src}:logical0 ${dst}:logical0 \
+	     -M -j 2 > /dev/null
+
+	pass ${RM} -f ${input} ${dst}
+}
+
+function blocks()
+{
+	stat -c %b ${1}
+}
+
+function sparse()
+{
+	local target=${TMP}/sparse.nor
+	local offset=0x3F0000
+	local name=data
+
+	local input=${TMP}/sparse.in
+	local output=${TMP}/sparse.out
+	local erased=${TMP}/sparse.ff
+
+	pass ${FPART} -t ${target} -s 64M -b 64K -p ${offset} -C -z
+	pass "[[ $(blocks ${target}) -lt 1024 ]]"
+	pass ${FPART} -t ${target} -p ${offset} -o 1M -s 1M -g 0 -n ${name} -A
+
+	pass "tr '\\000' '\\377' < /dev/zero | ${HEAD} -c ${MB} > ${erased}"
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=256 2> /dev/null
+
+	pass ${FCP} -o ${offset} -z ${input} ${target}:${name} -W
+	pass ${FCP} -o ${offset} -z ${target}:${name} ${output} -R -f
+	pass ${DIFF} ${input} ${output}
+
+	# erasing deallocates, the holes read back as 0xFF
+	local written=$(blocks ${target})
+	pass ${FCP} -o ${offset} -z ${target}:${name} -E 0xff
+	pass "[[ $(blocks ${target}) -lt ${written} ]]"
+
+	pass ${FCP} -o ${offset} ${target}:${name} -T ${MB}
+	pass ${FCP} -o ${offset} -z ${target}:${name} ${output} -R -f
+	pass ${DIFF} ${erased} ${output} > /dev/null
+	pass ${FCP} -o ${offset} ${target}:${name} ${output} -R -f
+	fail ${DIFF} ${erased} ${output} > /dev/null
+
+	pass ${RM} -f ${target} ${input} ${output} ${erased}
+}
+
+function diffwrite()
+{
+	local target=${TMP}/${TARGET}
+	local offset=0x3F0000
+	local name="logical1/entry2"
+
+	local input=${TMP}/diffwrite.in
+	local output=${TMP}/diffwrite.out
+	local log=${TMP}/diffwrite.log
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=512 2> /dev/null
+	pass ${FCP} -o ${offset} ${target}:${name} -E 0xff
+
+	pass "${FCP} -o ${offset} ${input} ${target}:${name} -W -w 2> ${log}"
+	pass ${GREP} \"80000 written, 0 skipped\" ${log} > /dev/null
+
+	# unchanged, nothing is written
+	pass "${FCP} -o ${offset} ${input} ${target}:${name} -W -w 2> ${log}"
+	pass ${GREP} \"0 written, 80000 skipped\" ${log} > /dev/null
+
+	# a single erase block differs
+	pass "printf xxxx | ${DD} of=${input} bs=1 seek=200000 conv=notrunc \
+	     2> /dev/null"
+	pass "${FCP} -o ${offset} ${input} ${target}:${name} -W -w 2> ${log}"
+	pass ${GREP} \"10000 written, 70000 skipped\" ${log} > /dev/null
+
+	pass ${FCP} -o ${offset} ${target}:${name} ${output} -R -f
+	pass ${DIFF} ${input} ${output}
+
+	pass ${RM} -f ${input} ${output} ${log}
+}
+
+function blank()
+{
+	local target=${TMP}/blank.nor
+	local offset=0x3F0000
+	local name=data
+
+	local output=${TMP}/blank.out
+	local erased=${TMP}/blank.ff
+
+	pass ${FPART} -t ${target} -s 64M -b 64K -p ${offset} -C -z
+	pass ${FPART} -t ${target} -p ${offset} -o 1M -s 1M -g 0 -n ${name} -A
+
+	# the holes already read as 0x00, erasing must not allocate them
+	local before=$(blocks ${target})
+	pass ${FCP} -o ${offset} ${target}:${name} -E 0x00
+	pass "[[ $(blocks ${target}) -eq ${before} ]]"
+
+	pass ${FCP} -o ${offset} ${target}:${name} -E 0xff
+	pass "[[ ${before} -lt $(blocks ${target}) ]]"
+	pass ${FCP} -o ${offset} ${target}:${name} -E 0xff
+
+	pass "tr '\\000' '\\377' < /dev/zero | ${HEAD} -c ${MB} > ${erased}"
+	pass ${FCP} -o ${offset} ${target}:${name} -T ${MB}
+	pass ${FCP} -o ${offset} ${target}:${name} ${output} -R -f
+	pass ${DIFF} ${erased} ${output} > /dev/null
+
+	# a zero fill over holes of a sparse image must read back as 0x00,
+	# not as the 0xFF the holes stand for
+	local zeros=${TMP}/blank.00
+	pass "${HEAD} -c ${MB} /dev/zero > ${zeros}"
+	pass ${FCP} -o ${offset} -z ${target}:${name} -E 0xff
+	pass ${FCP} -o ${offset} -z ${target}:${name} -E 0x00
+	pass ${FCP} -o ${offset} ${target}:${name} -T ${MB}
+	pass ${RM} -f ${output}
+	pass ${FCP} -o ${offset} -z ${target}:${name} ${output} -R -f
+	pass ${DIFF} ${zeros} ${output} > /dev/null
+	pass ${FCP} -o ${offset} ${target}:${name} ${output} -R -f
+	pass ${DIFF} ${zeros} ${output} > /dev/null
+
+	pass ${RM} -f ${target} ${output} ${erased} ${zeros}
+}
+
+function ranges()
+{
+	local src=${TMP}/${TARGET}
+	local dst=${TMP}/${COPY}
+	local offset=0x3F0000
+	local name="logical1/entry1"
+
+	local input=${TMP}/ranges.in
+	local log=${TMP}/ranges.log
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=512 2> /dev/null
+	pass ${FCP} -o ${offset} ${input} ${src}:${name} -W
+	pass ${CP} ${src} ${dst}
+	pass ${FCP} -o ${offset} ${src}:${name} ${dst}:${name} -M
+
+	# three ranges, far enough apart not to be coalesced
+	local base=$((5*${MB}))
+	for o in 100000 300000 500000; do
+		pass "printf xxxx | ${DD} of=${dst} bs=1 seek=$((${base}+${o})) \
+		     conv=notrunc 2> /dev/null"
+	done
+
+	fail "${FCP} -o ${offset} ${src}:${name} ${dst}:${name} -M > ${log} \
+	     2> /dev/null"
+	pass "[[ $(${GREP} -c 'miscompare offset' ${log}) -eq 3 ]]"
+	pass ${GREP} \"c bytes differ in 3 blocks, 3 ranges\" ${log} > /dev/null
+
+	fail "${FCP} -o ${offset} ${src}:${name} ${dst}:${name} -M -r 1 \
+	     > ${log} 2> /dev/null"
+	pass "[[ $(${GREP} -c 'miscompare offset' ${log}) -eq 1 ]]"
+	pass ${GREP} \"limit reached\" ${log} > /dev/null
+	pass ${GREP} \"3 ranges\" ${log} > /dev/null
+
+	pass ${RM} -f ${input} ${log} ${dst}
+}
+
+function journal()
+{
+	local target=${TMP}/${TARGET}
+	local offset=0x3F0000
+	local name="logical1/entry3"
+
+	local input=${TMP}/journal.in
+	local output=${TMP}/journal.out
+	local jnl=${TMP}/journal.jnl
+	local log=${TMP}/journal.log
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=512 2> /dev/null
+	pass ${FCP} -o ${offset} ${target}:${name} -T 0
+
+	pass ${FCP} -o ${offset} ${input} ${target}:${name} -W -k ${jnl}
+	pass ${GREP} ${name} ${jnl} > /dev/null
+
+	# rerun, the ranges already written are skipped
+	pass "${FCP} -o ${offset} ${input} ${target}:${name} -W -k ${jnl} \
+	     2> ${log}"
+	pass ${GREP} \"journal write 0 written, 80000 skipped\" ${log} > /dev/null
+
+	# unless their source data changed
+	pass "printf xxxx | ${DD} of=${input} bs=1 seek=200000 conv=notrunc \
+	     2> /dev/null"
+	pass "${FCP} -o ${offset} ${input} ${target}:${name} -W -k ${jnl} \
+	     2> ${log}"
+	fail ${GREP} skipped ${log} > /dev/null
+
+	pass ${FCP} -o ${offset} ${target}:${name} ${output} -R -f
+	pass ${DIFF} ${input} ${output}
+
+	pass ${RM} -f ${input} ${output} ${jnl} ${log}
+}
+
+function verify()
+{
+	local target=${TMP}/${TARGET}
+	local offset="0x3F0000,0x7F0000"
+	local name="logical1/entry1"
+	local base=$((5*${MB}))
+
+	local input=${TMP}/verify.in
+	local log=${TMP}/verify.log
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=300 2> /dev/null
+	pass ${FCP} -o ${offset} ${target}:${name} -T 0
+	pass ${FCP} -o ${offset} ${input} ${target}:${name} -W
+	pass ${FCP} -o ${offset} ${target}:${name} -V
+
+	# corrupt the data behind fcp's back
+	pass "printf xxxx | ${DD} of=${target} bs=1 seek=$((${base}+70000)) \
+	     conv=notrunc 2> /dev/null"
+	fail "${FCP} -o ${offset} ${target}:${name} -V > ${log} 2>&1"
+	pass ${GREP} \"crc .*, expected\" ${log} > /dev/null
+
+	# rewriting it records a fresh CRC
+	pass ${FCP} -o ${offset} ${input} ${target}:${name} -W
+	pass ${FCP} -o ${offset} ${target}:${name} -V
+
+	pass ${RM} -f ${input} ${log}
+}
+
+function manifest()
+{
+	local target=${TMP}/${TARGET}
+	local offset="0x3F0000,0x7F0000"
+	local name="logical0/entry2"
+	local base=$((2*${MB}))
+
+	local input=${TMP}/manifest.in
+	local old=${TMP}/manifest.old
+	local new=${TMP}/manifest.new
+	local log=${TMP}/manifest.log
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=400 2> /dev/null
+	pass ${FCP} -o ${offset} ${input} ${target}:${name} -W
+
+	pass ${FCP} -o ${offset} ${target} ${old} -H
+	pass ${FCP} -o ${offset} ${target} -V -m ${old}
+	pass ${FCP} ${old} ${old} -V
+
+	# change one erase block behind fcp's back
+	pass "printf xxxx | ${DD} of=${target} bs=1 seek=$((${base}+200000)) \
+	     conv=notrunc 2> /dev/null"
+	fail "${FCP} -o ${offset} ${target} -V -m ${old} > ${log} 2>&1"
+	pass ${GREP} \"${name}: blocks 3..3 differ\" ${log} > /dev/null
+
+	pass ${FCP} -o ${offset} ${target} ${new} -H
+	fail "${FCP} ${old} ${new} -V > ${log} 2>&1"
+	pass ${GREP} \"${name}: blocks 3..3 differ\" ${log} > /dev/null
+
+	pass ${RM} -f ${input} ${old} ${new} ${log}
+}
+
+function patch()
+{
+	local target=${TMP}/${TARGET}
+	local copy=${TMP}/${COPY}
+	local offset="0x3F0000,0x7F0000"
+
+	local input=${TMP}/patch.in
+	local old=${TMP}/patch.old
+	local diff=${TMP}/patch.diff
+	local log=${TMP}/patch.log
+
+	pass ${CP} ${target} ${old}
+
+	# new data, plus a block moved from elsewhere in the old image
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=150 2> /dev/null
+	pass ${FCP} -o ${offset} ${input} ${target}:logical1/entry2 -W
+	pass ${FCP} -o ${offset} ${target}:logical0/entry2 \
+	     ${target}:logical1/entry0 -C
+
+	pass "${FCP} -o ${offset} ${old} ${target} -D > ${diff}"
+	pass ${CP} ${old} ${copy}
+	pass ${FCP} ${diff} ${copy} -A
+	pass ${DIFF} ${target} ${copy}
+
+	# applying it again rewrites nothing
+	pass "${FCP} ${diff} ${copy} -A -v > ${log} 2>&1"
+	pass "[[ $(${GREP} -c 'apply 0 written' ${log}) -eq 2 ]]"
+	pass ${DIFF} ${target} ${copy}
+
+	pass ${RM} -f ${input} ${old} ${diff} ${log} ${copy}
+}
+
+function compress()
+{
+	local target=${TMP}/${TARGET}
+	local offset="0x3F0000,0x7F0000"
+	local name="logical0/entry1"
+
+	local input=${TMP}/compress.in
+	local output=${TMP}/compress.out
+	local image=${TMP}/compress.z
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=200 2> /dev/null
+	pass ${FCP} -o ${offset} ${target}:${name} -T 0
+	pass ${FCP} -o ${offset} ${input} ${target}:${name} -W
+
+	pass ${FCP} -o ${offset} ${target} ${image} -Z
+	pass "[[ $(stat -L -c %s ${image}) -lt $(stat -L -c %s ${target}) ]]"
+
+	# any command that reads an image reads the container
+	pass ${FCP} -o ${offset} ${image}:${name} ${output} -R -f
+	pass ${DIFF} ${input} ${output}
+	pass ${FCP} -o ${offset} ${image} ${target} -M
+	pass ${FCP} -o ${offset} ${image}:${name} -V
+	pass "${FPART} -t ${target} -p ${offset} -L > ${output}.src"
+	pass "${FPART} -t ${image} -p ${offset} -L > ${output}.dst"
+	pass ${DIFF} ${output}.src ${output}.dst
+
+	# but nothing writes it
+	local crc=$(checksum ${image})
+	fail "${FCP} -o ${offset} ${input} ${image}:${name} -W 2> /dev/null"
+	fail "${FCP} -o ${offset} ${image}:${name} -E 0xff 2> /dev/null"
+	crc ${crc} ${image}
+
+	pass ${RM} -f ${input} ${output}* ${image}
+}
+
+function nested()
+{
+	local image=${TMP}/nested.nor
+	local copy=${TMP}/nested.copy
+	local offset=0x7F0000
+	local inner=0x400000
+
+	local input=${TMP}/nested.in
+	local output=${TMP}/nested.out
+
+	pass ${FPART} -t ${image} -s 8M -b 64K -p ${offset} -C
+	pass ${FPART} -t ${image} -p ${offset} -o ${inner} -s ${MB} -g 0 \
+	     -n sub -A
+	pass ${FPART} -t ${image} -p ${offset} -o 0 -s ${MB} -g 0 -n outer -A
+	pass ${FPART} -t ${image} -s 8M -b 64K -p ${inner} -C
+	pass ${FPART} -t ${image} -p ${inner} -o $((${inner}+64*${KB})) \
+	     -s $((128*${KB})) -g 0 -n inner -A
+
+	# fpart only adds data and logical entries, so retype 'sub' (the
+	# second entry) in place; the entry checksum is the XOR of its words
+	local entry=$((${offset}+0x30+128))
+	local csum=$(${HEX} -j $((${entry}+127)) -N 1 ${image})
+	pass "printf '\\x03' | ${DD} of=${image} bs=1 seek=$((${entry}+35)) \
+	     conv=notrunc 2> /dev/null"
+	pass "printf '\\x$(printf %.2x $((0x${csum// /} ^ 0x02)))' | \
+	     ${DD} of=${image} bs=1 seek=$((${entry}+127)) conv=notrunc \
+	     2> /dev/null"
+
+	pass "${FCP} -o ${offset} ${image} -L > ${output}"
+	pass ${GREP} \"p-----\] sub\" ${output} > /dev/null
+	pass ${GREP} \"PARTITION TABLE 0x400000\" ${output} > /dev/null
+	pass ${GREP} \"\] inner\" ${output} > /dev/null
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=100 2> /dev/null
+	pass ${FCP} -o ${inner} ${input} ${image}:inner -W
+	pass ${FCP} -o ${offset} ${input} ${image}:outer -W
+
+	# one copy of the outer table brings the nested one along
+	pass ${TRUNC} -s 8M ${copy}
+	pass ${FCP} -o ${offset} ${image} ${copy} -C -f
+	pass ${FCP} -o ${inner} ${copy}:inner ${output} -R -f
+	pass ${DIFF} ${input} ${output}
+	pass ${FCP} -o ${offset} ${image} ${copy} -M
+
+	pass ${FCP} -o ${inner} ${copy}:inner -E 0x00
+	fail "${FCP} -o ${offset} ${image} ${copy} -M > ${output} 2>&1"
+	pass ${GREP} \"400000: inner: miscompare\" ${output} > /dev/null
+
+	pass ${RM} -f ${image} ${copy} ${input} ${output}
+}
+
+function short()
+{
+	local target=${TMP}/short.nor
+	local name=data
+
+	local output=${TMP}/short.out
+	local log=${TMP}/short.log
+
+	pass ${FPART} -t ${target} -s 8M -b 64K -p 0 -C
+	pass ${FPART} -t ${target} -p 0 -o 1M -s 1M -g 0 -n ${name} -A
+	pass ${FCP} -o 0 ${target}:${name} -T ${MB}
+
+	# the image ends half way through the partition
+	pass ${TRUNC} -s $((${MB}+512*${KB})) ${target}
+	fail "timeout 60 ${FCP} -o 0 ${target}:${name} ${output} -R -f \
+	     2> ${log}"
+	pass ${GREP} \"short read\" ${log} > /dev/null
+
+	pass ${RM} -f ${target} ${output} ${log}
 }
 
 function main()
@@ -304,6 +778,20 @@ function main()
 	write $((64*$KB))
 	copy $((21*$KB))
 	copy $((64*$KB))
+	queue
+	backup
+	jobs
+	sparse
+	diffwrite
+	blank
+	ranges
+	journal
+	verify
+	manifest
+	patch
+	compress
+	nested
+	short
 }
 
 setup
@@ -314,6 +802,20 @@ else
 		erase	) erase 				;;
 		write	) write 				;;
 		copy	) copy	 				;;
+		queue	) queue					;;
+		backup	) backup				;;
+		jobs	) jobs					;;
+		sparse	) sparse				;;
+		diffwrite ) diffwrite				;;
+		blank	) blank					;;
+		ranges	) ranges				;;
+		journal	) journal				;;
+		verify	) verify				;;
+		manifest) manifest				;;
+		patch	) patch					;;
+		compress) compress				;;
+		nested	) nested				;;
+		short	) short					;;
 		*	) echo "$1 not implemented"; exit 1	;;
 	esac
 	exit 0;
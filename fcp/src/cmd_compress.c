@@ -0,0 +1,163 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fcp/src/cmd_compress.c $                                      */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_compress.c
+ *  Author:
+ *   Descr: compress implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <clib/attribute.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/max.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#include "misc.h"
+#include "main.h"
+
+/*
+ * Partition boundaries of every table, so that no frame of the container
+ * spans two partitions and each partition decompresses on its own.
+ */
+typedef struct cut_list cut_list_t;
+struct cut_list {
+	FILE * file;
+	off_t * cut;
+	size_t nr, sz;
+	uint32_t frame_size;
+};
+
+static int __cut_add(cut_list_t * list, off_t offset)
+{
+	if (list->nr == list->sz) {
+		size_t sz = list->sz ? list->sz * 2 : 64;
+		off_t * tmp = realloc(list->cut, sz * sizeof(*tmp));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			return -1;
+		}
+		list->cut = tmp, list->sz = sz;
+	}
+
+	list->cut[list->nr++] = offset;
+
+	return 0;
+}
+
+static int __cuts(args_t * args, off_t offset, void * ctx)
+{
+	cut_list_t * list = (cut_list_t *)ctx;
+
+	RAII(ffs_t*, ffs, __ffs_fopen(list->file, offset), __ffs_fclose);
+	if (ffs == NULL)
+		return -1;
+
+	uint32_t block_size = ffs->hdr->block_size;
+
+	/* a frame per erase block at least */
+	list->frame_size = min(max(list->frame_size, block_size),
+			       (uint32_t)FFS_ZIMAGE_FRAME_MAX);
+
+	ffs_entry_t * entries = NULL;
+	int nr = __ffs_entry_list(ffs, &entries);
+	if (nr < 0)
+		return -1;
+
+	int rc = 0;
+
+	for (int i = 0; i < nr && rc == 0; i++) {
+		ffs_entry_t * entry = entries + i;
+
+		if (entry->type == FFS_TYPE_LOGICAL)
+			continue;
+
+		off_t base = (off_t)entry->base * block_size;
+		off_t size = (off_t)entry->size * block_size;
+
+		rc = __cut_add(list, base);
+		if (rc == 0)
+			rc = __cut_add(list, base + size);
+	}
+
+	free(entries);
+
+	if (rc == 0 && args->verbose == f_VERBOSE)
+		printf("%8llx: %d partition(s)\n", (long long)offset, nr);
+
+	return rc;
+}
+
+int command_compress(args_t * args)
+{
+	assert(args != NULL);
+
+	RAII(FILE*, in, __fopen(args->src_type, args->src_target, "r",
+				debug), fclose);
+	if (in == NULL)
+		return -1;
+
+	RAII(FILE*, out, __fopen(args->dst_type, args->dst_target, "w",
+				 debug), fclose);
+	if (out == NULL)
+		return -1;
+
+	cut_list_t list = {
+		.file = in,
+		.frame_size = FFS_ZIMAGE_FRAME,
+	};
+
+	int rc = for_each_offset(args, __cuts, &list);
+
+	if (rc == 0)
+		rc = __ffs_zimage_create(in, out, list.frame_size, list.cut,
+					 list.nr);
+
+	free(list.cut);
+
+	if (rc == 0 && args->verbose == f_VERBOSE) {
+		struct stat src, dst;
+		if (fstat(fileno(in), &src) == 0 &&
+		    fstat(fileno(out), &dst) == 0)
+			printf("%s: %llx bytes compressed to %llx bytes, "
+			       "frame size '%x'\n", args->dst_target,
+			       (long long)src.st_size, (long long)dst.st_size,
+			       list.frame_size);
+	}
+
+	return rc;
+}
@@ -52,6 +52,7 @@
 #include <clib/min.h>
 #include <clib/err.h>
 #include <clib/raii.h>
+#include <clib/workq.h>
 
 #include "misc.h"
 #include "main.h"
@@ -100,7 +101,9 @@ static int validate_files(ffs_t * src, ffs_t * dst)
 		return -1;
 	if (__ffs_info(dst, FFS_INFO_VERSION, &d) < 0)
 		return -1;
-	if (s != d) {
+	/* version 2 only widens 'actual', the destination is upgraded when
+	 * a partition needs it */
+	if (s != d && (FFS_VERSION_2 < s || FFS_VERSION_2 < d)) {
 		UNEXPECTED("source '%s' and destination '%s' version "
 			   "differs, use --force to overwrite\n",
 			   src->path, dst->path);
@@ -110,10 +113,460 @@ static int validate_files(ffs_t * src, ffs_t * dst)
 	return 0;
 }
 
+/*
+ * The data transfer of each partition is deferred until all table metadata
+ * (truncate, user words) has been updated by the main thread.  The planner
+ * then sorts the partitions by base offset and merges runs of adjacent ones
+ * into a single sequential transfer, split back into per partition results
+ * afterwards.  With --jobs the runs go to a worker pool, largest first.  The
+ * tables are committed when the images are closed.
+ *
+ * A partition listed by several tables (primary, backup) is copied by the
+ * table that claims it first.  The others queue a 'skip' job which takes
+ * its CRC once the claimer has settled the claim, so every table settles
+ * its own claims before it waits for any other.
+ */
+#define PLAN_GAP	0x10000	/* compare: max distance within a run */
+
+typedef struct job job_t;
+struct job {
+	args_t * args;
+	ffs_t * src_ffs, * dst_ffs;
+	char * src_name, * dst_name;
+	off_t src_base, dst_base;
+	uint64_t size, src_actual, dst_actual;
+
+	uint32_t crc;		/* copy: data CRC, stored by the main thread */
+	bool crc_valid;
+
+	entry_list_t * done_list;	/* copy: claims of every table */
+	ffs_entry_t claim;
+	bool skip;		/* claimed by another table, no data pass */
+	bool settled;
+};
+
+typedef struct run run_t;
+struct run {
+	job_t * job;
+	size_t nr;
+	off_t length;
+};
+
+typedef struct job_list job_list_t;
+struct job_list {
+	job_t * job;
+	size_t nr, sz;
+
+	run_t * run;
+	size_t run_nr;
+};
+
+static int __max_ranges(args_t * args, uint32_t * max_ranges)
+{
+	*max_ranges = 0;
+	if (args->ranges != NULL)
+		if (parse_number(args->ranges, max_ranges) < 0)
+			return -1;
+
+	return 0;
+}
+
+static void __job_done(job_t * job, ffs_t * src_ffs, ffs_t * dst_ffs)
+{
+	args_t * args = job->args;
+
+	if (args->verbose == f_VERBOSE)
+		fprintf(stderr, "%8llx: %s: %s from '%s' (done)\n",
+			(long long)dst_ffs->offset, job->dst_name,
+			args->cmd == c_COPY ? "copy" : "compare",
+			src_ffs->path);
+}
+
+static int __job_run(job_t * job, ffs_t * src_ffs, ffs_t * dst_ffs)
+{
+	args_t * args = job->args;
+
+	if (args->cmd == c_COPY) {
+		ssize_t rc = fcp_copy_entry(src_ffs, job->src_name, dst_ffs,
+					    job->dst_name, args->diff == f_DIFF,
+					    args->jnl, &job->crc,
+					    &job->crc_valid);
+		if (rc < 0)
+			return -1;
+	} else {
+		uint32_t max_ranges;
+		if (__max_ranges(args, &max_ranges) < 0)
+			return -1;
+
+		if (fcp_compare_entry(src_ffs, job->src_name, dst_ffs,
+				      job->dst_name, max_ranges) < 0)
+			return -1;
+	}
+
+	__job_done(job, src_ffs, dst_ffs);
+
+	return 0;
+}
+
+static int __run_exec(run_t * run, ffs_t * src_ffs, ffs_t * dst_ffs)
+{
+	if (run->nr == 1)
+		return __job_run(run->job, src_ffs, dst_ffs);
+
+	args_t * args = run->job->args;
+
+	RAII(fcp_extent_t*, ext, calloc(run->nr, sizeof(*ext)), free);
+	if (ext == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	for (size_t i = 0; i < run->nr; i++) {
+		job_t * job = run->job + i;
+
+		ext[i].src_name = job->src_name;
+		ext[i].dst_name = job->dst_name;
+		ext[i].src_base = job->src_base;
+		ext[i].dst_base = job->dst_base;
+		ext[i].size = job->size;
+		ext[i].src_actual = job->src_actual;
+		ext[i].dst_actual = job->dst_actual;
+	}
+
+	if (args->cmd == c_COPY) {
+		if (fcp_copy_run(src_ffs, dst_ffs, ext, run->nr) < 0)
+			return -1;
+
+		for (size_t i = 0; i < run->nr; i++) {
+			run->job[i].crc = ext[i].crc;
+			run->job[i].crc_valid = ext[i].crc_valid;
+		}
+	} else {
+		uint32_t max_ranges;
+		if (__max_ranges(args, &max_ranges) < 0)
+			return -1;
+
+		if (fcp_compare_run(src_ffs, dst_ffs, ext, run->nr,
+				    max_ranges) < 0)
+			return -1;
+	}
+
+	for (size_t i = 0; i < run->nr; i++)
+		__job_done(run->job + i, src_ffs, dst_ffs);
+
+	return 0;
+}
+
+/*
+ * The workers write partition data through the shared tables and the
+ * library updates an entry whenever a write goes past its 'actual' or
+ * hits data under a valid CRC.  __copy_entry() already set 'actual' to
+ * the source size and dropped the CRC bit from the main thread, so both
+ * updates are no-ops and the workers never modify a table.
+ */
+static bool __job_ready(job_t * job)
+{
+	if (job->args->cmd != c_COPY || job->skip)
+		return true;
+
+	ffs_entry_t entry;
+	if (__ffs_entry_find(job->dst_ffs, job->dst_name, &entry) == false)
+		return false;
+
+	return job->src_actual <= __ffs_entry_actual(job->dst_ffs, &entry) &&
+	    !(entry.user.data[USER_DATA_VOL] & FFS_ENTRY_INTEG_CRC);
+}
+
+/* metadata the workers must not touch is updated afterwards */
+static int __job_commit(job_t * job)
+{
+	if (job->args->cmd != c_COPY)
+		return 0;
+
+	if (job->skip)
+		return entry_list_crc_put(job->done_list, &job->claim,
+					  job->dst_ffs, job->dst_name);
+
+	int rc = 0;
+	if (job->crc_valid)
+		rc = fcp_entry_crc_put(job->dst_ffs, job->dst_name, job->crc);
+
+	entry_list_settle(job->done_list, &job->claim,
+			  rc < 0 ? NULL : job->dst_ffs, job->dst_name);
+	job->settled = true;
+
+	return rc;
+}
+
+/* release the tables waiting for a claim whose data pass never finished */
+static void __job_abort(job_t * job)
+{
+	if (job->args->cmd != c_COPY || job->skip || job->settled)
+		return;
+
+	entry_list_settle(job->done_list, &job->claim, NULL, job->dst_name);
+	job->settled = true;
+}
+
+static int __run_worker(void * arg)
+{
+	run_t * run = (run_t *)arg;
+	args_t * args = run->job->args;
+
+	for (size_t i = 0; i < run->nr; i++)
+		assert(__job_ready(run->job + i));
+
+	/* private views of the tables, each with its own I/O engine */
+	ffs_t src_ffs = *run->job->src_ffs, dst_ffs = *run->job->dst_ffs;
+	src_ffs.io = dst_ffs.io = NULL;
+
+	int rc = -1;
+
+	if (setup_io(&src_ffs, args->depth, args->sparse == f_SPARSE) == 0 &&
+	    setup_io(&dst_ffs, args->depth, args->sparse == f_SPARSE) == 0)
+		rc = __run_exec(run, &src_ffs, &dst_ffs);
+
+	if (src_ffs.io != NULL)
+		__ffs_io_delete(src_ffs.io);
+	if (dst_ffs.io != NULL)
+		__ffs_io_delete(dst_ffs.io);
+
+	return rc;
+}
+
+static int __job_push(job_list_t * jobs, job_t * job)
+{
+	if (jobs->nr == jobs->sz) {
+		size_t sz = jobs->sz ? jobs->sz * 2 : 16;
+		job_t * tmp = realloc(jobs->job, sz * sizeof(*tmp));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			return -1;
+		}
+		jobs->job = tmp, jobs->sz = sz;
+	}
+
+	job->src_name = strdup(job->src_name);
+	job->dst_name = strdup(job->dst_name);
+	if (job->src_name == NULL || job->dst_name == NULL) {
+		ERRNO(errno);
+		free(job->src_name), free(job->dst_name);
+		return -1;
+	}
+
+	jobs->job[jobs->nr++] = *job;
+
+	return 0;
+}
+
+static int __job_add(args_t * args, job_list_t * jobs,
+		     ffs_t * src_ffs, const char * src_name,
+		     ffs_entry_t * src_entry,
+		     ffs_t * dst_ffs, const char * dst_name,
+		     ffs_entry_t * dst_entry, entry_list_t * done_list)
+{
+	uint32_t src_block_size, dst_block_size;
+	if (__ffs_info(src_ffs, FFS_INFO_BLOCK_SIZE, &src_block_size) < 0)
+		return -1;
+	if (__ffs_info(dst_ffs, FFS_INFO_BLOCK_SIZE, &dst_block_size) < 0)
+		return -1;
+
+	job_t job = {
+		.args = args,
+		.src_ffs = src_ffs,
+		.dst_ffs = dst_ffs,
+		.src_name = (char *)src_name,
+		.dst_name = (char *)dst_name,
+		.src_base = (off_t)src_entry->base * src_block_size,
+		.dst_base = (off_t)dst_entry->base * dst_block_size,
+		.size = (uint64_t)src_entry->size * src_block_size,
+		.src_actual = __ffs_entry_actual(src_ffs, src_entry),
+		.dst_actual = __ffs_entry_actual(dst_ffs, dst_entry),
+		.done_list = done_list,
+		.claim = *src_entry,
+	};
+
+	if (jobs == NULL) {
+		if (__job_run(&job, src_ffs, dst_ffs) < 0)
+			return -1;
+		return __job_commit(&job);
+	}
+
+	return __job_push(jobs, &job);
+}
+
+/* a partition claimed by another table, takes its CRC when committed */
+static int __job_skip(args_t * args, job_list_t * jobs,
+		      ffs_t * src_ffs, const char * src_name,
+		      ffs_entry_t * src_entry,
+		      ffs_t * dst_ffs, const char * dst_name,
+		      entry_list_t * done_list)
+{
+	if (jobs == NULL)
+		return entry_list_crc_put(done_list, src_entry, dst_ffs,
+					  dst_name);
+
+	job_t job = {
+		.args = args,
+		.src_ffs = src_ffs,
+		.dst_ffs = dst_ffs,
+		.src_name = (char *)src_name,
+		.dst_name = (char *)dst_name,
+		.done_list = done_list,
+		.claim = *src_entry,
+		.skip = true,
+	};
+
+	return __job_push(jobs, &job);
+}
+
+static int __job_cmp(const void * a, const void * b)
+{
+	const job_t * x = a, * y = b;
+
+	/* skip jobs last, they are not part of any run */
+	if (x->skip != y->skip)
+		return x->skip - y->skip;
+
+	/* flash order */
+	return (x->src_base > y->src_base) - (x->src_base < y->src_base);
+}
+
+static int __run_cmp(const void * a, const void * b)
+{
+	const run_t * x = a, * y = b;
+
+	/* longest run first */
+	return (x->length < y->length) - (y->length < x->length);
+}
+
+static bool __job_adjacent(job_t * prev, job_t * next)
+{
+	args_t * args = prev->args;
+
+	if (next->dst_base - next->src_base != prev->dst_base - prev->src_base)
+		return false;
+
+	off_t end = prev->src_base + prev->src_actual;
+	if (next->src_base < end)
+		return false;
+
+	/* the bytes in between are read and ignored */
+	if (args->cmd == c_COMPARE)
+		return next->src_base - end <= PLAN_GAP;
+
+	/* never write past the data of a partition, --diff and --journal
+	 * work partition by partition */
+	return args->diff != f_DIFF && args->jnl == NULL &&
+	    prev->src_actual == prev->size && next->src_base == end;
+}
+
+static int __job_list_plan(job_list_t * jobs)
+{
+	qsort(jobs->job, jobs->nr, sizeof(*jobs->job), __job_cmp);
+
+	jobs->run = calloc(jobs->nr, sizeof(*jobs->run));
+	if (jobs->run == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	for (size_t i = 0; i < jobs->nr; i++) {
+		job_t * job = jobs->job + i;
+		run_t * run = NULL;
+
+		if (job->skip)
+			continue;
+
+		if (0 < jobs->run_nr)
+			run = jobs->run + jobs->run_nr - 1;
+
+		if (run != NULL && __job_adjacent(run->job + run->nr - 1, job)) {
+			run->nr++;
+		} else {
+			run = jobs->run + jobs->run_nr++;
+			run->job = job;
+			run->nr = 1;
+		}
+
+		run->length = job->src_base + job->src_actual -
+		    run->job->src_base;
+	}
+
+	return 0;
+}
+
+static int __job_list_run(job_list_t * jobs, uint32_t threads)
+{
+	if (jobs->nr == 0)
+		return 0;
+
+	if (__job_list_plan(jobs) < 0)
+		return -1;
+
+	/* one streaming pass over the image, in flash order */
+	if (threads <= 1) {
+		for (size_t i = 0; i < jobs->run_nr; i++) {
+			run_t * run = jobs->run + i;
+			if (__run_exec(run, run->job->src_ffs,
+				       run->job->dst_ffs) < 0)
+				return -1;
+		}
+	} else {
+		qsort(jobs->run, jobs->run_nr, sizeof(*jobs->run), __run_cmp);
+
+		workq_t * wq = workq_create(min((size_t)threads,
+						jobs->run_nr));
+		if (wq == NULL)
+			return -1;
+
+		for (size_t i = 0; i < jobs->run_nr; i++) {
+			if (workq_add(wq, __run_worker, &jobs->run[i]) < 0) {
+				workq_delete(wq);
+				return -1;
+			}
+		}
+
+		if (workq_delete(wq) < 0)
+			return -1;
+	}
+
+	/* settle our own claims before waiting for the other tables' */
+	for (size_t i = 0; i < jobs->nr; i++)
+		if (jobs->job[i].skip == false &&
+		    __job_commit(jobs->job + i) < 0)
+			return -1;
+	for (size_t i = 0; i < jobs->nr; i++)
+		if (jobs->job[i].skip == true &&
+		    __job_commit(jobs->job + i) < 0)
+			return -1;
+
+	return 0;
+}
+
+static int job_list_delete(job_list_t * jobs)
+{
+	for (size_t i = 0; i < jobs->nr; i++) {
+		__job_abort(jobs->job + i);
+		free(jobs->job[i].src_name);
+		free(jobs->job[i].dst_name);
+	}
+	free(jobs->job);
+	free(jobs->run);
+
+	return 0;
+}
+
+static bool __is_nested(ffs_t * ffs, ffs_entry_t * entry)
+{
+	return entry->type == FFS_TYPE_PARTITION &&
+		(off_t)entry->base * ffs->hdr->block_size != ffs->offset;
+}
+
 static int __copy_entry(args_t * args,
 			ffs_t * src_ffs, ffs_entry_t * src_entry,
 			ffs_t * dst_ffs, ffs_entry_t * dst_entry,
-			entry_list_t * done_list)
+			entry_list_t * done_list, job_list_t * jobs)
 {
 	char full_src_name[page_size];
 	if (__ffs_entry_name(src_ffs, src_entry, full_src_name,
@@ -186,51 +639,54 @@ static int __copy_entry(args_t * args,
 		return -1;
 	}
 
-	if (__ffs_entry_truncate(dst_ffs, full_dst_name,
-				 src_entry->actual) < 0) {
+	uint64_t actual = __ffs_entry_actual(src_ffs, src_entry);
+	if (__ffs_entry_truncate(dst_ffs, full_dst_name, actual) < 0) {
 		ERRNO(errno);
 		return -1;
 	}
 	if (args->verbose == f_VERBOSE)
-		fprintf(stderr, "%8llx: %s: trunc size '%x' (done)\n",
-			(long long)dst_ffs->offset, full_dst_name, src_entry->actual);
+		fprintf(stderr, "%8llx: %s: trunc size '%llx' (done)\n",
+			(long long)dst_ffs->offset, full_dst_name,
+			(long long)actual);
 
-	uint32_t src_val, dst_val;
-	for (uint32_t i=0; i<FFS_USER_WORDS; i++) {
-		__ffs_entry_user_get(src_ffs, full_src_name, i, &src_val);
-		__ffs_entry_user_get(dst_ffs, full_dst_name, i, &dst_val);
+	/* the source words are already at hand in the resolved entry */
+	uint32_t user[FFS_USER_WORDS];
+	memcpy(user, src_entry->user.data, sizeof(user));
 
-                if (args->force != f_FORCE && i == USER_DATA_VOL)
-                        continue;
+	uint32_t mask = ((1U << FFS_USER_WORDS) - 1) & ~(1U << USER_DATA_CRC);
+	if (args->force != f_FORCE)
+		user[USER_DATA_VOL] = dst_entry->user.data[USER_DATA_VOL];
 
-		if (src_val != dst_val) {
-			if (__ffs_entry_user_put(dst_ffs, full_dst_name,
-					         i, src_val) < 0)
-				return -1;
-		}
-	}
+	/* valid again once the data has been copied (by the main thread,
+	 * the workers must not modify the table) */
+	user[USER_DATA_VOL] &= ~FFS_ENTRY_INTEG_CRC;
+
+	if (__ffs_entry_user_put_all(dst_ffs, full_dst_name, user, mask) < 0)
+		return -1;
 	if (args->verbose == f_VERBOSE)
 		if (args->verbose == f_VERBOSE)
 			fprintf(stderr, "%8llx: %s: copy user[] from '%s' "
 				"(done)\n", (long long)dst_ffs->offset, full_dst_name,
 				src_ffs->path);
 
-	if (entry_list_exists(done_list, src_entry) == 1) {
+	int claimed = entry_list_claim(done_list, src_entry);
+	if (claimed < 0)
+		return -1;
+	if (claimed == 1) {
 		if (args->verbose == f_VERBOSE)
 			fprintf(stderr, "%8llx: %s: copy from '%s' (skip)\n",
 		       		(long long)dst_ffs->offset, full_dst_name, src_ffs->path);
-		return 0;
+		return __job_skip(args, jobs, src_ffs, full_src_name,
+				  src_entry, dst_ffs, full_dst_name,
+				  done_list);
 	}
 
-	if (entry_list_add(done_list, src_entry) < 0)
-		return -1;
-
-	if (fcp_copy_entry(src_ffs, full_src_name, dst_ffs, full_dst_name) < 0)
+	if (__job_add(args, jobs, src_ffs, full_src_name, src_entry,
+		      dst_ffs, full_dst_name, dst_entry, done_list) < 0) {
+		/* release the tables waiting for the claim */
+		entry_list_settle(done_list, src_entry, NULL, NULL);
 		return -1;
-
-	if (args->verbose == f_VERBOSE)
-		fprintf(stderr, "%8llx: %s: copy from '%s' (done)\n",
-		        (long long)dst_ffs->offset, full_dst_name, src_ffs->path);
+	}
 
 	return 0;
 }
@@ -238,7 +694,7 @@ static int __copy_entry(args_t * args,
 static int __compare_entry(args_t * args,
 			   ffs_t * src_ffs, ffs_entry_t * src_entry,
 			   ffs_t * dst_ffs, ffs_entry_t * dst_entry,
-			   entry_list_t * done_list)
+			   entry_list_t * done_list, job_list_t * jobs)
 {
 	char full_src_name[page_size];
 	if (__ffs_entry_name(src_ffs, src_entry, full_src_name,
@@ -266,6 +722,15 @@ static int __compare_entry(args_t * args,
 		return 0;
 	}
 
+	/* nested tables are compared on their own, not as data */
+	if (__is_nested(src_ffs, src_entry)) {
+		if (args->verbose == f_VERBOSE)
+			fprintf(stderr, "%8llx: %s: nested partition table "
+				"(skip)\n", (long long)src_ffs->offset,
+				full_src_name);
+		return 0;
+	}
+
 	if (args->protected != f_PROTECTED) {
 		if (dst_entry->flags & FFS_FLAGS_PROTECTED) {
 			if (args->verbose == f_VERBOSE)
@@ -297,25 +762,18 @@ static int __compare_entry(args_t * args,
 		return -1;
 	}
 
-	if (entry_list_exists(done_list, src_entry) == 1) {
+	int claimed = entry_list_claim(done_list, src_entry);
+	if (claimed < 0)
+		return -1;
+	if (claimed == 1) {
 		if (args->verbose == f_VERBOSE)
 			fprintf(stderr, "%8llx: %s: compare from '%s' (skip)\n",
 				(long long)dst_ffs->offset, full_dst_name, src_ffs->path);
 		return 0;
 	}
 
-	if (entry_list_add(done_list, src_entry) < 0)
-		return -1;
-
-	if (fcp_compare_entry(src_ffs, full_src_name,
-			      dst_ffs, full_dst_name) < 0)
-		return -1;
-
-	if (args->verbose == f_VERBOSE)
-		fprintf(stderr, "%8llx: %s: compare from '%s' (done)\n",
-			(long long)dst_ffs->offset, full_dst_name, src_ffs->path);
-
-	return 0;
+	return __job_add(args, jobs, src_ffs, full_src_name, src_entry,
+			 dst_ffs, full_dst_name, dst_entry, done_list);
 }
 
 static int __force_part(ffs_t * src, FILE * dst)
@@ -334,23 +792,24 @@ static int __force_part(ffs_t * src, FILE * dst)
 			     0, block_size) < 0)
 		return -1;
 
-	uint32_t offset;
-	if (__ffs_info(src, FFS_INFO_OFFSET, &offset) < 0)
+	uint64_t offset;
+	if (__ffs_info64(src, FFS_INFO_OFFSET, &offset) < 0)
 		return -1;
 
-	if (fseek(dst, offset, SEEK_SET) < 0) {
-		ERRNO(errno);
-		return -1;
-	}
+	flockfile(dst);
 
-	if (fwrite(part, 1, block_size, dst) != block_size) {
-		if (ferror(dst)) {
-			ERRNO(errno);
-			return -1;
-		}
-	}
+	int rc = 0;
+	if (fseeko(dst, offset, SEEK_SET) < 0)
+		rc = -1;
+	else if (fwrite(part, 1, block_size, dst) != block_size &&
+		 ferror(dst))
+		rc = -1;
+	else if (fflush(dst) == EOF)
+		rc = -1;
+
+	funlockfile(dst);
 
-	if (fflush(dst) == EOF) {
+	if (rc < 0) {
 		ERRNO(errno);
 		return -1;
 	}
@@ -358,16 +817,16 @@ static int __force_part(ffs_t * src, FILE * dst)
 	return 0;
 }
 
-static int __copy_compare(args_t * args, off_t offset, entry_list_t * done_list)
+static int __copy_compare(args_t * args, off_t offset, void * __ctx)
 {
 	assert(args != NULL);
-	assert(done_list != NULL);
 
-	char * src_type = args->src_type;
+	offset_ctx_t * ctx = (offset_ctx_t *)__ctx;
+	entry_list_t * done_list = ctx->done_list;
+
 	char * src_target = args->src_target;
 	char * src_name = args->src_name;
 
-	char * dst_type = args->dst_type;
 	char * dst_target = args->dst_target;
 	char * dst_name = src_name;
 
@@ -379,10 +838,7 @@ static int __copy_compare(args_t * args, off_t offset, entry_list_t * done_list)
 	if (dst_name == NULL)
 		dst_name = "*";
 
-	RAII(FILE*, src_file, __fopen(src_type, src_target, "r", debug),
-	     fclose);
-	if (src_file == NULL)
-		return -1;
+	FILE * src_file = ctx->src;
 	if (check_file(src_target, src_file, offset) < 0)
 		return -1;
 	RAII(ffs_t*, src_ffs, __ffs_fopen(src_file, offset), __ffs_fclose);
@@ -390,13 +846,11 @@ static int __copy_compare(args_t * args, off_t offset, entry_list_t * done_list)
 		return -1;
 
 	src_ffs->path = basename(src_target);
-	done_list->ffs = src_ffs;
-
-	RAII(FILE*, dst_file, __fopen(dst_type, dst_target, "r+", debug),
-	     fclose);
-	if (dst_file == NULL)
+	if (setup_io(src_ffs, args->depth, args->sparse == f_SPARSE) < 0)
 		return -1;
 
+	FILE * dst_file = ctx->dst;
+
 	if (args->force == f_FORCE && args->cmd == c_COPY) {
 		if (__force_part(src_ffs, dst_file) < 0)
 			return -1;
@@ -414,6 +868,8 @@ static int __copy_compare(args_t * args, off_t offset, entry_list_t * done_list)
 		return -1;
 
 	dst_ffs->path = basename(dst_target);
+	if (setup_io(dst_ffs, args->depth, args->sparse == f_SPARSE) < 0)
+		return -1;
 
 	if (validate_files(src_ffs, dst_ffs) < 0)
 		return -1;
@@ -453,13 +909,25 @@ static int __copy_compare(args_t * args, off_t offset, entry_list_t * done_list)
 	    dst_parent.type == FFS_TYPE_DATA) {
 		if (args->cmd == c_COPY)
 			return __copy_entry(args, src_ffs, &src_parent,
-					    dst_ffs, &dst_parent, done_list);
+					    dst_ffs, &dst_parent, done_list,
+					    NULL);
 		else
 			return __compare_entry(args, src_ffs, &src_parent,
-					       dst_ffs, &dst_parent, done_list);
+					       dst_ffs, &dst_parent, done_list,
+					       NULL);
 	} else if (src_parent.type == FFS_TYPE_LOGICAL &&
 		   dst_parent.type == FFS_TYPE_LOGICAL) {
 
+		uint32_t threads = 1;
+		if (args->jobs != NULL)
+			if (parse_number(args->jobs, &threads) < 0)
+				return -1;
+		if (threads == 0)
+			threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+		job_list_t __jobs = { NULL, 0, 0, NULL, 0 };
+		RAII(job_list_t*, jobs, &__jobs, job_list_delete);
+
 		RAII(entry_list_t*, src_list, entry_list_create(src_ffs),
 		     entry_list_delete);
 		if (src_list == NULL)
@@ -523,16 +991,18 @@ static int __copy_compare(args_t * args, off_t offset, entry_list_t * done_list)
 			if (args->cmd == c_COPY) {
 				if (__copy_entry(args, src_ffs, src_entry,
 						 dst_ffs, dst_entry,
-						 done_list) < 0)
+						 done_list, jobs) < 0)
 					return -1;
 			} else if (args->cmd == c_COMPARE) {
 				if (__compare_entry(args, src_ffs, src_entry,
 						 dst_ffs, dst_entry,
-						 done_list) < 0) {
+						 done_list, jobs) < 0) {
 					return -1;
 				}
 			}
 		}
+
+		return __job_list_run(jobs, threads);
 	}
 
 	return 0;
@@ -549,30 +1019,23 @@ int command_copy_compare(args_t * args)
 	if (done_list == NULL)
 		return -1;
 
-	char * end = (char *)args->offset;
-	while (rc == 0 && end != NULL && *end != '\0') {
-		errno = 0;
-		off_t offset = strtoull(end, &end, 0);
-		if (end == NULL || errno != 0) {
-			UNEXPECTED("invalid --offset specified '%s'",
-				   args->offset);
-			return -1;
-		}
+	RAII(FILE*, src_file, __fopen(args->src_type, args->src_target, "r",
+				      debug), fclose);
+	if (src_file == NULL)
+		return -1;
 
-		if (*end != ',' && *end != ':' && *end != '\0') {
-			UNEXPECTED("invalid --offset separator "
-				   "character '%c'", *end);
-			return -1;
-		}
+	RAII(FILE*, dst_file, __fopen(args->dst_type, args->dst_target, "r+",
+				      debug), fclose);
+	if (dst_file == NULL)
+		return -1;
 
-		rc = __copy_compare(args, offset, done_list);
-		if (rc < 0)
-			break;
+	offset_ctx_t ctx = {
+		.src = src_file,
+		.dst = dst_file,
+		.done_list = done_list,
+	};
 
-		if (*end == '\0')
-			break;
-		end++;
-	}
+	rc = for_each_table(args, src_file, __copy_compare, &ctx);
 
 	return rc;
 }
@@ -56,11 +56,13 @@
 #include "misc.h"
 #include "main.h"
 
-static int __erase(args_t * args, off_t offset, entry_list_t * done_list)
+static int __erase(args_t * args, off_t offset, void * __ctx)
 {
 	assert(args != NULL);
 
-	char * type = args->dst_type;
+	offset_ctx_t * ctx = (offset_ctx_t *)__ctx;
+	entry_list_t * done_list = ctx->done_list;
+
 	char * target = args->dst_target;
 	char * name = args->dst_name;
 
@@ -72,9 +74,7 @@ static int __erase(args_t * args, off_t offset, entry_list_t * done_list)
 			return -1;
 	}
 
-	RAII(FILE*, file, __fopen(type, target, "r+", debug), fclose);
-	if (file == NULL)
-		return -1;
+	FILE * file = ctx->dst;
 	if (check_file(target, file, offset) < 0)
 		return -1;
 	RAII(ffs_t*, ffs, __ffs_fopen(file, offset), __ffs_fclose);
@@ -82,7 +82,8 @@ static int __erase(args_t * args, off_t offset, entry_list_t * done_list)
 		return -1;
 
 	ffs->path = basename(target);
-	done_list->ffs = ffs;
+	if (setup_io(ffs, args->depth, args->sparse == f_SPARSE) < 0)
+		return -1;
 
 	if (ffs->count <= 0)
 		return 0;
@@ -140,17 +141,26 @@ static int __erase(args_t * args, off_t offset, entry_list_t * done_list)
 			fprintf(stderr, "%8llx: %s: trunc size '%x' (done)\n",
 			       (long long)offset, full_name, 0);
 
-		if (entry_list_exists(done_list, entry) == 1) {
+		int claimed = entry_list_claim(done_list, entry);
+		if (claimed < 0)
+			return -1;
+		if (claimed == 1) {
 			if (args->verbose == f_VERBOSE)
 				fprintf(stderr, "%8llx: %s: erase partition "
 					"(skip)\n", (long long)offset, full_name);
+			if (entry_list_crc_put(done_list, entry, ffs,
+					       full_name) < 0)
+				return -1;
 			continue;
 		}
 
-		if (entry_list_add(done_list, entry) < 0)
-			return -1;
+		ssize_t rc = fcp_erase_entry(ffs, full_name, (char)fill,
+					     args->jnl);
 
-		if (fcp_erase_entry(ffs, full_name, (char)fill) < 0)
+		/* the backup tables take the CRC from here */
+		entry_list_settle(done_list, entry, rc < 0 ? NULL : ffs,
+				  full_name);
+		if (rc < 0)
 			return -1;
 
 		if (args->verbose == f_VERBOSE)
@@ -172,30 +182,17 @@ int command_erase(args_t * args)
 	if (done_list == NULL)
 		return -1;
 
-	char * end = (char *)args->offset;
-	while (rc == 0 && end != NULL && *end != '\0') {
-		errno = 0;
-		off_t offset = strtoull(end, &end, 0);
-		if (end == NULL || errno != 0) {
-			UNEXPECTED("invalid --offset specified '%s'",
-				   args->offset);
-			return -1;
-		}
-
-		if (*end != ',' && *end != ':' && *end != '\0') {
-			UNEXPECTED("invalid --offset separator "
-				   "character '%c'", *end);
-			return -1;
-		}
+	RAII(FILE*, file, __fopen(args->dst_type, args->dst_target, "r+",
+				  debug), fclose);
+	if (file == NULL)
+		return -1;
 
-		rc = __erase(args, offset, done_list);
-		if (rc < 0)
-			break;
+	offset_ctx_t ctx = {
+		.dst = file,
+		.done_list = done_list,
+	};
 
-		if (*end == '\0')
-			break;
-		end++;
-	}
+	rc = for_each_offset(args, __erase, &ctx);
 
 	return rc;
 }
@@ -56,17 +56,14 @@
 #include "misc.h"
 #include "main.h"
 
-static int list(args_t * args, off_t offset)
+static int list(args_t * args, off_t offset, void * ctx)
 {
 	assert(args != NULL);
 
-	char * type = args->dst_type;
 	char * target = args->dst_target;
 	char * name = args->dst_name;
 
-	RAII(FILE*, file, __fopen(type, target, "r", debug), fclose);
-	if (file == NULL)
-		return -1;
+	FILE * file = (FILE *)ctx;
 	if (check_file(target, file, offset) < 0)
 		return -1;
 	RAII(ffs_t*, ffs, __ffs_fopen(file, offset), __ffs_fclose);
@@ -104,8 +101,8 @@ static int list(args_t * args, off_t offset)
 				     sizeof full_name) < 0)
 			return -1;
 
-		uint32_t offset = entry->base * ffs->hdr->block_size;
-		uint32_t size = entry->size * ffs->hdr->block_size;
+		off_t offset = (off_t)entry->base * ffs->hdr->block_size;
+		off_t size = (off_t)entry->size * ffs->hdr->block_size;
 
 		char type;
 		if (entry->type == FFS_TYPE_LOGICAL)
@@ -114,8 +111,10 @@ static int list(args_t * args, off_t offset)
 			type ='d';
 		else if (entry->type == FFS_TYPE_PARTITION)
 			type ='p';
-		fprintf(stdout, "%3d [%08x-%08x] [%8x:%8x] ",
-			entry->id, offset, offset+size-1, size, entry->actual);
+		fprintf(stdout, "%3d [%08llx-%08llx] [%8llx:%8llx] ",
+			entry->id, (long long)offset,
+			(long long)(offset + size - 1), (long long)size,
+			(long long)__ffs_entry_actual(ffs, entry));
 
 		fprintf(stdout, "[%c%c%c%c%c%c] %s\n",
 			type, '-', '-', '-',
@@ -141,32 +140,10 @@ int command_list(args_t * args)
 {
 	assert(args != NULL);
 
-	int rc = 0;
-
-	char * end = (char *)args->offset;
-	while (rc == 0 && end != NULL && *end != '\0') {
-		errno = 0;
-		off_t offset = strtoull(end, &end, 0);
-		if (end == NULL || errno != 0) {
-			UNEXPECTED("invalid --offset specified '%s'",
-				   args->offset);
-			return -1;
-		}
-
-		if (*end != ',' && *end != ':' && *end != '\0') {
-			UNEXPECTED("invalid --offset separator "
-				   "character '%c'", *end);
-			return -1;
-		}
-
-		rc = list(args, offset);
-		if (rc < 0)
-			break;
-
-		if (*end == '\0')
-			break;
-		end++;
-	}
+	RAII(FILE*, file, __fopen(args->dst_type, args->dst_target, "r",
+				  debug), fclose);
+	if (file == NULL)
+		return -1;
 
-	return rc;
+	return for_each_table(args, file, list, file);
 }
@@ -0,0 +1,662 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fcp/src/cmd_patch.c $                                         */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_patch.c
+ *  Author:
+ *   Descr: diff and apply implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <endian.h>
+
+#include <clib/attribute.h>
+#include <clib/list.h>
+#include <clib/list_iter.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+#include <clib/sha256.h>
+
+#include "misc.h"
+#include "main.h"
+
+#define PATCH_MAGIC	"FCPPATCH"
+#define PATCH_VERSION	1
+#define PATCH_RUN	16	/* max blocks per op */
+
+/*
+ * A patch is a header followed by a stream of ops, all integers are
+ * big-endian:
+ *
+ *   'T' partition table at 'dst', erase block size 'block_size'
+ *   'L' literal: 'nr' block digests, then 'nr' blocks of data for 'dst'
+ *   'C' copy: 'nr' block digests, the data is read from the target at
+ *       'src' (where the old image had it)
+ *   'E' end of patch, 'dst' is the number of ops before it
+ *
+ * Each digest is the SHA-256 of the block once patched.  --diff walks the
+ * tables and the data partitions of the new image in flash order and only
+ * emits the blocks that differ from the old image at the same offset; a
+ * block that the old image had at the same offset within the same named
+ * partition elsewhere (a moved partition) becomes a copy.  --apply skips
+ * the blocks that already hash to their digest, so it only rewrites the
+ * affected erase blocks and can be rerun.
+ */
+typedef struct patch_hdr patch_hdr_t;
+struct patch_hdr {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+typedef struct patch_op patch_op_t;
+struct patch_op {
+	uint8_t op;
+	uint8_t pad[3];
+	uint32_t block_size;
+	uint32_t nr;
+	uint32_t reserved;
+	uint64_t dst;
+	uint64_t src;
+};
+
+typedef struct patch_run patch_run_t;
+struct patch_run {
+	FILE * out;
+	patch_op_t op;			/* pending op, host order */
+	uint8_t (*md)[SHA256_SIZE];
+	void * data;
+	size_t ops;
+};
+
+typedef struct patch_ctx patch_ctx_t;
+struct patch_ctx {
+	offset_ctx_t offset;
+	patch_run_t * run;
+};
+
+static int __fwrite(FILE * file, const void * buf, size_t count)
+{
+	if (fwrite(buf, 1, count, file) != count) {
+		ERRNO(errno);
+		return -1;
+	}
+	return 0;
+}
+
+static int __fread(FILE * file, void * buf, size_t count, const char * path)
+{
+	if (fread(buf, 1, count, file) != count) {
+		if (ferror(file))
+			ERRNO(errno);
+		else
+			UNEXPECTED("'%s' patch is truncated", path);
+		return -1;
+	}
+	return 0;
+}
+
+static int __op_write(FILE * out, patch_op_t * op)
+{
+	patch_op_t be = {
+		.op = op->op,
+		.block_size = htobe32(op->block_size),
+		.nr = htobe32(op->nr),
+		.dst = htobe64(op->dst),
+		.src = htobe64(op->src),
+	};
+
+	return __fwrite(out, &be, sizeof(be));
+}
+
+static int __op_read(FILE * in, patch_op_t * op, const char * path)
+{
+	if (__fread(in, op, sizeof(*op), path) < 0)
+		return -1;
+
+	op->block_size = be32toh(op->block_size);
+	op->nr = be32toh(op->nr);
+	op->dst = be64toh(op->dst);
+	op->src = be64toh(op->src);
+
+	switch (op->op) {
+	case 'T':
+	case 'E':
+		return 0;
+	case 'L':
+	case 'C':
+		if (op->block_size == 0 || op->nr == 0 ||
+		    PATCH_RUN < op->nr)
+			break;
+		return 0;
+	}
+
+	UNEXPECTED("'%s' malformed patch op '%c'", path, op->op);
+	return -1;
+}
+
+static int __run_flush(patch_run_t * run)
+{
+	patch_op_t * op = &run->op;
+
+	if (op->nr == 0)
+		return 0;
+
+	if (__op_write(run->out, op) < 0)
+		return -1;
+	if (__fwrite(run->out, run->md, op->nr * SHA256_SIZE) < 0)
+		return -1;
+	if (op->op == 'L' &&
+	    __fwrite(run->out, run->data, op->nr * op->block_size) < 0)
+		return -1;
+
+	run->ops++;
+	op->nr = 0;
+
+	return 0;
+}
+
+/* add one block to the pending op, starting a new one when it can't be
+ * merged */
+static int __run_add(patch_run_t * run, uint8_t kind, uint32_t block_size,
+		     off_t dst, off_t src, const void * buf)
+{
+	patch_op_t * op = &run->op;
+
+	if (0 < op->nr && (op->op != kind || op->block_size != block_size ||
+			   op->nr == PATCH_RUN ||
+			   op->dst + op->nr * block_size != (uint64_t)dst ||
+			   (kind == 'C' &&
+			    op->src + op->nr * block_size != (uint64_t)src)))
+		if (__run_flush(run) < 0)
+			return -1;
+
+	if (op->nr == 0)
+		*op = (patch_op_t){
+			.op = kind,
+			.block_size = block_size,
+			.dst = dst,
+			.src = src,
+		};
+
+	sha256(buf, block_size, run->md[op->nr]);
+	if (kind == 'L')
+		memcpy(run->data + op->nr * block_size, buf, block_size);
+	op->nr++;
+
+	return 0;
+}
+
+/* blocks [base, base + size) of the new image, 'moved' is where the old
+ * image had the same partition (or -1) */
+static int __diff_range(patch_run_t * run, ffs_t * old, ffs_t * new,
+			uint32_t block_size, off_t base, size_t size,
+			off_t moved, size_t moved_size, size_t * literal,
+			size_t * copy)
+{
+	size_t chunk = PATCH_RUN * block_size;
+
+	RAII(void*, new_buf, malloc(chunk), free);
+	RAII(void*, old_buf, malloc(chunk), free);
+	RAII(void*, mov_buf, malloc(chunk), free);
+	if (new_buf == NULL || old_buf == NULL || mov_buf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	for (size_t done = 0; done < size; done += chunk) {
+		size_t count = min(chunk, size - done);
+
+		if (__ffs_pread(new, new_buf, count, base + done) < 0)
+			return -1;
+		if (__ffs_pread(old, old_buf, count, base + done) < 0)
+			return -1;
+
+		size_t mov_count = 0;
+		if (0 <= moved && done < moved_size) {
+			mov_count = min(count, moved_size - done);
+			if (__ffs_pread(old, mov_buf, mov_count,
+					moved + done) < 0)
+				return -1;
+		}
+
+		for (size_t b = 0; b < count; b += block_size) {
+			void * buf = new_buf + b;
+			off_t dst = base + done + b;
+
+			if (memcmp(buf, old_buf + b, block_size) == 0)
+				continue;
+
+			int rc;
+			if (b < mov_count &&
+			    memcmp(buf, mov_buf + b, block_size) == 0) {
+				rc = __run_add(run, 'C', block_size, dst,
+					       moved + done + b, buf);
+				(*copy)++;
+			} else {
+				rc = __run_add(run, 'L', block_size, dst, 0,
+					       buf);
+				(*literal)++;
+			}
+			if (rc < 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int __diff(args_t * args, off_t offset, void * __ctx)
+{
+	assert(args != NULL);
+
+	patch_ctx_t * ctx = (patch_ctx_t *)__ctx;
+	patch_run_t * run = ctx->run;
+
+	FILE * src = ctx->offset.src, * dst = ctx->offset.dst;
+
+	if (check_file(args->src_target, src, offset) < 0)
+		return -1;
+	RAII(ffs_t*, old, __ffs_fopen(src, offset), __ffs_fclose);
+	if (old == NULL)
+		return -1;
+
+	if (check_file(args->dst_target, dst, offset) < 0)
+		return -1;
+	RAII(ffs_t*, new, __ffs_fopen(dst, offset), __ffs_fclose);
+	if (new == NULL)
+		return -1;
+
+	if (__ffs_set_sparse(old, args->sparse == f_SPARSE) < 0 ||
+	    __ffs_set_sparse(new, args->sparse == f_SPARSE) < 0)
+		return -1;
+
+	uint32_t block_size = new->hdr->block_size;
+	if (old->hdr->block_size != block_size) {
+		UNEXPECTED("partition table at offset '%llx' block sizes "
+			   "differ '%x' != '%x'", (long long)offset,
+			   old->hdr->block_size, block_size);
+		return -1;
+	}
+
+	size_t chunk = PATCH_RUN * block_size;
+	if (run->data == NULL) {
+		run->data = malloc(chunk);
+		if (run->data == NULL) {
+			ERRNO(errno);
+			return -1;
+		}
+	}
+
+	if (__run_flush(run) < 0)
+		return -1;
+
+	patch_op_t table = {
+		.op = 'T',
+		.block_size = block_size,
+		.dst = offset,
+	};
+	if (__op_write(run->out, &table) < 0)
+		return -1;
+	run->ops++;
+
+	/* the table itself */
+	size_t literal = 0, copy = 0;
+
+	if (__diff_range(run, old, new, block_size, offset,
+			 (size_t)new->hdr->size * block_size, -1, 0,
+			 &literal, &copy) < 0)
+		return -1;
+
+	RAII(entry_list_t*, entry_list, entry_list_create_by_regex(new, NULL),
+	     entry_list_delete);
+	if (entry_list == NULL)
+		return -1;
+
+	list_iter_t it;
+	entry_node_t * entry_node;
+
+	list_iter_init(&it, &entry_list->list, LI_FLAG_FWD);
+	list_for_each(&it, entry_node, node) {
+		ffs_entry_t * entry = &entry_node->entry;
+
+		if (entry->type != FFS_TYPE_DATA)
+			continue;
+
+		char full_name[page_size];
+		if (__ffs_entry_name(new, entry, full_name,
+				     sizeof full_name) < 0)
+			return -1;
+
+		int claimed = entry_list_claim(ctx->offset.done_list, entry);
+		if (claimed < 0)
+			return -1;
+		if (claimed == 1)
+			continue;
+
+		off_t base = (off_t)entry->base * block_size;
+		size_t size = (size_t)entry->size * block_size;
+
+		off_t moved = -1;
+		size_t moved_size = 0;
+
+		ffs_entry_t old_entry;
+		if (__ffs_entry_find(old, full_name, &old_entry) == true &&
+		    old_entry.type == FFS_TYPE_DATA &&
+		    old_entry.base != entry->base) {
+			moved = (off_t)old_entry.base * block_size;
+			moved_size = (size_t)old_entry.size * block_size;
+		}
+
+		size_t l = 0, c = 0;
+
+		if (__diff_range(run, old, new, block_size, base, size,
+				 moved, moved_size, &l, &c) < 0)
+			return -1;
+
+		if (args->verbose == f_VERBOSE)
+			fprintf(stderr, "%8llx: %s: %zu literal, %zu copy "
+				"block(s)\n", (long long)offset, full_name,
+				l, c);
+
+		literal += l, copy += c;
+	}
+
+	if (__run_flush(run) < 0)
+		return -1;
+
+	if (args->verbose == f_VERBOSE)
+		fprintf(stderr, "%8llx: diff %zu literal, %zu copy block(s)\n",
+			(long long)offset, literal, copy);
+
+	return 0;
+}
+
+int command_diff(args_t * args)
+{
+	assert(args != NULL);
+
+	RAII(entry_list_t*, done_list, entry_list_create(NULL),
+	     entry_list_delete);
+	if (done_list == NULL)
+		return -1;
+
+	RAII(FILE*, old_file, __fopen(args->src_type, args->src_target, "r",
+				      debug), fclose);
+	if (old_file == NULL)
+		return -1;
+
+	RAII(FILE*, new_file, __fopen(args->dst_type, args->dst_target, "r",
+				      debug), fclose);
+	if (new_file == NULL)
+		return -1;
+
+	uint8_t md[PATCH_RUN][SHA256_SIZE];
+	patch_run_t run = {
+		.out = stdout,
+		.md = md,
+	};
+
+	patch_ctx_t ctx = {
+		.offset = {
+			.src = old_file,
+			.dst = new_file,
+			.done_list = done_list,
+		},
+		.run = &run,
+	};
+
+	patch_hdr_t hdr = {
+		.version = htobe32(PATCH_VERSION),
+	};
+	memcpy(hdr.magic, PATCH_MAGIC, sizeof(hdr.magic));
+
+	int rc = __fwrite(stdout, &hdr, sizeof(hdr));
+
+	/* one stream, one table at a time */
+	if (rc == 0)
+		rc = for_each_offset(args, __diff, &ctx);
+
+	if (rc == 0) {
+		patch_op_t end = { .op = 'E', .dst = run.ops };
+		rc = __op_write(stdout, &end);
+	}
+
+	if (rc == 0 && fflush(stdout) == EOF) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	free(run.data);
+
+	return rc;
+}
+
+/*
+ * Two passes over the patch: the first saves the source of every copy
+ * before anything is written (a copy source may be the destination of
+ * another op), the second writes each block that does not already hash
+ * to its digest.
+ */
+static int __stage_copies(args_t * args, FILE * patch, ffs_t * target,
+			  FILE * stage)
+{
+	const char * path = args->src_target;
+
+	patch_op_t op;
+	do {
+		if (__op_read(patch, &op, path) < 0)
+			return -1;
+
+		if (op.op != 'L' && op.op != 'C')
+			continue;
+
+		size_t count = (size_t)op.nr * op.block_size;
+		off_t skip = op.nr * SHA256_SIZE;
+		if (op.op == 'L')
+			skip += count;
+		if (fseeko(patch, skip, SEEK_CUR) != 0) {
+			ERRNO(errno);
+			return -1;
+		}
+
+		if (op.op == 'C') {
+			RAII(void*, buf, malloc(count), free);
+			if (buf == NULL) {
+				ERRNO(errno);
+				return -1;
+			}
+			if (__ffs_pread(target, buf, count, op.src) < 0)
+				return -1;
+			if (__fwrite(stage, buf, count) < 0)
+				return -1;
+		}
+	} while (op.op != 'E');
+
+	return 0;
+}
+
+static int __apply_op(args_t * args, FILE * patch, ffs_t * target,
+		      FILE * stage, patch_op_t * op, size_t * written,
+		      size_t * skipped)
+{
+	const char * path = args->src_target;
+	size_t block_size = op->block_size;
+
+	uint8_t md[PATCH_RUN][SHA256_SIZE];
+	if (__fread(patch, md, op->nr * SHA256_SIZE, path) < 0)
+		return -1;
+
+	RAII(void*, data, malloc(op->nr * block_size), free);
+	RAII(void*, buf, malloc(block_size), free);
+	if (data == NULL || buf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	FILE * src = op->op == 'L' ? patch : stage;
+	if (__fread(src, data, op->nr * block_size, path) < 0)
+		return -1;
+
+	for (size_t i = 0; i < op->nr; i++) {
+		off_t dst = op->dst + i * block_size;
+		uint8_t cur[SHA256_SIZE];
+
+		if (__ffs_pread(target, buf, block_size, dst) < 0)
+			return -1;
+
+		sha256(buf, block_size, cur);
+		if (memcmp(cur, md[i], SHA256_SIZE) == 0) {
+			(*skipped)++;
+			continue;
+		}
+
+		void * blk = data + i * block_size;
+
+		sha256(blk, block_size, cur);
+		if (memcmp(cur, md[i], SHA256_SIZE) != 0) {
+			if (op->op == 'C')
+				UNEXPECTED("'%s' copy source '%llx' has "
+					   "changed, patch does not apply",
+					   path, (long long)(op->src +
+							     i * block_size));
+			else
+				UNEXPECTED("'%s' literal data for '%llx' is "
+					   "corrupt", path, (long long)dst);
+			return -1;
+		}
+
+		if (__ffs_pwrite(target, blk, block_size, dst) < 0)
+			return -1;
+		(*written)++;
+	}
+
+	return 0;
+}
+
+int command_apply(args_t * args)
+{
+	assert(args != NULL);
+
+	const char * path = args->src_target;
+
+	RAII(FILE*, patch, fopen(path, "r"), fclose);
+	if (patch == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	patch_hdr_t hdr;
+	if (__fread(patch, &hdr, sizeof(hdr), path) < 0)
+		return -1;
+	if (memcmp(hdr.magic, PATCH_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    be32toh(hdr.version) != PATCH_VERSION) {
+		UNEXPECTED("'%s' is not a version %d patch", path,
+			   PATCH_VERSION);
+		return -1;
+	}
+
+	RAII(FILE*, file, __fopen(args->dst_type, args->dst_target, "r+",
+				  debug), fclose);
+	if (file == NULL)
+		return -1;
+
+	/* raw image I/O, no partition table is needed */
+	ffs_t target = {
+		.file = file,
+		.sparse = args->sparse == f_SPARSE,
+	};
+
+	RAII(FILE*, stage, tmpfile(), fclose);
+	if (stage == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	off_t start = ftello(patch);
+	if (__stage_copies(args, patch, &target, stage) < 0)
+		return -1;
+	if (fseeko(patch, start, SEEK_SET) != 0 ||
+	    fseeko(stage, 0, SEEK_SET) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	size_t ops = 0, written = 0, skipped = 0;
+	off_t table = -1;
+
+	void report(void) {
+		if (args->verbose == f_VERBOSE && 0 <= table)
+			fprintf(stderr, "%8llx: apply %zu written, %zu "
+				"skipped\n", (long long)table, written,
+				skipped);
+	}
+
+	patch_op_t op;
+	for (;;) {
+		if (__op_read(patch, &op, path) < 0)
+			return -1;
+		if (op.op == 'E')
+			break;
+		ops++;
+
+		if (op.op == 'T') {
+			report();
+			table = op.dst;
+			written = skipped = 0;
+			continue;
+		}
+
+		if (__apply_op(args, patch, &target, stage, &op, &written,
+			       &skipped) < 0)
+			return -1;
+	}
+
+	if (op.dst != ops) {
+		UNEXPECTED("'%s' patch has '%zu' ops, expected '%llu'", path,
+			   ops, (unsigned long long)op.dst);
+		return -1;
+	}
+
+	report();
+
+	if (__ffs_fsync(&target) < 0)
+		return -1;
+
+	return 0;
+}
@@ -76,6 +76,9 @@ static int __read(args_t * args, off_t offset, entry_list_t * done_list)
 
 	done_list->ffs = ffs;
 
+	if (setup_io(ffs, args->depth, args->sparse == f_SPARSE) < 0)
+		return -1;
+
 	if (ffs->count <= 0)
 		return 0;
 
@@ -89,7 +92,7 @@ static int __read(args_t * args, off_t offset, entry_list_t * done_list)
 		return -1;
 	}
 
-	if (entry.actual == 0) {
+	if (__ffs_entry_actual(ffs, &entry) == 0) {
 		if (args->verbose == f_VERBOSE)
 			fprintf(stderr, "%8llx: %s: is empty (skip)\n",
 		       		(long long)offset, name);
@@ -106,11 +106,11 @@ static int __trunc(args_t * args, off_t offset)
 		return 0;
 	}
 
-	uint32_t size = 0;
+	off_t size = 0;
 	if (args->opt_nr == 1) {
-		size = entry.size * block_size;
+		size = (off_t)entry.size * block_size;
 	} else if (args->opt_nr == 2) {
-		if (parse_number(args->opt[1], &size) < 0)
+		if (parse_offset(args->opt[1], &size) < 0)
 			return -1;
 	}
 
@@ -120,8 +120,8 @@ static int __trunc(args_t * args, off_t offset)
 	}
 
 	if (args->verbose == f_VERBOSE)
-		fprintf(stderr, "%8llx: %s: truncate '%x' (done)\n",
-			(long long)offset, full_name, size);
+		fprintf(stderr, "%8llx: %s: truncate '%llx' (done)\n",
+			(long long)offset, full_name, (long long)size);
 
 	return 0;
 }
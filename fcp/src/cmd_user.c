@@ -104,15 +104,14 @@ static int __user(args_t * args, off_t offset)
 	// parse <word>[=<value>]
 
 	if (args->opt_nr <= 1) {
-		for (uint32_t word=0; word<FFS_USER_WORDS; word++) {
-			uint32_t value = 0;
-
-			if (__ffs_entry_user_get(ffs, name, word, &value) < 0)
-				return -1;
+		uint32_t value[FFS_USER_WORDS];
+		if (__ffs_entry_user_get_all(ffs, name, value) < 0)
+			return -1;
 
+		for (uint32_t word=0; word<FFS_USER_WORDS; word++)
 			fprintf(stdout, "%8llx: %s: [%02d] = %08x\n",
-				(long long)offset, full_name, word, value);
-		}
+				(long long)offset, full_name, word,
+				value[word]);
 		fprintf(stdout, "\n");
 	} else {
 		for (int i=1; i<args->opt_nr; i++) {
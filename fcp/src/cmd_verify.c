@@ -0,0 +1,480 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fcp/src/cmd_verify.c $                                        */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_verify.c
+ *  Author:
+ *   Descr: verify and hash implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <ctype.h>
+#include <regex.h>
+
+#include <clib/attribute.h>
+#include <clib/list.h>
+#include <clib/list_iter.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+#include <clib/workq.h>
+
+#include "misc.h"
+#include "main.h"
+#include "manifest.h"
+
+/*
+ * Without a manifest, every data partition with FFS_ENTRY_INTEG_CRC set is
+ * hashed by a worker (own view of the table and I/O engine) and checked
+ * against its USER_DATA_CRC word.  With one, every selected data partition
+ * gets a block hash tree, which --hash saves and --verify diffs against the
+ * manifest to name the erase blocks that changed.
+ */
+typedef struct verify_ctx verify_ctx_t;
+struct verify_ctx {
+	offset_ctx_t offset;
+	manifest_t * manifest;		/* --verify --manifest */
+	manifest_t * build;		/* --hash */
+};
+
+typedef struct verify_job verify_job_t;
+struct verify_job {
+	args_t * args;
+	ffs_t * ffs;
+	char * name;
+	uint32_t expected, crc;
+	manifest_part_t * part;
+	int rc;
+};
+
+typedef struct verify_list verify_list_t;
+struct verify_list {
+	verify_job_t * job;
+	size_t nr;
+};
+
+static void verify_list_delete(verify_list_t * self)
+{
+	for (size_t i = 0; i < self->nr; i++) {
+		free(self->job[i].name);
+		manifest_part_delete(self->job[i].part);
+	}
+	free(self->job);
+}
+
+static int __verify_worker(void * arg)
+{
+	verify_job_t * job = (verify_job_t *)arg;
+	args_t * args = job->args;
+
+	ffs_t ffs = *job->ffs;
+	ffs.io = NULL;
+
+	job->rc = -1;
+	if (setup_io(&ffs, args->depth, args->sparse == f_SPARSE) == 0) {
+		if (job->part != NULL)
+			job->rc = manifest_part_hash(job->part, &ffs,
+						     job->name);
+		else
+			job->rc = __ffs_entry_crc(&ffs, job->name, &job->crc);
+	}
+
+	if (ffs.io != NULL)
+		__ffs_io_delete(ffs.io);
+
+	return job->rc;
+}
+
+static int __report_blocks(manifest_part_t * part, size_t first, size_t nr,
+			   void * data)
+{
+	off_t offset = *(off_t *)data;
+
+	printf("%8llx: %s: blocks %zx..%zx differ (offset %llx length "
+	       "%zx) <== [ERROR]\n", (long long)offset, part->name, first,
+	       first + nr - 1, (long long)first * part->block_size,
+	       nr * part->block_size);
+
+	return 0;
+}
+
+static int __check_crc(args_t * args, off_t offset, verify_job_t * job)
+{
+	if (job->crc != job->expected) {
+		printf("%8llx: %s: crc %08x, expected %08x <== [ERROR]\n",
+		       (long long)offset, job->name, job->crc, job->expected);
+		UNEXPECTED("CRC MISMATCH! '%s' at offset '%llx'",
+			   job->name, (long long)offset);
+		return -1;
+	}
+
+	if (args->verbose == f_VERBOSE)
+		fprintf(stderr, "%8llx: %s: crc %08x (done)\n",
+			(long long)offset, job->name, job->crc);
+
+	return 0;
+}
+
+static int __check_manifest(args_t * args, off_t offset, manifest_t * manifest,
+			    verify_job_t * job)
+{
+	manifest_part_t * part = job->part;
+
+	manifest_part_t * expect = manifest_find(manifest, part->name,
+						 part->base);
+	if (expect == NULL) {
+		printf("%8llx: %s: not in manifest <== [ERROR]\n",
+		       (long long)offset, job->name);
+		UNEXPECTED("MANIFEST MISMATCH! '%s' at offset '%llx'",
+			   job->name, (long long)offset);
+		return -1;
+	}
+
+	ssize_t nr = manifest_part_diff(expect, part, __report_blocks,
+					&offset);
+	if (nr < 0)
+		return -1;
+
+	if (0 < nr) {
+		UNEXPECTED("MANIFEST MISMATCH! '%s' at offset '%llx', '%zd' "
+			   "of '%zx' blocks differ", job->name,
+			   (long long)offset, nr, part->nr);
+		return -1;
+	}
+
+	if (args->verbose == f_VERBOSE)
+		fprintf(stderr, "%8llx: %s: %zx blocks (done)\n",
+			(long long)offset, job->name, part->nr);
+
+	return 0;
+}
+
+static int __verify(args_t * args, off_t offset, void * __ctx)
+{
+	assert(args != NULL);
+
+	verify_ctx_t * ctx = (verify_ctx_t *)__ctx;
+	entry_list_t * done_list = ctx->offset.done_list;
+
+	/* hash every data partition, not only those with a CRC */
+	bool tree = ctx->manifest != NULL || ctx->build != NULL;
+
+	char * target = args->dst_target;
+	char * name = args->dst_name;
+
+	FILE * file = ctx->offset.dst;
+	if (check_file(target, file, offset) < 0)
+		return -1;
+	RAII(ffs_t*, ffs, __ffs_fopen(file, offset), __ffs_fclose);
+	if (ffs == NULL)
+		return -1;
+
+	ffs->path = basename(target);
+	if (__ffs_set_sparse(ffs, args->sparse == f_SPARSE) < 0)
+		return -1;
+
+	if (ffs->count <= 0)
+		return 0;
+
+	uint32_t block_size;
+	if (__ffs_info(ffs, FFS_INFO_BLOCK_SIZE, &block_size) < 0)
+		return -1;
+
+	RAII(entry_list_t*, entry_list, entry_list_create_by_regex(ffs, name),
+	     entry_list_delete);
+	if (entry_list == NULL)
+		return -1;
+
+	size_t nr = 0;
+	list_iter_t it;
+	entry_node_t * entry_node;
+
+	list_iter_init(&it, &entry_list->list, LI_FLAG_FWD);
+	list_for_each(&it, entry_node, node)
+		nr++;
+	verify_list_t __jobs = { calloc(nr ? nr : 1, sizeof(verify_job_t)), 0 };
+	RAII(verify_list_t*, jobs, &__jobs, verify_list_delete);
+	if (jobs->job == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	list_iter_init(&it, &entry_list->list, LI_FLAG_FWD);
+	list_for_each(&it, entry_node, node) {
+		ffs_entry_t * entry = &entry_node->entry;
+		verify_job_t * job = jobs->job + jobs->nr;
+
+		if (entry->type != FFS_TYPE_DATA)
+			continue;
+
+		char full_name[page_size];
+		if (__ffs_entry_name(ffs, entry, full_name,
+				     sizeof full_name) < 0)
+			return -1;
+
+		if (!tree &&
+		    !(entry->user.data[USER_DATA_VOL] & FFS_ENTRY_INTEG_CRC)) {
+			if (args->verbose == f_VERBOSE)
+				fprintf(stderr, "%8llx: %s: no crc (skip)\n",
+					(long long)offset, full_name);
+			continue;
+		}
+
+		int claimed = entry_list_claim(done_list, entry);
+		if (claimed < 0)
+			return -1;
+		if (claimed == 1) {
+			if (args->verbose == f_VERBOSE)
+				fprintf(stderr, "%8llx: %s: verify (skip)\n",
+					(long long)offset, full_name);
+			continue;
+		}
+
+		job->name = strdup(full_name);
+		if (job->name == NULL) {
+			ERRNO(errno);
+			return -1;
+		}
+		job->args = args;
+		job->ffs = ffs;
+		job->expected = entry->user.data[USER_DATA_CRC];
+		jobs->nr++;
+
+		if (tree) {
+			job->part = manifest_part_create(full_name,
+					(off_t)entry->base * block_size,
+					(uint64_t)entry->size * block_size,
+					__ffs_entry_actual(ffs, entry),
+					block_size);
+			if (job->part == NULL)
+				return -1;
+		}
+	}
+
+	if (jobs->nr == 0)
+		return 0;
+
+	uint32_t threads = 0;
+	if (args->jobs != NULL)
+		if (parse_number(args->jobs, &threads) < 0)
+			return -1;
+	if (threads == 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	workq_t * wq = workq_create(min((size_t)threads, jobs->nr));
+	if (wq == NULL)
+		return -1;
+
+	for (size_t i = 0; i < jobs->nr; i++) {
+		if (workq_add(wq, __verify_worker, jobs->job + i) < 0) {
+			workq_delete(wq);
+			return -1;
+		}
+	}
+
+	int rc = workq_delete(wq);
+
+	for (size_t i = 0; i < jobs->nr; i++) {
+		verify_job_t * job = jobs->job + i;
+
+		if (job->rc < 0)
+			continue;
+
+		if (ctx->build != NULL) {
+			if (manifest_add(ctx->build, job->part) < 0)
+				return -1;
+			job->part = NULL;
+			if (args->verbose == f_VERBOSE)
+				fprintf(stderr, "%8llx: %s: hash (done)\n",
+					(long long)offset, job->name);
+		} else if (ctx->manifest != NULL) {
+			if (__check_manifest(args, offset, ctx->manifest,
+					     job) < 0)
+				rc = -1;
+		} else {
+			if (__check_crc(args, offset, job) < 0)
+				rc = -1;
+		}
+	}
+
+	return rc;
+}
+
+static int __manifest_diff(args_t * args)
+{
+	RAII(manifest_t*, old, manifest_load(args->opt[0]), manifest_delete);
+	if (old == NULL)
+		return -1;
+	RAII(manifest_t*, new, manifest_load(args->opt[1]), manifest_delete);
+	if (new == NULL)
+		return -1;
+
+	off_t offset = 0;
+	size_t changed = 0;
+
+	for (size_t i = 0; i < new->nr; i++) {
+		manifest_part_t * part = new->part[i];
+		manifest_part_t * expect = manifest_find(old, part->name,
+							 part->base);
+		if (expect == NULL) {
+			printf("%8llx: %s: added\n", (long long)part->base,
+			       part->name);
+			changed++;
+			continue;
+		}
+
+		if (expect->nr != part->nr ||
+		    expect->block_size != part->block_size) {
+			printf("%8llx: %s: resized\n", (long long)part->base,
+			       part->name);
+			changed++;
+			continue;
+		}
+
+		offset = part->base;
+		ssize_t nr = manifest_part_diff(expect, part, __report_blocks,
+						&offset);
+		if (nr < 0)
+			return -1;
+		if (0 < nr)
+			changed++;
+		else if (args->verbose == f_VERBOSE)
+			fprintf(stderr, "%8llx: %s: %zx blocks (done)\n",
+				(long long)part->base, part->name, part->nr);
+	}
+
+	for (size_t i = 0; i < old->nr; i++) {
+		manifest_part_t * part = old->part[i];
+		if (manifest_find(new, part->name, part->base) == NULL) {
+			printf("%8llx: %s: removed\n", (long long)part->base,
+			       part->name);
+			changed++;
+		}
+	}
+
+	if (0 < changed) {
+		UNEXPECTED("MANIFEST MISMATCH! '%zu' partition(s) differ",
+			   changed);
+		return -1;
+	}
+
+	return 0;
+}
+
+int command_verify(args_t * args)
+{
+	assert(args != NULL);
+
+	/* two manifests, no image is read */
+	if (args->opt_nr == 2)
+		return __manifest_diff(args);
+
+	RAII(entry_list_t*, done_list, entry_list_create(NULL),
+	     entry_list_delete);
+	if (done_list == NULL)
+		return -1;
+
+	RAII(manifest_t*, manifest, NULL, manifest_delete);
+	if (args->manifest != NULL) {
+		manifest = manifest_load(args->manifest);
+		if (manifest == NULL)
+			return -1;
+	}
+
+	RAII(FILE*, file, __fopen(args->dst_type, args->dst_target, "r",
+				  debug), fclose);
+	if (file == NULL)
+		return -1;
+
+	verify_ctx_t ctx = {
+		.offset = {
+			.dst = file,
+			.done_list = done_list,
+		},
+		.manifest = manifest,
+	};
+
+	return for_each_offset(args, __verify, &ctx);
+}
+
+int command_hash(args_t * args)
+{
+	assert(args != NULL);
+
+	RAII(entry_list_t*, done_list, entry_list_create(NULL),
+	     entry_list_delete);
+	if (done_list == NULL)
+		return -1;
+
+	RAII(manifest_t*, manifest, manifest_create(), manifest_delete);
+	if (manifest == NULL)
+		return -1;
+
+	RAII(FILE*, file, __fopen(args->dst_type, args->dst_target, "r",
+				  debug), fclose);
+	if (file == NULL)
+		return -1;
+
+	verify_ctx_t ctx = {
+		.offset = {
+			.dst = file,
+			.done_list = done_list,
+		},
+		.build = manifest,
+	};
+
+	if (for_each_offset(args, __verify, &ctx) < 0)
+		return -1;
+
+	bool std = strcmp(args->opt[1], "-") == 0;
+
+	FILE * out = std ? stdout : fopen(args->opt[1], "w");
+	if (out == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	int rc = manifest_save(manifest, out);
+
+	if (!std && fclose(out) == EOF) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	return rc;
+}
@@ -56,19 +56,19 @@
 #include "misc.h"
 #include "main.h"
 
-static int __write(args_t * args, off_t offset, entry_list_t * done_list)
+static int __write(args_t * args, off_t offset, void * __ctx)
 {
 	assert(args != NULL);
 
+	offset_ctx_t * ctx = (offset_ctx_t *)__ctx;
+	entry_list_t * done_list = ctx->done_list;
+
 	char * in_path = args->src_target;
 
-	char * type = args->dst_type;
 	char * target = args->dst_target;
 	char * name = args->dst_name;
 
-	RAII(FILE*, file, __fopen(type, target, "r+", debug), fclose);
-	if (file == NULL)
-		return -1;
+	FILE * file = ctx->dst;
 	if (check_file(target, file, offset) < 0)
 		return -1;
 	RAII(ffs_t*, ffs, __ffs_fopen(file, offset), __ffs_fclose);
@@ -76,7 +76,8 @@ static int __write(args_t * args, off_t offset, entry_list_t * done_list)
 		return -1;
 
 	ffs->path = basename(target);
-	done_list->ffs = ffs;
+	if (setup_io(ffs, args->depth, args->sparse == f_SPARSE) < 0)
+		return -1;
 
 	if (ffs->count <= 0)
 		return 0;
@@ -117,7 +118,7 @@ static int __write(args_t * args, off_t offset, entry_list_t * done_list)
 		return -1;
 	}
 
-	if (entry.actual < st.st_size) {
+	if (__ffs_entry_actual(ffs, &entry) < (uint64_t)st.st_size) {
 		if (__ffs_entry_truncate(ffs, full_name,
 					 st.st_size) < 0) {
 			ERRNO(errno);
@@ -129,35 +130,38 @@ static int __write(args_t * args, off_t offset, entry_list_t * done_list)
 				(long long)offset, full_name, (long long)st.st_size);
 	}
 
-	if (entry_list_exists(done_list, &entry) == 1) {
+	int claimed = entry_list_claim(done_list, &entry);
+	if (claimed < 0)
+		return -1;
+	if (claimed == 1) {
 		if (args->verbose == f_VERBOSE)
 			fprintf(stderr, "%8llx: %s: read from '%s' (skip)\n",
 				(long long)offset, full_name, in_path);
-		return 0;
+		return entry_list_crc_put(done_list, &entry, ffs, full_name);
 	}
 
-	if (entry_list_add(done_list, &entry) < 0)
-		return -1;
+	ssize_t rc = -1;
 
 	if (strcmp(in_path, "-") == 0) {
-		if (fcp_write_entry(ffs, full_name, stdin) < 0)
-			return -1;
+		rc = fcp_write_entry(ffs, full_name, stdin,
+				     args->diff == f_DIFF, args->jnl);
 	} else {
 		RAII(FILE*, in, fopen(in_path, "r"), fclose);
-		if (in == NULL) {
+		if (in == NULL)
 			ERRNO(errno);
-			return -1;
-		}
-
-		if (fcp_write_entry(ffs, full_name, in) < 0)
-			return -1;
+		else
+			rc = fcp_write_entry(ffs, full_name, in,
+					     args->diff == f_DIFF, args->jnl);
 
-		if (args->verbose == f_VERBOSE)
+		if (0 <= rc && args->verbose == f_VERBOSE)
 			fprintf(stderr, "%8llx: %s: read from '%s' (done)\n",
 				(long long)offset, full_name, in_path);
 	}
 
-	return 0;
+	/* the backup tables take the CRC from here */
+	entry_list_settle(done_list, &entry, rc < 0 ? NULL : ffs, full_name);
+
+	return rc < 0 ? -1 : 0;
 }
 
 int command_write(args_t * args)
@@ -171,30 +175,17 @@ int command_write(args_t * args)
 	if (done_list == NULL)
 		return -1;
 
-	char * end = (char *)args->offset;
-	while (rc == 0 && end != NULL && *end != '\0') {
-		errno = 0;
-		off_t offset = strtoull(end, &end, 0);
-		if (end == NULL || errno != 0) {
-			UNEXPECTED("invalid --offset specified '%s'",
-				   args->offset);
-			return -1;
-		}
-
-		if (*end != ',' && *end != ':' && *end != '\0') {
-			UNEXPECTED("invalid --offset separator "
-				   "character '%c'", *end);
-			return -1;
-		}
+	RAII(FILE*, file, __fopen(args->dst_type, args->dst_target, "r+",
+				  debug), fclose);
+	if (file == NULL)
+		return -1;
 
-		rc = __write(args, offset, done_list);
-		if (rc < 0)
-			break;
+	offset_ctx_t ctx = {
+		.dst = file,
+		.done_list = done_list,
+	};
 
-		if (*end == '\0')
-			break;
-		end++;
-	}
+	rc = for_each_offset(args, __write, &ctx);
 
 	return rc;
 }
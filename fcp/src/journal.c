@@ -0,0 +1,317 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fcp/src/journal.c $                                          */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: journal.c
+ *  Author:
+ *   Descr: resumable transfer journal
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <clib/attribute.h>
+#include <clib/checksum.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+
+#include "journal.h"
+
+#define JOURNAL_MAGIC	"fcp-journal 1"
+
+/*
+ * The journal is a text file, one line per completed range of a partition
+ * (at most JOURNAL_CHUNK bytes), e.g.
+ *
+ *   fcp-journal 1 C nor.img
+ *   3f0000 bank0/ipl 0 100000 9a3c52e1
+ *   3f0000 bank0/ipl 100000 100000 1f00b0c4
+ *
+ * i.e. the partition table offset, partition name, offset and length of
+ * the range and the CRC32C of the data written there.  Records are queued
+ * and only appended once the target has been synced (a checkpoint), so a
+ * range is never recorded before its data is durable.  A rerun skips a
+ * range if the source data still hashes to the recorded CRC.  A torn last
+ * line is ignored.
+ */
+typedef struct record record_t;
+struct record {
+	off_t poffset;
+	off_t offset;
+	size_t count;
+	uint32_t crc;
+	char * name;
+};
+
+struct journal {
+	pthread_mutex_t lock;
+	FILE * file;
+
+	record_t * done;		/* loaded from a previous run */
+	size_t done_nr, done_sz;
+
+	record_t * pending;		/* waiting for a checkpoint */
+	size_t pending_nr, pending_sz;
+	size_t pending_bytes;
+};
+
+static int __record_add(record_t ** rec, size_t * nr, size_t * sz,
+			off_t poffset, const char * name, off_t offset,
+			size_t count, uint32_t crc)
+{
+	if (*nr == *sz) {
+		size_t n = *sz ? *sz * 2 : 64;
+		record_t * tmp = realloc(*rec, n * sizeof(*tmp));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			return -1;
+		}
+		*rec = tmp, *sz = n;
+	}
+
+	char * dup = strdup(name);
+	if (dup == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	(*rec)[(*nr)++] = (record_t){ poffset, offset, count, crc, dup };
+
+	return 0;
+}
+
+static void __record_delete(record_t * rec, size_t nr)
+{
+	for (size_t i = 0; i < nr; i++)
+		free(rec[i].name);
+	free(rec);
+}
+
+static int __journal_load(journal_t * self, const char * header)
+{
+	char * line = NULL;
+	size_t line_sz = 0;
+	int rc = 0;
+
+	if (getline(&line, &line_sz, self->file) == -1) {
+		/* new journal */
+		if (fprintf(self->file, "%s\n", header) < 0 ||
+		    fflush(self->file) != 0) {
+			ERRNO(errno);
+			rc = -1;
+		}
+		free(line);
+		return rc;
+	}
+
+	line[strcspn(line, "\n")] = '\0';
+	if (strcmp(line, header) != 0) {
+		UNEXPECTED("journal header '%s' does not match '%s'",
+			   line, header);
+		free(line);
+		return -1;
+	}
+
+	while (rc == 0 && getline(&line, &line_sz, self->file) != -1) {
+		unsigned long long poffset, offset;
+		size_t count;
+		uint32_t crc;
+		char * name = NULL;
+
+		if (strchr(line, '\n') != NULL &&
+		    sscanf(line, "%llx %ms %llx %zx %x", &poffset, &name,
+			   &offset, &count, &crc) == 5)
+			rc = __record_add(&self->done, &self->done_nr,
+					  &self->done_sz, poffset, name,
+					  offset, count, crc);
+
+		free(name);
+	}
+
+	free(line);
+
+	if (rc == 0 && ferror(self->file)) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	return rc;
+}
+
+journal_t * journal_open(const char * path, const char * header)
+{
+	assert(path != NULL);
+	assert(header != NULL);
+
+	journal_t * self = calloc(1, sizeof(*self));
+	if (self == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	self->file = fopen(path, "a+");
+	if (self->file == NULL) {
+		ERRNO(errno);
+		free(self);
+		return NULL;
+	}
+
+	char magic[strlen(JOURNAL_MAGIC) + strlen(header) + 2];
+	snprintf(magic, sizeof magic, "%s %s", JOURNAL_MAGIC, header);
+
+	rewind(self->file);
+	if (__journal_load(self, magic) < 0) {
+		journal_close(self);
+		return NULL;
+	}
+
+	pthread_mutex_init(&self->lock, NULL);
+
+	return self;
+}
+
+int journal_close(journal_t * self)
+{
+	if (self == NULL)
+		return 0;
+
+	int rc = 0;
+	if (self->file != NULL && fclose(self->file) != 0) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	__record_delete(self->done, self->done_nr);
+	__record_delete(self->pending, self->pending_nr);
+	pthread_mutex_destroy(&self->lock);
+	free(self);
+
+	return rc;
+}
+
+bool journal_done(journal_t * self, ffs_t * ffs, const char * name,
+		  off_t offset, size_t count, uint32_t crc)
+{
+	assert(self != NULL);
+	assert(ffs != NULL);
+	assert(name != NULL);
+
+	/* read-only after open, a rewritten range is recorded again */
+	for (size_t i = self->done_nr; 0 < i; i--) {
+		record_t * r = self->done + i - 1;
+
+		if (r->poffset == ffs->offset && r->offset == offset &&
+		    r->count == count && strcmp(r->name, name) == 0)
+			return r->crc == crc;
+	}
+
+	return false;
+}
+
+static int __checkpoint(journal_t * self, ffs_t * ffs)
+{
+	if (self->pending_nr == 0)
+		return 0;
+
+	/* the data first, then the records that describe it */
+	if (__ffs_fsync(ffs) < 0)
+		return -1;
+
+	int fd = fileno(ffs->file);
+	if (0 <= fd && fdatasync(fd) < 0 && errno != EINVAL &&
+	    errno != EROFS) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	for (size_t i = 0; i < self->pending_nr; i++) {
+		record_t * r = self->pending + i;
+
+		if (fprintf(self->file, "%llx %s %llx %zx %08x\n",
+			    (long long)r->poffset, r->name,
+			    (long long)r->offset, r->count, r->crc) < 0) {
+			ERRNO(errno);
+			return -1;
+		}
+		free(r->name);
+	}
+
+	self->pending_nr = 0;
+	self->pending_bytes = 0;
+
+	if (fflush(self->file) != 0 || fdatasync(fileno(self->file)) < 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+int journal_record(journal_t * self, ffs_t * ffs, const char * name,
+		   off_t offset, size_t count, uint32_t crc)
+{
+	assert(self != NULL);
+	assert(ffs != NULL);
+	assert(name != NULL);
+
+	pthread_mutex_lock(&self->lock);
+
+	int rc = __record_add(&self->pending, &self->pending_nr,
+			      &self->pending_sz, ffs->offset, name, offset,
+			      count, crc);
+	if (rc == 0) {
+		self->pending_bytes += count;
+		if (JOURNAL_SYNC <= self->pending_bytes)
+			rc = __checkpoint(self, ffs);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+
+	return rc;
+}
+
+int journal_checkpoint(journal_t * self, ffs_t * ffs)
+{
+	assert(self != NULL);
+	assert(ffs != NULL);
+
+	pthread_mutex_lock(&self->lock);
+	int rc = __checkpoint(self, ffs);
+	pthread_mutex_unlock(&self->lock);
+
+	return rc;
+}
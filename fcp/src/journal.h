@@ -0,0 +1,64 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fcp/src/journal.h $                                          */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: journal.h
+ *  Author:
+ *   Descr: resumable transfer journal
+ *    Date: 10/19/2026
+ */
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <sys/types.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <ffs/libffs.h>
+
+#define JOURNAL_CHUNK	(1024 * 1024)	/* max bytes per record */
+#define JOURNAL_SYNC	(8 * JOURNAL_CHUNK)	/* checkpoint interval */
+
+typedef struct journal journal_t;
+
+extern journal_t * journal_open(const char *, const char *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int journal_close(journal_t *);
+
+extern bool journal_done(journal_t *, ffs_t *, const char *, off_t, size_t,
+			 uint32_t)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+extern int journal_record(journal_t *, ffs_t *, const char *, off_t, size_t,
+			  uint32_t)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+extern int journal_checkpoint(journal_t *, ffs_t *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+#endif /* __JOURNAL_H__ */
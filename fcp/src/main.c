@@ -72,11 +72,19 @@ static void usage(bool verbose)
 
 	fprintf(e, "\n");
 	fprintf(e, "Usage:\n");
-	fprintf(e," fcp [<src_type>:]<src_target>[:<src_name>] -PLETU"
-		"\n     [-b <size>] [-o <offset,...>] [-fpvdh]\n");
+	fprintf(e," fcp [<src_type>:]<src_target>[:<src_name>] -PLETUV"
+		"\n     [-b <size>] [-o <offset,...>] [-q <depth>] [-j <jobs>]"
+		"\n     [-k <journal>] [-fpzwvdh]\n");
 	fprintf(e," fcp [<src_type>:]<src_target>[:<src_name>] "
-		  "[<dst_type>:]<dst_target>[:<dst_name>]  -RWCM"
-		  "\n     [-b <size>] [-o <offset,...>] [-fpvdh]\n");
+		  "[<dst_type>:]<dst_target>[:<dst_name>]  -RWCMH"
+		  "\n     [-b <size>] [-o <offset,...>] [-q <depth>] [-r <count>]"
+		  "\n     [-j <jobs>] [-k <journal>] [-fpzwvdh]\n");
+	fprintf(e," fcp <manifest> <manifest> -V [-vdh]\n");
+	fprintf(e," fcp [<src_type>:]<old_target> [<dst_type>:]<new_target> -D"
+		"\n     [-o <offset,...>] [-fzvdh] > <patch>\n");
+	fprintf(e," fcp <patch> [<dst_type>:]<dst_target> -A [-fzvdh]\n");
+	fprintf(e," fcp [<src_type>:]<src_target> <container> -Z"
+		"\n     [-o <offset,...>] [-vdh]\n");
 	fprintf(e, "\n");
 	fprintf(e, "    <type>\n");
 	fprintf(e, "       'aa' : Aardvark USB probe\n");
@@ -191,7 +199,49 @@ static void usage(bool verbose)
 	if (verbose)
 		fprintf(e,
 			"\n  Get or set a user word.  <word> and <value> are "
-			"decimal (or hex) numbers.\n");
+			"decimal (or hex) numbers.\n\n");
+
+	fprintf(e, "  -V, --verify\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Check the contents of partition(s) against the "
+			"CRC32C recorded in their\n  user words by --write, "
+			"--erase or --copy.  With --manifest, check them\n  "
+			"against a manifest from --hash and report the erase "
+			"blocks that differ.\n  Given two manifests, diff them "
+			"without reading an image.\n\n");
+
+	fprintf(e, "  -H, --hash\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Hash each erase block of the data partition(s) and "
+			"write the block hash\n  trees to a manifest file (use "
+			"'-' for stdout).\n\n");
+
+	fprintf(e, "  -D, --diff\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Write a patch to stdout that turns the old image "
+			"into the new one: the\n  erase blocks of the "
+			"partition tables and data partitions that differ,\n  "
+			"as literal data or as copies from where the old image "
+			"had them.\n\n");
+
+	fprintf(e, "  -A, --apply\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Apply a patch written by --diff, rewriting only the "
+			"erase blocks that\n  do not already hold the patched "
+			"data.  Applying it again is a no-op.\n\n");
+
+	fprintf(e, "  -Z, --compress\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Write a compressed container of the image, each "
+			"partition in its own\n  frames.  Containers are "
+			"read-only images, any command that reads an\n  image "
+			"(and libffs) accepts them and only decompresses the "
+			"frames it\n  touches.\n");
 
 	fprintf(e, "\n");
 
@@ -206,6 +256,39 @@ static void usage(bool verbose)
 	if (verbose)
 		fprintf(e,
 			"\n  Ignored.\n\n");
+
+	fprintf(e, "  -q, --queue-depth <value>\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Transfer partition data with io_uring, keeping up "
+			"to <value> block sized\n  requests in flight.  Falls "
+			"back to pread/pwrite if the kernel does not\n  support "
+			"io_uring.\n\n");
+	fprintf(e, "  -r, --max-ranges <value>\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Report at most <value> miscompare ranges per "
+			"partition with --compare,\n  the summary still "
+			"counts every differing byte and block.\n\n");
+	fprintf(e, "  -j, --jobs <value>\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Copy or compare up to <value> partitions in "
+			"parallel, largest first.\n  A <value> of 0 uses one "
+			"job per online CPU, which is the default for\n  "
+			"--verify and --hash.\n\n");
+	fprintf(e, "  -k, --journal <path>\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Record the ranges completed by --write, --erase or "
+			"--copy in <path>.  If\n  the command is interrupted, "
+			"rerun it with the same journal to skip the\n  ranges "
+			"already done whose source data is unchanged.\n\n");
+	fprintf(e, "  -m, --manifest <path>\n");
+	if (verbose)
+		fprintf(e,
+			"\n  Manifest written by --hash, checked by "
+			"--verify.\n\n");
 	fprintf(e, "\n");
 
 	/* =============================== */
@@ -221,6 +304,18 @@ static void usage(bool verbose)
 		fprintf(e, "\n  Do not ignore protected partition "
 			"entries\n\n");
 
+	fprintf(e, "  -z, --sparse\n");
+	if (verbose)
+		fprintf(e, "\n  Treat file targets as sparse images, holes read "
+			"as 0xFF, erasing to 0xFF\n  deallocates the blocks "
+			"and copy/compare skip over holes\n\n");
+
+	fprintf(e, "  -w, --diff-write\n");
+	if (verbose)
+		fprintf(e, "\n  Read back the target before --write or --copy "
+			"and only write the erase\n  blocks that differ, "
+			"reporting bytes written and skipped\n\n");
+
 	fprintf(e, "  -v, --verbose\n");
 	if (verbose)
 		fprintf(e, "\n  Write progress messages to stdout\n\n");
@@ -253,6 +348,11 @@ static int process_argument(args_t * args, int opt, const char *optarg)
 	case c_TRUNC:		/* trunc */
 	case c_COMPARE:		/* compare */
 	case c_USER:		/* user */
+	case c_VERIFY:		/* verify */
+	case c_HASH:		/* hash */
+	case c_DIFF:		/* diff */
+	case c_APPLY:		/* apply */
+	case c_COMPRESS:	/* compress */
 		if (args->cmd != c_ERROR) {
 			UNEXPECTED("commands '%c' and '%c' are mutually "
 				   "exclusive", args->cmd, opt);
@@ -266,12 +366,33 @@ static int process_argument(args_t * args, int opt, const char *optarg)
 	case o_BUFFER:		/* buffer */
 		/* We ignore it, it's useless but kept for backwards compat */
 		break;
+	case o_DEPTH:		/* queue-depth */
+		args->depth = strdup(optarg);
+		break;
+	case o_RANGES:		/* max-ranges */
+		args->ranges = strdup(optarg);
+		break;
+	case o_JOBS:		/* jobs */
+		args->jobs = strdup(optarg);
+		break;
+	case o_JOURNAL:		/* journal */
+		args->journal = strdup(optarg);
+		break;
+	case o_MANIFEST:	/* manifest */
+		args->manifest = strdup(optarg);
+		break;
 	case f_FORCE:		/* force */
 		args->force = (flag_t) opt;
 		break;
 	case f_PROTECTED:	/* protected */
 		args->protected = (flag_t) opt;
 		break;
+	case f_SPARSE:		/* sparse */
+		args->sparse = (flag_t) opt;
+		break;
+	case f_DIFF:		/* diff-write */
+		args->diff = (flag_t) opt;
+		break;
 	case f_VERBOSE:		/* verbose */
 		verbose = 1;
 		args->verbose = (flag_t) opt;
@@ -331,6 +452,15 @@ static int process_option(args_t * args, const char *opt)
  * 	fcp [<type>:]<target>[:<path>] -T <size>
  * user:
  * 	fcp [<type>:]<target>[:<path>] -U <word>[=<value>] ...
+ * verify:
+ * 	fcp [<type>:]<target>[:<path>] -V [-m <manifest>]
+ * 	fcp <manifest> <manifest> -V
+ * hash:
+ * 	fcp [<type>:]<target>[:<path>] <manifest> -H
+ * diff:
+ * 	fcp [<type>:]<old> [<type>:]<new> -D > <patch>
+ * apply:
+ * 	fcp <patch> [<type>:]<target> -A
  * write:
  * 	fcp <path>			[<type>:]<target>:<path> -W
  * read:
@@ -346,7 +476,10 @@ static int validate_args(args_t * args)
 {
 	assert(args != NULL);
 
-	if (args->offset == NULL) {
+	/* diffing two manifests reads no partition table */
+	if (args->offset == NULL &&
+	    !(args->cmd == c_VERIFY && args->opt_nr == 2) &&
+	    args->cmd != c_APPLY) {
 		UNEXPECTED("--offset is required for all '%s' "
 			   "commands", args->short_name);
 		return -1;
@@ -358,6 +491,8 @@ static int validate_args(args_t * args)
 	case c_ERASE:
 	case c_TRUNC:
 	case c_USER:
+	case c_VERIFY:
+	case c_HASH:
 		if (args->opt_nr < 1) {
 			UNEXPECTED("invalid options, please see --help for "
 				   "details");
@@ -373,6 +508,9 @@ static int validate_args(args_t * args)
 	case c_WRITE:
 	case c_COPY:
 	case c_COMPARE:
+	case c_DIFF:
+	case c_APPLY:
+	case c_COMPRESS:
 		if (args->opt_nr < 2) {
 			UNEXPECTED("invalid options, please see --help for "
 				   "details");
@@ -459,6 +597,9 @@ static int validate_args(args_t * args)
 			return -1;
 		}
 
+		/* one table after the other, in order */
+		UNSUP_OPT(jobs, list);
+
 	} else if (args->cmd == c_READ) {
 		void syntax(void) {
 			fprintf(stderr, "Syntax: %s [<src_type>:]<src_source>"
@@ -473,6 +614,7 @@ static int validate_args(args_t * args)
 		}
 
 		REQ_FIELD(src_name, read);
+		UNSUP_OPT(journal, read);
 	} else if (args->cmd == c_WRITE) {
 		void syntax(void) {
 			fprintf(stderr, "Syntax: %s <path> [<dst_type>:]"
@@ -515,6 +657,7 @@ static int validate_args(args_t * args)
 		}
 
 		REQ_FIELD(dst_name, trunc);
+		UNSUP_OPT(journal, trunc);
 
 	} else if (args->cmd == c_USER) {
 		void syntax(void) {
@@ -525,6 +668,7 @@ static int validate_args(args_t * args)
 		}
 
 		REQ_FIELD(dst_name, user);
+		UNSUP_OPT(journal, user);
 
 	} else if (args->cmd == c_COPY) {
 		void syntax(void) {
@@ -552,6 +696,96 @@ static int validate_args(args_t * args)
 			UNEXPECTED("syntax error");
 			return -1;
 		}
+		UNSUP_OPT(journal, compare);
+	} else if (args->cmd == c_VERIFY) {
+		void syntax(void) {
+			fprintf(stderr, "Syntax: %s [<dst_type>:]<dst_target>"
+				"[:<dst_name>] --verify [--manifest <path>] "
+				"[--verbose] [--jobs <value>]\n"
+				"        %s <manifest> <manifest> --verify "
+				"[--verbose]\n", args->short_name,
+				args->short_name);
+		}
+		if (args->opt_nr != 1 && args->opt_nr != 2) {
+			syntax();
+			UNEXPECTED("syntax error");
+			return -1;
+		}
+		UNSUP_OPT(journal, verify);
+		if (args->opt_nr == 2)
+			UNSUP_OPT(manifest, verify);
+	} else if (args->cmd == c_HASH) {
+		void syntax(void) {
+			fprintf(stderr, "Syntax: %s [<dst_type>:]<dst_target>"
+				"[:<dst_name>] <path> --hash [--verbose] "
+				"[--jobs <value>]\n", args->short_name);
+		}
+		if (args->opt_nr != 2) {
+			syntax();
+			UNEXPECTED("syntax error");
+			return -1;
+		}
+		UNSUP_OPT(journal, hash);
+		UNSUP_OPT(manifest, hash);
+	} else if (args->cmd == c_DIFF) {
+		void syntax(void) {
+			fprintf(stderr, "Syntax: %s [<src_type>:]<old_target> "
+				"[<dst_type>:]<new_target> --diff [--verbose] "
+				"[--sparse] > <patch>\n", args->short_name);
+		}
+		if (args->opt_nr != 2) {
+			syntax();
+			UNEXPECTED("syntax error");
+			return -1;
+		}
+		if (args->src_name != NULL || args->dst_name != NULL) {
+			syntax();
+			UNEXPECTED("--diff compares whole images, partition "
+				   "names are not supported");
+			return -1;
+		}
+		UNSUP_OPT(journal, diff);
+		UNSUP_OPT(manifest, diff);
+		UNSUP_OPT(jobs, diff);
+	} else if (args->cmd == c_APPLY) {
+		void syntax(void) {
+			fprintf(stderr, "Syntax: %s <patch> [<dst_type>:]"
+				"<dst_target> --apply [--verbose]\n",
+				args->short_name);
+		}
+		if (args->opt_nr != 2) {
+			syntax();
+			UNEXPECTED("syntax error");
+			return -1;
+		}
+		if (args->dst_name != NULL) {
+			syntax();
+			UNEXPECTED("--apply patches whole images, partition "
+				   "names are not supported");
+			return -1;
+		}
+		UNSUP_OPT(journal, apply);
+		UNSUP_OPT(manifest, apply);
+	} else if (args->cmd == c_COMPRESS) {
+		void syntax(void) {
+			fprintf(stderr, "Syntax: %s [<src_type>:]<src_target> "
+				"<container> --compress [--verbose]\n",
+				args->short_name);
+		}
+		if (args->opt_nr != 2) {
+			syntax();
+			UNEXPECTED("syntax error");
+			return -1;
+		}
+		if (args->src_name != NULL || args->dst_name != NULL) {
+			syntax();
+			UNEXPECTED("--compress stores whole images, partition "
+				   "names are not supported");
+			return -1;
+		}
+		UNSUP_OPT(journal, compress);
+		UNSUP_OPT(manifest, compress);
+		UNSUP_OPT(jobs, compress);
 	} else {
 		UNEXPECTED("invalid command '%c'", args->cmd);
 		return -1;
@@ -565,6 +799,16 @@ static int process_args(args_t * args)
 	assert(args != NULL);
 	int rc = 0;
 
+	if (args->journal != NULL) {
+		char header[strlen(args->dst_target) + 3];
+		snprintf(header, sizeof header, "%c %s", args->cmd,
+			 args->dst_target);
+
+		args->jnl = journal_open(args->journal, header);
+		if (args->jnl == NULL)
+			return -1;
+	}
+
 	switch (args->cmd) {
 	case c_PROBE:
 		//rc = command_probe(args);
@@ -591,11 +835,30 @@ static int process_args(args_t * args)
 	case c_COMPARE:
 		rc = command_copy_compare(args);
 		break;
+	case c_VERIFY:
+		rc = command_verify(args);
+		break;
+	case c_HASH:
+		rc = command_hash(args);
+		break;
+	case c_DIFF:
+		rc = command_diff(args);
+		break;
+	case c_APPLY:
+		rc = command_apply(args);
+		break;
+	case c_COMPRESS:
+		rc = command_compress(args);
+		break;
 	default:
 		UNEXPECTED("NOT IMPLEMENTED YET => '%c'", args->cmd);
 		rc = -1;
 	}
 
+	if (journal_close(args->jnl) < 0)
+		rc = -1;
+	args->jnl = NULL;
+
 	return rc;
 }
 
@@ -608,10 +871,24 @@ static void args_dump(args_t * args)
 	printf("cmd[%c]\n", args->cmd);
 	if (args->offset != NULL)
 		printf("offset[%s]\n", args->offset);
+	if (args->depth != NULL)
+		printf("depth[%s]\n", args->depth);
+	if (args->ranges != NULL)
+		printf("ranges[%s]\n", args->ranges);
+	if (args->jobs != NULL)
+		printf("jobs[%s]\n", args->jobs);
+	if (args->journal != NULL)
+		printf("journal[%s]\n", args->journal);
+	if (args->manifest != NULL)
+		printf("manifest[%s]\n", args->manifest);
 	if (args->force != 0)
 		printf("force[%c]\n", args->force);
 	if (args->protected != 0)
 		printf("protected[%c]\n", args->protected);
+	if (args->sparse != 0)
+		printf("sparse[%c]\n", args->sparse);
+	if (args->diff != 0)
+		printf("diff[%c]\n", args->diff);
 	if (args->verbose != 0)
 		printf("verbose[%c]\n", args->verbose);
 	if (args->debug != 0)
@@ -636,12 +913,24 @@ int main(int argc, char *argv[])
 		{"trunc", no_argument, NULL, c_TRUNC},
 		{"compare", no_argument, NULL, c_COMPARE},
 		{"user", no_argument, NULL, c_USER},
+		{"verify", no_argument, NULL, c_VERIFY},
+		{"hash", no_argument, NULL, c_HASH},
+		{"diff", no_argument, NULL, c_DIFF},
+		{"apply", no_argument, NULL, c_APPLY},
+		{"compress", no_argument, NULL, c_COMPRESS},
 		/* options */
 		{"offset", required_argument, NULL, o_OFFSET},
 		{"buffer", required_argument, NULL, o_BUFFER},
+		{"queue-depth", required_argument, NULL, o_DEPTH},
+		{"max-ranges", required_argument, NULL, o_RANGES},
+		{"jobs", required_argument, NULL, o_JOBS},
+		{"journal", required_argument, NULL, o_JOURNAL},
+		{"manifest", required_argument, NULL, o_MANIFEST},
 		/* flags */
 		{"force", no_argument, NULL, f_FORCE},
 		{"protected", no_argument, NULL, f_PROTECTED},
+		{"sparse", no_argument, NULL, f_SPARSE},
+		{"diff-write", no_argument, NULL, f_DIFF},
 		{"verbose", no_argument, NULL, f_VERBOSE},
 		{"debug", no_argument, NULL, f_DEBUG},
 		{"help", no_argument, NULL, f_HELP},
@@ -649,7 +938,7 @@ int main(int argc, char *argv[])
 	};
 
 	static const char *short_opt;
-	short_opt = "PLRWECTMUo:b:fpvdh";
+	short_opt = "PLRWECTMUVHDAZo:b:q:r:j:k:m:fpzwvdh";
 
 	int rc = EXIT_FAILURE;
 
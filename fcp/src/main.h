@@ -36,9 +36,12 @@
 #include <sys/types.h>
 
 #include <stdio.h>
+#include <stdbool.h>
 
 #include <ffs/libffs.h>
 
+#include "journal.h"
+
 #define FCP_MAJOR	0x01
 #define FCP_MINOR	0x00
 #define FCP_PATCH	0x00
@@ -64,18 +67,30 @@ typedef enum {
 	c_TRUNC = 'T',
 	c_COMPARE = 'M',
 	c_USER = 'U',
+	c_VERIFY = 'V',
+	c_HASH = 'H',
+	c_DIFF = 'D',
+	c_APPLY = 'A',
+	c_COMPRESS = 'Z',
 } cmd_t;
 
 typedef enum {
 	o_ERROR = 0,
 	o_OFFSET = 'o',
 	o_BUFFER = 'b',
+	o_DEPTH = 'q',
+	o_RANGES = 'r',
+	o_JOBS = 'j',
+	o_JOURNAL = 'k',
+	o_MANIFEST = 'm',
 } option_t;
 
 typedef enum {
 	f_ERROR = 0,
 	f_FORCE = 'f',
 	f_PROTECTED = 'p',
+	f_SPARSE = 'z',
+	f_DIFF = 'w',
 	f_VERBOSE = 'v',
 	f_DEBUG = 'd',
 	f_HELP = 'h',
@@ -90,15 +105,24 @@ typedef struct {
 
 	/* options */
 	const char *offset;
+	const char *depth;
+	const char *ranges;
+	const char *jobs;
+	const char *journal;
+	const char *manifest;
 
 	/* flags */
 	flag_t force;
 	flag_t protected;
+	flag_t sparse;
+	flag_t diff;
 	flag_t verbose;
 	flag_t debug;
 
 	const char **opt;
 	int opt_sz, opt_nr;
+
+	journal_t *jnl;			/* open --journal */
 } args_t;
 
 extern args_t args;
@@ -107,11 +131,38 @@ extern size_t page_size;
 extern int verbose;
 extern int debug;
 
-extern int fcp_read_entry(ffs_t *, const char *, FILE *);
-extern int fcp_write_entry(ffs_t *, const char *, FILE *);
-extern int fcp_erase_entry(ffs_t *, const char *, char);
-extern int fcp_copy_entry(ffs_t *, const char *, ffs_t *, const char *);
-extern int fcp_compare_entry(ffs_t *, const char *, ffs_t *, const char *);
+extern ssize_t fcp_read_entry(ffs_t *, const char *, FILE *);
+extern ssize_t fcp_write_entry(ffs_t *, const char *, FILE *, bool,
+			       journal_t *);
+extern ssize_t fcp_erase_entry(ffs_t *, const char *, char, journal_t *);
+extern ssize_t fcp_copy_entry(ffs_t *, const char *, ffs_t *, const char *,
+			      bool, journal_t *, uint32_t *, bool *);
+extern int fcp_entry_crc_put(ffs_t *, const char *, uint32_t);
+extern ssize_t fcp_compare_entry(ffs_t *, const char *, ffs_t *,
+				 const char *, size_t);
+
+/*
+ * A partition within a run of partitions that are transferred as one
+ * sequential range, offsets are relative to the start of the image.
+ */
+typedef struct fcp_extent fcp_extent_t;
+struct fcp_extent {
+	const char * src_name, * dst_name;
+	off_t src_base, dst_base;
+	uint64_t size;			/* partition size in bytes */
+	uint64_t src_actual, dst_actual;
+	uint32_t crc;			/* copy: CRC32C of the data */
+	bool crc_valid;			/* copy: 'crc' describes the data */
+};
+
+extern int fcp_copy_run(ffs_t *, ffs_t *, fcp_extent_t *, size_t);
+extern int fcp_compare_run(ffs_t *, ffs_t *, const fcp_extent_t *, size_t,
+			   size_t);
+
+extern int for_each_offset(args_t *, int (*)(args_t *, off_t, void *),
+			   void *);
+extern int for_each_table(args_t *, FILE *,
+			  int (*)(args_t *, off_t, void *), void *);
 
 extern int command_probe(args_t *);
 extern int command_list(args_t *);
@@ -122,5 +173,10 @@ extern int command_copy_compare(args_t *);
 extern int command_trunc(args_t *);
 extern int command_compare(args_t *);
 extern int command_user(args_t *);
+extern int command_verify(args_t *);
+extern int command_hash(args_t *);
+extern int command_diff(args_t *);
+extern int command_apply(args_t *);
+extern int command_compress(args_t *);
 
 #endif /* __FCP_H__ */
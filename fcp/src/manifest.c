@@ -0,0 +1,503 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fcp/src/manifest.c $                                         */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: manifest.c
+ *  Author:
+ *   Descr: per-erase-block hash tree (Merkle tree) manifest
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <clib/attribute.h>
+#include <clib/sha256.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#include "manifest.h"
+
+#define MANIFEST_MAGIC	"fcp-manifest 1"
+#define MANIFEST_BATCH	64	/* blocks hashed per library call */
+
+/*
+ * The manifest is a text file, one 'part' line per data partition followed
+ * by the SHA-256 of each of its erase blocks, e.g.
+ *
+ *   fcp-manifest 1
+ *   part bank0/ipl 100000 40000 12345 10000 4 <root>
+ *   <block 0>
+ *   ...
+ *   <block 3>
+ *
+ * i.e. the name, flash offset, size, actual size, erase block size, number
+ * of blocks and the root of the tree.  Interior nodes are not stored, they
+ * are rebuilt from the leaves on load and the root is checked.  Each node
+ * is the SHA-256 of 0x01 followed by its one or two children, so two trees
+ * are diffed by descending only into the subtrees whose nodes differ.
+ * Partitions are identified by name and flash offset, so the entries of a
+ * backup table that share a partition with the primary table are listed
+ * once.
+ */
+
+manifest_part_t * manifest_part_create(const char * name, off_t base,
+				       uint64_t size, uint64_t actual,
+				       uint32_t block_size)
+{
+	assert(name != NULL);
+
+	if (block_size == 0 || size % block_size != 0) {
+		UNEXPECTED("partition '%s' size '%llx' is not a multiple of "
+			   "the block size '%x'", name, (long long)size,
+			   block_size);
+		return NULL;
+	}
+
+	manifest_part_t * self = calloc(1, sizeof(*self));
+	if (self == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	self->base = base;
+	self->size = size;
+	self->actual = actual;
+	self->block_size = block_size;
+	self->nr = size / block_size;
+
+	/* levels: nr, nr/2 rounded up, ... 1 */
+	size_t nodes = self->nr ? self->nr : 1, n;
+
+	self->level_nr = 1;
+	for (n = nodes; 1 < n; n = (n + 1) / 2) {
+		self->level_nr++;
+		nodes += (n + 1) / 2;
+	}
+
+	self->name = strdup(name);
+	self->level = calloc(self->level_nr, sizeof(*self->level));
+	self->node = calloc(nodes, sizeof(*self->node));
+	if (self->name == NULL || self->level == NULL || self->node == NULL) {
+		ERRNO(errno);
+		manifest_part_delete(self);
+		return NULL;
+	}
+
+	n = self->nr ? self->nr : 1;
+	for (size_t l = 1; l < self->level_nr; l++) {
+		self->level[l] = self->level[l - 1] + n;
+		n = (n + 1) / 2;
+	}
+
+	return self;
+}
+
+void manifest_part_delete(manifest_part_t * self)
+{
+	if (self == NULL)
+		return;
+
+	free(self->name);
+	free(self->level);
+	free(self->node);
+	free(self);
+}
+
+static size_t __level_size(manifest_part_t * self, size_t l)
+{
+	size_t n = self->nr ? self->nr : 1;
+	while (l--)
+		n = (n + 1) / 2;
+	return n;
+}
+
+static digest_t * __root(manifest_part_t * self)
+{
+	return self->node + self->level[self->level_nr - 1];
+}
+
+void manifest_part_tree(manifest_part_t * self)
+{
+	assert(self != NULL);
+
+	for (size_t l = 1; l < self->level_nr; l++) {
+		size_t nr = __level_size(self, l - 1);
+		digest_t * child = self->node + self->level[l - 1];
+		digest_t * node = self->node + self->level[l];
+
+		for (size_t i = 0; i < nr; i += 2) {
+			uint8_t prefix = 0x01;
+			sha256_t ctx;
+
+			sha256_init(&ctx);
+			sha256_update(&ctx, &prefix, sizeof(prefix));
+			sha256_update(&ctx, child[i], SHA256_SIZE);
+			if (i + 1 < nr)
+				sha256_update(&ctx, child[i + 1], SHA256_SIZE);
+			sha256_final(&ctx, node[i / 2]);
+		}
+	}
+}
+
+int manifest_part_hash(manifest_part_t * self, ffs_t * ffs, const char * name)
+{
+	assert(self != NULL);
+	assert(ffs != NULL);
+	assert(name != NULL);
+
+	for (size_t i = 0; i < self->nr; i += MANIFEST_BATCH) {
+		size_t nr = min((size_t)MANIFEST_BATCH, self->nr - i);
+		if (__ffs_entry_hash(ffs, name, i, nr,
+				     (uint8_t *)self->node[i]) < 0)
+			return -1;
+	}
+
+	manifest_part_tree(self);
+
+	return 0;
+}
+
+typedef struct diff_ctx diff_ctx_t;
+struct diff_ctx {
+	manifest_part_t * a, * b;
+	manifest_diff_f func;
+	void * data;
+	size_t first, nr;	/* pending run of differing blocks */
+	ssize_t total;
+};
+
+static int __diff_flush(diff_ctx_t * ctx)
+{
+	if (ctx->nr == 0)
+		return 0;
+
+	int rc = ctx->func(ctx->b, ctx->first, ctx->nr, ctx->data);
+	ctx->total += ctx->nr;
+	ctx->nr = 0;
+
+	return rc;
+}
+
+static int __diff(diff_ctx_t * ctx, size_t l, size_t i)
+{
+	digest_t * a = ctx->a->node + ctx->a->level[l] + i;
+	digest_t * b = ctx->b->node + ctx->b->level[l] + i;
+
+	if (memcmp(*a, *b, SHA256_SIZE) == 0)
+		return 0;
+
+	if (l == 0) {
+		if (0 < ctx->nr && ctx->first + ctx->nr == i) {
+			ctx->nr++;
+			return 0;
+		}
+		if (__diff_flush(ctx) < 0)
+			return -1;
+		ctx->first = i, ctx->nr = 1;
+		return 0;
+	}
+
+	size_t nr = __level_size(ctx->a, l - 1);
+
+	if (__diff(ctx, l - 1, i * 2) < 0)
+		return -1;
+	if (i * 2 + 1 < nr && __diff(ctx, l - 1, i * 2 + 1) < 0)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Report the runs of differing blocks between two trees of the same
+ * geometry, visiting only the nodes on the path to a difference.  Returns
+ * the number of differing blocks.
+ */
+ssize_t manifest_part_diff(manifest_part_t * a, manifest_part_t * b,
+			   manifest_diff_f func, void * data)
+{
+	assert(a != NULL);
+	assert(b != NULL);
+	assert(func != NULL);
+
+	if (a->nr != b->nr || a->block_size != b->block_size) {
+		UNEXPECTED("partition '%s' geometry differs, '%zx' blocks of "
+			   "'%x' != '%zx' blocks of '%x'", b->name, a->nr,
+			   a->block_size, b->nr, b->block_size);
+		return -1;
+	}
+
+	if (a->nr == 0)
+		return 0;
+
+	diff_ctx_t ctx = { a, b, func, data, 0, 0, 0 };
+
+	if (__diff(&ctx, a->level_nr - 1, 0) < 0 || __diff_flush(&ctx) < 0)
+		return -1;
+
+	return ctx.total;
+}
+
+manifest_t * manifest_create(void)
+{
+	manifest_t * self = calloc(1, sizeof(*self));
+	if (self == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	pthread_mutex_init(&self->lock, NULL);
+
+	return self;
+}
+
+void manifest_delete(manifest_t * self)
+{
+	if (self == NULL)
+		return;
+
+	for (size_t i = 0; i < self->nr; i++)
+		manifest_part_delete(self->part[i]);
+	free(self->part);
+
+	pthread_mutex_destroy(&self->lock);
+	free(self);
+}
+
+int manifest_add(manifest_t * self, manifest_part_t * part)
+{
+	assert(self != NULL);
+	assert(part != NULL);
+
+	int rc = 0;
+
+	pthread_mutex_lock(&self->lock);
+
+	if (self->nr == self->sz) {
+		size_t sz = self->sz ? self->sz * 2 : 64;
+		manifest_part_t ** tmp = realloc(self->part,
+						 sz * sizeof(*tmp));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			rc = -1;
+		} else {
+			self->part = tmp, self->sz = sz;
+		}
+	}
+
+	if (rc == 0)
+		self->part[self->nr++] = part;
+
+	pthread_mutex_unlock(&self->lock);
+
+	return rc;
+}
+
+manifest_part_t * manifest_find(manifest_t * self, const char * name,
+				off_t base)
+{
+	assert(self != NULL);
+	assert(name != NULL);
+
+	manifest_part_t * part = NULL;
+
+	pthread_mutex_lock(&self->lock);
+
+	for (size_t i = 0; i < self->nr && part == NULL; i++)
+		if (self->part[i]->base == base &&
+		    strcmp(self->part[i]->name, name) == 0)
+			part = self->part[i];
+
+	pthread_mutex_unlock(&self->lock);
+
+	return part;
+}
+
+static void __digest_print(FILE * file, const digest_t md)
+{
+	for (size_t i = 0; i < SHA256_SIZE; i++)
+		fprintf(file, "%02x", md[i]);
+}
+
+static int __digest_parse(const char * str, digest_t md)
+{
+	for (size_t i = 0; i < SHA256_SIZE; i++) {
+		unsigned int x;
+		if (sscanf(str + i * 2, "%2x", &x) != 1)
+			return -1;
+		md[i] = x;
+	}
+	return 0;
+}
+
+static int __part_cmp(const void * __a, const void * __b)
+{
+	const manifest_part_t * a = *(const manifest_part_t **)__a;
+	const manifest_part_t * b = *(const manifest_part_t **)__b;
+
+	if (a->base != b->base)
+		return a->base < b->base ? -1 : 1;
+	return strcmp(a->name, b->name);
+}
+
+/* partitions are written in flash order, so tables hashed in parallel
+ * still produce the same file */
+int manifest_save(manifest_t * self, FILE * file)
+{
+	assert(self != NULL);
+	assert(file != NULL);
+
+	qsort(self->part, self->nr, sizeof(*self->part), __part_cmp);
+
+	fprintf(file, "%s\n", MANIFEST_MAGIC);
+
+	for (size_t i = 0; i < self->nr; i++) {
+		manifest_part_t * part = self->part[i];
+
+		fprintf(file, "part %s %llx %llx %llx %x %zx ", part->name,
+			(long long)part->base, (long long)part->size,
+			(long long)part->actual, part->block_size, part->nr);
+		__digest_print(file, *__root(part));
+		fprintf(file, "\n");
+
+		for (size_t b = 0; b < part->nr; b++) {
+			__digest_print(file, part->node[b]);
+			fprintf(file, "\n");
+		}
+	}
+
+	if (fflush(file) == EOF || ferror(file)) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+manifest_t * manifest_load(const char * path)
+{
+	assert(path != NULL);
+
+	RAII(FILE*, file, fopen(path, "r"), fclose);
+	if (file == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	manifest_t * self = manifest_create();
+	if (self == NULL)
+		return NULL;
+
+	char * line = NULL;
+	size_t line_sz = 0;
+	int line_nr = 0;
+
+	manifest_part_t * part = NULL;
+	size_t leaf = 0;
+	digest_t root;
+
+	int rc = -1;
+
+	if (getline(&line, &line_sz, file) == -1 ||
+	    strcmp(line, MANIFEST_MAGIC "\n") != 0) {
+		UNEXPECTED("'%s' is not a manifest", path);
+		goto out;
+	}
+	line_nr++;
+
+	while (getline(&line, &line_sz, file) != -1) {
+		line_nr++;
+
+		if (part != NULL && leaf < part->nr) {
+			if (__digest_parse(line, part->node[leaf]) < 0)
+				break;
+			if (++leaf < part->nr)
+				continue;
+		} else {
+			char name[line_sz];
+			unsigned long long base, size, actual;
+			uint32_t block_size;
+			size_t nr;
+			char md[SHA256_SIZE * 2 + 1];
+
+			if (sscanf(line, "part %s %llx %llx %llx %x %zx %64s",
+				   name, &base, &size, &actual, &block_size,
+				   &nr, md) != 7 ||
+			    __digest_parse(md, root) < 0)
+				break;
+
+			part = manifest_part_create(name, base, size, actual,
+						    block_size);
+			if (part == NULL)
+				goto out;
+			if (part->nr != nr || manifest_add(self, part) < 0) {
+				manifest_part_delete(part);
+				part = NULL;
+				break;
+			}
+			leaf = 0;
+			if (0 < part->nr)
+				continue;
+		}
+
+		/* all the leaves are in, the root must match */
+		manifest_part_tree(part);
+		if (memcmp(*__root(part), root, SHA256_SIZE) != 0) {
+			UNEXPECTED("'%s' line %d: partition '%s' root hash "
+				   "mismatch, manifest is corrupt", path,
+				   line_nr, part->name);
+			goto out;
+		}
+		part = NULL;
+	}
+
+	if (ferror(file)) {
+		ERRNO(errno);
+	} else if (!feof(file) || part != NULL) {
+		UNEXPECTED("'%s' line %d: malformed manifest", path, line_nr);
+	} else {
+		rc = 0;
+	}
+
+out:
+	free(line);
+
+	if (rc < 0) {
+		manifest_delete(self);
+		self = NULL;
+	}
+
+	return self;
+}
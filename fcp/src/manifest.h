@@ -0,0 +1,103 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fcp/src/manifest.h $                                         */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: manifest.h
+ *  Author:
+ *   Descr: per-erase-block hash tree (Merkle tree) manifest
+ *    Date: 10/19/2026
+ */
+
+#ifndef __MANIFEST_H__
+#define __MANIFEST_H__
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <clib/sha256.h>
+
+#include <ffs/libffs.h>
+
+typedef uint8_t digest_t[SHA256_SIZE];
+
+/* one partition: leaves are the erase block digests, root is last */
+typedef struct manifest_part manifest_part_t;
+struct manifest_part {
+	char * name;
+	off_t base;
+	uint64_t size, actual;
+	uint32_t block_size;
+	size_t nr;			/* leaves */
+	size_t level_nr;		/* levels, leaves are level 0 */
+	size_t * level;			/* index of each level's first node */
+	digest_t * node;
+};
+
+typedef struct manifest manifest_t;
+struct manifest {
+	manifest_part_t ** part;
+	size_t nr, sz;
+	pthread_mutex_t lock;
+};
+
+/* called per run of differing blocks [first, first + nr) */
+typedef int (*manifest_diff_f)(manifest_part_t *, size_t, size_t, void *);
+
+extern manifest_part_t * manifest_part_create(const char *, off_t, uint64_t,
+					      uint64_t, uint32_t)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern void manifest_part_delete(manifest_part_t *);
+
+extern int manifest_part_hash(manifest_part_t *, ffs_t *, const char *)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+extern void manifest_part_tree(manifest_part_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern ssize_t manifest_part_diff(manifest_part_t *, manifest_part_t *,
+				  manifest_diff_f, void *)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+extern manifest_t * manifest_create(void);
+extern void manifest_delete(manifest_t *);
+
+extern int manifest_add(manifest_t *, manifest_part_t *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern manifest_part_t * manifest_find(manifest_t *, const char *, off_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int manifest_save(manifest_t *, FILE *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern manifest_t * manifest_load(const char *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+#endif /* __MANIFEST_H__ */
@@ -44,6 +44,7 @@
 #include <errno.h>
 #include <ctype.h>
 #include <regex.h>
+#include <pthread.h>
 
 #include <clib/attribute.h>
 #include <clib/version.h>
@@ -51,13 +52,19 @@
 #include <clib/list_iter.h>
 #include <clib/misc.h>
 #include <clib/min.h>
+#include <clib/max.h>
+#include <clib/mem.h>
+#include <clib/checksum.h>
 #include <clib/err.h>
 #include <clib/raii.h>
+#include <clib/workq.h>
 
 #include "misc.h"
 #include "main.h"
+#include "journal.h"
 
 #define COMPARE_SIZE	256UL
+#define BUFFER_MAX	(64UL << 20)
 
 static regex_t * regex_create(const char * str)
 {
@@ -141,7 +148,7 @@ int parse_size(const char *str, uint32_t *size)
 	char *end = NULL;
 
 	errno = 0;
-	*size = strtoul(str, &end, 0);
+	unsigned long long __size = strtoull(str, &end, 0);
 	if (errno != 0) {
 		ERRNO(errno);
 		return -1;
@@ -150,19 +157,26 @@ int parse_size(const char *str, uint32_t *size)
 	if (*end != '\0') {
 		if (!strcmp(end, "KiB") || !strcasecmp(end, "K") ||
 		    !strcasecmp(end, "KB"))
-			*size <<= 10;
+			__size <<= 10;
 		else if (!strcmp(end, "MiB") || !strcasecmp(end, "M") ||
 			 !strcasecmp(end, "MB"))
-			*size <<= 20;
+			__size <<= 20;
 		else if (!strcmp(end, "GiB") || !strcasecmp(end, "G") ||
 			 !strcasecmp(end, "GB"))
-			*size <<= 30;
+			__size <<= 30;
 		else {
 			UNEXPECTED("invalid size specified '%s'", end);
 			return -1;
 		}
 	}
 
+	if (UINT32_MAX < __size) {
+		UNEXPECTED("size '%s' exceeds 32 bits", str);
+		return -1;
+	}
+
+	*size = __size;
+
 	return 0;
 }
 
@@ -372,6 +386,8 @@ int entry_list_add(entry_list_t * self, ffs_entry_t * entry)
 	}
 
 	memcpy(&entry_node->entry, entry, sizeof(entry_node->entry));
+	entry_node->claim = CLAIM_BUSY;
+	entry_node->crc = 0;
 	list_add_tail(&self->list, &entry_node->node);
 
 	return 0;
@@ -452,6 +468,116 @@ int entry_list_exists(entry_list_t * self, ffs_entry_t * entry)
 	return 0;
 }
 
+/*
+ * Atomically check for and add an entry, returns 1 if the entry was already
+ * on the list (another table offset owns it), 0 if it was added.
+ */
+static pthread_mutex_t entry_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t entry_list_cond = PTHREAD_COND_INITIALIZER;
+
+int entry_list_claim(entry_list_t * self, ffs_entry_t * entry)
+{
+	assert(self != NULL);
+	assert(entry != NULL);
+
+	pthread_mutex_lock(&entry_list_lock);
+
+	int rc = entry_list_exists(self, entry);
+	if (rc == 0 && entry_list_add(self, entry) < 0)
+		rc = -1;
+
+	pthread_mutex_unlock(&entry_list_lock);
+
+	return rc;
+}
+
+static entry_node_t * __entry_list_node(entry_list_t * self,
+					ffs_entry_t * entry)
+{
+	list_iter_t it;
+	entry_node_t * entry_node;
+
+	list_iter_init(&it, &self->list, LI_FLAG_FWD);
+
+	list_for_each(&it, entry_node, node) {
+		if (entry_node->entry.base == entry->base &&
+		    entry_node->entry.size == entry->size)
+			return entry_node;
+	}
+
+	return NULL;
+}
+
+/*
+ * The claimer of an entry publishes the CRC word its data pass left in
+ * 'ffs', for the tables that skipped the entry.  A NULL 'ffs' (e.g. the
+ * pass failed) publishes that there is none.  Every claim of a command
+ * that stamps CRCs must be settled, or the other tables wait forever.
+ */
+void entry_list_settle(entry_list_t * self, ffs_entry_t * entry,
+		       ffs_t * ffs, const char * name)
+{
+	assert(self != NULL);
+	assert(entry != NULL);
+
+	uint32_t user[FFS_USER_WORDS];
+	int claim = CLAIM_NONE;
+	uint32_t crc = 0;
+
+	if (ffs != NULL && __ffs_entry_user_get_all(ffs, name, user) == 0 &&
+	    user[USER_DATA_VOL] & FFS_ENTRY_INTEG_CRC)
+		claim = CLAIM_CRC, crc = user[USER_DATA_CRC];
+
+	pthread_mutex_lock(&entry_list_lock);
+
+	entry_node_t * entry_node = __entry_list_node(self, entry);
+	if (entry_node != NULL) {
+		entry_node->claim = claim;
+		entry_node->crc = crc;
+	}
+
+	pthread_cond_broadcast(&entry_list_cond);
+	pthread_mutex_unlock(&entry_list_lock);
+}
+
+/*
+ * A table that skipped an entry claimed by another one records the same
+ * CRC, once the claimer is done.  Callers must not hold unsettled claims
+ * of their own while they wait.
+ */
+int entry_list_crc_put(entry_list_t * self, ffs_entry_t * entry,
+		       ffs_t * ffs, const char * name)
+{
+	assert(self != NULL);
+	assert(entry != NULL);
+	assert(ffs != NULL);
+	assert(name != NULL);
+
+	pthread_mutex_lock(&entry_list_lock);
+
+	entry_node_t * entry_node = __entry_list_node(self, entry);
+	while (entry_node != NULL && entry_node->claim == CLAIM_BUSY)
+		pthread_cond_wait(&entry_list_cond, &entry_list_lock);
+
+	int claim = entry_node ? entry_node->claim : CLAIM_NONE;
+	uint32_t crc = entry_node ? entry_node->crc : 0;
+
+	pthread_mutex_unlock(&entry_list_lock);
+
+	if (claim == CLAIM_CRC)
+		return fcp_entry_crc_put(ffs, name, crc);
+
+	/* the data changed under a CRC this table may still carry */
+	uint32_t user[FFS_USER_WORDS];
+	if (__ffs_entry_user_get_all(ffs, name, user) < 0)
+		return -1;
+
+	user[USER_DATA_VOL] &= ~FFS_ENTRY_INTEG_CRC;
+
+	return __ffs_entry_user_put_all(ffs, name, user,
+					1U << USER_DATA_VOL);
+}
+
 ffs_entry_t * entry_list_find(entry_list_t * self, const char * name)
 {
 	assert(self != NULL);
@@ -493,6 +619,24 @@ int entry_list_dump(entry_list_t * self, FILE * out)
 	return 0;
 }
 
+/* compressed containers read as the image they hold */
+static FILE *__fopen_zimage(FILE * file, const char * target,
+			    const char * mode)
+{
+	if (strchr(mode, '+') != NULL) {
+		UNEXPECTED("'%s' is a compressed image, which is read-only",
+			   target);
+		fclose(file);
+		return NULL;
+	}
+
+	FILE *image = __ffs_zimage_fopen(file);
+	if (image == NULL)
+		fclose(file);
+
+	return image;
+}
+
 FILE *__fopen(const char * type, const char * target, const char * mode,
 	      int debug)
 {
@@ -520,6 +664,8 @@ FILE *__fopen(const char * type, const char * target, const char * mode,
 		file = fopen(target, mode);
 		if (file == NULL)
 			ERRNO(errno);
+		else if (*mode != 'w' && __ffs_zimage_fcheck(file) == 1)
+			file = __fopen_zimage(file, target, mode);
 	} else {
 		errno = EINVAL;
 		ERRNO(errno);
@@ -528,6 +674,190 @@ FILE *__fopen(const char * type, const char * target, const char * mode,
 	return file;
 }
 
+int setup_io(ffs_t * ffs, const char * depth, bool sparse)
+{
+	assert(ffs != NULL);
+
+	if (__ffs_set_sparse(ffs, sparse) < 0)
+		return -1;
+
+	if (depth == NULL)
+		return 0;
+
+	uint32_t value;
+	if (parse_number(depth, &value) < 0)
+		return -1;
+
+	if (__ffs_io_setup(ffs, value) < 0)
+		return -1;
+
+	if (0 < value && __ffs_io_depth(ffs->io) == 0)
+		verbose("%8llx: io_uring unavailable, using pread/pwrite\n",
+			(long long)ffs->offset);
+
+	return 0;
+}
+
+typedef struct offset_job offset_job_t;
+struct offset_job {
+	args_t * args;
+	off_t offset;
+	int (*func)(args_t *, off_t, void *);
+	void * ctx;
+};
+
+static int __offset_job(void * arg)
+{
+	offset_job_t * job = (offset_job_t *)arg;
+	return job->func(job->args, job->offset, job->ctx);
+}
+
+static int __parse_offsets(args_t * args, off_t * offsets, size_t * nr)
+{
+	char * end = (char *)args->offset;
+	while (end != NULL && *end != '\0') {
+		errno = 0;
+		off_t offset = strtoull(end, &end, 0);
+		if (end == NULL || errno != 0) {
+			UNEXPECTED("invalid --offset specified '%s'",
+				   args->offset);
+			return -1;
+		}
+
+		if (*end != ',' && *end != ':' && *end != '\0') {
+			UNEXPECTED("invalid --offset separator "
+				   "character '%c'", *end);
+			return -1;
+		}
+
+		offsets[(*nr)++] = offset;
+
+		if (*end == '\0')
+			break;
+		end++;
+	}
+
+	return 0;
+}
+
+static int __run_offsets(args_t * args, const off_t * offsets, size_t nr,
+			 int (*func)(args_t *, off_t, void *), void * ctx)
+{
+	uint32_t threads = 1;
+	if (args->jobs != NULL)
+		if (parse_number(args->jobs, &threads) < 0)
+			return -1;
+	if (threads == 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (threads <= 1 || nr <= 1) {
+		for (size_t i = 0; i < nr; i++)
+			if (func(args, offsets[i], ctx) < 0)
+				return -1;
+		return 0;
+	}
+
+	/* every table (primary, backup, ...) in parallel */
+	offset_job_t jobs[nr];
+
+	workq_t * wq = workq_create(min((size_t)threads, nr));
+	if (wq == NULL)
+		return -1;
+
+	for (size_t i = 0; i < nr; i++) {
+		jobs[i] = (offset_job_t){ args, offsets[i], func, ctx };
+
+		if (workq_add(wq, __offset_job, &jobs[i]) < 0) {
+			workq_delete(wq);
+			return -1;
+		}
+	}
+
+	return workq_delete(wq);
+}
+
+int for_each_offset(args_t * args, int (*func)(args_t *, off_t, void *),
+		    void * ctx)
+{
+	assert(args != NULL);
+	assert(func != NULL);
+
+	size_t nr = 0;
+	off_t offsets[strlen(args->offset) / 2 + 1];
+
+	if (__parse_offsets(args, offsets, &nr) < 0)
+		return -1;
+
+	return __run_offsets(args, offsets, nr, func, ctx);
+}
+
+/*
+ * for_each_offset() over the --offset tables of 'file' and every table
+ * nested in them, breadth first and each table once.  Nested tables are
+ * read over the same stream and run in parallel with the others.
+ */
+int for_each_table(args_t * args, FILE * file,
+		   int (*func)(args_t *, off_t, void *), void * ctx)
+{
+	assert(args != NULL);
+	assert(file != NULL);
+	assert(func != NULL);
+
+	size_t nr = 0, sz = strlen(args->offset) / 2 + 1;
+
+	RAII(off_t*, offsets, malloc(sz * sizeof(off_t)), free);
+	if (offsets == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	if (__parse_offsets(args, offsets, &nr) < 0)
+		return -1;
+
+	for (size_t i = 0; i < nr; i++) {
+		/* a missing table is reported by 'func' */
+		int rc = __ffs_fcheck_table(file, offsets[i], NULL);
+		if (rc == -1)
+			return -1;
+		if (rc != 0)
+			continue;
+
+		RAII(ffs_t*, ffs, __ffs_fopen(file, offsets[i]), __ffs_fclose);
+		if (ffs == NULL)
+			return -1;
+
+		RAII(off_t*, nested, NULL, free);
+		int count = __ffs_nested(ffs, &nested);
+		if (count < 0)
+			return -1;
+
+		for (int j = 0; j < count; j++) {
+			bool seen = false;
+			for (size_t k = 0; k < nr && !seen; k++)
+				seen = offsets[k] == nested[j];
+			if (seen)
+				continue;
+
+			if (nr == sz) {
+				off_t * tmp = realloc(offsets, sz * 2 *
+						      sizeof(off_t));
+				if (tmp == NULL) {
+					ERRNO(errno);
+					return -1;
+				}
+				offsets = tmp, sz *= 2;
+			}
+
+			offsets[nr++] = nested[j];
+
+			verbose("%8llx: nested partition table at '%llx'\n",
+				(long long)offsets[i], (long long)nested[j]);
+		}
+	}
+
+	return __run_offsets(args, offsets, nr, func, ctx);
+}
+
 int is_file(const char * type, const char * target, const char * name)
 {
 	return type == NULL && target != NULL && name == NULL;
@@ -542,7 +872,41 @@ int valid_type(const char * type)
 	       strcasecmp(type, TYPE_SFC) == 0;
 }
 
-int fcp_read_entry(ffs_t * src, const char * name, FILE * out)
+/*
+ * Record the CRC32C of an entry that was streamed from start to end, the
+ * library already dropped FFS_ENTRY_INTEG_CRC when the data was modified
+ */
+int fcp_entry_crc_put(ffs_t * ffs, const char * name, uint32_t crc)
+{
+	assert(ffs != NULL);
+	assert(name != NULL);
+
+	uint32_t user[FFS_USER_WORDS];
+	if (__ffs_entry_user_get_all(ffs, name, user) < 0)
+		return -1;
+
+	user[USER_DATA_VOL] |= FFS_ENTRY_INTEG_CRC;
+	user[USER_DATA_CRC] = crc;
+
+	return __ffs_entry_user_put_all(ffs, name, user,
+					1U << USER_DATA_VOL |
+					1U << USER_DATA_CRC);
+}
+
+/*
+ * Transfer buffer: the whole device on small flash, bounded on large
+ * devices so that memory use doesn't grow with the image
+ */
+static size_t __buffer_size(uint32_t block_size, uint32_t block_count)
+{
+	size_t size = (size_t)block_size * block_count;
+	size_t limit = max((size_t)block_size,
+			   BUFFER_MAX - BUFFER_MAX % block_size);
+
+	return min(size, limit);
+}
+
+ssize_t fcp_read_entry(ffs_t * src, const char * name, FILE * out)
 {
 	assert(src != NULL);
 	assert(name != NULL);
@@ -555,7 +919,7 @@ int fcp_read_entry(ffs_t * src, const char * name, FILE * out)
 	if (__ffs_info(src, FFS_INFO_BLOCK_COUNT, &block_count) < 0)
 		return -1;
 
-	size_t buffer_size = block_size * block_count;
+	size_t buffer_size = __buffer_size(block_size, block_count);
 	RAII(void*, buffer, malloc(buffer_size), free);
 	if (buffer == NULL) {
 		ERRNO(errno);
@@ -569,17 +933,19 @@ int fcp_read_entry(ffs_t * src, const char * name, FILE * out)
 		return -1;
 	}
 
-	uint32_t poffset;
-	if (__ffs_info(src, FFS_INFO_OFFSET, &poffset) < 0)
+	uint64_t poffset;
+	if (__ffs_info64(src, FFS_INFO_OFFSET, &poffset) < 0)
 		return -1;
 
-	uint32_t total = 0;
-	uint32_t size = entry.actual;
+	uint64_t actual = __ffs_entry_actual(src, &entry);
+	uint64_t total = 0;
+	uint64_t size = actual;
 	off_t offset = 0;
 
 	if (isatty(fileno(stderr))) {
-		fprintf(stderr, "%8x: %s: read partition %8x/%8x",
-			poffset, name, entry.actual, total);
+		fprintf(stderr, "%8llx: %s: read partition %8llx/%8llx",
+			(long long)poffset, name, (long long)actual,
+			(long long)total);
 	}
 
 	while (0 < size) {
@@ -587,7 +953,15 @@ int fcp_read_entry(ffs_t * src, const char * name, FILE * out)
 
 		ssize_t rc;
 		rc = __ffs_entry_read(src, name, buffer, offset, count);
-
+		if (rc < 0)
+			return -1;
+		if (rc == 0) {
+			UNEXPECTED("'%s' short read at offset '%llx', '%llx' "
+				   "of '%llx' bytes read", name,
+				   (long long)offset, (long long)total,
+				   (long long)actual);
+			return -1;
+		}
 
 		rc = fwrite(buffer, 1, rc, out);
 		if (rc <= 0 && ferror(out)) {
@@ -601,7 +975,8 @@ int fcp_read_entry(ffs_t * src, const char * name, FILE * out)
 
 		if (isatty(fileno(stderr))) {
 			fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
-			fprintf(stderr, "%8x/%8x", entry.actual, total);
+			fprintf(stderr, "%8llx/%8llx", (long long)actual,
+				(long long)total);
 		}
 	}
 
@@ -612,7 +987,60 @@ int fcp_read_entry(ffs_t * src, const char * name, FILE * out)
 	return total;
 }
 
-int fcp_write_entry(ffs_t * dst, const char * name, FILE * in)
+/*
+ * Write only the erase blocks of [offset, offset + count) whose current
+ * contents differ from buf.  Runs of dirty blocks are coalesced into one
+ * write.  Returns the number of bytes consumed from buf (written plus
+ * skipped); *skipped is advanced by the number of bytes left untouched.
+ */
+static ssize_t __write_diff(ffs_t * dst, const char * name, const void * buf,
+			    void * scratch, off_t offset, size_t count,
+			    uint32_t block_size, size_t * skipped)
+{
+	ssize_t rc = __ffs_entry_read(dst, name, scratch, offset, count);
+	if (rc < 0)
+		return -1;
+
+	size_t have = rc, total = 0, dirty = 0;
+
+	while (total < count) {
+		size_t n = min((size_t)(block_size -
+				        (offset + total) % block_size),
+			       count - total);
+
+		bool same = total + n <= have &&
+		    memdiff((const uint8_t *)buf + total,
+			    (const uint8_t *)scratch + total, n) == n;
+
+		if (same == false && dirty == 0)
+			dirty = total + 1;
+
+		total += n;
+
+		if (dirty != 0 && (same == true || total == count)) {
+			size_t start = dirty - 1;
+			size_t end = same ? total - n : total;
+
+			rc = __ffs_entry_write(dst, name,
+					       (const uint8_t *)buf + start,
+					       offset + start, end - start);
+			if (rc < 0)
+				return -1;
+			if ((size_t)rc < end - start)
+				return start + rc;
+
+			dirty = 0;
+		}
+
+		if (same == true)
+			*skipped += n;
+	}
+
+	return total;
+}
+
+ssize_t fcp_write_entry(ffs_t * dst, const char * name, FILE * in, bool diff,
+		    journal_t * journal)
 {
 	assert(dst != NULL);
 	assert(name != NULL);
@@ -625,13 +1053,19 @@ int fcp_write_entry(ffs_t * dst, const char * name, FILE * in)
 	if (__ffs_info(dst, FFS_INFO_BLOCK_COUNT, &block_count) < 0)
 		return -1;
 
-	size_t buffer_size = block_size * block_count;
+	size_t buffer_size = __buffer_size(block_size, block_count);
 	RAII(void*, buffer, malloc(buffer_size), free);
 	if (buffer == NULL) {
 		ERRNO(errno);
 		return -1;
 	}
 
+	RAII(void*, scratch, diff ? malloc(buffer_size) : NULL, free);
+	if (diff && scratch == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
 	ffs_entry_t entry;
 	if (__ffs_entry_find(dst, name, &entry) == false) {
 		UNEXPECTED("'%s' partition not found => %s",
@@ -639,21 +1073,27 @@ int fcp_write_entry(ffs_t * dst, const char * name, FILE * in)
 		return -1;
 	}
 
-	uint32_t poffset;
-	if (__ffs_info(dst, FFS_INFO_OFFSET, &poffset) < 0)
+	uint64_t poffset;
+	if (__ffs_info64(dst, FFS_INFO_OFFSET, &poffset) < 0)
 		return -1;
 
-	uint32_t total = 0;
-	uint32_t size = entry.actual;
+	uint64_t actual = __ffs_entry_actual(dst, &entry);
+	uint64_t total = 0;
+	uint64_t size = actual;
 	off_t offset = 0;
+	size_t skipped = 0;
+	uint32_t sum = 0;
 
 	if (isatty(fileno(stderr))) {
-		fprintf(stderr, "%8x: %s: write partition %8x/%8x",
-			poffset, name, entry.actual, total);
+		fprintf(stderr, "%8llx: %s: write partition %8llx/%8llx",
+			(long long)poffset, name, (long long)actual,
+			(long long)total);
 	}
 
 	while (0 < size) {
 		size_t count = min(buffer_size, size);
+		if (journal != NULL)
+			count = min(count, JOURNAL_CHUNK - offset % JOURNAL_CHUNK);
 
 		ssize_t rc;
 		rc = fread(buffer, 1, count, in);
@@ -666,10 +1106,40 @@ int fcp_write_entry(ffs_t * dst, const char * name, FILE * in)
 			}
 		}
 
-		rc = __ffs_entry_write(dst, name, buffer, offset, rc);
+		uint32_t crc = 0;
+		if (journal != NULL) {
+			crc = crc32c(0, buffer, rc);
+			if (journal_done(journal, dst, name, offset, rc, crc)) {
+				skipped += rc;
+				goto next;
+			}
+		}
+
+		if (diff) {
+			size_t prev = skipped;
+			rc = __write_diff(dst, name, buffer, scratch, offset,
+					  rc, block_size, &skipped);
+			if (rc < 0)
+				return -1;
+			if (rc == 0)
+				break;
+			if ((size_t)rc != skipped - prev &&
+			    __ffs_fsync(dst) < 0)
+				return -1;
+		} else {
+			rc = __ffs_entry_write(dst, name, buffer, offset, rc);
+			if (rc < 0)
+				return -1;
+
+			if (__ffs_fsync(dst) < 0)
+				return -1;
+		}
 
-		if (__ffs_fsync(dst) < 0)
+		if (journal != NULL &&
+		    journal_record(journal, dst, name, offset, rc, crc) < 0)
 			return -1;
+next:
+		sum = crc32c(sum, buffer, rc);
 
 		size -= rc;
 		total += rc;
@@ -677,7 +1147,8 @@ int fcp_write_entry(ffs_t * dst, const char * name, FILE * in)
 
 		if (isatty(fileno(stderr))) {
 			fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
-			fprintf(stderr, "%8x/%8x", entry.actual, total);
+			fprintf(stderr, "%8llx/%8llx", (long long)actual,
+				(long long)total);
 		}
 	}
 
@@ -685,10 +1156,23 @@ int fcp_write_entry(ffs_t * dst, const char * name, FILE * in)
 		fprintf(stderr, "\n");
 	}
 
+	if (journal != NULL && journal_checkpoint(journal, dst) < 0)
+		return -1;
+
+	if (total == actual && fcp_entry_crc_put(dst, name, sum) < 0)
+		return -1;
+
+	if (diff || (journal != NULL && skipped != 0))
+		fprintf(stderr, "%8llx: %s: %s write %llx written, %zx "
+			"skipped\n", (long long)poffset, name,
+			diff ? "diff" : "journal",
+			(long long)(total - skipped), skipped);
+
 	return total;
 }
 
-int fcp_erase_entry(ffs_t * dst, const char * name, char fill)
+ssize_t fcp_erase_entry(ffs_t * dst, const char * name, char fill,
+		    journal_t * journal)
 {
 	assert(dst != NULL);
 	assert(name != NULL);
@@ -697,19 +1181,6 @@ int fcp_erase_entry(ffs_t * dst, const char * name, char fill)
 	if (__ffs_info(dst, FFS_INFO_BLOCK_SIZE, &block_size) < 0)
 		return -1;
 
-	uint32_t block_count;
-	if (__ffs_info(dst, FFS_INFO_BLOCK_COUNT, &block_count) < 0)
-		return -1;
-
-	size_t buffer_size = block_size * block_count;
-	RAII(void*, buffer, malloc(buffer_size), free);
-	if (buffer == NULL) {
-		ERRNO(errno);
-		return -1;
-	}
-
-	memset(buffer, fill, buffer_size);
-
 	ffs_entry_t entry;
 	if (__ffs_entry_find(dst, name, &entry) == false) {
 		UNEXPECTED("'%s' partition not found => %s",
@@ -717,26 +1188,61 @@ int fcp_erase_entry(ffs_t * dst, const char * name, char fill)
 		return -1;
 	}
 
-	uint32_t poffset;
-	if (__ffs_info(dst, FFS_INFO_OFFSET, &poffset) < 0)
+	uint64_t poffset;
+	if (__ffs_info64(dst, FFS_INFO_OFFSET, &poffset) < 0)
 		return -1;
 
-	uint32_t total = 0;
-	uint32_t size = entry.size * block_size;
+	uint64_t total = 0;
+	uint64_t size = (uint64_t)entry.size * block_size;
 	off_t offset = 0;
 
 	if (isatty(fileno(stderr))) {
-		fprintf(stderr, "%8x: %s: erase partition %8x/%8x",
-			poffset, name, entry.actual, total);
+		fprintf(stderr, "%8llx: %s: erase partition %8llx/%8llx",
+			(long long)poffset, name,
+			(long long)__ffs_entry_actual(dst, &entry),
+			(long long)total);
 	}
 
+	bool dirty = false;
+	uint32_t crc = 0;
+
+	if (journal != NULL)
+		crc = crc32c_fill(0, fill, block_size);
+
 	while (0 < size) {
-		size_t count = min(buffer_size, size);
+		size_t count = min((size_t)block_size, size);
+
+		if (journal != NULL) {
+			if (count < block_size)
+				crc = crc32c_fill(0, fill, count);
+			if (journal_done(journal, dst, name, offset, count,
+					 crc)) {
+				size -= count;
+				total += count;
+				offset += count;
+				continue;
+			}
+		}
 
-		ssize_t rc;
-		rc = __ffs_entry_write(dst, name, buffer, offset, count);
+		/* skip erase blocks that already hold the fill value */
+		int blank = __ffs_entry_is_filled(dst, name, fill, offset,
+						  count, NULL);
+		if (blank < 0)
+			return -1;
+
+		ssize_t rc = count;
+		if (blank == 0) {
+			rc = __ffs_entry_fill(dst, name, fill, offset, count);
+			if (rc < 0)
+				return -1;
+			if (rc == 0)
+				break;
+
+			dirty = true;
+		}
 
-		if (__ffs_fsync(dst) < 0)
+		if (journal != NULL &&
+		    journal_record(journal, dst, name, offset, rc, crc) < 0)
 			return -1;
 
 		size -= rc;
@@ -745,16 +1251,27 @@ int fcp_erase_entry(ffs_t * dst, const char * name, char fill)
 
 		if (isatty(fileno(stderr))) {
 			fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
-			fprintf(stderr, "%8x/%8x", entry.size * block_size,
-				total);
+			fprintf(stderr, "%8llx/%8llx",
+				(long long)entry.size * block_size,
+				(long long)total);
 		}
 	}
 
+	if (dirty && __ffs_fsync(dst) < 0)
+		return -1;
+
+	if (journal != NULL && journal_checkpoint(journal, dst) < 0)
+		return -1;
+
 	if (__ffs_entry_truncate(dst, name, 0ULL) < 0) {
 		ERRNO(errno);
 		return -1;
 	}
 
+	/* nothing left to describe */
+	if (fcp_entry_crc_put(dst, name, 0) < 0)
+		return -1;
+
 	if (isatty(fileno(stderr))) {
 		fprintf(stderr, "\n");
 	}
@@ -762,8 +1279,9 @@ int fcp_erase_entry(ffs_t * dst, const char * name, char fill)
 	return total;
 }
 
-int fcp_copy_entry(ffs_t * src, const char * src_name,
-		   ffs_t * dst, const char * dst_name)
+ssize_t fcp_copy_entry(ffs_t * src, const char * src_name,
+		   ffs_t * dst, const char * dst_name, bool diff,
+		   journal_t * journal, uint32_t * sum, bool * sum_valid)
 {
 	assert(src != NULL);
 	assert(src_name != NULL);
@@ -778,13 +1296,19 @@ int fcp_copy_entry(ffs_t * src, const char * src_name,
 	if (__ffs_info(dst, FFS_INFO_BLOCK_COUNT, &block_count) < 0)
 		return -1;
 
-	size_t buffer_size = block_size * block_count;
+	size_t buffer_size = __buffer_size(block_size, block_count);
 	RAII(void*, buffer, malloc(buffer_size), free);
 	if (buffer == NULL) {
 		ERRNO(errno);
 		return -1;
 	}
 
+	RAII(void*, scratch, diff ? malloc(buffer_size) : NULL, free);
+	if (diff && scratch == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
 	ffs_entry_t src_entry;
 	if (__ffs_entry_find(src, src_name, &src_entry) == false) {
 		UNEXPECTED("'%s' partition not found => %s",
@@ -799,28 +1323,123 @@ int fcp_copy_entry(ffs_t * src, const char * src_name,
 		return -1;
 	}
 
-	uint32_t total = 0;
-	uint32_t size = src_entry.actual;
+	uint64_t actual = __ffs_entry_actual(src, &src_entry);
+	uint64_t total = 0;
+	uint64_t size = actual;
 	off_t offset = 0;
+	size_t skipped = 0;
+	bool kernel = false;	/* data copied w/o passing through here */
+
+	*sum = 0;
 
 	if (isatty(fileno(stderr))) {
-		fprintf(stderr, "%8llx: %s: copy partition %8x/%8x",
-			(long long)src->offset, dst_name, src_entry.actual, total);
+		fprintf(stderr, "%8llx: %s: copy partition %8llx/%8llx",
+			(long long)src->offset, dst_name, (long long)actual,
+			(long long)total);
 	}
 
 	while (0 < size) {
-		size_t count = min(buffer_size, size);
+		/* holes in a sparse source are erased in the destination */
+		off_t data = __ffs_entry_seek(src, src_name, offset, SEEK_DATA);
+		if (data < 0)
+			return -1;
+
+		off_t hole = data;
+		if (data == offset) {
+			hole = __ffs_entry_seek(src, src_name, offset,
+						SEEK_HOLE);
+			if (hole < 0)
+				return -1;
+		}
+
+		size_t extent = min((size_t)(hole - offset), (size_t)size);
+		if (offset < data)
+			extent = min((size_t)(data - offset), (size_t)size);
+		if (journal != NULL)
+			extent = min(extent, (size_t)(JOURNAL_CHUNK -
+						      offset % JOURNAL_CHUNK));
 
+		uint32_t crc = 0;
+		bool hashed = false;	/* data at hand in 'buffer' */
 		ssize_t rc;
-		rc = __ffs_entry_read(src, src_name, buffer, offset, count);
-		if (rc < 0)
-			return -1;
-		rc = __ffs_entry_write(dst, dst_name, buffer, offset, rc);
-		if (rc < 0)
-			return -1;
+		if (offset < data) {
+			if (journal != NULL) {
+				crc = crc32c_fill(0, FFS_SPARSE_FILL, extent);
+				if (journal_done(journal, dst, dst_name, offset,
+						 extent, crc)) {
+					rc = extent;
+					skipped += rc;
+					goto next;
+				}
+			}
+
+			rc = __ffs_entry_fill(dst, dst_name, FFS_SPARSE_FILL,
+					      offset, extent);
+			if (rc < 0)
+				return -1;
+		} else if (diff == false && journal == NULL) {
+			/* file-to-file: reflink / copy_file_range */
+			rc = __ffs_entry_copy_range(dst, dst_name, src,
+						    src_name, offset, extent);
+			if (rc < 0)
+				return -1;
+			if (0 < rc)
+				kernel = true;
+		} else {
+			rc = 0;
+		}
+
+		if (rc == 0) {
+			size_t count = min(buffer_size, extent);
+
+			rc = __ffs_entry_read(src, src_name, buffer, offset,
+					      count);
+			if (rc < 0)
+				return -1;
+			hashed = true;
+
+			if (journal != NULL) {
+				crc = crc32c(0, buffer, rc);
+				if (rc != 0 && journal_done(journal, dst,
+							    dst_name, offset,
+							    rc, crc)) {
+					skipped += rc;
+					goto next;
+				}
+			}
 
-		if (__ffs_fsync(dst) < 0)
+			if (diff) {
+				size_t prev = skipped;
+				rc = __write_diff(dst, dst_name, buffer,
+						  scratch, offset, rc,
+						  block_size, &skipped);
+				if (rc < 0)
+					return -1;
+				if ((size_t)rc != skipped - prev &&
+				    __ffs_fsync(dst) < 0)
+					return -1;
+			} else {
+				rc = __ffs_entry_write(dst, dst_name, buffer,
+						       offset, rc);
+				if (rc < 0)
+					return -1;
+
+				if (__ffs_fsync(dst) < 0)
+					return -1;
+			}
+		}
+
+		if (rc == 0)
+			break;
+
+		if (journal != NULL &&
+		    journal_record(journal, dst, dst_name, offset, rc, crc) < 0)
 			return -1;
+next:
+		if (offset < data)
+			*sum = crc32c_fill(*sum, FFS_SPARSE_FILL, rc);
+		else if (hashed)
+			*sum = crc32c(*sum, buffer, rc);
 
 		size -= rc;
 		total += rc;
@@ -828,7 +1447,8 @@ int fcp_copy_entry(ffs_t * src, const char * src_name,
 
 		if (isatty(fileno(stderr))) {
 			fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
-			fprintf(stderr, "%8x/%8x", (uint32_t)src_entry.actual, total);
+			fprintf(stderr, "%8llx/%8llx", (long long)actual,
+				(long long)total);
 		}
 	}
 
@@ -836,11 +1456,123 @@ int fcp_copy_entry(ffs_t * src, const char * src_name,
 		fprintf(stderr, "\n");
 	}
 
+	if (journal != NULL && journal_checkpoint(journal, dst) < 0)
+		return -1;
+
+	/* rather than reading it all back, the source CRC describes the
+	 * data the kernel copied, if there is one */
+	*sum_valid = total == actual;
+	if (kernel) {
+		*sum_valid = *sum_valid && (src_entry.user.data[USER_DATA_VOL] &
+					    FFS_ENTRY_INTEG_CRC);
+		*sum = src_entry.user.data[USER_DATA_CRC];
+	}
+
+	if (diff || (journal != NULL && skipped != 0))
+		fprintf(stderr, "%8llx: %s: %s copy %llx written, %zx "
+			"skipped\n", (long long)src->offset, dst_name,
+			diff ? "diff" : "journal",
+			(long long)(total - skipped), skipped);
+
 	return total;
 }
 
-int fcp_compare_entry(ffs_t * src, const char * src_name,
-		      ffs_t * dst, const char * dst_name)
+/*
+ * Miscompare ranges are coalesced while the gap between two differing
+ * bytes is shorter than COMPARE_SIZE.
+ */
+typedef struct {
+	const char * name;
+	off_t poffset;
+	uint32_t block_size;
+
+	off_t start, end;	/* current range, empty if start == end */
+	size_t count;		/* differing bytes in current range */
+
+	uint64_t bytes;		/* differing bytes, total */
+	uint32_t blocks;	/* erase blocks with at least one diff */
+	off_t last_block;
+
+	size_t ranges, max_ranges;
+} miscompare_t;
+
+static void __miscompare_flush(miscompare_t * self)
+{
+	if (self->start == self->end)
+		return;
+
+	if (self->max_ranges == 0 || self->ranges < self->max_ranges)
+		printf("%8llx: %s: miscompare offset %8llx length %8llx "
+		       "count %8zx\n", (long long)self->poffset, self->name,
+		       (long long)self->start,
+		       (long long)(self->end - self->start), self->count);
+	else if (self->ranges == self->max_ranges)
+		printf("%8llx: %s: miscompare ... (limit reached)\n",
+		       (long long)self->poffset, self->name);
+
+	self->ranges++;
+	self->start = self->end = 0;
+	self->count = 0;
+}
+
+static void __miscompare_add(miscompare_t * self, off_t offset, size_t len)
+{
+	if (self->start != self->end &&
+	    offset - self->end >= (off_t)COMPARE_SIZE)
+		__miscompare_flush(self);
+
+	if (self->start == self->end)
+		self->start = offset;
+	self->end = offset + len;
+	self->count += len;
+	self->bytes += len;
+
+	off_t first = offset / self->block_size;
+	off_t last = (offset + len - 1) / self->block_size;
+	if (first <= self->last_block)
+		first = self->last_block + 1;
+	if (first <= last) {
+		self->blocks += last - first + 1;
+		self->last_block = last;
+	}
+}
+
+/* record every run of differing bytes in a[0..n) vs b[0..n) */
+static void __miscompare_scan(miscompare_t * self, off_t offset,
+			      const uint8_t * a, const uint8_t * b, size_t n)
+{
+	size_t i = 0;
+
+	while (i < n) {
+		i += memdiff(a + i, b + i, n - i);
+		if (n <= i)
+			break;
+
+		size_t j = i + 1;
+		while (j < n && a[j] != b[j])
+			j++;
+
+		__miscompare_add(self, offset + i, j - i);
+		i = j;
+	}
+}
+
+static int __miscompare_report(miscompare_t * self, const char * src_name)
+{
+	if (self->bytes == 0)
+		return 0;
+
+	printf("%8llx: %s: %llx bytes differ in %x blocks, %zx "
+	       "ranges\n", (long long)self->poffset, self->name,
+	       (long long)self->bytes, self->blocks, self->ranges);
+
+	UNEXPECTED("MISCOMPARE! '%s' != '%s', %llx bytes differ\n",
+		   src_name, self->name, (long long)self->bytes);
+	return -1;
+}
+
+ssize_t fcp_compare_entry(ffs_t * src, const char * src_name,
+		      ffs_t * dst, const char * dst_name, size_t max_ranges)
 {
 	assert(src != NULL);
 	assert(src_name != NULL);
@@ -855,7 +1587,7 @@ int fcp_compare_entry(ffs_t * src, const char * src_name,
 	if (__ffs_info(dst, FFS_INFO_BLOCK_COUNT, &block_count) < 0)
 		return -1;
 
-	size_t buffer_size = block_size * block_count;
+	size_t buffer_size = __buffer_size(block_size, block_count);
 
 	RAII(void*, src_buffer, malloc(buffer_size), free);
 	if (src_buffer == NULL) {
@@ -882,56 +1614,228 @@ int fcp_compare_entry(ffs_t * src, const char * src_name,
 		return -1;
 	}
 
-	uint32_t total = 0;
-	uint32_t size = src_entry.actual;
+	miscompare_t mis = {
+		.name = dst_name,
+		.poffset = src->offset,
+		.block_size = block_size,
+		.last_block = -1,
+		.max_ranges = max_ranges,
+	};
+
+	uint64_t actual = __ffs_entry_actual(src, &src_entry);
+	uint64_t total = 0;
+	uint64_t size = actual;
 	off_t offset = 0;
 
 	if (isatty(fileno(stderr))) {
-		fprintf(stderr, "%8llx: %s: compare partition %8x/%8x",
-			(long long)src->offset, dst_name, src_entry.actual, total);
+		fprintf(stderr, "%8llx: %s: compare partition %8llx/%8llx",
+			(long long)src->offset, dst_name, (long long)actual,
+			(long long)total);
 	}
 
 	while (0 < size) {
+		/* ranges that are holes in both sparse images are equal */
+		off_t src_data = __ffs_entry_seek(src, src_name, offset,
+						  SEEK_DATA);
+		if (src_data < 0)
+			return -1;
+		off_t dst_data = __ffs_entry_seek(dst, dst_name, offset,
+						  SEEK_DATA);
+		if (dst_data < 0)
+			return -1;
+
+		if (offset < min(src_data, dst_data)) {
+			uint64_t skip = min(min(src_data, dst_data) - offset,
+					    (off_t)size);
+			size -= skip;
+			total += skip;
+			offset += skip;
+			continue;
+		}
+
 		size_t count = min(buffer_size, size);
 
 		ssize_t rc;
 		rc = __ffs_entry_read(src, src_name, src_buffer, offset, count);
 		if (rc < 0)
 			return -1;
-		rc = __ffs_entry_read(dst, dst_name, dst_buffer, offset, rc);
+		if (rc == 0)
+			break;
+		count = rc;
+
+		rc = __ffs_entry_read(dst, dst_name, dst_buffer, offset, count);
 		if (rc < 0)
 			return -1;
 
-		char * src_ptr = src_buffer;
-		char * dst_ptr = dst_buffer;
-		size_t cnt = 0;
+		__miscompare_scan(&mis, offset, src_buffer, dst_buffer, rc);
+
+		/* past the end of the destination data */
+		if ((size_t)rc < count)
+			__miscompare_add(&mis, offset + rc, count - rc);
+
+		size -= count;
+		total += count;
+		offset += count;
+
+		if (isatty(fileno(stderr))) {
+			fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
+			fprintf(stderr, "%8llx/%8llx", (long long)actual,
+				(long long)total);
+		}
+	}
+
+	__miscompare_flush(&mis);
+
+	if (isatty(fileno(stderr))) {
+		if (mis.bytes != 0)
+			fprintf(stderr, " <== [ERROR]");
+		fprintf(stderr, "\n");
+	}
+
+	if (__miscompare_report(&mis, src_name) < 0)
+		return -1;
 
-		while (cnt < count) {
-			size_t cmp_sz = min(count - cnt, COMPARE_SIZE);
+	return total;
+}
 
-			if (memcmp(src_ptr, dst_ptr, cmp_sz) != 0) {
-				UNEXPECTED("MISCOMPARE! '%s' != '%s' at "
-					   "offset '%llx'\n", src_name,
-					   dst_name, (long long)offset + cnt);
+/*
+ * Partitions that are adjacent on flash (each one full up to the base of
+ * the next) are copied as a single range, so a wildcard copy turns into
+ * a few long sequential transfers instead of a seek per partition.  The
+ * destination sizes were already set by the caller.
+ */
+/* continue the CRC of each extent overlapping [offset, offset + count) */
+static void __extent_crc(fcp_extent_t * ext, size_t nr, off_t offset,
+			 const uint8_t * buf, size_t count)
+{
+	for (size_t i = 0; i < nr; i++) {
+		off_t lo = max(offset, ext[i].src_base);
+		off_t hi = min(offset + (off_t)count,
+			       ext[i].src_base + (off_t)ext[i].src_actual);
+		if (hi <= lo)
+			continue;
+
+		if (buf == NULL)
+			ext[i].crc = crc32c_fill(ext[i].crc, FFS_SPARSE_FILL,
+						 hi - lo);
+		else
+			ext[i].crc = crc32c(ext[i].crc, buf + (lo - offset),
+					    hi - lo);
+	}
+}
 
-				if (isatty(fileno(stderr)))
-					fprintf(stderr, " <== [ERROR]\n");
+int fcp_copy_run(ffs_t * src, ffs_t * dst, fcp_extent_t * ext, size_t nr)
+{
+	assert(src != NULL);
+	assert(dst != NULL);
+	assert(ext != NULL);
 
+	if (nr == 0)
+		return 0;
+
+	uint32_t block_size;
+	if (__ffs_info(src, FFS_INFO_BLOCK_SIZE, &block_size) < 0)
+		return -1;
+
+	uint32_t block_count;
+	if (__ffs_info(dst, FFS_INFO_BLOCK_COUNT, &block_count) < 0)
+		return -1;
+
+	size_t buffer_size = __buffer_size(block_size, block_count);
+	RAII(void*, buffer, malloc(buffer_size), free);
+	if (buffer == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	/* 'src_actual' is bounded by the partition size, so fits an off_t */
+	for (size_t i = 1; i < nr; i++) {
+		if (ext[i - 1].src_base + (off_t)ext[i - 1].src_actual !=
+		    ext[i].src_base ||
+		    ext[i].dst_base - ext[i].src_base !=
+		    ext[0].dst_base - ext[0].src_base) {
+			UNEXPECTED("'%s' and '%s' are not adjacent",
+				   ext[i - 1].dst_name, ext[i].dst_name);
+			return -1;
+		}
+	}
+
+	off_t delta = ext[0].dst_base - ext[0].src_base;
+	off_t offset = ext[0].src_base;
+	off_t end = ext[nr - 1].src_base + (off_t)ext[nr - 1].src_actual;
+
+	bool kernel[nr];	/* data copied w/o passing through here */
+
+	for (size_t i = 0; i < nr; i++)
+		ext[i].crc = 0, kernel[i] = false;
+
+	if (isatty(fileno(stderr))) {
+		fprintf(stderr, "%8llx: %s..%s: copy %zu partitions %8llx/%8x",
+			(long long)src->offset, ext[0].dst_name,
+			ext[nr - 1].dst_name, nr, (long long)(end - offset), 0);
+	}
+
+	while (offset < end) {
+		/* holes in a sparse source are erased in the destination */
+		off_t data = __ffs_seek(src, offset, end, SEEK_DATA);
+		if (data < 0)
+			return -1;
+
+		off_t hole = data;
+		if (data == offset) {
+			hole = __ffs_seek(src, offset, end, SEEK_HOLE);
+			if (hole < 0)
 				return -1;
-			}
+		}
 
-			src_ptr += cmp_sz;
-			dst_ptr += cmp_sz;
-			cnt += cmp_sz;
+		ssize_t rc;
+		if (offset < data) {
+			rc = __ffs_fill(dst, FFS_SPARSE_FILL, offset + delta,
+					data - offset);
+			if (rc < 0)
+				return -1;
+			__extent_crc(ext, nr, offset, NULL, rc);
+		} else {
+			rc = __ffs_copy_range(dst, offset + delta, src, offset,
+					      hole - offset);
+			if (rc < 0)
+				return -1;
+
+			for (size_t i = 0; i < nr && 0 < rc; i++)
+				if (offset < ext[i].src_base +
+				    (off_t)ext[i].src_actual &&
+				    ext[i].src_base < offset + rc)
+					kernel[i] = true;
 		}
 
-		size -= rc;
-		total += rc;
+		if (rc == 0) {
+			size_t count = min(buffer_size, (size_t)(hole - offset));
+
+			rc = __ffs_pread(src, buffer, count, offset);
+			if (rc < 0)
+				return -1;
+			if (rc == 0)
+				break;
+
+			rc = __ffs_pwrite(dst, buffer, rc, offset + delta);
+			if (rc < 0)
+				return -1;
+
+			if (__ffs_fsync(dst) < 0)
+				return -1;
+
+			__extent_crc(ext, nr, offset, buffer, rc);
+		}
+
+		if (rc == 0)
+			break;
+
 		offset += rc;
 
 		if (isatty(fileno(stderr))) {
-			fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
-			fprintf(stderr, "%8x/%8x", src_entry.actual, total);
+			fprintf(stderr, "\b\b\b\b\b\b\b\b\b");
+			fprintf(stderr, "%8llx", (long long)(offset -
+							      ext[0].src_base));
 		}
 	}
 
@@ -939,5 +1843,187 @@ int fcp_compare_entry(ffs_t * src, const char * src_name,
 		fprintf(stderr, "\n");
 	}
 
-	return total;
+	if (offset < end) {
+		UNEXPECTED("'%s' short read at offset '%llx'", src->path,
+			   (long long)offset);
+		return -1;
+	}
+
+	/* rather than reading it all back, the source CRC describes the
+	 * data the kernel copied, if there is one */
+	for (size_t i = 0; i < nr; i++) {
+		ext[i].crc_valid = true;
+		if (kernel[i] == false)
+			continue;
+
+		ffs_entry_t entry;
+		if (__ffs_entry_find(src, ext[i].src_name, &entry) == false) {
+			UNEXPECTED("'%s' partition not found => %s",
+				   src->path, ext[i].src_name);
+			return -1;
+		}
+
+		ext[i].crc_valid = (entry.user.data[USER_DATA_VOL] &
+				    FFS_ENTRY_INTEG_CRC) != 0;
+		ext[i].crc = entry.user.data[USER_DATA_CRC];
+	}
+
+	return 0;
+}
+
+/*
+ * Partitions that are at most 'gap' bytes apart (in both images) are
+ * compared as a single range, the bytes in between are read and ignored.
+ * Miscompares are accounted to, and reported for, each partition on its
+ * own.
+ */
+int fcp_compare_run(ffs_t * src, ffs_t * dst, const fcp_extent_t * ext,
+		    size_t nr, size_t max_ranges)
+{
+	assert(src != NULL);
+	assert(dst != NULL);
+	assert(ext != NULL);
+
+	if (nr == 0)
+		return 0;
+
+	uint32_t block_size;
+	if (__ffs_info(src, FFS_INFO_BLOCK_SIZE, &block_size) < 0)
+		return -1;
+
+	uint32_t block_count;
+	if (__ffs_info(dst, FFS_INFO_BLOCK_COUNT, &block_count) < 0)
+		return -1;
+
+	size_t buffer_size = __buffer_size(block_size, block_count);
+
+	RAII(void*, src_buffer, malloc(buffer_size), free);
+	if (src_buffer == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+	RAII(void*, dst_buffer, malloc(buffer_size), free);
+	if (dst_buffer == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+	RAII(miscompare_t*, mis, calloc(nr, sizeof(*mis)), free);
+	if (mis == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	off_t delta = ext[0].dst_base - ext[0].src_base;
+
+	for (size_t i = 0; i < nr; i++) {
+		if (ext[i].dst_base - ext[i].src_base != delta ||
+		    (0 < i && ext[i].src_base < ext[i - 1].src_base +
+		     (off_t)ext[i - 1].src_actual)) {
+			UNEXPECTED("'%s' and '%s' are out of order",
+				   ext[i - 1].dst_name, ext[i].dst_name);
+			return -1;
+		}
+
+		mis[i].name = ext[i].dst_name;
+		mis[i].poffset = src->offset;
+		mis[i].block_size = block_size;
+		mis[i].last_block = -1;
+		mis[i].max_ranges = max_ranges;
+	}
+
+	off_t offset = ext[0].src_base;
+	off_t end = ext[nr - 1].src_base + ext[nr - 1].src_actual;
+	size_t first = 0;
+
+	if (isatty(fileno(stderr))) {
+		fprintf(stderr, "%8llx: %s..%s: compare %zu partitions "
+			"%8llx/%8x", (long long)src->offset, ext[0].dst_name,
+			ext[nr - 1].dst_name, nr, (long long)(end - offset), 0);
+	}
+
+	while (offset < end) {
+		/* ranges that are holes in both sparse images are equal */
+		off_t src_data = __ffs_seek(src, offset, end, SEEK_DATA);
+		if (src_data < 0)
+			return -1;
+		off_t dst_data = __ffs_seek(dst, offset + delta, end + delta,
+					    SEEK_DATA);
+		if (dst_data < 0)
+			return -1;
+
+		if (offset < min(src_data, dst_data - delta)) {
+			offset = min(src_data, dst_data - delta);
+			continue;
+		}
+
+		size_t count = min(buffer_size, (size_t)(end - offset));
+
+		ssize_t rc;
+		rc = __ffs_pread(src, src_buffer, count, offset);
+		if (rc < 0)
+			return -1;
+		if (rc == 0)
+			break;
+		count = rc;
+
+		ssize_t dst_rc;
+		dst_rc = __ffs_pread(dst, dst_buffer, count, offset + delta);
+		if (dst_rc < 0)
+			return -1;
+
+		/* split the range back into its partitions */
+		while (first < nr && ext[first].src_base +
+		       (off_t)ext[first].src_actual <= offset)
+			first++;
+
+		for (size_t i = first; i < nr; i++) {
+			const fcp_extent_t * e = ext + i;
+
+			off_t lo = max(offset, e->src_base);
+			off_t hi = min(offset + (off_t)count,
+				       e->src_base + (off_t)e->src_actual);
+			if (hi <= lo)
+				break;
+
+			/* past the end of the destination data */
+			off_t valid = e->src_base + (off_t)min(e->dst_actual,
+							       e->size);
+			valid = max(lo, min(min(hi, valid), offset + dst_rc));
+
+			__miscompare_scan(mis + i, lo - e->src_base,
+					  src_buffer + (lo - offset),
+					  dst_buffer + (lo - offset),
+					  valid - lo);
+			if (valid < hi)
+				__miscompare_add(mis + i, valid - e->src_base,
+						 hi - valid);
+		}
+
+		offset += count;
+
+		if (isatty(fileno(stderr))) {
+			fprintf(stderr, "\b\b\b\b\b\b\b\b\b");
+			fprintf(stderr, "%8llx", (long long)(offset -
+							      ext[0].src_base));
+		}
+	}
+
+	int rc = 0;
+	for (size_t i = 0; i < nr; i++)
+		__miscompare_flush(mis + i);
+
+	if (isatty(fileno(stderr))) {
+		for (size_t i = 0; i < nr; i++)
+			if (mis[i].bytes != 0) {
+				fprintf(stderr, " <== [ERROR]");
+				break;
+			}
+		fprintf(stderr, "\n");
+	}
+
+	for (size_t i = 0; i < nr; i++)
+		if (__miscompare_report(mis + i, ext[i].src_name) < 0)
+			rc = -1;
+
+	return rc;
 }
@@ -36,6 +36,7 @@
 #include <sys/types.h>
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <regex.h>
 
 #include <clib/list.h>
@@ -48,12 +49,27 @@ struct entry_list {
 	ffs_t * ffs;
 };
 
+/* images opened once and shared by the tables at every --offset */
+typedef struct offset_ctx offset_ctx_t;
+struct offset_ctx {
+	FILE * src;
+	FILE * dst;
+	entry_list_t * done_list;
+};
+
 typedef struct entry_node entry_node_t;
 struct entry_node {
 	list_node_t node;
 	ffs_entry_t entry;
+
+	int claim;		/* done_list: CLAIM_*, set by the claimer */
+	uint32_t crc;		/* done_list: CRC word, if CLAIM_CRC */
 };
 
+#define CLAIM_BUSY	0	/* data pass still running */
+#define CLAIM_CRC	1	/* done, the data has a CRC */
+#define CLAIM_NONE	2	/* done (or failed), no CRC */
+
 extern entry_list_t * entry_list_create(ffs_t *);
 extern entry_list_t * entry_list_create_by_regex(ffs_t *, const char *);
 extern int entry_list_add(entry_list_t *, ffs_entry_t *);
@@ -61,6 +77,11 @@ extern int entry_list_add_child(entry_list_t *, ffs_entry_t *);
 extern int entry_list_remove(entry_list_t *, entry_node_t *);
 extern int entry_list_delete(entry_list_t *);
 extern int entry_list_exists(entry_list_t *, ffs_entry_t *);
+extern int entry_list_claim(entry_list_t *, ffs_entry_t *);
+extern void entry_list_settle(entry_list_t *, ffs_entry_t *, ffs_t *,
+			      const char *);
+extern int entry_list_crc_put(entry_list_t *, ffs_entry_t *, ffs_t *,
+			      const char *);
 extern ffs_entry_t * entry_list_find(entry_list_t *, const char *);
 extern int entry_list_dump(entry_list_t *, FILE *);
 
@@ -75,5 +96,6 @@ extern int is_file(const char *, const char *, const char *);
 extern int valid_type(const char *);
 
 extern FILE *__fopen(const char *, const char *, const char *, int);
+extern int setup_io(ffs_t *, const char *, bool);
 
 #endif /* __MISC__H__ */
@@ -34,6 +34,8 @@
 
 /* The version of this partition implementation */
 #define FFS_VERSION_1	1
+/* As version 1, with 64-bit @actual sizes (see struct ffs_entry) */
+#define FFS_VERSION_2	2
 
 /* Magic number for the partition header (ASCII 'PART') */
 #define FFS_MAGIC	0x50415254
@@ -90,6 +92,15 @@ enum user_data {
 	USER_DATA_CRC  = 2,
 };
 
+/*
+ * Data integrity bits of user.data[USER_DATA_VOL]
+ */
+#define FFS_ENTRY_INTEG_ECC	0x8000
+#define FFS_ENTRY_INTEG_CRC	0x4000	/* user.data[USER_DATA_CRC] is valid */
+
+/* Reserved word holding the high 32 bits of 'actual' (FFS_VERSION_2) */
+#define FFS_ENTRY_ACTUAL_HI	0
+
 /**
  * struct ffs_entry - Partition entry
  *
@@ -101,7 +112,8 @@ enum user_data {
  * @type:	Describe type of partition
  * @flags:	Partition attributes (optional)
  * @actual:	Actual partition size (in bytes)
- * @resvd:	Reserved words for future use
+ * @resvd:	Reserved words for future use; in FFS_VERSION_2 tables
+ *		resvd[FFS_ENTRY_ACTUAL_HI] holds the high word of @actual
  * @user:	User data (optional)
  * @checksum:	Partition entry checksum (includes all above)
  */
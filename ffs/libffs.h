@@ -35,6 +35,9 @@
 typedef struct ffs_entry ffs_entry_t;
 typedef struct ffs_hdr ffs_hdr_t;
 typedef enum type ffs_type_t;
+typedef struct ffs_io ffs_io_t;
+typedef struct ffs_sync ffs_sync_t;
+typedef struct ffs_txn ffs_txn_t;
 
 #define FFS_EXCEPTION_DATA	1024
 
@@ -53,6 +56,11 @@ struct ffs {
     uint32_t count;
 
     bool dirty;
+    bool sparse;
+    int hole_fd;
+
+    ffs_io_t * io;
+    ffs_sync_t * sync;
 };
 
 typedef struct ffs ffs_t;
@@ -66,6 +74,8 @@ typedef struct ffs_exception ffs_exception_t;
 
 #define FFS_PARTITION_NAME		"part"
 
+#define FFS_SPARSE_FILL			0xFF
+
 #define FFS_INFO_ERROR			0
 #define FFS_INFO_MAGIC			1
 #define FFS_INFO_VERSION		2
@@ -75,21 +85,45 @@ typedef struct ffs_exception ffs_exception_t;
 #define FFS_INFO_BLOCK_COUNT		6
 #define FFS_INFO_OFFSET			8
 
+#define FFS_ATTR_FLAGS			1
+#define FFS_ATTR_ACTUAL			2
+#define FFS_ATTR_TYPE			3
+
+#define FFS_SCAN_ALIGN			0x1000
+
+#define FFS_ZIMAGE_FRAME		0x10000
+#define FFS_ZIMAGE_FRAME_MAX		0x100000
+
 #define FFS_CHECK_PATH			-3
 #define FFS_CHECK_HEADER_MAGIC		-4
 #define FFS_CHECK_HEADER_CHECKSUM	-5
 #define FFS_CHECK_ENTRY_CHECKSUM	-6
+#define FFS_CHECK_TRUNCATED		-7
+#define FFS_CHECK_GEOMETRY		-8
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+extern int __ffs_set_concurrent(ffs_t *, bool)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
 extern int __ffs_fcheck(FILE *, off_t)
 /*! @cond */ __nonnull ((1)) /*! @endcond */ ;
 
 extern int __ffs_check(const char *, off_t)
 /*! @cond */ __nonnull ((1)) /*! @endcond */ ;
 
+extern int __ffs_mcheck(const void *, size_t, off_t, ffs_hdr_t **)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern int __ffs_fcheck_table(FILE *, off_t, ffs_hdr_t **)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern int __ffs_fscan(FILE *, uint32_t,
+		       int (*)(off_t, const ffs_hdr_t *, void *), void *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
 extern ffs_t * __ffs_fcreate(FILE *, off_t, uint32_t, uint32_t)
 /*! @cond */ __nonnull ((1)) /*! @endcond */ ;
 
@@ -105,6 +139,9 @@ extern ffs_t * __ffs_open(const char *, off_t)
 extern int __ffs_info(ffs_t *, int, uint32_t *)
 /*! @cond */ __nonnull ((1)) /*! @endcond */ ;
 
+extern int __ffs_info64(ffs_t *, int, uint64_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
 extern int __ffs_close(ffs_t *)
 /*! @cond */ __nonnull ((1)) /*! @endcond */ ;
 
@@ -129,8 +166,11 @@ extern int __ffs_entry_find_parent(ffs_t *, const char *, ffs_entry_t *)
 extern int __ffs_entry_name(ffs_t *, ffs_entry_t *, char *, size_t)
 /*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
 
+extern uint64_t __ffs_entry_actual(ffs_t *, const ffs_entry_t *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
 extern int __ffs_entry_add(ffs_t *, const char *, off_t,
-			    uint32_t, ffs_type_t, uint32_t)
+			    off_t, ffs_type_t, uint32_t)
 /*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
 
 extern int __ffs_entry_delete(ffs_t *, const char *)
@@ -142,6 +182,19 @@ extern int __ffs_entry_user_get(ffs_t *, const char *, uint32_t, uint32_t *)
 extern int __ffs_entry_user_put(ffs_t *, const char *, uint32_t, uint32_t)
 /*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
 
+extern int __ffs_entry_user_get_all(ffs_t *, const char *, uint32_t *)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+extern int __ffs_entry_user_put_all(ffs_t *, const char *, const uint32_t *,
+				    uint32_t)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+extern int __ffs_entry_attr_get(ffs_t *, const char *, int, uint32_t *)
+/*! @cond */ __nonnull ((1,2,4)) /*! @endcond */ ;
+
+extern int __ffs_entry_attr_set(ffs_t *, const char *, int, uint32_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
 extern ssize_t __ffs_entry_hexdump(ffs_t *, const char *, FILE *)
 /*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
 
@@ -155,6 +208,26 @@ extern ssize_t __ffs_entry_write(ffs_t *, const char *, const void *,
 				 off_t, size_t)
 /*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
 
+extern ssize_t __ffs_entry_fill(ffs_t *, const char *, uint8_t, off_t, size_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern off_t __ffs_entry_seek(ffs_t *, const char *, off_t, int)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int __ffs_entry_is_filled(ffs_t *, const char *, uint8_t, off_t, size_t,
+				 off_t *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern ssize_t __ffs_entry_copy_range(ffs_t *, const char *, ffs_t *,
+				      const char *, off_t, size_t)
+/*! @cond */ __nonnull ((1,2,3,4)) /*! @endcond */ ;
+
+extern int __ffs_entry_crc(ffs_t *, const char *, uint32_t *)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+extern int __ffs_entry_hash(ffs_t *, const char *, size_t, size_t, uint8_t *)
+/*! @cond */ __nonnull ((1,2,5)) /*! @endcond */ ;
+
 extern ssize_t __ffs_entry_copy(ffs_t *, ffs_t *, const char *)
 /*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
 
@@ -164,6 +237,79 @@ extern ssize_t __ffs_entry_compare(ffs_t *, ffs_t *, const char *)
 extern int __ffs_entry_list(ffs_t *, ffs_entry_t ** list)
 /*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
 
+extern int __ffs_nested(ffs_t *, off_t **)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern ffs_io_t * __ffs_io_create(int, uint32_t, size_t);
+
+extern int __ffs_io_delete(ffs_io_t *);
+
+extern uint32_t __ffs_io_depth(ffs_io_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern ssize_t __ffs_io_pread(ffs_io_t *, void *, size_t, off_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern ssize_t __ffs_io_pwrite(ffs_io_t *, const void *, size_t, off_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int __ffs_io_setup(ffs_t *, uint32_t)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern ssize_t __ffs_pread(ffs_t *, void *, size_t, off_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern ssize_t __ffs_pwrite(ffs_t *, const void *, size_t, off_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern ssize_t __ffs_copy_range(ffs_t *, off_t, ffs_t *, off_t, size_t)
+/*! @cond */ __nonnull ((1,3)) /*! @endcond */ ;
+
+extern int __ffs_is_filled(ffs_t *, uint8_t, off_t, size_t, off_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern int __ffs_set_sparse(ffs_t *, bool)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern off_t __ffs_seek(ffs_t *, off_t, off_t, int)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern ssize_t __ffs_fill(ffs_t *, uint8_t, off_t, size_t)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern int __ffs_zimage_fcheck(FILE *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern FILE * __ffs_zimage_fopen(FILE *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern int __ffs_zimage_create(FILE *, FILE *, uint32_t, const off_t *, size_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern ffs_txn_t * __ffs_txn_begin(ffs_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern int __ffs_txn_find(ffs_txn_t *, const char *, ffs_entry_t *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int __ffs_txn_add(ffs_txn_t *, const char *, off_t, off_t,
+			 ffs_type_t, uint32_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int __ffs_txn_delete(ffs_txn_t *, const char *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int __ffs_txn_user_put(ffs_txn_t *, const char *, uint32_t, uint32_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern ssize_t __ffs_txn_truncate(ffs_txn_t *, const char *, size_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int __ffs_txn_commit(ffs_txn_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern int __ffs_txn_abort(ffs_txn_t *);
+
 #ifdef __cplusplus
 }
 #endif
@@ -148,6 +148,23 @@ extern int ffs_close(ffs_t *)
 extern int ffs_fsync(ffs_t *)
 /*! @cond */ __nonnull ((1)) /*! @endcond */ ;
 
+/*!
+ * @brief Enable (or disable) concurrent access to a @em FFS object.
+ *        Once enabled, any number of threads may look up and read
+ *        entries while other threads modify the table; lookups never
+ *        take a lock and always see a complete table, while
+ *        modifications are serialized with each other.
+ * @memberof ffs
+ * @param self [in] Pointer to ffs object
+ * @param enable [in] true to enable, false to disable
+ * @return '0' on success, non-0 otherwise
+ * @note Must be called while no other thread is using the object.
+ *       Entries returned by reference (e.g. to ffs_iterate_entries
+ *       callbacks) remain valid until the object is closed.
+ */
+extern int ffs_set_concurrent(ffs_t *, bool)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
 /*!
  * @brief Pretty print the entries of a @em FFS partition table to
  *        stream 'out'
@@ -253,6 +270,93 @@ extern int ffs_entry_user_get(ffs_t *, const char *, uint32_t, uint32_t *)
 extern int ffs_entry_user_put(ffs_t *, const char *, uint32_t, uint32_t)
 /*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
 
+/*!
+ * @brief Get the values of all FFS_USER_WORDS meta-data user words of
+ *        a partition entry with a single lookup
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @param name [in] Name of a partition entry
+ * @param value [out] Array of FFS_USER_WORDS user word values
+ * @return '0' on success, non-0 otherwise
+ */
+extern int ffs_entry_user_get_all(ffs_t *, const char *, uint32_t *)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+/*!
+ * @brief Set any of the FFS_USER_WORDS meta-data user words of a
+ *        partition entry with a single lookup
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @param name [in] Name of a partition entry
+ * @param value [in] Array of FFS_USER_WORDS user word values
+ * @param mask [in] Bit 'n' set selects user word 'n' to be written
+ * @return '0' on success, non-0 otherwise
+ * @note The table is only marked modified if a selected word changes
+ */
+extern int ffs_entry_user_put_all(ffs_t *, const char *, const uint32_t *,
+				  uint32_t)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+/*!
+ * @brief Get an attribute of a partition entry
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @param name [in] Name of a partition entry
+ * @param attr [in] Attribute, see libffs.h for details
+ *		FFS_ATTR_FLAGS - ffs_entry::flags
+ *		FFS_ATTR_ACTUAL - ffs_entry::actual
+ *		FFS_ATTR_TYPE - ffs_entry::type
+ * @param value [out] Attribute value
+ * @return '0' on success, non-0 otherwise
+ */
+extern int ffs_entry_attr_get(ffs_t *, const char *, int, uint32_t *)
+/*! @cond */ __nonnull ((1,2,4)) /*! @endcond */ ;
+
+/*!
+ * @brief Set an attribute of a partition entry
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @param name [in] Name of a partition entry
+ * @param attr [in] Attribute, see ffs_entry_attr_get
+ * @param value [in] Attribute value
+ * @return '0' on success, non-0 otherwise
+ * @note FFS_ATTR_ACTUAL must not exceed the partition size, and
+ *       FFS_ATTR_TYPE only switches between data and logical entries
+ */
+extern int ffs_entry_attr_set(ffs_t *, const char *, int, uint32_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+/*!
+ * @brief Compute the CRC32C of the data contents (the first 'actual'
+ *        bytes) of a partition entry
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @param name [in] Name of a partition entry
+ * @param crc [out] CRC32C value
+ * @return '0' on success, non-0 otherwise
+ * @note When FFS_ENTRY_INTEG_CRC is set in user word USER_DATA_VOL, user
+ *       word USER_DATA_CRC holds the value computed when the data was
+ *       written.  Writes through the library clear the bit.
+ */
+extern int ffs_entry_crc(ffs_t *, const char *, uint32_t *)
+/*! @cond */ __nonnull ((1,2,3)) /*! @endcond */ ;
+
+/*!
+ * @brief Compute the SHA-256 of each erase block in a range of a partition
+ *        entry, e.g. the leaves of a block hash tree
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @param name [in] Name of a partition entry
+ * @param first [in] Index of the first block, relative to the entry
+ * @param nr [in] Number of blocks
+ * @param md [out] nr * 32 bytes of digests, in block order
+ * @return '0' on success, non-0 otherwise
+ * @note Blocks past 'actual' are hashed too, erased blocks in a sparse
+ *       image hash as if filled with 0xFF
+ */
+extern int ffs_entry_hash(ffs_t *, const char *, size_t, size_t, uint8_t *)
+/*! @cond */ __nonnull ((1,2,5)) /*! @endcond */ ;
+
 /*!
  * @brief Hexdump the data contents of a partition entry to output stream
  *        'out'
@@ -319,6 +423,21 @@ extern ssize_t ffs_entry_read(ffs_t *, const char *, void *, off_t, size_t)
 extern ssize_t ffs_entry_write(ffs_t *, const char *, const void *, off_t, size_t)
 /*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
 
+/*!
+ * @brief Check whether every data byte of partition entry 'name' holds
+ *        the fill value 'value', e.g. to skip erasing a blank partition
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @param name [in] Name of a partition entry
+ * @param value [in] Fill value
+ * @param first [out] Offset, from the beginning of the entry, of the first
+ *        byte not equal to 'value' (entry size if blank), may be NULL
+ * @return Negative on failure, 1 if the entry is blank, 0 otherwise
+ * @note Holes in a sparse image read as 0xFF
+ */
+extern int ffs_entry_is_filled(ffs_t *, const char *, uint8_t, off_t *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
 /*!
  * @brief Return an array of entry_t structures, one each partition that
  * 	exists in the partition table
@@ -332,6 +451,73 @@ extern ssize_t ffs_entry_write(ffs_t *, const char *, const void *, off_t, size_
 extern ssize_t ffs_entry_list(ffs_t *, ffs_entry_t **)
 /*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
 
+/*!
+ * @brief Start a transaction on a @em FFS partition table.  Entries are
+ *        added, deleted and modified on a private copy of the table,
+ *        which replaces the table, and is written to the file (or
+ *        device) once, by ffs_txn_commit
+ * @memberof ffs
+ * @param self [in] Pointer to an ffs object
+ * @return Pointer to ffs_txn_t (allocated on the heap) on success,
+ *         NULL otherwise
+ * @note In concurrent mode, other writers block until the transaction
+ *       is committed or aborted
+ */
+extern ffs_txn_t * ffs_txn_begin(ffs_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+/*!
+ * @brief Add a partition entry within a transaction, see ffs_entry_add
+ * @memberof ffs_txn
+ */
+extern int ffs_txn_add(ffs_txn_t *, const char *, off_t, uint32_t,
+		       ffs_type_t, uint32_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+/*!
+ * @brief Delete a partition entry within a transaction, see
+ *        ffs_entry_delete
+ * @memberof ffs_txn
+ */
+extern int ffs_txn_delete(ffs_txn_t *, const char *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+/*!
+ * @brief Set a user word of a partition entry within a transaction, see
+ *        ffs_entry_user_put
+ * @memberof ffs_txn
+ */
+extern int ffs_txn_user_put(ffs_txn_t *, const char *, uint32_t, uint32_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+/*!
+ * @brief Set the actual size of a partition entry within a transaction,
+ *        see ffs_entry_truncate_no_pad
+ * @memberof ffs_txn
+ */
+extern ssize_t ffs_txn_truncate(ffs_txn_t *, const char *, size_t)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+/*!
+ * @brief Replace the partition table with the transaction copy, write
+ *        it to the file (or device) and free the transaction
+ * @memberof ffs_txn
+ * @param self [in] Pointer to an ffs_txn object
+ * @return '0' on success, non-0 otherwise
+ * @note A failed ffs_txn_{add,delete,user_put,truncate} may leave the
+ *       copy partially modified, the transaction should be aborted
+ */
+extern int ffs_txn_commit(ffs_txn_t *)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+/*!
+ * @brief Discard all changes made within a transaction and free it
+ * @memberof ffs_txn
+ * @param self [in] Pointer to an ffs_txn object, may be NULL
+ * @return '0' on success, non-0 otherwise
+ */
+extern int ffs_txn_abort(ffs_txn_t *);
+
 #ifdef __cplusplus
 }
 #endif
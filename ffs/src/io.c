@@ -0,0 +1,945 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: ffs/src/io.c $                                                */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *   File: io.c
+ * Author:
+ *  Descr: FFS positional I/O engine (io_uring w/ pread/pwrite fallback)
+ *   Note: The io_uring backend talks to the kernel directly (no liburing),
+ *         it batches up to 'depth' SQEs per io_uring_enter(2) and stages
+ *         the data through a pool of pre-registered buffers.
+ *   Date: 10/19/26
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+/* the package version, clashes with VERSION() from clib/err.h */
+#undef VERSION
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+
+#include "libffs.h"
+
+#include <clib/builtin.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/max.h>
+#include <clib/mem.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup)
+#define FFS_IO_URING	1
+#endif
+
+#define FFS_IO_CHUNK_MIN	4096UL
+#define FFS_IO_CHUNK_MAX	(1UL << 20)
+#define FFS_IO_POOL_MAX		(64UL << 20)
+
+struct ffs_io {
+	int fd;
+	uint32_t depth;
+	size_t chunk;
+
+	bool uring;
+	bool fixed;
+
+	void *pool;		// depth * chunk staging buffers
+	size_t *len;		// per-slot request length
+	int *res;		// per-slot completion result
+	struct iovec *iov;	// per-slot iovec (non-fixed)
+
+#ifdef FFS_IO_URING
+	int ring;
+
+	void *sq_ptr, *cq_ptr;
+	size_t sq_size, cq_size;
+
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	uint32_t *sq_head, *sq_tail, *sq_mask, *sq_array;
+	uint32_t *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+#endif
+};
+
+/* ============================================================ */
+
+static ssize_t __sync_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	ssize_t total = 0;
+
+	while (0 < count) {
+		ssize_t rc = pread(fd, buf + total, count, offset + total);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			ERRNO(errno);
+			return -1;
+		}
+		if (rc == 0)
+			break;
+
+		total += rc;
+		count -= rc;
+	}
+
+	return total;
+}
+
+static ssize_t __sync_pwrite(int fd, const void *buf, size_t count,
+			     off_t offset)
+{
+	ssize_t total = 0;
+
+	while (0 < count) {
+		ssize_t rc = pwrite(fd, buf + total, count, offset + total);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			ERRNO(errno);
+			return -1;
+		}
+		if (rc == 0)
+			break;
+
+		total += rc;
+		count -= rc;
+	}
+
+	return total;
+}
+
+/* ============================================================ */
+
+#ifdef FFS_IO_URING
+static int __uring_setup(ffs_io_t * self)
+{
+	assert(self != NULL);
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	self->ring = syscall(__NR_io_uring_setup, self->depth, &p);
+	if (self->ring < 0)
+		return -1;
+
+	self->sq_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+	self->cq_size = p.cq_off.cqes +
+			p.cq_entries * sizeof(struct io_uring_cqe);
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (self->sq_size < self->cq_size)
+			self->sq_size = self->cq_size;
+		self->cq_size = self->sq_size;
+	}
+
+	self->sq_ptr = mmap(NULL, self->sq_size, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, self->ring,
+			    IORING_OFF_SQ_RING);
+	if (self->sq_ptr == MAP_FAILED) {
+		self->sq_ptr = NULL;
+		return -1;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		self->cq_ptr = self->sq_ptr;
+	} else {
+		self->cq_ptr = mmap(NULL, self->cq_size,
+				    PROT_READ | PROT_WRITE,
+				    MAP_SHARED | MAP_POPULATE, self->ring,
+				    IORING_OFF_CQ_RING);
+		if (self->cq_ptr == MAP_FAILED) {
+			self->cq_ptr = NULL;
+			return -1;
+		}
+	}
+
+	self->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	self->sqes = mmap(NULL, self->sqes_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, self->ring,
+			  IORING_OFF_SQES);
+	if (self->sqes == MAP_FAILED) {
+		self->sqes = NULL;
+		return -1;
+	}
+
+	self->sq_head = self->sq_ptr + p.sq_off.head;
+	self->sq_tail = self->sq_ptr + p.sq_off.tail;
+	self->sq_mask = self->sq_ptr + p.sq_off.ring_mask;
+	self->sq_array = self->sq_ptr + p.sq_off.array;
+
+	self->cq_head = self->cq_ptr + p.cq_off.head;
+	self->cq_tail = self->cq_ptr + p.cq_off.tail;
+	self->cq_mask = self->cq_ptr + p.cq_off.ring_mask;
+	self->cqes = self->cq_ptr + p.cq_off.cqes;
+
+	/*
+	 * Registered (fixed) buffers avoid the per-I/O page pinning, but
+	 * are charged against RLIMIT_MEMLOCK on older kernels -- if the
+	 * registration is refused, use plain READV/WRITEV SQEs instead
+	 */
+	self->fixed = syscall(__NR_io_uring_register, self->ring,
+			      IORING_REGISTER_BUFFERS, self->iov,
+			      self->depth) == 0;
+
+	return 0;
+}
+
+static void __uring_teardown(ffs_io_t * self)
+{
+	assert(self != NULL);
+
+	if (self->sqes != NULL)
+		munmap(self->sqes, self->sqes_size), self->sqes = NULL;
+	if (self->cq_ptr != NULL && self->cq_ptr != self->sq_ptr)
+		munmap(self->cq_ptr, self->cq_size);
+	self->cq_ptr = NULL;
+	if (self->sq_ptr != NULL)
+		munmap(self->sq_ptr, self->sq_size), self->sq_ptr = NULL;
+	if (0 <= self->ring)
+		close(self->ring), self->ring = -1;
+}
+
+static int __uring_enter(ffs_io_t * self, uint32_t submit, uint32_t wait)
+{
+	assert(self != NULL);
+
+	for (;;) {
+		int rc = syscall(__NR_io_uring_enter, self->ring, submit, wait,
+				 IORING_ENTER_GETEVENTS, NULL, 0);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			ERRNO(errno);
+			return -1;
+		}
+
+		/* the kernel skips the wait after a partial submission */
+		if (submit <= (uint32_t)rc)
+			break;
+		submit -= rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Queue up to 'depth' chunk sized requests, submit them with a single
+ * io_uring_enter(2), and reap the completions in one go
+ */
+static ssize_t __uring_rw(ffs_io_t * self, bool write, void *buf,
+			  size_t count, off_t offset)
+{
+	assert(self != NULL);
+
+	ssize_t total = 0;
+	bool eof = false;
+
+	while (eof == false && (size_t)total < count) {
+		uint32_t tail = *self->sq_tail;
+		uint32_t mask = *self->sq_mask;
+		uint32_t nr = 0;
+		size_t queued = 0;
+
+		while (nr < self->depth && total + queued < count) {
+			size_t len = min(self->chunk, count - total - queued);
+			void *slot = self->pool + nr * self->chunk;
+
+			if (write)
+				memcpy(slot, buf + total + queued, len);
+
+			struct io_uring_sqe *sqe = &self->sqes[tail & mask];
+			memset(sqe, 0, sizeof(*sqe));
+
+			sqe->fd = self->fd;
+			sqe->off = offset + total + queued;
+			sqe->user_data = nr;
+
+			if (self->fixed) {
+				sqe->opcode = write ? IORING_OP_WRITE_FIXED :
+						      IORING_OP_READ_FIXED;
+				sqe->addr = (uintptr_t)slot;
+				sqe->len = len;
+				sqe->buf_index = nr;
+			} else {
+				self->iov[nr].iov_len = len;
+				sqe->opcode = write ? IORING_OP_WRITEV :
+						      IORING_OP_READV;
+				sqe->addr = (uintptr_t)&self->iov[nr];
+				sqe->len = 1;
+			}
+
+			self->sq_array[tail & mask] = tail & mask;
+			self->len[nr] = len;
+
+			tail++, nr++;
+			queued += len;
+		}
+
+		__atomic_store_n(self->sq_tail, tail, __ATOMIC_RELEASE);
+
+		if (__uring_enter(self, nr, nr) < 0)
+			return -1;
+
+		uint32_t done = 0;
+		while (done < nr) {
+			uint32_t head = *self->cq_head;
+
+			while (head != __atomic_load_n(self->cq_tail,
+						       __ATOMIC_ACQUIRE)) {
+				struct io_uring_cqe *cqe;
+				cqe = &self->cqes[head & *self->cq_mask];
+				self->res[cqe->user_data] = cqe->res;
+				head++, done++;
+			}
+
+			__atomic_store_n(self->cq_head, head, __ATOMIC_RELEASE);
+
+			if (done < nr && __uring_enter(self, 0, nr - done) < 0)
+				return -1;
+		}
+
+		for (uint32_t i = 0; i < nr && eof == false; i++) {
+			int res = self->res[i];
+
+			if (res < 0) {
+				errno = -res;
+				ERRNO(errno);
+				return -1;
+			}
+
+			if (write == false)
+				memcpy(buf + total,
+				       self->pool + i * self->chunk, res);
+
+			if ((size_t)res < self->len[i]) {
+				if (write) {	// finish a short write
+					ssize_t rc = __sync_pwrite(self->fd,
+						buf + total + res,
+						self->len[i] - res,
+						offset + total + res);
+					if (rc < 0)
+						return -1;
+					res += rc;
+				}
+				eof = (size_t)res < self->len[i];
+			}
+
+			total += res;
+		}
+	}
+
+	return total;
+}
+#endif
+
+/* ============================================================ */
+
+ffs_io_t *__ffs_io_create(int fd, uint32_t depth, size_t chunk)
+{
+	ffs_io_t *self = (ffs_io_t *) malloc(sizeof(*self));
+	if (self == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	memset(self, 0, sizeof(*self));
+	self->fd = fd;
+#ifdef FFS_IO_URING
+	self->ring = -1;
+#endif
+
+	if (depth == 0)
+		return self;
+
+	chunk = max(min(chunk, FFS_IO_CHUNK_MAX), FFS_IO_CHUNK_MIN);
+	depth = min(depth, (uint32_t)(FFS_IO_POOL_MAX / chunk));
+
+	self->depth = depth;
+	self->chunk = chunk;
+
+#ifdef FFS_IO_URING
+	if (posix_memalign(&self->pool, FFS_IO_CHUNK_MIN, depth * chunk)) {
+		self->pool = NULL;
+		goto sync;
+	}
+
+	self->len = (size_t *) calloc(depth, sizeof(*self->len));
+	self->res = (int *) calloc(depth, sizeof(*self->res));
+	self->iov = (struct iovec *) calloc(depth, sizeof(*self->iov));
+	if (self->len == NULL || self->res == NULL || self->iov == NULL)
+		goto sync;
+
+	for (uint32_t i = 0; i < depth; i++) {
+		self->iov[i].iov_base = self->pool + i * chunk;
+		self->iov[i].iov_len = chunk;
+	}
+
+	if (__uring_setup(self) == 0) {
+		self->uring = true;
+		return self;
+	}
+
+	/* ENOSYS, EPERM (seccomp, sysctl), ... use pread/pwrite */
+	__uring_teardown(self);
+ sync:
+#endif
+	if (self->pool != NULL)
+		free(self->pool), self->pool = NULL;
+	if (self->len != NULL)
+		free(self->len), self->len = NULL;
+	if (self->res != NULL)
+		free(self->res), self->res = NULL;
+	if (self->iov != NULL)
+		free(self->iov), self->iov = NULL;
+
+	self->depth = 0;
+
+	return self;
+}
+
+int __ffs_io_delete(ffs_io_t * self)
+{
+	if (self == NULL)
+		return 0;
+
+#ifdef FFS_IO_URING
+	__uring_teardown(self);
+#endif
+
+	if (self->pool != NULL)
+		free(self->pool), self->pool = NULL;
+	if (self->len != NULL)
+		free(self->len), self->len = NULL;
+	if (self->res != NULL)
+		free(self->res), self->res = NULL;
+	if (self->iov != NULL)
+		free(self->iov), self->iov = NULL;
+
+	free(self);
+
+	return 0;
+}
+
+uint32_t __ffs_io_depth(ffs_io_t * self)
+{
+	assert(self != NULL);
+	return self->uring ? self->depth : 0;
+}
+
+ssize_t __ffs_io_pread(ffs_io_t * self, void *buf, size_t count,
+		       off_t offset)
+{
+	assert(self != NULL);
+	assert(buf != NULL);
+
+#ifdef FFS_IO_URING
+	if (self->uring)
+		return __uring_rw(self, false, buf, count, offset);
+#endif
+
+	return __sync_pread(self->fd, buf, count, offset);
+}
+
+ssize_t __ffs_io_pwrite(ffs_io_t * self, const void *buf, size_t count,
+			off_t offset)
+{
+	assert(self != NULL);
+	assert(buf != NULL);
+
+#ifdef FFS_IO_URING
+	if (self->uring)
+		return __uring_rw(self, true, (void *)buf, count, offset);
+#endif
+
+	return __sync_pwrite(self->fd, buf, count, offset);
+}
+
+/* ============================================================ */
+
+int __ffs_io_setup(ffs_t * self, uint32_t depth)
+{
+	assert(self != NULL);
+
+	int fd = fileno(self->file);
+	if (fd < 0) {
+		UNEXPECTED("partition table at offset '%llx' is not backed "
+			   "by a file descriptor", (long long)self->offset);
+		return -1;
+	}
+
+	ffs_io_t *io = __ffs_io_create(fd, depth, self->hdr->block_size);
+	if (io == NULL)
+		return -1;
+
+	if (self->io != NULL)
+		__ffs_io_delete(self->io);
+	self->io = io;
+
+	return 0;
+}
+
+/*
+ * lseek(2) SEEK_DATA/SEEK_HOLE on the private descriptor of a sparse
+ * image, the shared one's file position belongs to stdio (and the
+ * partition table I/O) and may be in use by other threads
+ */
+static off_t __seek(ffs_t * self, off_t offset, int whence)
+{
+	if (0 <= self->hole_fd)
+		return lseek(self->hole_fd, offset, whence);
+
+	/* no private descriptor, move the shared one under the stream lock */
+	int fd = fileno(self->file);
+
+	flockfile(self->file);
+
+	off_t pos = lseek(fd, 0, SEEK_CUR);
+	if (pos < 0) {
+		funlockfile(self->file);
+		return -1;
+	}
+
+	off_t rc = lseek(fd, offset, whence);
+	int err = errno;
+
+	if (lseek(fd, pos, SEEK_SET) < 0) {
+		funlockfile(self->file);
+		return -1;
+	}
+
+	funlockfile(self->file);
+
+	errno = err;
+	return rc;
+}
+
+/* holes (and anything past EOF) of a sparse image read back as 0xFF */
+static void __fill_holes(ffs_t * self, void *buf, size_t count, off_t offset)
+{
+	off_t end = offset + count;
+	off_t pos = offset;
+
+	while (pos < end) {
+		off_t hole = __seek(self, pos, SEEK_HOLE);
+		if (hole < 0 || end <= hole)
+			break;
+
+		off_t data = __seek(self, hole, SEEK_DATA);
+		if (data < 0 || end < data)
+			data = end;
+
+		memset(buf + (hole - offset), FFS_SPARSE_FILL, data - hole);
+		pos = data;
+	}
+}
+
+ssize_t __ffs_pread(ffs_t * self, void *buf, size_t count, off_t offset)
+{
+	assert(self != NULL);
+	assert(buf != NULL);
+
+	int fd = fileno(self->file);
+	if (0 <= fd && self->sparse) {
+		ssize_t rc = self->io != NULL ?
+			__ffs_io_pread(self->io, buf, count, offset) :
+			__sync_pread(fd, buf, count, offset);
+		if (rc < 0)
+			return -1;
+
+		memset(buf + rc, FFS_SPARSE_FILL, count - rc);
+		__fill_holes(self, buf, count, offset);
+
+		return count;
+	}
+
+	if (self->io != NULL)
+		return __ffs_io_pread(self->io, buf, count, offset);
+	if (0 <= fd)
+		return __sync_pread(fd, buf, count, offset);
+
+	/* streams w/o a descriptor (e.g. fopencookie) */
+	flockfile(self->file);
+
+	if (fseeko(self->file, offset, SEEK_SET) != 0) {
+		funlockfile(self->file);
+		ERRNO(errno);
+		return -1;
+	}
+
+	size_t rc = fread(buf, 1, count, self->file);
+	bool failed = rc < count && ferror(self->file);
+
+	funlockfile(self->file);
+
+	if (failed) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return rc;
+}
+
+ssize_t __ffs_pwrite(ffs_t * self, const void *buf, size_t count,
+		     off_t offset)
+{
+	assert(self != NULL);
+	assert(buf != NULL);
+
+	if (self->io != NULL)
+		return __ffs_io_pwrite(self->io, buf, count, offset);
+
+	int fd = fileno(self->file);
+	if (0 <= fd)
+		return __sync_pwrite(fd, buf, count, offset);
+
+	flockfile(self->file);
+
+	if (fseeko(self->file, offset, SEEK_SET) != 0) {
+		funlockfile(self->file);
+		ERRNO(errno);
+		return -1;
+	}
+
+	size_t rc = fwrite(buf, 1, count, self->file);
+	bool failed = (rc < count && ferror(self->file)) ||
+	    fflush(self->file) != 0;
+
+	funlockfile(self->file);
+
+	if (failed) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return rc;
+}
+
+/*
+ * Copy 'count' bytes between two regular files without bouncing the data
+ * through user space -- FICLONERANGE shares the (block aligned) extents on
+ * reflink capable filesystems (XFS, btrfs), copy_file_range(2) handles the
+ * rest.  Returns the number of bytes copied, which can be short (or 0) if
+ * neither is supported, the caller is expected to copy the remainder.
+ */
+ssize_t __ffs_copy_range(ffs_t * self, off_t offset, ffs_t * in,
+			 off_t in_offset, size_t count)
+{
+	assert(self != NULL);
+	assert(in != NULL);
+
+	int out_fd = fileno(self->file);
+	int in_fd = fileno(in->file);
+	if (out_fd < 0 || in_fd < 0)
+		return 0;
+
+	struct stat out_st, in_st;
+	if (fstat(out_fd, &out_st) < 0 || fstat(in_fd, &in_st) < 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	if (!S_ISREG(out_st.st_mode) || !S_ISREG(in_st.st_mode))
+		return 0;
+
+	size_t total = 0;
+
+#ifdef FICLONERANGE
+	size_t align = max(out_st.st_blksize, in_st.st_blksize);
+
+	if (offset % align == 0 && in_offset % align == 0 &&
+	    align <= count) {
+		struct file_clone_range range = {
+			.src_fd = in_fd,
+			.src_offset = in_offset,
+			.src_length = count - count % align,
+			.dest_offset = offset,
+		};
+
+		if (ioctl(out_fd, FICLONERANGE, &range) == 0)
+			total = range.src_length;
+	}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+	while (total < count) {
+		loff_t in_off = in_offset + total;
+		loff_t out_off = offset + total;
+
+		ssize_t rc = copy_file_range(in_fd, &in_off, out_fd, &out_off,
+					     count - total, 0);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EXDEV || errno == ENOSYS ||
+			    errno == EINVAL || errno == EOPNOTSUPP ||
+			    errno == EBADF)
+				break;
+			ERRNO(errno);
+			return -1;
+		}
+		if (rc == 0)
+			break;
+
+		total += rc;
+	}
+#endif
+
+	return total;
+}
+
+int __ffs_set_sparse(ffs_t * self, bool sparse)
+{
+	assert(self != NULL);
+
+	if (self->sparse == sparse)
+		return 0;
+
+	if (self->sparse && 0 <= self->hole_fd)
+		close(self->hole_fd);
+	self->hole_fd = -1;
+
+	/*
+	 * A descriptor of our own (not a dup(2), that would share the file
+	 * position) for the SEEK_DATA/SEEK_HOLE probes
+	 */
+	int fd = fileno(self->file);
+	if (sparse && 0 <= fd) {
+		char proc[64];
+		snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+		self->hole_fd = open(proc, O_RDONLY | O_CLOEXEC);
+	}
+
+	self->sparse = sparse;
+
+	return 0;
+}
+
+off_t __ffs_seek(ffs_t * self, off_t offset, off_t end, int whence)
+{
+	assert(self != NULL);
+
+	if (whence != SEEK_DATA && whence != SEEK_HOLE) {
+		UNEXPECTED("'%d' invalid whence", whence);
+		return -1;
+	}
+
+	if (end <= offset)
+		return end;
+
+	int fd = fileno(self->file);
+	if (self->sparse == false || fd < 0)
+		return whence == SEEK_DATA ? offset : end;
+
+	off_t rc = __seek(self, offset, whence);
+	if (rc < 0) {
+		if (errno == ENXIO)	// no data past 'offset'
+			return whence == SEEK_DATA ? end : offset;
+		if (errno == EINVAL || errno == EOPNOTSUPP)
+			return whence == SEEK_DATA ? offset : end;
+		ERRNO(errno);
+		return -1;
+	}
+
+	return min(rc, end);
+}
+
+static ssize_t __fill_write(ffs_t * self, uint8_t value, off_t offset,
+			    size_t count)
+{
+	assert(self != NULL);
+
+	if (count == 0)
+		return 0;
+
+	size_t size = min(count, FFS_IO_CHUNK_MAX);
+
+	void *buf = malloc(size);
+	if (buf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+	memset(buf, value, size);
+
+	ssize_t total = 0;
+	while ((size_t)total < count) {
+		ssize_t rc = __ffs_pwrite(self, buf,
+					  min(size, count - total),
+					  offset + total);
+		if (rc <= 0) {
+			free(buf);
+			return rc < 0 ? -1 : total;
+		}
+		total += rc;
+	}
+
+	free(buf);
+
+	return total;
+}
+
+/*
+ * Fill a range with 'value'.  A zero fill of a regular file is left to
+ * fallocate(), unless the image is sparse and holes must read as 0xFF.
+ * For sparse images an erased (0xFF) range is deallocated instead, only
+ * the unaligned head and tail are written.
+ */
+ssize_t __ffs_fill(ffs_t * self, uint8_t value, off_t offset, size_t count)
+{
+	assert(self != NULL);
+
+	int fd = fileno(self->file);
+	struct stat st;
+
+	/*
+	 * zero fill of a regular file, let the filesystem do it.  Not for
+	 * sparse images: some filesystems leave unwritten extents that
+	 * SEEK_DATA reports as holes, which then read back as erased.
+	 */
+	if (value == 0 && 0 < count && !self->sparse && 0 <= fd &&
+	    fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		if (fallocate(fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE,
+			      offset, count) == 0)
+			return count;
+
+		if (errno != EOPNOTSUPP && errno != ENOSYS) {
+			ERRNO(errno);
+			return -1;
+		}
+	}
+
+	if (self->sparse && value == FFS_SPARSE_FILL && 0 <= fd &&
+	    fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		off_t align = st.st_blksize;
+		off_t start = (offset + align - 1) / align * align;
+		off_t end = (offset + (off_t)count) / align * align;
+
+		if (start < end) {
+			if (fallocate(fd, FALLOC_FL_PUNCH_HOLE |
+				      FALLOC_FL_KEEP_SIZE, start,
+				      end - start) == 0) {
+				if (__fill_write(self, value, offset,
+						 start - offset) < 0)
+					return -1;
+				if (__fill_write(self, value, end,
+						 offset + count - end) < 0)
+					return -1;
+				return count;
+			}
+
+			if (errno != EOPNOTSUPP && errno != ENOSYS) {
+				ERRNO(errno);
+				return -1;
+			}
+		}
+	}
+
+	return __fill_write(self, value, offset, count);
+}
+
+int __ffs_is_filled(ffs_t * self, uint8_t value, off_t offset, size_t count,
+		    off_t * first)
+{
+	assert(self != NULL);
+
+	off_t end = offset + count;
+
+	RAII(void*, buf, NULL, free);
+
+	while (offset < end) {
+		off_t data = __ffs_seek(self, offset, end, SEEK_DATA);
+		if (data < 0)
+			return -1;
+
+		/* holes read as FFS_SPARSE_FILL */
+		if (offset < data) {
+			if (value != FFS_SPARSE_FILL)
+				break;
+			offset = data;
+			continue;
+		}
+
+		off_t hole = __ffs_seek(self, offset, end, SEEK_HOLE);
+		if (hole < 0)
+			return -1;
+
+		if (buf == NULL) {
+			buf = malloc(min(count, FFS_IO_CHUNK_MAX));
+			if (buf == NULL) {
+				ERRNO(errno);
+				return -1;
+			}
+		}
+
+		while (offset < hole) {
+			size_t size = min((size_t)(hole - offset),
+					  FFS_IO_CHUNK_MAX);
+
+			ssize_t rc = __ffs_pread(self, buf, size, offset);
+			if (rc < 0)
+				return -1;
+			if (rc == 0)
+				break;
+
+			size_t n = memfilled(buf, value, rc);
+			offset += n;
+			if (n < (size_t)rc)
+				break;
+		}
+
+		/* short read or mismatch */
+		if (offset < hole)
+			break;
+	}
+
+	if (first != NULL)
+		*first = offset;
+
+	return end <= offset;
+}
@@ -45,11 +45,13 @@
 #include <endian.h>
 #include <libgen.h>
 #include <regex.h>
+#include <pthread.h>
 
 #include "libffs.h"
 
 #include <clib/builtin.h>
 #include <clib/checksum.h>
+#include <clib/sha256.h>
 #include <clib/misc.h>
 #include <clib/err.h>
 #include <clib/raii.h>
@@ -66,6 +68,23 @@
 #endif
 
 #define FFS_ENTRY_EXTENT	10UL
+#define FFS_SCAN_CHUNK		(4UL << 20)
+
+/*
+ * Concurrent mode: readers dereference whatever table snapshot is currently
+ * published in self->hdr without taking any lock.  Writers are serialized by
+ * a mutex, edit a private copy of the table and publish it with a single
+ * pointer store.  Replaced snapshots are retired rather than freed, since a
+ * reader may still be walking them, and are reclaimed when the table is
+ * closed.  The single words data writers touch on every write (the low word
+ * of 'actual', the CRC valid bit) are stored in place under the mutex
+ * instead, so the retired list only grows with real table edits.
+ */
+struct ffs_sync {
+	pthread_mutex_t lock;
+	ffs_hdr_t ** retired;
+	size_t nr, sz;
+};
 
 /* ============================================================ */
 
@@ -332,8 +351,9 @@ static ffs_entry_t *__find_entry(ffs_hdr_t * self, const char *path)
 
 	ffs_entry_t root = {.id = FFS_PID_TOPLEVEL }, *parent = &root;
 
-	char *name;
-	while (parent != NULL && (name = strtok((char *)path, "/")) != NULL) {
+	char *name, *save = NULL;
+	while (parent != NULL &&
+	       (name = strtok_r((char *)path, "/", &save)) != NULL) {
 		path = NULL;
 
 		int find_entry(ffs_entry_t * child) {
@@ -348,9 +368,36 @@ static ffs_entry_t *__find_entry(ffs_hdr_t * self, const char *path)
 	return parent;
 }
 
+/*
+ * 'actual' is 64 bits wide in FFS_VERSION_2 tables, the high word living in
+ * a reserved word that version 1 tables leave zero.
+ */
+static uint64_t __entry_actual(const ffs_hdr_t * hdr,
+			       const ffs_entry_t * entry)
+{
+	uint64_t actual = entry->actual;
+
+	if (FFS_VERSION_2 <= hdr->version)
+		actual |= (uint64_t)entry->resvd[FFS_ENTRY_ACTUAL_HI] << 32;
+
+	return actual;
+}
+
+/* Only tables holding an 'actual' past 4 GiB are moved to version 2 */
+static void __entry_actual_set(ffs_hdr_t * hdr, ffs_entry_t * entry,
+			       uint64_t actual)
+{
+	if (UINT32_MAX < actual && hdr->version < FFS_VERSION_2)
+		hdr->version = FFS_VERSION_2;
+
+	entry->actual = (uint32_t)actual;
+	if (FFS_VERSION_2 <= hdr->version)
+		entry->resvd[FFS_ENTRY_ACTUAL_HI] = (uint32_t)(actual >> 32);
+}
+
 /* ============================================================ */
 
-int __ffs_fcheck(FILE *file, off_t offset)
+static int __fcheck(FILE *file, off_t offset)
 {
 	assert(file != NULL);
 
@@ -424,6 +471,17 @@ int __ffs_fcheck(FILE *file, off_t offset)
 	return 0;
 }
 
+int __ffs_fcheck(FILE *file, off_t offset)
+{
+	assert(file != NULL);
+
+	flockfile(file);
+	int rc = __fcheck(file, offset);
+	funlockfile(file);
+
+	return rc;
+}
+
 int __ffs_check(const char *path, off_t offset)
 {
 	if (path == NULL || *path == '\0') {
@@ -437,9 +495,246 @@ int __ffs_check(const char *path, off_t offset)
 		return -1;
 	}
 
+	if (__ffs_zimage_fcheck(file) == 1) {
+		FILE *image = __ffs_zimage_fopen(file);
+		if (image == NULL)
+			return -1;
+		file = image;	/* closes the container */
+	}
+
 	return __ffs_fcheck(file, offset);
 }
 
+/* short only at end of file */
+static ssize_t __read_at(FILE *file, void *buf, size_t count, off_t offset)
+{
+	int fd = fileno(file);
+	size_t done = 0;
+
+	if (0 <= fd) {
+		while (done < count) {
+			ssize_t rc = pread(fd, buf + done, count - done,
+					   offset + done);
+			if (rc < 0 && errno == EINTR)
+				continue;
+			if (rc < 0) {
+				ERRNO(errno);
+				return -1;
+			}
+			if (rc == 0)
+				break;
+			done += rc;
+		}
+
+		return done;
+	}
+
+	/* streams w/o a descriptor (e.g. a compressed image) */
+	flockfile(file);
+
+	if (fseeko(file, offset, SEEK_SET) != 0) {
+		funlockfile(file);
+		ERRNO(errno);
+		return -1;
+	}
+
+	done = fread(buf, 1, count, file);
+	bool failed = done < count && ferror(file);
+
+	funlockfile(file);
+
+	if (failed) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return done;
+}
+
+/*
+ * __ffs_fcheck() for an image in memory (e.g. mmap'd): 0 if the table at
+ * 'offset' is sound, an FFS_CHECK_* code if not.  Only allocation failures
+ * raise an error, so callers checking many images keep a clean error stack.
+ * On success, '*table' (if not NULL) is a host order copy of the header and
+ * entries, for the caller to free.
+ */
+int __ffs_mcheck(const void *image, size_t size, off_t offset,
+		 ffs_hdr_t **table)
+{
+	assert(image != NULL);
+
+	if (offset < 0 || size < sizeof(ffs_hdr_t) ||
+	    size - sizeof(ffs_hdr_t) < (uint64_t)offset)
+		return FFS_CHECK_TRUNCATED;
+
+	const uint8_t *p = (const uint8_t *)image + offset;
+	size -= offset;
+
+	ffs_hdr_t hdr;
+	memcpy(&hdr, p, sizeof(hdr));
+
+	uint32_t ck = memcpy_checksum(NULL, (void *)&hdr,
+				      offsetof(ffs_hdr_t, checksum));
+	__hdr_be32toh(&hdr);
+
+	if (hdr.magic != FFS_MAGIC)
+		return FFS_CHECK_HEADER_MAGIC;
+	if (hdr.checksum != ck)
+		return FFS_CHECK_HEADER_CHECKSUM;
+
+	if (hdr.entry_size != sizeof(ffs_entry_t) ||
+	    !is_pow2(hdr.block_size) ||
+	    (uint64_t)hdr.size * hdr.block_size <
+	    sizeof(hdr) + (uint64_t)hdr.entry_count * hdr.entry_size)
+		return FFS_CHECK_GEOMETRY;
+
+	size_t entries = (size_t)hdr.entry_count * hdr.entry_size;
+	if (size - sizeof(hdr) < entries)
+		return FFS_CHECK_TRUNCATED;
+
+	p += sizeof(hdr);
+
+	for (size_t i = 0; i < hdr.entry_count; i++) {
+		ffs_entry_t e;
+		memcpy(&e, p + i * sizeof(e), sizeof(e));
+
+		ck = memcpy_checksum(NULL, (void *)&e,
+				     offsetof(ffs_entry_t, checksum));
+		if (be32toh(e.checksum) != ck)
+			return FFS_CHECK_ENTRY_CHECKSUM;
+	}
+
+	if (table == NULL)
+		return 0;
+
+	ffs_hdr_t *copy = malloc(sizeof(hdr) + entries);
+	if (copy == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	memcpy(copy, &hdr, sizeof(hdr));
+	memcpy(copy->entries, p, entries);
+	for (size_t i = 0; i < hdr.entry_count; i++)
+		__entry_be32toh(copy->entries + i);
+
+	*table = copy;
+
+	return 0;
+}
+
+/*
+ * __ffs_mcheck() for the table at 'offset' of 'file', reading the header
+ * first and then only the entries it declares.  -1 only on I/O or
+ * allocation failure.
+ */
+int __ffs_fcheck_table(FILE *file, off_t offset, ffs_hdr_t **table)
+{
+	assert(file != NULL);
+
+	ffs_hdr_t hdr;
+	ssize_t rc = __read_at(file, &hdr, sizeof(hdr), offset);
+	if (rc < 0)
+		return -1;
+
+	/* the header alone first, before sizing the entries by it */
+	int check = __ffs_mcheck(&hdr, rc, 0, NULL);
+	if (check != 0 && check != FFS_CHECK_TRUNCATED)
+		return check;
+	if ((size_t)rc < sizeof(hdr))
+		return FFS_CHECK_TRUNCATED;
+
+	size_t size = sizeof(hdr) +
+		(size_t)be32toh(hdr.entry_count) * sizeof(ffs_entry_t);
+
+	RAII(void*, buf, malloc(size), free);
+	if (buf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	rc = __read_at(file, buf, size, offset);
+	if (rc < 0)
+		return -1;
+
+	return __ffs_mcheck(buf, rc, 0, table);
+}
+
+/*
+ * 1 if a whole table checks out at 'offset', 0 if not.  Candidates are
+ * mostly data that happens to contain the magic, so no error is raised
+ * for them.
+ */
+static int __scan_check(FILE *file, off_t offset, ffs_hdr_t *hdr)
+{
+	RAII(ffs_hdr_t*, table, NULL, free);
+
+	int rc = __ffs_fcheck_table(file, offset, &table);
+	if (rc == -1)
+		return -1;
+	if (rc != 0)
+		return 0;
+
+	memcpy(hdr, table, sizeof(*hdr));
+
+	return 1;
+}
+
+int __ffs_fscan(FILE *file, uint32_t align,
+		int (*func)(off_t, const ffs_hdr_t *, void *), void *ctx)
+{
+	assert(file != NULL);
+
+	if (!is_pow2(align)) {
+		UNEXPECTED("'%d' invalid alignment (must be non-0 and a "
+			   "power of 2)", align);
+		return -1;
+	}
+
+	int fd = fileno(file);
+	if (0 <= fd)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	RAII(uint8_t*, buf, malloc(FFS_SCAN_CHUNK), free);
+	if (buf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	uint32_t magic = htobe32(FFS_MAGIC);
+	int found = 0;
+
+	/* chunks overlap by a partial magic, so none is missed */
+	for (off_t offset = 0;; offset += FFS_SCAN_CHUNK - sizeof(magic) + 1) {
+		ssize_t n = __read_at(file, buf, FFS_SCAN_CHUNK, offset);
+		if (n < 0)
+			return -1;
+
+		uint8_t *p = buf, *end = buf + n;
+		while ((p = memmem(p, end - p, &magic, sizeof(magic))) != NULL) {
+			off_t at = offset + (p++ - buf);
+			if (at & (align - 1))
+				continue;
+
+			ffs_hdr_t hdr;
+			int rc = __scan_check(file, at, &hdr);
+			if (rc < 0)
+				return -1;
+			if (rc == 0)
+				continue;
+
+			found++;
+			if (func != NULL && func(at, &hdr, ctx) < 0)
+				return -1;
+		}
+
+		if (n < (ssize_t)FFS_SCAN_CHUNK)
+			break;
+	}
+
+	return found;
+}
+
 ffs_t *__ffs_fcreate(FILE *file, off_t offset, uint32_t block_size,
 		     uint32_t block_count)
 {
@@ -564,8 +859,13 @@ ffs_t *__ffs_fopen(FILE * file, off_t offset)
 	}
 	memset(self->hdr, 0, sizeof(*self->hdr));
 
-	if (__hdr_read(self->hdr, self->file, self->offset) < 0)
+	/* tables at other offsets may share the stream, see ffs_flush() */
+	flockfile(self->file);
+
+	if (__hdr_read(self->hdr, self->file, self->offset) < 0) {
+		funlockfile(self->file);
 		goto error;
+	}
 
 	self->count = max(self->hdr->entry_count, FFS_ENTRY_EXTENT);
 	size_t size = self->count * self->hdr->entry_size;
@@ -573,16 +873,21 @@ ffs_t *__ffs_fopen(FILE * file, off_t offset)
 	self->hdr = (ffs_hdr_t *)realloc(self->hdr, sizeof(*self->hdr) + size);
 	if (self->hdr == NULL) {
 		ERRNO(errno);
+		funlockfile(self->file);
 		goto error;
 	}
 	memset(self->hdr->entries, 0, size);
 
 	if (0 < self->hdr->entry_count) {
 		if (__entries_read(self->hdr, self->file,
-	 		           self->offset + sizeof(*self->hdr)) < 0)
+	 		           self->offset + sizeof(*self->hdr)) < 0) {
+			funlockfile(self->file);
 			goto error;
+		}
 	}
 
+	funlockfile(self->file);
+
 	if (false) {
  error:
 		if (self != NULL) {
@@ -606,6 +911,16 @@ ffs_t *__ffs_open(const char *path, off_t offset)
 		return NULL;
 	}
 
+	/* compressed images open read-only */
+	if (__ffs_zimage_fcheck(file) == 1) {
+		FILE *image = __ffs_zimage_fopen(file);
+		if (image == NULL) {
+			fclose(file);
+			return NULL;
+		}
+		file = image;
+	}
+
 	ffs_t *self = __ffs_fopen(file, offset);
 	if (self != NULL)
 		self->path = strdup(path);
@@ -613,46 +928,212 @@ ffs_t *__ffs_open(const char *path, off_t offset)
 	return self;
 }
 
-static int ffs_flush(ffs_t * self)
+static inline ffs_hdr_t *__hdr(ffs_t * self)
+{
+	return __atomic_load_n(&self->hdr, __ATOMIC_ACQUIRE);
+}
+
+static ffs_hdr_t *__hdr_dup(ffs_t * self)
 {
 	assert(self != NULL);
 
-	if (__hdr_write(self->hdr, self->file, self->offset) < 0)
-		return -1;
+	size_t size = sizeof(*self->hdr) + self->count * self->hdr->entry_size;
+
+	ffs_hdr_t *hdr = (ffs_hdr_t *) malloc(size);
+	if (hdr == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	memcpy(hdr, self->hdr, size);
+
+	return hdr;
+}
+
+static ffs_hdr_t *__hdr_begin(ffs_t * self)
+{
+	assert(self != NULL);
+
+	if (self->sync == NULL)
+		return self->hdr;
+
+	pthread_mutex_lock(&self->sync->lock);
+
+	ffs_hdr_t *hdr = __hdr_dup(self);
+	if (hdr == NULL)
+		pthread_mutex_unlock(&self->sync->lock);
+
+	return hdr;
+}
+
+static int __hdr_commit(ffs_t * self, ffs_hdr_t * hdr)
+{
+	assert(self != NULL);
+	assert(hdr != NULL);
+
+	ffs_sync_t *sync = self->sync;
+
+	if (sync == NULL) {
+		self->hdr = hdr;
+		self->dirty = true;
+		return 0;
+	}
+
+	if (sync->nr == sync->sz) {
+		size_t sz = sync->sz ? sync->sz * 2 : 8;
+		ffs_hdr_t **tmp = realloc(sync->retired, sz * sizeof(*tmp));
+		if (tmp == NULL) {
+			free(hdr);
+			pthread_mutex_unlock(&sync->lock);
+			ERRNO(errno);
+			return -1;
+		}
+		sync->retired = tmp, sync->sz = sz;
+	}
+
+	sync->retired[sync->nr++] = self->hdr;
+
+	__atomic_store_n(&self->hdr, hdr, __ATOMIC_RELEASE);
+	__atomic_store_n(&self->dirty, true, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&sync->lock);
+
+	return 0;
+}
+
+static void __hdr_abort(ffs_t * self, ffs_hdr_t * hdr)
+{
+	assert(self != NULL);
+
+	if (self->sync == NULL) {
+		self->hdr = hdr;
+		return;
+	}
+
+	free(hdr);
+	pthread_mutex_unlock(&self->sync->lock);
+}
+
+/*
+ * Writer lock w/o a table copy, for in place stores of single entry words
+ */
+static void __hdr_lock(ffs_t * self)
+{
+	assert(self != NULL);
+
+	if (self->sync != NULL)
+		pthread_mutex_lock(&self->sync->lock);
+}
 
-	if (fflush(self->file) != 0) {
+static void __hdr_unlock(ffs_t * self, bool dirty)
+{
+	assert(self != NULL);
+
+	if (dirty)
+		__atomic_store_n(&self->dirty, true, __ATOMIC_RELEASE);
+
+	if (self->sync != NULL)
+		pthread_mutex_unlock(&self->sync->lock);
+}
+
+static void __sync_delete(ffs_sync_t * sync)
+{
+	if (sync == NULL)
+		return;
+
+	for (size_t i = 0; i < sync->nr; i++)
+		free(sync->retired[i]);
+	free(sync->retired);
+
+	pthread_mutex_destroy(&sync->lock);
+	free(sync);
+}
+
+int __ffs_set_concurrent(ffs_t * self, bool enable)
+{
+	assert(self != NULL);
+
+	if (enable == (self->sync != NULL))
+		return 0;
+
+	if (enable == false) {
+		__sync_delete(self->sync), self->sync = NULL;
+		return 0;
+	}
+
+	ffs_sync_t *sync = (ffs_sync_t *) malloc(sizeof(*sync));
+	if (sync == NULL) {
 		ERRNO(errno);
 		return -1;
 	}
 
-	self->dirty = false;
+	memset(sync, 0, sizeof(*sync));
+	pthread_mutex_init(&sync->lock, NULL);
+
+	self->sync = sync;
 
 	return 0;
 }
 
-int __ffs_info(ffs_t * self, int name, uint32_t *value)
+static int ffs_flush(ffs_t * self)
+{
+	assert(self != NULL);
+
+	/*
+	 * The stream lock keeps the seek + write atomic when several tables
+	 * (e.g. primary and backup) of one image share a FILE across threads
+	 */
+	flockfile(self->file);
+
+	/*
+	 * __hdr_write() byte-swaps the table in place, so in concurrent mode
+	 * the published snapshot is left alone and a private copy is written
+	 */
+	ffs_hdr_t *hdr = __hdr_begin(self);
+	if (hdr == NULL) {
+		funlockfile(self->file);
+		return -1;
+	}
+
+	int rc = __hdr_write(hdr, self->file, self->offset);
+	if (rc == 0 && fflush(self->file) != 0) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	if (rc == 0)
+		__atomic_store_n(&self->dirty, false, __ATOMIC_RELEASE);
+
+	__hdr_abort(self, hdr);
+
+	funlockfile(self->file);
+
+	return rc;
+}
+
+int __ffs_info64(ffs_t * self, int name, uint64_t *value)
 {
 	assert(self != NULL);
 	assert(value != NULL);
 
 	switch (name) {
 	case FFS_INFO_MAGIC:
-		*value = self->hdr->magic;
+		*value = __hdr(self)->magic;
 		break;
 	case FFS_INFO_VERSION:
-		*value = self->hdr->version;
+		*value = __hdr(self)->version;
 		break;
 	case FFS_INFO_ENTRY_SIZE:
-		*value = self->hdr->entry_size;
+		*value = __hdr(self)->entry_size;
 		break;
 	case FFS_INFO_ENTRY_COUNT:
-		*value = self->hdr->entry_count;
+		*value = __hdr(self)->entry_count;
 		break;
 	case FFS_INFO_BLOCK_SIZE:
-		*value = self->hdr->block_size;
+		*value = __hdr(self)->block_size;
 		break;
 	case FFS_INFO_BLOCK_COUNT:
-		*value = self->hdr->block_count;
+		*value = __hdr(self)->block_count;
 		break;
 	case FFS_INFO_OFFSET:
 		*value = self->offset;
@@ -665,6 +1146,24 @@ int __ffs_info(ffs_t * self, int name, uint32_t *value)
 	return 0;
 }
 
+int __ffs_info(ffs_t * self, int name, uint32_t *value)
+{
+	assert(value != NULL);
+
+	uint64_t __value;
+	if (__ffs_info64(self, name, &__value) < 0)
+		return -1;
+
+	if (UINT32_MAX < __value) {
+		UNEXPECTED("info field '%d' value '%llx' exceeds 32 bits, "
+			   "use __ffs_info64()", name, (long long)__value);
+		return -1;
+	}
+
+	*value = __value;
+
+	return 0;
+}
 
 int __ffs_fclose(ffs_t * self)
 {
@@ -675,6 +1174,12 @@ int __ffs_fclose(ffs_t * self)
 		if (ffs_flush(self) < 0)
 			return -1;
 
+	if (self->io != NULL)
+		__ffs_io_delete(self->io), self->io = NULL;
+	if (self->sparse == true && 0 <= self->hole_fd)
+		close(self->hole_fd), self->hole_fd = -1;
+	if (self->sync != NULL)
+		__sync_delete(self->sync), self->sync = NULL;
 	if (self->hdr != NULL)
 		free(self->hdr), self->hdr = NULL;
 
@@ -714,7 +1219,7 @@ int __ffs_fsync(ffs_t * self)
 }
 
 static ffs_entry_t *__add_entry_check(ffs_hdr_t * self, off_t offset,
-				      size_t size)
+				      off_t size)
 {
 	assert(self != NULL);
 
@@ -737,7 +1242,7 @@ static ffs_entry_t *__add_entry_check(ffs_hdr_t * self, off_t offset,
 
 int __ffs_iterate_entries(ffs_t * self, int (*func) (ffs_entry_t *))
 {
-	return __iterate_entries(self->hdr, func) != NULL;
+	return __iterate_entries(__hdr(self), func) != NULL;
 }
 
 int __ffs_list_entries(ffs_t * self, const char * name, bool user, FILE * out)
@@ -752,8 +1257,8 @@ int __ffs_list_entries(ffs_t * self, const char * name, bool user, FILE * out)
 
 	int print_entry(ffs_entry_t * entry)
 	{
-		uint32_t offset = entry->base * self->hdr->block_size;
-		uint32_t size = entry->size * self->hdr->block_size;
+		off_t offset = (off_t)entry->base * self->hdr->block_size;
+		off_t size = (off_t)entry->size * self->hdr->block_size;
 
                 if (__ffs_entry_name(self, entry, full_name,
 				     sizeof full_name) < 0)
@@ -762,9 +1267,11 @@ int __ffs_list_entries(ffs_t * self, const char * name, bool user, FILE * out)
 		if (regexec(&rx, full_name, 0, NULL, 0) == REG_NOMATCH)
 			return 0;
 
-		fprintf(stdout, "%3d [%08x-%08x:%8x] "
+		fprintf(stdout, "%3d [%08llx-%08llx:%8llx] "
 			"[%c%c%c%c%c%c%c%c%c%c] %s\n",
-			entry->id, offset, offset+size-1, entry->actual,
+			entry->id, (long long)offset,
+			(long long)(offset + size - 1),
+			(long long)__entry_actual(self->hdr, entry),
 			entry->type == FFS_TYPE_LOGICAL ? 'l' : 'd',
 	/* reserved */	'-', '-', '-', '-', '-', '-', '-',
 			entry->flags & FFS_FLAGS_U_BOOT_ENV ? 'b' : '-',
@@ -793,13 +1300,13 @@ int __ffs_list_entries(ffs_t * self, const char * name, bool user, FILE * out)
 			"]=======================\n", (long long)self->offset);
 		fprintf(out, "vers:%04x size:%04x * blk:%06x blk(s):%06x * "
 			"entsz:%06x ent(s):%06x\n",
-			self->hdr->version, self->hdr->size,
-			self->hdr->block_size, self->hdr->block_count,
-			self->hdr->entry_size, self->hdr->entry_count);
+			__hdr(self)->version, __hdr(self)->size,
+			__hdr(self)->block_size, __hdr(self)->block_count,
+			__hdr(self)->entry_size, __hdr(self)->entry_count);
 		fprintf(out, "------------------------------------------------"
 			"---------------------------\n");
 
-		(void)__iterate_entries(self->hdr, print_entry);
+		(void)__iterate_entries(__hdr(self), print_entry);
 
 		fprintf(stdout, "\n");
 
@@ -814,7 +1321,7 @@ int __ffs_entry_find(ffs_t *self, const char *path, ffs_entry_t *entry)
 	assert(self != NULL);
 	assert(path != NULL);
 
-	ffs_entry_t *__entry = __find_entry(self->hdr, path);
+	ffs_entry_t *__entry = __find_entry(__hdr(self), path);
 	if (__entry != NULL && entry != NULL)
 		*entry = *__entry;
 
@@ -852,7 +1359,7 @@ int __ffs_entry_name(ffs_t *self, ffs_entry_t *entry, char *name, size_t size)
 	assert(self != NULL);
 	assert(entry != NULL);
 
-	ffs_hdr_t *hdr = self->hdr;
+	ffs_hdr_t *hdr = __hdr(self);
 
 	int __entry_name(ffs_entry_t *parent, char *name, size_t size) {
 		assert(parent != NULL);
@@ -884,30 +1391,53 @@ int __ffs_entry_name(ffs_t *self, ffs_entry_t *entry, char *name, size_t size)
 	return __entry_name(entry, name, size);
 }
 
-int __ffs_entry_add(ffs_t * self, const char *path, off_t offset, uint32_t size,
+uint64_t __ffs_entry_actual(ffs_t * self, const ffs_entry_t * entry)
+{
+	assert(self != NULL);
+	assert(entry != NULL);
+
+	return __entry_actual(__hdr(self), entry);
+}
+
+int __ffs_entry_add(ffs_t * self, const char *path, off_t offset, off_t size,
 		    ffs_type_t type, uint32_t flags)
 {
 	assert(self != NULL);
 	assert(path != NULL);
 
+	ffs_hdr_t *hdr = __hdr_begin(self);
+	if (hdr == NULL)
+		return -1;
+
 	if (__ffs_entry_find(self, path, NULL) == true) {
+		__hdr_abort(self, hdr);
 		UNEXPECTED("'%s' entry already exists", path);
 		return -1;
 	}
 
+	/* 'base' and 'size' count blocks, so only the block count is 32-bit */
+	if (UINT32_MAX < offset / hdr->block_size ||
+	    UINT32_MAX < size / hdr->block_size) {
+		__hdr_abort(self, hdr);
+		UNEXPECTED("'%s' at offset %lld and size %lld is out of range "
+			   "for block size '%x'", path, (long long)offset,
+			   (long long)size, hdr->block_size);
+		return -1;
+	}
+
 	ffs_entry_t parent = {.id = FFS_PID_TOPLEVEL };
 	(void)__ffs_entry_find_parent(self, path, &parent);
 
-	ffs_hdr_t *hdr = self->hdr;
-
 	if (type != FFS_TYPE_LOGICAL) {
 		ffs_entry_t *overlap = __add_entry_check(hdr, offset, size);
 		if (overlap != NULL) {
-			UNEXPECTED("'%s' at offset %lld and size %d overlaps "
-				   "'%s' at offset %d and size %d",
-				   path, (long long)offset, size, overlap->name,
-				   overlap->base * hdr->block_size,
-				   overlap->size * hdr->block_size);
+			UNEXPECTED("'%s' at offset %lld and size %lld overlaps "
+				   "'%s' at offset %lld and size %lld",
+				   path, (long long)offset, (long long)size,
+				   overlap->name,
+				   (long long)overlap->base * hdr->block_size,
+				   (long long)overlap->size * hdr->block_size);
+			__hdr_abort(self, hdr);
 			return -1;
 		}
 	}
@@ -916,25 +1446,24 @@ int __ffs_entry_add(ffs_t * self, const char *path, off_t offset, uint32_t size,
 		return empty->type == 0;
 	}
 
+	/* capacity of the table copy, published along with it */
+	uint32_t count = self->count;
+
 	ffs_entry_t *entry = __iterate_entries(hdr, find_empty);
 	if (entry == NULL) {
-		if (self->count <= hdr->entry_count) {
+		if (count <= hdr->entry_count) {
 			size_t new_size;
 			new_size = hdr->entry_size *
-					(self->count + FFS_ENTRY_EXTENT);
+					(count + FFS_ENTRY_EXTENT);
 
-			self->hdr = (ffs_hdr_t *) realloc(self->hdr,
-							  sizeof(*self->hdr) +
-							  new_size);
-			assert(self->hdr != NULL);
+			hdr = (ffs_hdr_t *) realloc(hdr, sizeof(*hdr) +
+						    new_size);
+			assert(hdr != NULL);
 
-			if (hdr != self->hdr)
-				hdr = self->hdr;
-
-			memset(hdr->entries + self->count, 0,
+			memset(hdr->entries + count, 0,
 			       FFS_ENTRY_EXTENT * hdr->entry_size);
 
-			self->count += FFS_ENTRY_EXTENT;
+			count += FFS_ENTRY_EXTENT;
 		}
 
 		entry = hdr->entries + hdr->entry_count;
@@ -973,27 +1502,23 @@ int __ffs_entry_add(ffs_t * self, const char *path, off_t offset, uint32_t size,
 
     if(hdr->size != blocksNeeded)
     {
-        ffs_entry_t entry;
-        if (__ffs_entry_find(self, "part", &entry) == false) {
+        /* look in the working copy, realloc() may have freed self->hdr */
+        ffs_entry_t *entry_p = __find_entry(hdr, "part");
+        if (entry_p == NULL) {
+            __hdr_abort(self, hdr);
             UNEXPECTED("entry '%s' not found in table at offset '%llx'",
                        "part", (long long)self->offset);
                        return -1;
         }
 
-        int find_entry_id(ffs_entry_t * __entry) {
-              return entry.id == __entry->id;
-        }
-
-        ffs_entry_t *entry_p = __iterate_entries(hdr, find_entry_id);
-        assert(entry_p != NULL);
-
         hdr->size = blocksNeeded;
         entry_p->size = blocksNeeded;
         entry_p->actual = blocksNeeded * hdr->block_size;
     }
-	self->dirty = true;
 
-	return 0;
+	self->count = count;
+
+	return __hdr_commit(self, hdr);
 }
 
 int __ffs_entry_delete(ffs_t * self, const char *path)
@@ -1001,14 +1526,20 @@ int __ffs_entry_delete(ffs_t * self, const char *path)
 	assert(self != NULL);
 	assert(path != NULL);
 
+	ffs_hdr_t *hdr = __hdr_begin(self);
+	if (hdr == NULL)
+		return -1;
+
 	ffs_entry_t entry;
 	if (__ffs_entry_find(self, path, &entry) == false) {
+		__hdr_abort(self, hdr);
 		UNEXPECTED("entry '%s' not found in table at offset '%llx'",
 			  path, (long long)self->offset);
 		return -1;
 	}
 
 	if (entry.type == FFS_TYPE_PARTITION) {
+		__hdr_abort(self, hdr);
 		UNEXPECTED("'%s' cannot --delete partition type entries", path);
 		return -1;
 	}
@@ -1021,11 +1552,10 @@ int __ffs_entry_delete(ffs_t * self, const char *path)
 		return 0;
 	}
 
-	ffs_hdr_t *hdr = self->hdr;
-
 	(void)__iterate_entries(hdr, find_children);
 
 	if (0 < children) {
+		__hdr_abort(self, hdr);
 		UNEXPECTED("'%s' has '%d' children, --delete those first",
 			   path, children);
 		return -1;
@@ -1039,16 +1569,14 @@ int __ffs_entry_delete(ffs_t * self, const char *path)
 	assert(entry_p != NULL);
 
 	int start = entry_p - hdr->entries;
-	int count = hdr->entry_count - start;
+	int count = hdr->entry_count - start - 1;
 
 	memmove(entry_p, entry_p + 1, hdr->entry_size * count);
 
 	hdr->entry_count = max(0UL, hdr->entry_count - 1);
 	memset(hdr->entries + hdr->entry_count, 0, hdr->entry_size);
 
-	self->dirty = true;
-
-	return 0;
+	return __hdr_commit(self, hdr);
 }
 
 int __ffs_entry_user_get(ffs_t *self, const char *path, uint32_t word,
@@ -1064,7 +1592,7 @@ int __ffs_entry_user_get(ffs_t *self, const char *path, uint32_t word,
 		return -1;
 	}
 
-	ffs_entry_t *entry = __find_entry(self->hdr, path);
+	ffs_entry_t *entry = __find_entry(__hdr(self), path);
 	if (entry == NULL) {
 		UNEXPECTED("entry '%s' not found in partition table at "
 			   "offset '%llx'", path, (long long)self->offset);
@@ -1088,19 +1616,168 @@ int __ffs_entry_user_put(ffs_t *self, const char *path, uint32_t word,
 		return -1;
 	}
 
-	ffs_entry_t *entry = __find_entry(self->hdr, path);
+	ffs_hdr_t *hdr = __hdr_begin(self);
+	if (hdr == NULL)
+		return -1;
+
+	ffs_entry_t *entry = __find_entry(hdr, path);
 	if (entry == NULL) {
+		__hdr_abort(self, hdr);
 		UNEXPECTED("entry '%s' not found in partition table at "
 			   "offset '%llx'", path, (long long)self->offset);
 		return -1;
 	}
 
 	entry->user.data[word] = value;
-	self->dirty = true;
+
+	return __hdr_commit(self, hdr);
+}
+
+int __ffs_entry_user_get_all(ffs_t *self, const char *path, uint32_t *value)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+	assert(value != NULL);
+
+	ffs_entry_t *entry = __find_entry(__hdr(self), path);
+	if (entry == NULL) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
+	}
+
+	memcpy(value, entry->user.data, sizeof(entry->user.data));
 
 	return 0;
 }
 
+int __ffs_entry_user_put_all(ffs_t *self, const char *path,
+			     const uint32_t *value, uint32_t mask)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+	assert(value != NULL);
+
+	ffs_hdr_t *hdr = __hdr_begin(self);
+	if (hdr == NULL)
+		return -1;
+
+	ffs_entry_t *entry = __find_entry(hdr, path);
+	if (entry == NULL) {
+		__hdr_abort(self, hdr);
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
+	}
+
+	bool changed = false;
+
+	for (uint32_t word = 0; word < FFS_USER_WORDS; word++) {
+		if (!(mask & (1U << word)))
+			continue;
+		if (entry->user.data[word] != value[word]) {
+			entry->user.data[word] = value[word];
+			changed = true;
+		}
+	}
+
+	if (changed == false) {
+		__hdr_abort(self, hdr);
+		return 0;
+	}
+
+	return __hdr_commit(self, hdr);
+}
+
+int __ffs_entry_attr_get(ffs_t *self, const char *path, int name,
+			 uint32_t *value)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+	assert(value != NULL);
+
+	ffs_entry_t *entry = __find_entry(__hdr(self), path);
+	if (entry == NULL) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
+	}
+
+	switch (name) {
+	case FFS_ATTR_FLAGS:
+		*value = entry->flags;
+		break;
+	case FFS_ATTR_ACTUAL:
+		if (UINT32_MAX < __entry_actual(__hdr(self), entry)) {
+			UNEXPECTED("'%s' actual size '%llx' exceeds 32 bits, "
+				   "use __ffs_entry_actual()", path,
+				   (long long)__entry_actual(__hdr(self),
+							     entry));
+			return -1;
+		}
+		*value = entry->actual;
+		break;
+	case FFS_ATTR_TYPE:
+		*value = entry->type;
+		break;
+	default:
+		UNEXPECTED("'%d' invalid attribute", name);
+		return -1;
+	}
+
+	return 0;
+}
+
+int __ffs_entry_attr_set(ffs_t *self, const char *path, int name,
+			 uint32_t value)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+
+	ffs_hdr_t *hdr = __hdr_begin(self);
+	if (hdr == NULL)
+		return -1;
+
+	ffs_entry_t *entry = __find_entry(hdr, path);
+	if (entry == NULL) {
+		__hdr_abort(self, hdr);
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
+	}
+
+	switch (name) {
+	case FFS_ATTR_FLAGS:
+		entry->flags = value;
+		break;
+	case FFS_ATTR_ACTUAL:
+		if (((off_t)entry->size * hdr->block_size) < value) {
+			__hdr_abort(self, hdr);
+			errno = EFBIG;
+			ERRNO(errno);
+			return -1;
+		}
+		__entry_actual_set(hdr, entry, value);
+		break;
+	case FFS_ATTR_TYPE:
+		if (entry->type == FFS_TYPE_PARTITION ||
+		    (value != FFS_TYPE_DATA && value != FFS_TYPE_LOGICAL)) {
+			UNEXPECTED("'%s' invalid type change '%d' => '%d'",
+				   path, entry->type, value);
+			__hdr_abort(self, hdr);
+			return -1;
+		}
+		entry->type = value;
+		break;
+	default:
+		__hdr_abort(self, hdr);
+		UNEXPECTED("'%d' invalid attribute", name);
+		return -1;
+	}
+
+	return __hdr_commit(self, hdr);
+}
+
 ssize_t __ffs_entry_hexdump(ffs_t * self, const char *path, FILE * out)
 {
 	assert(self != NULL);
@@ -1113,11 +1790,11 @@ ssize_t __ffs_entry_hexdump(ffs_t * self, const char *path, FILE * out)
 		return -1;
 	}
 
-	size_t size = entry.size * self->hdr->block_size;
-	if (entry.actual < size)
-		size = entry.actual;
+	off_t size = (off_t)entry.size * self->hdr->block_size;
+	if (__entry_actual(__hdr(self), &entry) < (uint64_t)size)
+		size = __entry_actual(__hdr(self), &entry);
 
-	off_t offset = entry.base * self->hdr->block_size;
+	off_t offset = (off_t)entry.base * self->hdr->block_size;
 
 	if (fseeko(self->file, offset, SEEK_SET) != 0) {
 		ERRNO(errno);
@@ -1129,7 +1806,7 @@ ssize_t __ffs_entry_hexdump(ffs_t * self, const char *path, FILE * out)
 	size_t block_size = self->hdr->block_size;
 	char block[block_size];
 	while (0 < size) {
-		size_t rc = fread(block, 1, min(block_size, size),
+		size_t rc = fread(block, 1, min(block_size, (size_t)size),
 				  self->file);
 		if (rc <= 0) {
 			if (ferror(self->file)) {
@@ -1153,25 +1830,102 @@ ssize_t __ffs_entry_truncate(ffs_t * self, const char *path, size_t size)
 	assert(self != NULL);
 	assert(path != NULL);
 
-	ffs_entry_t * entry = __find_entry(self->hdr, path);
+	ffs_hdr_t *hdr = __hdr_begin(self);
+	if (hdr == NULL)
+		return -1;
+
+	ffs_entry_t * entry = __find_entry(hdr, path);
 	if (entry == NULL) {
+		__hdr_abort(self, hdr);
 		UNEXPECTED("entry '%s' not found in partition table at "
 			   "offset '%llx'", path, (long long)self->offset);
 		return -1;
 	}
 
-	if ((entry->size * self->hdr->block_size) < size) {
+	if (((off_t)entry->size * hdr->block_size) < (off_t)size) {
+		__hdr_abort(self, hdr);
 		errno = EFBIG;
 		ERRNO(errno);
 		return -1;
-	} else {
-		entry->actual = size;
-		self->dirty = true;
 	}
 
+	if (__entry_actual(hdr, entry) != size)
+		entry->user.data[USER_DATA_VOL] &= ~FFS_ENTRY_INTEG_CRC;
+	__entry_actual_set(hdr, entry, size);
+
+	return __hdr_commit(self, hdr);
+}
+
+/*
+ * The CRC word no longer describes the data once it is modified, drop the
+ * valid bit before the first write; writers that stream the whole entry set
+ * it again when they are done
+ */
+static int __entry_crc_invalidate(ffs_t * self, const char *path)
+{
+	ffs_entry_t *entry = __find_entry(__hdr(self), path);
+	if (entry == NULL ||
+	    !(entry->user.data[USER_DATA_VOL] & FFS_ENTRY_INTEG_CRC))
+		return 0;
+
+	__hdr_lock(self);
+
+	entry = __find_entry(self->hdr, path);
+	if (entry != NULL)
+		__atomic_and_fetch(&entry->user.data[USER_DATA_VOL],
+				   ~FFS_ENTRY_INTEG_CRC, __ATOMIC_RELEASE);
+
+	__hdr_unlock(self, entry != NULL);
+
 	return 0;
 }
 
+/*
+ * Grow the 'actual' length of an entry after data has been written past it;
+ * the writer lock is only taken when the table really changes.  A new low
+ * word is stored in place, a table copy is published only when the high
+ * word (or the table version) changes, a reader must not see half of it.
+ */
+static int __entry_extend(ffs_t * self, const char *path, uint64_t actual)
+{
+	ffs_entry_t *entry = __find_entry(__hdr(self), path);
+	if (entry == NULL || actual <= __entry_actual(__hdr(self), entry))
+		return 0;
+
+	__hdr_lock(self);
+
+	ffs_hdr_t *hdr = self->hdr;
+
+	entry = __find_entry(hdr, path);
+	if (entry == NULL || actual <= __entry_actual(hdr, entry)) {
+		__hdr_unlock(self, false);
+		return 0;
+	}
+
+	if (actual >> 32 == __entry_actual(hdr, entry) >> 32) {
+		__atomic_store_n(&entry->actual, (uint32_t)actual,
+				 __ATOMIC_RELEASE);
+		__hdr_unlock(self, true);
+		return 0;
+	}
+
+	__hdr_unlock(self, false);
+
+	hdr = __hdr_begin(self);
+	if (hdr == NULL)
+		return -1;
+
+	entry = __find_entry(hdr, path);
+	if (entry == NULL || actual <= __entry_actual(hdr, entry)) {
+		__hdr_abort(self, hdr);
+		return 0;
+	}
+
+	__entry_actual_set(hdr, entry, actual);
+
+	return __hdr_commit(self, hdr);
+}
+
 ssize_t __ffs_entry_read(ffs_t * self, const char *path, void *buf,
 			 off_t offset, size_t count)
 {
@@ -1189,103 +1943,335 @@ ssize_t __ffs_entry_read(ffs_t * self, const char *path, void *buf,
 		return -1;
 	}
 
-	size_t entry_size = entry.size * self->hdr->block_size;
-	if (entry.actual < entry_size)
-		entry_size = entry.actual;
-	off_t entry_offset = entry.base * self->hdr->block_size;
+	off_t entry_size = (off_t)entry.size * self->hdr->block_size;
+	if (__entry_actual(__hdr(self), &entry) < (uint64_t)entry_size)
+		entry_size = __entry_actual(__hdr(self), &entry);
+	off_t entry_offset = (off_t)entry.base * self->hdr->block_size;
 
 	if (entry_size <= offset)
 		return 0;
 	else
-		count = min(count, (entry_offset + entry_size) - offset);
+		count = min(count, (size_t)(entry_size - offset));
 
-	ssize_t total = 0;
+	return __ffs_pread(self, buf, count, entry_offset + offset);
+}
 
-	if (fseeko(self->file, entry_offset, SEEK_SET) != 0) {
-		ERRNO(errno);
+ssize_t __ffs_entry_write(ffs_t * self, const char *path, const void *buf,
+			  off_t offset, size_t count)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+	assert(buf != NULL);
+
+	if (count == 0)
+		return 0;
+
+	ffs_entry_t entry;
+	if (__ffs_entry_find(self, path, &entry) == false) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
 		return -1;
 	}
 
-	if (fseeko(self->file, offset, SEEK_CUR) != 0) {
-		ERRNO(errno);
+	off_t entry_size = (off_t)entry.size * self->hdr->block_size;
+	off_t entry_offset = (off_t)entry.base * self->hdr->block_size;
+
+	if (entry_size <= offset)
+		return 0;
+	else
+		count = min(count, (size_t)(entry_size - offset));
+
+	if (__entry_crc_invalidate(self, path) < 0)
 		return -1;
-	}
 
-	while (0 < count) {
-		size_t rc = fread(buf + total, 1, count, self->file);
-		if (rc <= 0) {
-			if (ferror(self->file)) {
-				ERRNO(errno);
-				return -1;
-			}
-			break;
-		}
+	ssize_t total = __ffs_pwrite(self, buf, count, entry_offset + offset);
+	if (total < 0)
+		return -1;
 
-		total += rc;
-		count -= rc;
-	}
+	if (__entry_extend(self, path, offset + total) < 0)
+		return -1;
 
 	return total;
 }
 
-ssize_t __ffs_entry_write(ffs_t * self, const char *path, const void *buf,
-			  off_t offset, size_t count)
+ssize_t __ffs_entry_fill(ffs_t * self, const char *path, uint8_t value,
+			 off_t offset, size_t count)
 {
 	assert(self != NULL);
 	assert(path != NULL);
-	assert(buf != NULL);
 
 	if (count == 0)
 		return 0;
 
-	ffs_entry_t *entry = __find_entry(self->hdr, path);
-	if (entry == NULL) {
+	ffs_entry_t entry;
+	if (__ffs_entry_find(self, path, &entry) == false) {
 		UNEXPECTED("entry '%s' not found in partition table at "
 			   "offset '%llx'", path, (long long)self->offset);
 		return -1;
 	}
 
-	size_t entry_size = entry->size * self->hdr->block_size;
-	off_t entry_offset = entry->base * self->hdr->block_size;
+	off_t entry_size = (off_t)entry.size * self->hdr->block_size;
+	off_t entry_offset = (off_t)entry.base * self->hdr->block_size;
 
 	if (entry_size <= offset)
 		return 0;
 	else
-		count = min(count, (entry_offset + entry_size) - offset);
+		count = min(count, (size_t)(entry_size - offset));
 
-	ssize_t total = 0;
+	if (__entry_crc_invalidate(self, path) < 0)
+		return -1;
 
-	if (fseeko(self->file, entry_offset, SEEK_SET) != 0) {
-		ERRNO(errno);
+	return __ffs_fill(self, value, entry_offset + offset, count);
+}
+
+off_t __ffs_entry_seek(ffs_t * self, const char *path, off_t offset,
+		       int whence)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+
+	ffs_entry_t entry;
+	if (__ffs_entry_find(self, path, &entry) == false) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
+	}
+
+	off_t entry_size = (off_t)entry.size * self->hdr->block_size;
+	off_t entry_offset = (off_t)entry.base * self->hdr->block_size;
+
+	off_t rc = __ffs_seek(self, entry_offset + offset,
+			      entry_offset + entry_size, whence);
+	if (rc < 0)
+		return -1;
+
+	return rc - entry_offset;
+}
+
+int __ffs_entry_is_filled(ffs_t * self, const char *path, uint8_t value,
+			  off_t offset, size_t count, off_t * first)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+
+	ffs_entry_t entry;
+	if (__ffs_entry_find(self, path, &entry) == false) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
 		return -1;
 	}
 
-	if (fseeko(self->file, offset, SEEK_CUR) != 0) {
+	off_t entry_size = (off_t)entry.size * self->hdr->block_size;
+	off_t entry_offset = (off_t)entry.base * self->hdr->block_size;
+
+	if (entry_size <= offset) {
+		if (first != NULL)
+			*first = offset;
+		return 1;
+	} else
+		count = min(count, (size_t)(entry_size - offset));
+
+	off_t pos;
+	int rc = __ffs_is_filled(self, value, entry_offset + offset, count,
+				 &pos);
+	if (rc < 0)
+		return -1;
+
+	if (first != NULL)
+		*first = pos - entry_offset;
+
+	return rc;
+}
+
+ssize_t __ffs_entry_copy_range(ffs_t * self, const char *path, ffs_t * in,
+			       const char *in_path, off_t offset, size_t count)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+	assert(in != NULL);
+	assert(in_path != NULL);
+
+	if (count == 0)
+		return 0;
+
+	ffs_entry_t src;
+	if (__ffs_entry_find(in, in_path, &src) == false) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", in_path, (long long)in->offset);
+		return -1;
+	}
+
+	ffs_entry_t entry;
+	if (__ffs_entry_find(self, path, &entry) == false) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
+	}
+
+	off_t src_size = (off_t)src.size * in->hdr->block_size;
+	if (__entry_actual(__hdr(in), &src) < (uint64_t)src_size)
+		src_size = __entry_actual(__hdr(in), &src);
+	off_t entry_size = (off_t)entry.size * self->hdr->block_size;
+
+	if (src_size <= offset || entry_size <= offset)
+		return 0;
+
+	count = min(count, (size_t)(src_size - offset));
+	count = min(count, (size_t)(entry_size - offset));
+
+	if (__entry_crc_invalidate(self, path) < 0)
+		return -1;
+
+	ssize_t total = __ffs_copy_range(self,
+		(off_t)entry.base * self->hdr->block_size + offset, in,
+		(off_t)src.base * in->hdr->block_size + offset, count);
+	if (total <= 0)
+		return total;
+
+	if (__entry_extend(self, path, offset + total) < 0)
+		return -1;
+
+	return total;
+}
+
+/*
+ * CRC32C of the first 'actual' bytes of an entry, as kept in the
+ * USER_DATA_CRC word.  Holes in a sparse image hash as erased data
+ * without being read.
+ */
+int __ffs_entry_crc(ffs_t * self, const char *path, uint32_t * crc)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+	assert(crc != NULL);
+
+	ffs_entry_t entry;
+	if (__ffs_entry_find(self, path, &entry) == false) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
+	}
+
+	off_t entry_size = (off_t)entry.size * self->hdr->block_size;
+	if (__entry_actual(__hdr(self), &entry) < (uint64_t)entry_size)
+		entry_size = __entry_actual(__hdr(self), &entry);
+	off_t entry_offset = (off_t)entry.base * self->hdr->block_size;
+
+	size_t buf_size = min((size_t)entry_size, (size_t)(1UL << 20));
+	RAII(void*, buf, malloc(buf_size ? buf_size : 1), free);
+	if (buf == NULL) {
 		ERRNO(errno);
 		return -1;
 	}
 
-	while (0 < count) {
-		size_t rc = fwrite(buf + total, 1, count, self->file);
-		if (rc <= 0) {
-			if (ferror(self->file)) {
-				ERRNO(errno);
+	off_t offset = entry_offset, end = entry_offset + entry_size;
+	uint32_t sum = 0;
+
+	while (offset < end) {
+		off_t data = __ffs_seek(self, offset, end, SEEK_DATA);
+		if (data < 0)
+			return -1;
+
+		if (offset < data) {
+			sum = crc32c_fill(sum, FFS_SPARSE_FILL, data - offset);
+			offset = data;
+			continue;
+		}
+
+		off_t hole = __ffs_seek(self, offset, end, SEEK_HOLE);
+		if (hole < 0)
+			return -1;
+
+		while (offset < hole) {
+			size_t count = min(buf_size, (size_t)(hole - offset));
+
+			ssize_t rc = __ffs_pread(self, buf, count, offset);
+			if (rc < 0)
 				return -1;
-			}
-			break;
+
+			/* short image, the rest reads as erased */
+			if ((size_t)rc < count)
+				memset(buf + rc, FFS_SPARSE_FILL, count - rc);
+
+			sum = crc32c(sum, buf, count);
+			offset += count;
 		}
-		total += rc;
-		count -= rc;
 	}
 
-	fflush(self->file);
+	*crc = sum;
 
-	if (entry->actual < (uint32_t) total) {
-		entry->actual = (uint32_t) total;
-		self->dirty = true;
+	return 0;
+}
+
+/*
+ * SHA-256 of erase blocks [first, first + nr) of an entry, one digest per
+ * block, covering the whole partition rather than just 'actual' bytes.
+ * Blocks that lie entirely in a hole of a sparse image are not read.
+ */
+int __ffs_entry_hash(ffs_t * self, const char *path, size_t first, size_t nr,
+		     uint8_t * md)
+{
+	assert(self != NULL);
+	assert(path != NULL);
+	assert(md != NULL);
+
+	ffs_entry_t entry;
+	if (__ffs_entry_find(self, path, &entry) == false) {
+		UNEXPECTED("entry '%s' not found in partition table at "
+			   "offset '%llx'", path, (long long)self->offset);
+		return -1;
 	}
 
-	return total;
+	if (entry.size < first + nr) {
+		UNEXPECTED("blocks '%zx..%zx' are beyond the end of entry "
+			   "'%s' (%x blocks)", first, first + nr, path,
+			   entry.size);
+		return -1;
+	}
+
+	size_t block_size = self->hdr->block_size;
+
+	RAII(void*, buf, malloc(block_size), free);
+	if (buf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	uint8_t erased[SHA256_SIZE];
+	bool have_erased = false;
+
+	for (size_t i = 0; i < nr; i++, md += SHA256_SIZE) {
+		off_t offset = (entry.base + first + i) * block_size;
+		off_t end = offset + block_size;
+
+		off_t data = __ffs_seek(self, offset, end, SEEK_DATA);
+		if (data < 0)
+			return -1;
+
+		if (data == end) {
+			if (have_erased == false) {
+				sha256_t ctx;
+				sha256_init(&ctx);
+				sha256_fill(&ctx, FFS_SPARSE_FILL, block_size);
+				sha256_final(&ctx, erased);
+				have_erased = true;
+			}
+			memcpy(md, erased, SHA256_SIZE);
+			continue;
+		}
+
+		ssize_t rc = __ffs_pread(self, buf, block_size, offset);
+		if (rc < 0)
+			return -1;
+
+		/* short image, the rest reads as erased */
+		if ((size_t)rc < block_size)
+			memset(buf + rc, FFS_SPARSE_FILL, block_size - rc);
+
+		sha256(buf, block_size, md);
+	}
+
+	return 0;
 }
 
 #if 0
@@ -1494,4 +2480,178 @@ int __ffs_entry_list(ffs_t * self, ffs_entry_t ** list)
 	return count;
 }
 
+/*
+ * Offsets of the tables nested in 'self', i.e. its FFS_TYPE_PARTITION
+ * entries that hold a sound table, other than the entry for 'self' itself.
+ * The caller opens each over the same stream, __ffs_fopen(self->file, ...)
+ */
+int __ffs_nested(ffs_t * self, off_t ** list)
+{
+	assert(self != NULL);
+	assert(list != NULL);
+
+	*list = NULL;
+
+	RAII(ffs_entry_t*, entries, NULL, free);
+	int nr = __ffs_entry_list(self, &entries);
+	if (nr < 0)
+		return -1;
+
+	int count = 0;
+
+	for (int i = 0; i < nr; i++) {
+		ffs_entry_t *entry = entries + i;
+
+		if (entry->type != FFS_TYPE_PARTITION)
+			continue;
+
+		off_t offset = (off_t)entry->base * self->hdr->block_size;
+		if (offset == self->offset)
+			continue;
+
+		int rc = __ffs_fcheck_table(self->file, offset, NULL);
+		if (rc == -1)
+			goto error;
+		if (rc != 0)
+			continue;
+
+		off_t *tmp = realloc(*list, (count + 1) * sizeof(**list));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			goto error;
+		}
+		*list = tmp;
+
+		(*list)[count++] = offset;
+	}
+
+	if (false) {
+ error:
+		free(*list), *list = NULL;
+		count = -1;
+	}
+
+	return count;
+}
+
+/* ============================================================ */
+
+/*
+ * A transaction edits a private copy of the table through a detached view
+ * of the ffs_t.  Nothing is visible to other users of the table (or written
+ * to the file) until commit, which swaps the copy in and writes the table
+ * once.  In concurrent mode the writer lock is held for the life of the
+ * transaction, so other writers can't be lost under the commit.
+ */
+struct ffs_txn {
+	ffs_t * ffs;
+	ffs_t view;
+};
+
+ffs_txn_t *__ffs_txn_begin(ffs_t * self)
+{
+	assert(self != NULL);
+
+	ffs_txn_t *txn = (ffs_txn_t *) malloc(sizeof(*txn));
+	if (txn == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	if (self->sync != NULL)
+		pthread_mutex_lock(&self->sync->lock);
+
+	txn->ffs = self;
+	txn->view = *self;
+	txn->view.dirty = false;
+	txn->view.io = NULL;
+	txn->view.sync = NULL;
+
+	txn->view.hdr = __hdr_dup(self);
+	if (txn->view.hdr == NULL) {
+		if (self->sync != NULL)
+			pthread_mutex_unlock(&self->sync->lock);
+		free(txn);
+		return NULL;
+	}
+
+	return txn;
+}
+
+int __ffs_txn_find(ffs_txn_t * self, const char *path, ffs_entry_t *entry)
+{
+	assert(self != NULL);
+	return __ffs_entry_find(&self->view, path, entry);
+}
+
+int __ffs_txn_add(ffs_txn_t * self, const char *path, off_t offset,
+		  off_t size, ffs_type_t type, uint32_t flags)
+{
+	assert(self != NULL);
+	return __ffs_entry_add(&self->view, path, offset, size, type, flags);
+}
+
+int __ffs_txn_delete(ffs_txn_t * self, const char *path)
+{
+	assert(self != NULL);
+	return __ffs_entry_delete(&self->view, path);
+}
+
+int __ffs_txn_user_put(ffs_txn_t * self, const char *path, uint32_t word,
+		       uint32_t value)
+{
+	assert(self != NULL);
+	return __ffs_entry_user_put(&self->view, path, word, value);
+}
+
+ssize_t __ffs_txn_truncate(ffs_txn_t * self, const char *path, size_t size)
+{
+	assert(self != NULL);
+	return __ffs_entry_truncate(&self->view, path, size);
+}
+
+int __ffs_txn_abort(ffs_txn_t * self)
+{
+	if (self == NULL)
+		return 0;
+
+	ffs_t *ffs = self->ffs;
+
+	if (ffs->sync != NULL)
+		pthread_mutex_unlock(&ffs->sync->lock);
+
+	free(self->view.hdr);
+	free(self);
+
+	return 0;
+}
+
+int __ffs_txn_commit(ffs_txn_t * self)
+{
+	assert(self != NULL);
+
+	if (self->view.dirty == false)
+		return __ffs_txn_abort(self);
+
+	ffs_t *ffs = self->ffs;
+	ffs_hdr_t *hdr = self->view.hdr;
+
+	uint32_t count = ffs->count;
+	ffs->count = self->view.count;
+
+	if (ffs->sync == NULL) {
+		free(ffs->hdr);
+		ffs->hdr = hdr;
+		ffs->dirty = true;
+	} else if (__hdr_commit(ffs, hdr) < 0) {
+		ffs->count = count;
+		free(self);
+		return -1;
+	}
+
+	free(self);
+
+	return ffs_flush(ffs);
+}
+
 /* ============================================================ */
@@ -61,7 +61,8 @@ struct ffs_error {
 
 typedef struct ffs_error ffs_error_t;
 
-static ffs_error_t __error;
+/* per thread, like the clib error stack it is formatted from */
+static __thread ffs_error_t __error;
 
 /* ============================================================ */
 
@@ -221,6 +222,26 @@ int ffs_fsync(ffs_t * self)
 	return rc;
 }
 
+int ffs_set_concurrent(ffs_t * self, bool enable)
+{
+	int rc = __ffs_set_concurrent(self, enable);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
 int ffs_list_entries(ffs_t * self, FILE * out)
 {
 	int rc = __ffs_list_entries(self, ".*", true, out);
@@ -384,6 +405,130 @@ int ffs_entry_user_put(ffs_t * self, const char *path, uint32_t word,
 	return rc;
 }
 
+int ffs_entry_user_get_all(ffs_t * self, const char *path, uint32_t *value)
+{
+	int rc = __ffs_entry_user_get_all(self, path, value);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_entry_user_put_all(ffs_t * self, const char *path,
+			   const uint32_t *value, uint32_t mask)
+{
+	int rc = __ffs_entry_user_put_all(self, path, value, mask);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_entry_attr_get(ffs_t * self, const char *path, int name,
+		       uint32_t *value)
+{
+	int rc = __ffs_entry_attr_get(self, path, name, value);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_entry_attr_set(ffs_t * self, const char *path, int name,
+		       uint32_t value)
+{
+	int rc = __ffs_entry_attr_set(self, path, name, value);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_entry_crc(ffs_t * self, const char *path, uint32_t *crc)
+{
+	int rc = __ffs_entry_crc(self, path, crc);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_entry_hash(ffs_t * self, const char *path, size_t first, size_t nr,
+		   uint8_t *md)
+{
+	int rc = __ffs_entry_hash(self, path, first, nr, md);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
 ssize_t ffs_entry_hexdump(ffs_t * self, const char *path, FILE * out)
 {
 	ssize_t rc = __ffs_entry_hexdump(self, path, out);
@@ -472,6 +617,27 @@ ssize_t ffs_entry_write(ffs_t * self, const char *path, const void *buf,
 	return rc;
 }
 
+int ffs_entry_is_filled(ffs_t * self, const char *path, uint8_t value,
+			off_t * first)
+{
+	int rc = __ffs_entry_is_filled(self, path, value, 0, SIZE_MAX, first);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
 ssize_t ffs_entry_list(ffs_t * self, ffs_entry_t ** list)
 {
 	ssize_t rc = __ffs_entry_list(self, list);
@@ -492,4 +658,129 @@ ssize_t ffs_entry_list(ffs_t * self, ffs_entry_t ** list)
 	return rc;
 }
 
+ffs_txn_t *ffs_txn_begin(ffs_t * self)
+{
+	ffs_txn_t *txn = __ffs_txn_begin(self);
+	if (txn == NULL) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+	}
+
+	return txn;
+}
+
+int ffs_txn_add(ffs_txn_t * self, const char *path, off_t offset,
+		 uint32_t size, ffs_type_t type, uint32_t flags)
+{
+	int rc = __ffs_txn_add(self, path, offset, size, type, flags);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_txn_delete(ffs_txn_t * self, const char *path)
+{
+	int rc = __ffs_txn_delete(self, path);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_txn_user_put(ffs_txn_t * self, const char *path, uint32_t word,
+		     uint32_t value)
+{
+	int rc = __ffs_txn_user_put(self, path, word, value);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+ssize_t ffs_txn_truncate(ffs_txn_t * self, const char *path, size_t size)
+{
+	ssize_t rc = __ffs_txn_truncate(self, path, size);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_txn_commit(ffs_txn_t * self)
+{
+	int rc = __ffs_txn_commit(self);
+	if (rc < 0) {
+		err_t *err = err_get();
+		assert(err != NULL);
+
+		__error.errnum = err_code(err);
+		snprintf(__error.errstr, sizeof __error.errstr,
+			 "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			 program_invocation_short_name,
+			 err_type_name(err), err_file(err), err_line(err),
+			 err_code(err), err_size(err), (char *)err_data(err));
+
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int ffs_txn_abort(ffs_txn_t * self)
+{
+	return __ffs_txn_abort(self);
+}
+
 /* ============================================================ */
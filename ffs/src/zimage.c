@@ -0,0 +1,526 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: ffs/src/zimage.c $                                            */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *   File: zimage.c
+ * Author:
+ *  Descr: Compressed FFS image container
+ *   Note: A container holds a whole flash image as independently compressed
+ *         frames.  Frames never span a partition boundary, so reading one
+ *         partition only decompresses that partition's frames.  The frame
+ *         index follows the header at the start of the container:
+ *
+ *           header   magic, version, frame size, image size, frame count,
+ *                    CRC32C of the index
+ *           index    one entry per frame: image offset, container offset,
+ *                    size, compressed size
+ *           frames   data
+ *
+ *         All fields are big-endian.  A compressed size of 0 marks an
+ *         erased (all 0xFF) frame that has no data, a compressed size equal
+ *         to the frame size marks a frame stored as is, anything else is an
+ *         LZ block (see clib/lz.h).
+ *
+ *         __ffs_zimage_fopen() returns a read-only stream (fopencookie)
+ *         over the decompressed image, which __ffs_fopen() and friends
+ *         accept like any other image.
+ *   Date: 10/19/26
+ */
+
+#include <sys/types.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+
+#include "libffs.h"
+
+#include <clib/checksum.h>
+#include <clib/mem.h>
+#include <clib/min.h>
+#include <clib/lz.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#define ZIMAGE_MAGIC		"FFSZIMG"
+#define ZIMAGE_VERSION		1
+
+typedef struct zimage_hdr zimage_hdr_t;
+struct zimage_hdr {
+	char magic[8];
+	uint32_t version;
+	uint32_t frame_size;
+	uint64_t size;
+	uint32_t frame_nr;
+	uint32_t checksum;
+} __attribute__ ((packed));
+
+typedef struct zimage_frame zimage_frame_t;
+struct zimage_frame {
+	uint64_t offset;
+	uint64_t data;
+	uint32_t size;
+	uint32_t csize;
+} __attribute__ ((packed));
+
+typedef struct zimage zimage_t;
+struct zimage {
+	FILE *file;
+
+	uint64_t size;
+	uint32_t frame_size;
+	uint32_t frame_nr;
+	zimage_frame_t *frame;		/* host order */
+
+	off_t pos;
+
+	uint32_t cached;		/* frame in 'buf', frame_nr if none */
+	uint8_t *buf;
+	uint8_t *cbuf;
+};
+
+static void __frame_swap(zimage_frame_t * frame)
+{
+	frame->offset = be64toh(frame->offset);
+	frame->data = be64toh(frame->data);
+	frame->size = be32toh(frame->size);
+	frame->csize = be32toh(frame->csize);
+}
+
+static int __fread_at(FILE * file, void *buf, size_t count, off_t offset)
+{
+	if (fseeko(file, offset, SEEK_SET) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	if (fread(buf, 1, count, file) != count) {
+		if (ferror(file))
+			ERRNO(errno);
+		else
+			UNEXPECTED("unexpected end of compressed image at "
+				   "'%llx'", (long long)offset);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void __zimage_delete(zimage_t * self)
+{
+	if (self == NULL)
+		return;
+
+	if (self->file != NULL)
+		fclose(self->file);
+
+	free(self->frame);
+	free(self->buf);
+	free(self->cbuf);
+	free(self);
+}
+
+static zimage_t *__zimage_load(FILE * file)
+{
+	zimage_hdr_t hdr;
+	if (__fread_at(file, &hdr, sizeof(hdr), 0) < 0)
+		return NULL;
+
+	if (memcmp(hdr.magic, ZIMAGE_MAGIC, sizeof(hdr.magic)) != 0) {
+		UNEXPECTED("not a compressed image");
+		return NULL;
+	}
+	if (be32toh(hdr.version) != ZIMAGE_VERSION) {
+		UNEXPECTED("'%d' unsupported compressed image version",
+			   be32toh(hdr.version));
+		return NULL;
+	}
+
+	zimage_t *self = calloc(1, sizeof(*self));
+	if (self == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	self->size = be64toh(hdr.size);
+	self->frame_size = be32toh(hdr.frame_size);
+	self->frame_nr = be32toh(hdr.frame_nr);
+	self->cached = self->frame_nr;
+
+	if (self->frame_size == 0 || FFS_ZIMAGE_FRAME_MAX < self->frame_size) {
+		UNEXPECTED("'%x' invalid compressed image frame size",
+			   self->frame_size);
+		goto error;
+	}
+
+	size_t index_sz = (size_t)self->frame_nr * sizeof(*self->frame);
+
+	self->frame = malloc(index_sz + 1);
+	self->buf = malloc(self->frame_size);
+	self->cbuf = malloc(self->frame_size);
+	if (self->frame == NULL || self->buf == NULL || self->cbuf == NULL) {
+		ERRNO(errno);
+		goto error;
+	}
+
+	if (__fread_at(file, self->frame, index_sz, sizeof(hdr)) < 0)
+		goto error;
+
+	if (crc32c(0, self->frame, index_sz) != be32toh(hdr.checksum)) {
+		UNEXPECTED("compressed image frame index checksum mismatch");
+		goto error;
+	}
+
+	/* the frames must tile [0, size) in order */
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < self->frame_nr; i++) {
+		zimage_frame_t *f = self->frame + i;
+		__frame_swap(f);
+
+		if (f->offset != offset || f->size == 0 ||
+		    self->frame_size < f->size || f->size < f->csize) {
+			UNEXPECTED("compressed image frame '%d' is invalid", i);
+			goto error;
+		}
+		offset += f->size;
+	}
+	if (offset != self->size) {
+		UNEXPECTED("compressed image frames cover '%llx' of '%llx' "
+			   "bytes", (long long)offset, (long long)self->size);
+		goto error;
+	}
+
+	self->file = file;
+
+	return self;
+
+error:
+	__zimage_delete(self);
+	return NULL;
+}
+
+static zimage_frame_t *__frame_find(zimage_t * self, off_t pos)
+{
+	uint32_t lo = 0, hi = self->frame_nr;
+
+	while (1 < hi - lo) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if ((uint64_t)pos < self->frame[mid].offset)
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	return self->frame + lo;
+}
+
+static int __frame_load(zimage_t * self, zimage_frame_t * f)
+{
+	uint32_t idx = f - self->frame;
+	if (self->cached == idx)
+		return 0;
+
+	self->cached = self->frame_nr;
+
+	if (f->csize == f->size) {
+		if (__fread_at(self->file, self->buf, f->size, f->data) < 0)
+			return -1;
+	} else {
+		if (__fread_at(self->file, self->cbuf, f->csize, f->data) < 0)
+			return -1;
+
+		ssize_t rc = lz_decompress(self->cbuf, f->csize, self->buf,
+					   f->size);
+		if (rc != f->size) {
+			UNEXPECTED("compressed image frame '%d' at '%llx' is "
+				   "corrupt", idx, (long long)f->offset);
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	self->cached = idx;
+
+	return 0;
+}
+
+static ssize_t __zimage_read(void *cookie, char *buf, size_t size)
+{
+	zimage_t *self = (zimage_t *) cookie;
+	size_t done = 0;
+
+	while (done < size && (uint64_t)self->pos < self->size) {
+		zimage_frame_t *f = __frame_find(self, self->pos);
+
+		size_t skip = self->pos - f->offset;
+		size_t count = min(size - done, (size_t)f->size - skip);
+
+		if (f->csize == 0) {
+			memset(buf + done, FFS_SPARSE_FILL, count);
+		} else {
+			if (__frame_load(self, f) < 0)
+				return done ? (ssize_t)done : -1;
+			memcpy(buf + done, self->buf + skip, count);
+		}
+
+		done += count;
+		self->pos += count;
+	}
+
+	return done;
+}
+
+static int __zimage_seek(void *cookie, off64_t * offset, int whence)
+{
+	zimage_t *self = (zimage_t *) cookie;
+	off64_t pos;
+
+	switch (whence) {
+	case SEEK_SET:
+		pos = *offset;
+		break;
+	case SEEK_CUR:
+		pos = self->pos + *offset;
+		break;
+	case SEEK_END:
+		pos = self->size + *offset;
+		break;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (pos < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*offset = self->pos = pos;
+
+	return 0;
+}
+
+static int __zimage_close(void *cookie)
+{
+	__zimage_delete((zimage_t *) cookie);
+	return 0;
+}
+
+int __ffs_zimage_fcheck(FILE * file)
+{
+	assert(file != NULL);
+
+	char magic[sizeof(((zimage_hdr_t *) 0)->magic)];
+
+	flockfile(file);
+
+	off_t pos = ftello(file);
+	bool match = pos != -1 && fseeko(file, 0, SEEK_SET) == 0 &&
+		fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+		memcmp(magic, ZIMAGE_MAGIC, sizeof(magic)) == 0;
+
+	clearerr(file);
+	if (pos != -1)
+		fseeko(file, pos, SEEK_SET);
+
+	funlockfile(file);
+
+	return match;
+}
+
+FILE *__ffs_zimage_fopen(FILE * file)
+{
+	assert(file != NULL);
+
+	zimage_t *self = __zimage_load(file);
+	if (self == NULL)
+		return NULL;
+
+	cookie_io_functions_t io = {
+		.read = __zimage_read,
+		.write = NULL,
+		.seek = __zimage_seek,
+		.close = __zimage_close,
+	};
+
+	FILE *stream = fopencookie(self, "r", io);
+	if (stream == NULL) {
+		ERRNO(errno);
+		self->file = NULL;	/* still the caller's */
+		__zimage_delete(self);
+		return NULL;
+	}
+
+	return stream;
+}
+
+static int __cut_cmp(const void *__a, const void *__b)
+{
+	off_t a = *(const off_t *)__a, b = *(const off_t *)__b;
+	return a < b ? -1 : a > b;
+}
+
+int __ffs_zimage_create(FILE * in, FILE * out, uint32_t frame_size,
+			const off_t * cut, size_t cut_nr)
+{
+	assert(in != NULL);
+	assert(out != NULL);
+
+	if (frame_size == 0 || FFS_ZIMAGE_FRAME_MAX < frame_size) {
+		UNEXPECTED("'%x' invalid frame size, valid range [1..%x]",
+			   frame_size, FFS_ZIMAGE_FRAME_MAX);
+		return -1;
+	}
+
+	if (fseeko(in, 0, SEEK_END) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+	off_t size = ftello(in);
+	if (size < 0 || fseeko(in, 0, SEEK_SET) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	off_t sorted[cut_nr + 1];
+	if (cut_nr != 0)
+		memcpy(sorted, cut, cut_nr * sizeof(*cut));
+	qsort(sorted, cut_nr, sizeof(*sorted), __cut_cmp);
+
+	/* plan the frames, restarting at every partition boundary */
+	size_t nr = 0, sz = 0;
+	RAII(zimage_frame_t*, frame, NULL, free);
+
+	size_t c = 0;
+	for (off_t pos = 0; pos < size;) {
+		while (c < cut_nr && sorted[c] <= pos)
+			c++;
+
+		off_t next = min(pos + (off_t)frame_size, size);
+		if (c < cut_nr && sorted[c] < next)
+			next = sorted[c];
+
+		if (nr == sz) {
+			sz = sz ? sz * 2 : 256;
+			zimage_frame_t *tmp = realloc(frame,
+						      sz * sizeof(*tmp));
+			if (tmp == NULL) {
+				ERRNO(errno);
+				return -1;
+			}
+			frame = tmp;
+		}
+
+		frame[nr++] = (zimage_frame_t) {
+			.offset = pos,
+			.size = next - pos,
+		};
+		pos = next;
+	}
+
+	if (UINT32_MAX < nr) {
+		UNEXPECTED("too many frames '%zu'", nr);
+		return -1;
+	}
+
+	RAII(uint8_t*, buf, malloc(frame_size), free);
+	RAII(uint8_t*, cbuf, malloc(frame_size), free);
+	if (buf == NULL || cbuf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	zimage_hdr_t hdr;
+	size_t index_sz = nr * sizeof(*frame);
+	off_t data = sizeof(hdr) + index_sz;
+
+	if (fseeko(out, data, SEEK_SET) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	for (size_t i = 0; i < nr; i++) {
+		zimage_frame_t *f = frame + i;
+
+		if (fread(buf, 1, f->size, in) != f->size) {
+			if (ferror(in))
+				ERRNO(errno);
+			else
+				UNEXPECTED("unexpected end of image at '%llx'",
+					   (long long)f->offset);
+			return -1;
+		}
+
+		const void *src = cbuf;
+
+		if (memfilled(buf, FFS_SPARSE_FILL, f->size) == f->size) {
+			f->csize = 0;
+		} else {
+			/* store the frame as is unless it shrinks */
+			f->csize = lz_compress(buf, f->size, cbuf,
+					       f->size - 1);
+			if (f->csize == 0)
+				f->csize = f->size, src = buf;
+		}
+
+		f->data = data;
+
+		if (fwrite(src, 1, f->csize, out) != f->csize) {
+			ERRNO(errno);
+			return -1;
+		}
+		data += f->csize;
+
+		f->offset = htobe64(f->offset);
+		f->data = htobe64(f->data);
+		f->size = htobe32(f->size);
+		f->csize = htobe32(f->csize);
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, ZIMAGE_MAGIC, sizeof(hdr.magic));
+	hdr.version = htobe32(ZIMAGE_VERSION);
+	hdr.frame_size = htobe32(frame_size);
+	hdr.size = htobe64(size);
+	hdr.frame_nr = htobe32(nr);
+	hdr.checksum = htobe32(crc32c(0, frame, index_sz));
+
+	if (fseeko(out, 0, SEEK_SET) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+	if (fwrite(&hdr, 1, sizeof(hdr), out) != sizeof(hdr) ||
+	    fwrite(frame, 1, index_sz, out) != index_sz ||
+	    fflush(out) == EOF) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return 0;
+}
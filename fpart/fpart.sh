@@ -211,6 +211,183 @@ function delete()
 	pass ${RM} -f ${target}
 }
 
+function batch()
+{
+	local target=${TMP}/batch.nor
+	pass ${RM} -f ${target}
+
+	pass ${FPART} -t ${target} -s 64M -b 64K --partition-offset 0x3f0000 -C
+	pass ${FPART} --target ${target} --size 64MiB --block 64kb -p 0x7f0000 --create
+
+	local input=${TMP}/batch.in
+	local output=${TMP}/batch.txt
+	local name="logical"
+
+	echo "--add -n ${name} -g 0 -l" > ${input}
+	for ((i=0; i<9; i++)); do
+		# avoid clobbering 'part'
+		if [[ ${i} -eq 4 ]]; then
+			local size=$MB
+		else
+			local size=$(($MB-64*KB))
+		fi
+
+		echo "--add -n ${name}/test${i} -o $((${i}*$MB)) -s ${size} -g 0"
+		echo "--trunc -n ${name}/test${i}"
+		echo "--user 1 -n ${name}/test${i} -u ${i}"
+	done >> ${input}
+
+	pass ${FPART} -t ${target} -B ${input}
+	pass ${FPART} -t ${target} -n ${name}/test8 -L > ${output}
+	pass ${GREP} "00800000-008effff" ${output} > /dev/null
+	pass ${FPART} -t ${target} -n ${name}/test8 -U 1 > ${output}
+	pass ${GREP} -F \"= \'8\'\" ${output} > /dev/null
+
+	# all-or-nothing: a failing line leaves the table untouched, and
+	# it fails for that line rather than for a crash in the ones before
+	pass ${CP} ${target} ${target}.orig
+	echo "--delete -n ${name}/test1" > ${input}
+	echo "--add -n overlap -o 0 -s ${MB} -g 0" >> ${input}
+	fail "${FPART} -t ${target} -B - < ${input} 2> ${output}"
+	pass ${GREP} \"overlaps\" ${output} > /dev/null
+	fail ${GREP} \"ERROR: AddressSanitizer\" ${output} > /dev/null
+	pass cmp ${target} ${target}.orig
+
+	# deleting from the middle of the table keeps the entries after it
+	echo "--delete -n ${name}/test1" > ${input}
+	echo "--delete -n ${name}/test8" >> ${input}
+	pass "${FPART} -t ${target} -B ${input} 2> ${output}"
+	fail ${GREP} \"ERROR: AddressSanitizer\" ${output} > /dev/null
+	pass "${FPART} -t ${target} -L > ${output}"
+	fail ${GREP} \"${name}/test1$\" ${output} > /dev/null
+	fail ${GREP} \"${name}/test8$\" ${output} > /dev/null
+	pass "[[ $(${GREP} -c '00700000-007effff.*/test7$' ${output}) -eq 2 ]]"
+
+	pass ${RM} -f ${input} ${output} ${target}.orig
+	pass ${RM} -f ${target}
+}
+
+function build()
+{
+	local target=${TMP}/build.nor
+	local input=${TMP}/build.conf
+	local output=${TMP}/build.txt
+	local data=${TMP}/build.bin
+	pass ${RM} -f ${target}
+
+	pass ${DD} if=${URANDOM} of=${data} bs=1000 count=3 status=none
+
+	echo "image size=64MiB block=64KiB" > ${input}
+	echo "table 0x3f0000" >> ${input}
+	echo "table 0x7f0000" >> ${input}
+	echo "entry name=logical flags=0 logical" >> ${input}
+	echo "entry name=logical/data offset=1M size=64K flags=0 file=${data}" >> ${input}
+	echo "entry name=logical/ecc offset=2M size=64K flags=0 file=${data} ecc" >> ${input}
+
+	pass ${FPART} -t ${target} -I ${input}
+	pass ${FPART} -t ${target} -p 0x7f0000 -n logical/data -L > ${output}
+	pass ${GREP} "00100000-0010ffff" ${output} > /dev/null
+	pass ${GREP} bb8 ${output} > /dev/null
+	pass ${FPART} -t ${target} -n logical/ecc -U 0 > ${output}
+	pass ${GREP} -F \"= \'8000\'\" ${output} > /dev/null
+	pass cmp -n 3000 -i 0:$MB ${data} ${target}
+
+	pass ${RM} -f ${input} ${output} ${data}
+	pass ${RM} -f ${target}
+}
+
+function scan()
+{
+	local target=${TMP}/scan.nor
+	local output=${TMP}/scan.txt
+	pass ${RM} -f ${target}
+
+	pass ${FPART} -t ${target} -s 64M -b 64K -p 0x3f0000,0x7f0000 -C
+	pass ${FPART} -t ${target} -S > ${output}
+	pass ${GREP} "^0x3f0000: " ${output} > /dev/null
+	pass ${GREP} "^0x7f0000: " ${output} > /dev/null
+
+	# a corrupt header is skipped
+	printf '\x55' > ${output}
+	pass ${DD} if=${output} of=${target} bs=1 seek=$((0x3f0000+8)) \
+		conv=notrunc status=none
+	pass ${FPART} -t ${target} -S > ${output}
+	fail ${GREP} "^0x3f0000: " ${output} > /dev/null
+
+	pass ${RM} -f ${output} ${target}
+}
+
+function check()
+{
+	local dir=${TMP}/check
+	local output=${TMP}/check.json
+	pass ${MKDIR} -p ${dir}
+
+	for i in 0 1 2; do
+		pass ${FPART} -t ${dir}/${i}.nor -s 64M -b 64K \
+			-p 0x3f0000,0x7f0000 -C
+		pass ${FPART} -t ${dir}/${i}.nor -p 0x3f0000,0x7f0000 \
+			-A -n data${i} -o 1M -s 64K -g 0
+	done
+
+	pass ${FPART} -K ${dir} -j 2 -c ${output} --crc
+	pass ${GREP} -q data2 ${output}
+
+	# a damaged backup table fails the whole image
+	printf '\x55' > ${output}
+	pass ${DD} if=${output} of=${dir}/1.nor bs=1 seek=$((0x7f0000+8)) \
+		conv=notrunc status=none
+	fail ${FPART} -K ${dir} -c ${output}
+	pass ${GREP} -q header.checksum.mismatch ${output}
+
+	pass ${RM} -rf ${dir} ${output}
+}
+
+function verify()
+{
+	local target=${TMP}/verify.nor
+	local input=${TMP}/verify.conf
+	local data=${TMP}/verify.bin
+	pass ${RM} -f ${target}
+
+	pass ${DD} if=${URANDOM} of=${data} bs=1000 count=3 status=none
+
+	echo "image size=64MiB block=64KiB" > ${input}
+	echo "table 0x3f0000" >> ${input}
+	echo "table 0x7f0000" >> ${input}
+	echo "entry name=ecc offset=2M size=64K flags=0 file=${data} ecc" >> ${input}
+
+	pass ${FPART} -t ${target} -I ${input}
+	pass ${FPART} -t ${target} -V
+
+	# an ECC word that cannot be corrected
+	printf '\x00\x00\x00\x00\x00\x00\x00\x00\xff' > ${data}
+	pass ${DD} if=${data} of=${target} bs=1 seek=$((2*MB)) conv=notrunc \
+		status=none
+	fail ${FPART} -t ${target} -V
+
+	pass ${RM} -f ${input} ${data} ${target}
+}
+
+function large()
+{
+	local target=${TMP}/large.nor
+	local output=${TMP}/large.txt
+	pass ${RM} -f ${target}
+
+	# sparse, offsets and sizes past 4GiB
+	pass ${FPART} -t ${target} -s 16G -b 64K -p 0x3ffff0000 -C -z
+	pass ${FPART} -t ${target} -p 0x3ffff0000 -A -n huge -o 4G -s 6G -g 0
+	pass ${FPART} -t ${target} -p 0x3ffff0000 -T -n huge -s 5G
+
+	pass ${FPART} -t ${target} -p 0x3ffff0000 -L > ${output}
+	pass ${GREP} -q vers:0002 ${output}
+	pass ${GREP} -q 100000000-27fffffff.*140000000 ${output}
+	pass ${FPART} -t ${target} -p 0x3ffff0000 -V
+
+	pass ${RM} -f ${output} ${target}
+}
+
 function hex()
 {
 	local target=${TMP}/hexdump.nor
@@ -376,6 +553,12 @@ function main()
 	create
 	add
 	delete
+	batch
+	build
+	scan
+	check
+	verify
+	large
 #	hex
 #	read
 #	copy  $((15*$KB))
@@ -394,6 +577,12 @@ else
 		create	) create		;;
 		add	) add			;;
 		delete	) delete		;;
+		batch	) batch			;;
+		build	) build			;;
+		scan	) scan			;;
+		check	) check			;;
+		verify	) verify		;;
+		large	) large			;;
 #		hex	) hex			;;
 #		read	) read			;;
 #		copy	) copy	$((${2}*$KB))	;;
@@ -65,13 +65,13 @@ int command_add(args_t * args)
 		int rc = 0;
 
 		off_t offset = 0;
-		uint32_t size = 0;
+		off_t size = 0;
 		uint32_t flags = 0;
 
 		rc = parse_offset(args->offset, &offset);
 		if (rc < 0)
 			return rc;
-		rc = parse_size(args->size, &size);
+		rc = parse_offset(args->size, &size);
 		if (rc < 0)
 			return rc;
 		rc = parse_size(args->flags, &flags);
@@ -95,8 +95,9 @@ int command_add(args_t * args)
 
 		if (args->verbose == f_VERBOSE)
 			printf("%llx: %s: add partition at offset '%llx' size "
-			       "'%x' type '%d' flags '%x'\n", (long long)poffset,
-				args->name, (long long)offset, size, type, flags);
+			       "'%llx' type '%d' flags '%x'\n", (long long)poffset,
+				args->name, (long long)offset, (long long)size,
+				type, flags);
 
 		return rc;
 	}
@@ -0,0 +1,406 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fpart/src/cmd_batch.c $                                       */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_batch.c
+ *  Author:
+ *   Descr: --batch implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <ctype.h>
+#include <regex.h>
+
+#include <clib/attribute.h>
+#include <clib/list.h>
+#include <clib/list_iter.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#include "main.h"
+
+#define BATCH_ARGS	32
+
+/*
+ * One table edit per line of the batch file, using the same options as
+ * the equivalent fpart command, e.g.
+ *
+ *   # layout of bank 0
+ *   --add   -n boot0 -g 0 -l
+ *   --add   -n boot0/ipl -o 1M -s 64K -g 0
+ *   --user  0 -n boot0/ipl -u 0xFF500FF5
+ *   --trunc -n boot0/ipl -s 0x1000
+ *   --delete -n scratch
+ *
+ * Names are fully qualified (no regular expressions).  The whole file is
+ * parsed before the target is opened, then applied to each partition
+ * table as a single transaction.
+ */
+typedef struct batch_op batch_op_t;
+struct batch_op {
+	cmd_t cmd;
+	char * name;
+	off_t offset;
+	off_t size;
+	uint32_t flags;
+	uint32_t user, value;
+	bool has_size, has_value;
+	ffs_type_t type;
+	int line;
+};
+
+typedef struct batch batch_t;
+struct batch {
+	batch_op_t * op;
+	size_t nr, sz;
+};
+
+static void batch_delete(batch_t * batch)
+{
+	for (size_t i = 0; i < batch->nr; i++)
+		free(batch->op[i].name);
+	free(batch->op);
+}
+
+static int batch_parse_line(batch_op_t * op, char * line, int line_nr)
+{
+	static const struct option long_opt[] = {
+		{"add", no_argument, NULL, c_ADD},
+		{"delete", no_argument, NULL, c_DELETE},
+		{"trunc", no_argument, NULL, c_TRUNC},
+		{"user", required_argument, NULL, c_USER},
+		{"name", required_argument, NULL, o_NAME},
+		{"offset", required_argument, NULL, o_OFFSET},
+		{"size", required_argument, NULL, o_SIZE},
+		{"value", required_argument, NULL, o_VALUE},
+		{"flags", required_argument, NULL, o_FLAGS},
+		{"logical", no_argument, NULL, f_LOGICAL},
+		{0, 0, 0, 0}
+	};
+
+	static const char *short_opt = "ADTU:n:o:s:u:g:l";
+
+	char * argv[BATCH_ARGS + 2] = { "batch" };
+	int argc = 1;
+
+	char * save = NULL;
+	for (char * tok = strtok_r(line, " \t\r\n", &save); tok != NULL;
+	     tok = strtok_r(NULL, " \t\r\n", &save)) {
+		if (BATCH_ARGS < argc) {
+			UNEXPECTED("line %d: too many arguments", line_nr);
+			return -1;
+		}
+		argv[argc++] = tok;
+	}
+	argv[argc] = NULL;
+
+	memset(op, 0, sizeof(*op));
+	op->type = FFS_TYPE_DATA;
+	op->line = line_nr;
+
+	bool has_offset = false, has_flags = false;
+
+	int rc = 0;
+	int opt = 0, idx = 0;
+
+	optind = 0;
+	opterr = 0;
+	while (rc == 0 && (opt = getopt_long(argc, argv, short_opt, long_opt,
+					     &idx)) != -1) {
+		switch (opt) {
+		case c_ADD:
+		case c_DELETE:
+		case c_TRUNC:
+		case c_USER:
+			if (op->cmd != c_ERROR) {
+				UNEXPECTED("line %d: commands '%c' and '%c' "
+					   "are mutually exclusive", line_nr,
+					   op->cmd, opt);
+				rc = -1;
+				break;
+			}
+			op->cmd = (cmd_t) opt;
+			if (opt == c_USER)
+				rc = parse_number(optarg, &op->user);
+			break;
+		case o_NAME:
+			free(op->name);
+			op->name = strdup(optarg);
+			if (op->name == NULL) {
+				ERRNO(errno);
+				rc = -1;
+			}
+			break;
+		case o_OFFSET:
+			has_offset = true;
+			rc = parse_offset(optarg, &op->offset);
+			break;
+		case o_SIZE:
+			op->has_size = true;
+			rc = parse_offset(optarg, &op->size);
+			break;
+		case o_VALUE:
+			op->has_value = true;
+			rc = parse_size(optarg, &op->value);
+			break;
+		case o_FLAGS:
+			has_flags = true;
+			rc = parse_size(optarg, &op->flags);
+			break;
+		case f_LOGICAL:
+			op->type = FFS_TYPE_LOGICAL;
+			break;
+		default:
+			UNEXPECTED("line %d: unknown option '%s'", line_nr,
+				   argv[optind - 1]);
+			rc = -1;
+		}
+	}
+
+	optind = 0;
+	opterr = 1;
+
+	if (rc < 0)
+		return -1;
+
+	if (op->cmd == c_ERROR) {
+		UNEXPECTED("line %d: no command specified", line_nr);
+		return -1;
+	}
+
+	if (op->name == NULL) {
+		UNEXPECTED("line %d: --name is required", line_nr);
+		return -1;
+	}
+
+	if (op->cmd == c_ADD) {
+		if (has_flags == false) {
+			UNEXPECTED("line %d: --flags is required for the "
+				   "--add command", line_nr);
+			return -1;
+		}
+		if (op->type != FFS_TYPE_LOGICAL &&
+		    (has_offset == false || op->has_size == false)) {
+			UNEXPECTED("line %d: --offset and --size are required "
+				   "for the --add command", line_nr);
+			return -1;
+		}
+	} else if (op->cmd == c_USER) {
+		if (op->has_value == false) {
+			UNEXPECTED("line %d: --value is required for the "
+				   "--user command", line_nr);
+			return -1;
+		}
+		if (FFS_USER_WORDS <= op->user) {
+			UNEXPECTED("line %d: invalid user word '%d', valid "
+				   "range [0..%d]", line_nr, op->user,
+				   FFS_USER_WORDS - 1);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int batch_parse(batch_t * batch, const char * path)
+{
+	bool std = strcmp(path, "-") == 0;
+
+	FILE * file = std ? stdin : fopen(path, "r");
+	if (file == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	char * line = NULL;
+	size_t line_sz = 0;
+	int line_nr = 0, rc = 0;
+
+	while (rc == 0 && getline(&line, &line_sz, file) != -1) {
+		line_nr++;
+
+		char * hash = strchr(line, '#');
+		if (hash != NULL)
+			*hash = '\0';
+
+		char * p = line;
+		while (isspace(*p))
+			p++;
+		if (*p == '\0')
+			continue;
+
+		if (batch->nr == batch->sz) {
+			size_t sz = batch->sz ? batch->sz * 2 : 64;
+			batch_op_t * tmp = realloc(batch->op, sz * sizeof(*tmp));
+			if (tmp == NULL) {
+				ERRNO(errno);
+				rc = -1;
+				break;
+			}
+			batch->op = tmp, batch->sz = sz;
+		}
+
+		rc = batch_parse_line(batch->op + batch->nr, p, line_nr);
+		if (rc == 0)
+			batch->nr++;
+		else
+			free(batch->op[batch->nr].name);
+	}
+
+	if (rc == 0 && ferror(file)) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	free(line);
+	if (!std)
+		fclose(file);
+
+	return rc;
+}
+
+static int batch_apply(args_t * args, ffs_t * ffs, ffs_txn_t * txn,
+		       batch_op_t * op, off_t poffset)
+{
+	ffs_entry_t entry;
+	off_t size = op->size;
+	int rc = 0;
+
+	switch (op->cmd) {
+	case c_ADD:
+		rc = __ffs_txn_add(txn, op->name, op->offset, op->size,
+				   op->type, op->flags);
+		if (rc == 0 && args->verbose == f_VERBOSE)
+			printf("%llx: %s: add partition at offset '%llx' size "
+			       "'%llx' type '%d' flags '%x'\n", (long long)poffset,
+			       op->name, (long long)op->offset,
+			       (long long)op->size, op->type, op->flags);
+		break;
+	case c_DELETE:
+		rc = __ffs_txn_delete(txn, op->name);
+		if (rc == 0 && args->verbose == f_VERBOSE)
+			printf("%llx: %s: delete\n", (long long)poffset,
+			       op->name);
+		break;
+	case c_TRUNC:
+		/* default to the full partition, which may have been
+		 * added by an earlier line of this batch */
+		if (op->has_size == false &&
+		    __ffs_txn_find(txn, op->name, &entry) == true)
+			size = (off_t)entry.size * ffs->hdr->block_size;
+		rc = __ffs_txn_truncate(txn, op->name, size);
+		if (rc == 0 && args->verbose == f_VERBOSE)
+			printf("%llx: %s: truncate size '%llx'\n",
+			       (long long)poffset, op->name, (long long)size);
+		break;
+	case c_USER:
+		rc = __ffs_txn_user_put(txn, op->name, op->user, op->value);
+		if (rc == 0 && args->verbose == f_VERBOSE)
+			printf("%llx: %s: user[%d] = '%x'\n",
+			       (long long)poffset, op->name, op->user,
+			       op->value);
+		break;
+	default:
+		UNEXPECTED("line %d: invalid command '%c'", op->line, op->cmd);
+		rc = -1;
+	}
+
+	if (rc < 0)
+		UNEXPECTED("line %d: '%s' failed, partition table at offset "
+			   "'%llx' left unchanged", op->line, op->name,
+			   (long long)poffset);
+
+	return rc < 0 ? -1 : 0;
+}
+
+int command_batch(args_t * args)
+{
+	assert(args != NULL);
+
+	batch_t batch = { NULL, 0, 0 };
+
+	if (batch_parse(&batch, args->batch) < 0) {
+		batch_delete(&batch);
+		return -1;
+	}
+
+	/* ========================= */
+
+	int __batch(args_t * args, off_t poffset)
+	{
+		const char * target = args->target;
+		int debug = args->debug;
+
+		RAII(FILE*, file, fopen_generic(target, "r+", debug), fclose);
+		if (file == NULL)
+			return -1;
+		RAII(ffs_t*, ffs, __ffs_fopen(file, poffset), __ffs_fclose);
+		if (ffs == NULL)
+			return -1;
+
+		ffs_txn_t * txn = __ffs_txn_begin(ffs);
+		if (txn == NULL)
+			return -1;
+
+		for (size_t i = 0; i < batch.nr; i++) {
+			if (batch_apply(args, ffs, txn, batch.op + i,
+					poffset) < 0) {
+				__ffs_txn_abort(txn);
+				return -1;
+			}
+		}
+
+		if (__ffs_txn_commit(txn) < 0)
+			return -1;
+
+		if (args->verbose == f_VERBOSE)
+			printf("%llx: batch of %zu command(s) committed\n",
+			       (long long)poffset, batch.nr);
+
+		return 0;
+	}
+
+	/* ========================= */
+
+	int rc = command(args, __batch);
+
+	batch_delete(&batch);
+
+	return rc;
+}
@@ -0,0 +1,544 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fpart/src/cmd_build.c $                                       */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_build.c
+ *  Author:
+ *   Descr: --build implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <ctype.h>
+#include <regex.h>
+
+#include <clib/attribute.h>
+#include <clib/list.h>
+#include <clib/list_iter.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+#include <clib/ecc.h>
+#include <clib/raii.h>
+
+#include "main.h"
+
+#define BUILD_TABLES	8
+
+/*
+ * The layout manifest is a list of keyword lines, '#' starts a comment:
+ *
+ *   image size=64MiB block=64KiB pad=0xFF
+ *   table 0x3f0000
+ *   table 0x7f0000
+ *   entry name=boot0 flags=0 logical
+ *   entry name=boot0/ipl offset=1M size=256K flags=0 file=ipl.bin ecc
+ *   entry name=nvram offset=2M size=64K flags=1 user1=0x1000
+ *
+ * Every entry is added to every table.  The image is composed in a memory
+ * mapping of a temporary file next to the target: the partition tables are
+ * written through a memory stream, payloads are read straight into their
+ * partitions (with P8 ECC injected on the fly for 'ecc' entries), and the
+ * result is renamed over the target once complete.
+ */
+typedef struct build_entry build_entry_t;
+struct build_entry {
+	char * name;
+	char * file;
+	off_t offset;
+	off_t size;
+	uint32_t flags;
+	ffs_type_t type;
+	bool ecc;
+	uint32_t user_mask;
+	uint32_t user[FFS_USER_WORDS];
+	size_t actual;
+	int line;
+};
+
+typedef struct build build_t;
+struct build {
+	off_t size;
+	uint32_t block;
+	uint32_t pad;
+
+	off_t table[BUILD_TABLES];
+	size_t table_nr;
+
+	build_entry_t * entry;
+	size_t nr, sz;
+};
+
+static void build_delete(build_t * build)
+{
+	for (size_t i = 0; i < build->nr; i++) {
+		free(build->entry[i].name);
+		free(build->entry[i].file);
+	}
+	free(build->entry);
+}
+
+static int build_parse_image(build_t * build, char ** save, int line_nr)
+{
+	char * tok;
+	while ((tok = strtok_r(NULL, " \t\r\n", save)) != NULL) {
+		char * val = strchr(tok, '=');
+		if (val == NULL) {
+			UNEXPECTED("line %d: '%s' invalid image field", line_nr,
+				   tok);
+			return -1;
+		}
+		*val++ = '\0';
+
+		int rc = 0;
+		if (strcmp(tok, "size") == 0)
+			rc = parse_offset(val, &build->size);
+		else if (strcmp(tok, "block") == 0)
+			rc = parse_size(val, &build->block);
+		else if (strcmp(tok, "pad") == 0)
+			rc = parse_number(val, &build->pad);
+		else {
+			UNEXPECTED("line %d: '%s' unknown image field",
+				   line_nr, tok);
+			return -1;
+		}
+		if (rc < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int build_parse_entry(build_entry_t * entry, char ** save,
+			     int line_nr)
+{
+	memset(entry, 0, sizeof(*entry));
+	entry->type = FFS_TYPE_DATA;
+	entry->line = line_nr;
+
+	char * tok;
+	while ((tok = strtok_r(NULL, " \t\r\n", save)) != NULL) {
+		if (strcmp(tok, "logical") == 0) {
+			entry->type = FFS_TYPE_LOGICAL;
+			continue;
+		}
+		if (strcmp(tok, "ecc") == 0) {
+			entry->ecc = true;
+			continue;
+		}
+
+		char * val = strchr(tok, '=');
+		if (val == NULL) {
+			UNEXPECTED("line %d: '%s' invalid entry field", line_nr,
+				   tok);
+			return -1;
+		}
+		*val++ = '\0';
+
+		int rc = 0;
+		char * end = NULL;
+		unsigned long word = FFS_USER_WORDS;
+		if (strncmp(tok, "user", 4) == 0 && isdigit(tok[4])) {
+			word = strtoul(tok + 4, &end, 10);
+			if (*end != '\0')
+				word = FFS_USER_WORDS;
+		}
+
+		if (strcmp(tok, "name") == 0) {
+			free(entry->name);
+			entry->name = strdup(val);
+		} else if (strcmp(tok, "file") == 0) {
+			free(entry->file);
+			entry->file = strdup(val);
+		} else if (strcmp(tok, "offset") == 0) {
+			rc = parse_offset(val, &entry->offset);
+		} else if (strcmp(tok, "size") == 0) {
+			rc = parse_offset(val, &entry->size);
+		} else if (strcmp(tok, "flags") == 0) {
+			rc = parse_number(val, &entry->flags);
+		} else if (word < FFS_USER_WORDS) {
+			entry->user_mask |= 1U << word;
+			rc = parse_number(val, &entry->user[word]);
+		} else {
+			UNEXPECTED("line %d: '%s' unknown entry field",
+				   line_nr, tok);
+			return -1;
+		}
+		if (rc < 0)
+			return -1;
+	}
+
+	if (entry->name == NULL) {
+		UNEXPECTED("line %d: entry name= is required", line_nr);
+		return -1;
+	}
+
+	if (entry->type == FFS_TYPE_LOGICAL) {
+		if (entry->file != NULL || entry->ecc) {
+			UNEXPECTED("line %d: logical entry '%s' cannot hold "
+				   "data", line_nr, entry->name);
+			return -1;
+		}
+	} else if (entry->size == 0) {
+		UNEXPECTED("line %d: entry '%s' size= is required", line_nr,
+			   entry->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int build_parse(build_t * build, const char * path)
+{
+	FILE * file = fopen(path, "r");
+	if (file == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	char * line = NULL;
+	size_t line_sz = 0;
+	int line_nr = 0, rc = 0;
+
+	while (rc == 0 && getline(&line, &line_sz, file) != -1) {
+		line_nr++;
+
+		char * hash = strchr(line, '#');
+		if (hash != NULL)
+			*hash = '\0';
+
+		char * save = NULL;
+		char * key = strtok_r(line, " \t\r\n", &save);
+		if (key == NULL)
+			continue;
+
+		if (strcmp(key, "image") == 0) {
+			rc = build_parse_image(build, &save, line_nr);
+		} else if (strcmp(key, "table") == 0) {
+			char * tok = strtok_r(NULL, " \t\r\n", &save);
+			if (tok != NULL && strncmp(tok, "offset=", 7) == 0)
+				tok += 7;
+			if (tok == NULL || build->table_nr == BUILD_TABLES) {
+				UNEXPECTED("line %d: invalid table", line_nr);
+				rc = -1;
+			} else {
+				rc = parse_offset(tok,
+					build->table + build->table_nr++);
+			}
+		} else if (strcmp(key, "entry") == 0) {
+			if (build->nr == build->sz) {
+				size_t sz = build->sz ? build->sz * 2 : 32;
+				build_entry_t * tmp = realloc(build->entry,
+							sz * sizeof(*tmp));
+				if (tmp == NULL) {
+					ERRNO(errno);
+					rc = -1;
+					break;
+				}
+				build->entry = tmp, build->sz = sz;
+			}
+
+			build_entry_t * entry = build->entry + build->nr;
+			rc = build_parse_entry(entry, &save, line_nr);
+			if (rc == 0) {
+				build->nr++;
+			} else {
+				free(entry->name);
+				free(entry->file);
+			}
+		} else {
+			UNEXPECTED("line %d: '%s' unknown keyword", line_nr,
+				   key);
+			rc = -1;
+		}
+	}
+
+	if (rc == 0 && ferror(file)) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	free(line);
+	fclose(file);
+
+	if (rc < 0)
+		return -1;
+
+	if (build->size == 0 || build->block == 0) {
+		UNEXPECTED("'%s': image size= and block= are required", path);
+		return -1;
+	}
+
+	if (build->table_nr == 0) {
+		UNEXPECTED("'%s': at least one table is required", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Read the payload of 'entry' into its partition, injecting ECC if the
+ * entry asks for it, and record the number of bytes stored
+ */
+static int build_payload(uint8_t * image, build_entry_t * entry)
+{
+	if (entry->file == NULL)
+		return 0;
+
+	int fd = open(entry->file, O_RDONLY);
+	if (fd < 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		ERRNO(errno);
+		close(fd);
+		return -1;
+	}
+
+	size_t data = st.st_size;
+	size_t stored = data;
+	if (entry->ecc)
+		stored = align(data, 8) / 8 * 9;
+
+	if (entry->size < (off_t)stored) {
+		UNEXPECTED("line %d: '%s' payload '%s' (%zx bytes stored) "
+			   "exceeds partition size '%llx'", entry->line,
+			   entry->name, entry->file, stored,
+			   (long long)entry->size);
+		close(fd);
+		return -1;
+	}
+
+	uint8_t * dst = image + entry->offset;
+
+	/* an ECC payload is staged then expanded into the partition */
+	RAII(void*, buf, entry->ecc ? malloc(align(data, 8)) : NULL, free);
+	if (entry->ecc && buf == NULL) {
+		ERRNO(errno);
+		close(fd);
+		return -1;
+	}
+
+	uint8_t * in = entry->ecc ? buf : dst;
+	size_t done = 0;
+
+	while (done < data) {
+		ssize_t rc = read(fd, in + done, data - done);
+		if (rc <= 0) {
+			if (rc == 0)
+				errno = EIO;
+			ERRNO(errno);
+			close(fd);
+			return -1;
+		}
+		done += rc;
+	}
+
+	close(fd);
+
+	if (entry->ecc && 0 < data) {
+		memset(in + data, 0, align(data, 8) - data);
+		if (p8_ecc_inject(dst, entry->size, in,
+				  align(data, 8)) < 0) {
+			ERRNO(errno);
+			return -1;
+		}
+	}
+
+	entry->actual = stored;
+
+	return 0;
+}
+
+static int build_table(args_t * args, build_t * build, uint8_t * image,
+		       off_t poffset)
+{
+	if (args->verbose == f_VERBOSE)
+		printf("%llx: create partition table\n", (long long)poffset);
+
+	/* the table is written through a memory stream over the image */
+	FILE * mem = fmemopen(image, build->size, "r+");
+	if (mem == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	/* on failure, __ffs_fcreate() may already have closed the stream */
+	ffs_t * ffs = __ffs_fcreate(mem, poffset, build->block,
+				    build->size / build->block);
+	if (ffs == NULL)
+		return -1;
+
+	for (size_t i = 0; i < build->nr; i++) {
+		build_entry_t * e = build->entry + i;
+
+		if (__ffs_entry_add(ffs, e->name, e->offset, e->size,
+				    e->type, e->flags) < 0)
+			goto error;
+
+		if (e->ecc) {
+			e->user[USER_DATA_VOL] |= FFS_ENTRY_INTEG_ECC;
+			e->user_mask |= 1U << USER_DATA_VOL;
+		}
+
+		if (__ffs_entry_user_put_all(ffs, e->name, e->user,
+					     e->user_mask) < 0)
+			goto error;
+
+		if (e->type != FFS_TYPE_LOGICAL)
+			if (__ffs_entry_truncate(ffs, e->name, e->actual) < 0)
+				goto error;
+
+		if (args->verbose == f_VERBOSE)
+			printf("%llx: %s: add partition at offset '%llx' size "
+			       "'%llx' actual '%zx'%s\n", (long long)poffset,
+			       e->name, (long long)e->offset,
+			       (long long)e->size, e->actual,
+			       e->ecc ? " ecc" : "");
+	}
+
+	if (__ffs_fclose(ffs) < 0) {
+		fclose(mem);
+		return -1;
+	}
+
+	if (fclose(mem) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return 0;
+
+error:
+	/* don't let a half built table reach the image */
+	ffs->dirty = false;
+	__ffs_fclose(ffs);
+	fclose(mem);
+	return -1;
+}
+
+int command_build(args_t * args)
+{
+	assert(args != NULL);
+
+	build_t build;
+	memset(&build, 0, sizeof(build));
+	build.pad = 0xFF;
+
+	if (build_parse(&build, args->build) < 0) {
+		build_delete(&build);
+		return -1;
+	}
+
+	const char * target = args->target;
+	char tmp[strlen(target) + 8];
+	sprintf(tmp, "%s.XXXXXX", target);
+
+	int fd = mkstemp(tmp);
+	if (fd < 0) {
+		ERRNO(errno);
+		build_delete(&build);
+		return -1;
+	}
+
+	uint8_t * image = MAP_FAILED;
+	int rc = -1;
+
+	if (ftruncate(fd, build.size) < 0) {
+		ERRNO(errno);
+		goto out;
+	}
+
+	image = mmap(NULL, build.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     fd, 0);
+	if (image == MAP_FAILED) {
+		ERRNO(errno);
+		goto out;
+	}
+
+	/* the fresh file is all holes, which already read as erased */
+	if (!(args->sparse == f_SPARSE && (uint8_t)build.pad == 0xFF))
+		memset(image, build.pad, build.size);
+
+	for (size_t i = 0; i < build.nr; i++) {
+		build_entry_t * e = build.entry + i;
+
+		if (e->type != FFS_TYPE_LOGICAL &&
+		    build.size < e->offset + e->size) {
+			UNEXPECTED("line %d: '%s' extends past the end of the "
+				   "image", e->line, e->name);
+			goto out;
+		}
+
+		if (build_payload(image, e) < 0)
+			goto out;
+	}
+
+	for (size_t i = 0; i < build.table_nr; i++)
+		if (build_table(args, &build, image, build.table[i]) < 0)
+			goto out;
+
+	if (msync(image, build.size, MS_SYNC) < 0) {
+		ERRNO(errno);
+		goto out;
+	}
+
+	if (rename(tmp, target) < 0) {
+		ERRNO(errno);
+		goto out;
+	}
+
+	if (args->verbose == f_VERBOSE)
+		printf("%s: built %zu entries in %zu table(s)\n", target,
+		       build.nr, build.table_nr);
+
+	rc = 0;
+out:
+	if (image != MAP_FAILED)
+		munmap(image, build.size);
+	close(fd);
+	if (rc < 0)
+		unlink(tmp);
+
+	build_delete(&build);
+
+	return rc;
+}
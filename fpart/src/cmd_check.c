@@ -0,0 +1,612 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fpart/src/cmd_check.c $                                       */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_check.c
+ *  Author:
+ *   Descr: --check-dir implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <fcntl.h>
+#include <fts.h>
+#include <limits.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <clib/attribute.h>
+#include <clib/checksum.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+#include <clib/workq.h>
+
+#include "main.h"
+
+#define CATALOG_VERSION		1
+
+/*
+ * One job per image file.  Each job renders its own catalog record and
+ * failure report, the main thread writes them out in directory order once
+ * every job is done.
+ */
+typedef struct check check_t;
+typedef struct check_job check_job_t;
+
+struct check_job {
+	check_t * check;
+	char * path;
+
+	char * json;
+	size_t json_sz;
+	char * report;
+	size_t report_sz;
+
+	bool failed;
+};
+
+struct check {
+	args_t * args;
+
+	off_t * offset;
+	size_t offset_nr;
+
+	check_job_t * job;
+	size_t nr, sz;
+};
+
+/* an image file, mmap'd, or expanded in memory if it is compressed */
+typedef struct image image_t;
+struct image {
+	int fd;
+	uint8_t * data;
+	size_t size;
+	bool mapped;
+};
+
+/* CRC32C already computed for one of the image's tables */
+typedef struct crc_cache crc_cache_t;
+struct crc_cache {
+	struct {
+		off_t base;
+		uint64_t actual;
+		uint32_t crc;
+	} * entry;
+	size_t nr, sz;
+};
+
+static uint8_t empty;
+
+static int image_open(image_t * self, const char * path)
+{
+	memset(self, 0, sizeof(*self));
+	self->data = &empty;
+
+	self->fd = open(path, O_RDONLY);
+	if (self->fd < 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(self->fd, &st) < 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	self->size = st.st_size;
+	if (self->size == 0)
+		return 0;
+
+	FILE * file = fdopen(dup(self->fd), "r");
+	if (file == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	if (__ffs_zimage_fcheck(file) != 1) {
+		fclose(file);
+
+		void * data = mmap(NULL, self->size, PROT_READ, MAP_PRIVATE,
+				   self->fd, 0);
+		if (data == MAP_FAILED) {
+			ERRNO(errno);
+			return -1;
+		}
+		madvise(data, self->size, MADV_SEQUENTIAL);
+
+		self->data = data;
+		self->mapped = true;
+
+		return 0;
+	}
+
+	RAII(FILE*, image, __ffs_zimage_fopen(file), fclose);
+	if (image == NULL) {
+		fclose(file);
+		return -1;
+	}
+
+	if (fseeko(image, 0, SEEK_END) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+	self->size = ftello(image);
+	rewind(image);
+
+	self->data = malloc(self->size + 1);
+	if (self->data == NULL) {
+		self->data = &empty;
+		ERRNO(errno);
+		return -1;
+	}
+
+	if (fread(self->data, 1, self->size, image) != self->size) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void image_close(image_t * self)
+{
+	if (self->mapped)
+		munmap(self->data, self->size);
+	else if (self->data != &empty)
+		free(self->data);
+
+	if (0 <= self->fd)
+		close(self->fd);
+}
+
+/* holes of sparse images read as erased (0xFF), not as mmap's 0x00 */
+static uint32_t image_crc(image_t * self, off_t offset, size_t count,
+			  bool sparse)
+{
+	if (sparse == false || self->mapped == false)
+		return crc32c(0, self->data + offset, count);
+
+	uint32_t crc = 0;
+	off_t end = offset + count;
+
+	while (offset < end) {
+		off_t data = lseek(self->fd, offset, SEEK_DATA);
+		if (data < 0)
+			data = errno == ENXIO ? end : offset;
+		data = min(data, end);
+
+		crc = crc32c_fill(crc, FFS_SPARSE_FILL, data - offset);
+
+		off_t hole = end;
+		if (data < end)
+			hole = lseek(self->fd, data, SEEK_HOLE);
+		if (hole < 0)
+			hole = end;
+		hole = min(hole, end);
+
+		crc = crc32c(crc, self->data + data, hole - data);
+		offset = hole;
+	}
+
+	return crc;
+}
+
+static void json_string(FILE * out, const char * str)
+{
+	fputc('"', out);
+
+	for (const unsigned char * s = (const unsigned char *)str;
+	     *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(out, "\\%c", *s);
+		else if (*s < 0x20)
+			fprintf(out, "\\u%04x", *s);
+		else
+			fputc(*s, out);
+	}
+
+	fputc('"', out);
+}
+
+static const char * entry_type(ffs_entry_t * entry)
+{
+	switch (entry->type) {
+	case FFS_TYPE_DATA:
+		return "data";
+	case FFS_TYPE_LOGICAL:
+		return "logical";
+	case FFS_TYPE_PARTITION:
+		return "partition";
+	default:
+		return "unknown";
+	}
+}
+
+static uint32_t *__crc_lookup(crc_cache_t * cache, image_t * image,
+			      off_t base, uint64_t actual, bool sparse)
+{
+	for (size_t i = 0; i < cache->nr; i++)
+		if (cache->entry[i].base == base &&
+		    cache->entry[i].actual == actual)
+			return &cache->entry[i].crc;
+
+	if (cache->nr == cache->sz) {
+		size_t sz = cache->sz ? cache->sz * 2 : 64;
+		void * tmp = realloc(cache->entry, sz * sizeof(*cache->entry));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			return NULL;
+		}
+		cache->entry = tmp, cache->sz = sz;
+	}
+
+	cache->entry[cache->nr].base = base;
+	cache->entry[cache->nr].actual = actual;
+	cache->entry[cache->nr].crc = image_crc(image, base, actual, sparse);
+
+	return &cache->entry[cache->nr++].crc;
+}
+
+static int __check_table(check_job_t * job, image_t * image, off_t offset,
+			 crc_cache_t * cache, FILE * json, FILE * report)
+{
+	args_t * args = job->check->args;
+
+	RAII(ffs_hdr_t*, hdr, NULL, free);
+	int rc = __ffs_mcheck(image->data, image->size, offset, &hdr);
+	if (rc == -1)
+		return -1;
+
+	fprintf(json, "{\"offset\":%lld,\"status\":", (long long)offset);
+	json_string(json, check_status(rc));
+
+	if (rc != 0) {
+		fprintf(report, "%s: 0x%llx: %s\n", job->path,
+			(long long)offset, check_status(rc));
+		job->failed = true;
+		fputc('}', json);
+		return 0;
+	}
+
+	uint32_t block_size = hdr->block_size;
+
+	fprintf(json, ",\"block_size\":%u,\"block_count\":%u,"
+		"\"partitions\":[", block_size, hdr->block_count);
+
+	/* just enough of a table for __ffs_entry_name() */
+	ffs_t ffs = {
+		.hdr = hdr,
+		.offset = offset,
+		.count = hdr->entry_count,
+	};
+
+	char name[PATH_MAX];
+
+	for (uint32_t i = 0; i < hdr->entry_count; i++) {
+		ffs_entry_t * entry = hdr->entries + i;
+
+		if (__ffs_entry_name(&ffs, entry, name, sizeof name) < 0)
+			return -1;
+
+		off_t base = (off_t)entry->base * block_size;
+		off_t size = (off_t)entry->size * block_size;
+		uint64_t actual = __ffs_entry_actual(&ffs, entry);
+
+		fprintf(json, "%s{\"name\":", i ? "," : "");
+		json_string(json, name);
+		fprintf(json, ",\"type\":\"%s\",\"base\":%lld,\"size\":%lld,"
+			"\"actual\":%llu", entry_type(entry), (long long)base,
+			(long long)size, (unsigned long long)actual);
+
+		bool recorded = entry->type == FFS_TYPE_DATA &&
+			entry->user.data[USER_DATA_VOL] & FFS_ENTRY_INTEG_CRC;
+		uint32_t want = entry->user.data[USER_DATA_CRC];
+
+		if (recorded)
+			fprintf(json, ",\"crc\":\"%08x\"", want);
+
+		if (args->crc != f_CRC || entry->type != FFS_TYPE_DATA) {
+			fputc('}', json);
+			continue;
+		}
+
+		if ((off_t)image->size < base ||
+		    (uint64_t)image->size - base < actual) {
+			fprintf(json, ",\"status\":\"truncated\"}");
+			fprintf(report, "%s: 0x%llx: %s: truncated\n",
+				job->path, (long long)offset, name);
+			job->failed = true;
+			continue;
+		}
+
+		/* the backup table usually lists the same partitions */
+		uint32_t * cached = __crc_lookup(cache, image, base, actual,
+						 args->sparse == f_SPARSE);
+		if (cached == NULL)
+			return -1;
+
+		uint32_t crc = *cached;
+		bool ok = recorded == false || crc == want;
+
+		fprintf(json, ",\"crc32c\":\"%08x\",\"status\":\"%s\"}", crc,
+			ok ? "ok" : "crc mismatch");
+
+		if (ok == false) {
+			fprintf(report, "%s: 0x%llx: %s: crc mismatch '%08x' "
+				"!= '%08x'\n", job->path, (long long)offset,
+				name, crc, want);
+			job->failed = true;
+		}
+	}
+
+	fprintf(json, "]}");
+
+	return 0;
+}
+
+static int __check_image(void * arg)
+{
+	check_job_t * job = (check_job_t *)arg;
+	check_t * check = job->check;
+
+	RAII(FILE*, json, open_memstream(&job->json, &job->json_sz), fclose);
+	RAII(FILE*, report, open_memstream(&job->report, &job->report_sz),
+	     fclose);
+	if (json == NULL || report == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	fprintf(json, "{\"image\":");
+	json_string(json, job->path);
+
+	image_t image;
+	if (image_open(&image, job->path) < 0) {
+		/* an unreadable image is a finding, not a failure to run */
+		char msg[256] = "";
+
+		err_t * err = err_get();
+		if (err != NULL)
+			snprintf(msg, sizeof msg, "%.*s", err_size(err),
+				 (const char *)err_data(err));
+
+		fprintf(json, ",\"status\":");
+		json_string(json, msg);
+		fputc('}', json);
+		fprintf(report, "%s: %s\n", job->path, msg);
+		job->failed = true;
+
+		for (; err != NULL; err = err_get())
+			err_delete(err);
+
+		image_close(&image);
+		return 0;
+	}
+
+	fprintf(json, ",\"size\":%zu,\"tables\":[", image.size);
+
+	crc_cache_t cache = { NULL, 0, 0 };
+	int rc = 0;
+
+	for (size_t i = 0; i < check->offset_nr && rc == 0; i++) {
+		if (i != 0)
+			fputc(',', json);
+		rc = __check_table(job, &image, check->offset[i], &cache,
+				   json, report);
+	}
+
+	fprintf(json, "],\"status\":\"%s\"}", job->failed ? "failed" : "ok");
+
+	free(cache.entry);
+	image_close(&image);
+
+	return rc;
+}
+
+static int __fts_cmp(const FTSENT ** a, const FTSENT ** b)
+{
+	return strcmp((*a)->fts_name, (*b)->fts_name);
+}
+
+static int __check_walk(check_t * check, const char * dir)
+{
+	char * paths[] = { (char *)dir, NULL };
+
+	FTS * fts = fts_open(paths, FTS_PHYSICAL | FTS_NOCHDIR, __fts_cmp);
+	if (fts == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	int rc = 0;
+	FTSENT * ent;
+
+	for (errno = 0; (ent = fts_read(fts)) != NULL; errno = 0) {
+		if (ent->fts_info == FTS_DNR || ent->fts_info == FTS_ERR ||
+		    ent->fts_info == FTS_NS) {
+			ERRNO(ent->fts_errno);
+			rc = -1;
+			break;
+		}
+		if (ent->fts_info != FTS_F)
+			continue;
+
+		if (check->nr == check->sz) {
+			size_t sz = check->sz ? check->sz * 2 : 256;
+			check_job_t * tmp = realloc(check->job,
+						    sz * sizeof(*tmp));
+			if (tmp == NULL) {
+				ERRNO(errno);
+				rc = -1;
+				break;
+			}
+			check->job = tmp, check->sz = sz;
+		}
+
+		check_job_t * job = check->job + check->nr;
+		memset(job, 0, sizeof(*job));
+		job->check = check;
+		job->path = strdup(ent->fts_path);
+		if (job->path == NULL) {
+			ERRNO(errno);
+			rc = -1;
+			break;
+		}
+		check->nr++;
+	}
+
+	if (rc == 0 && ent == NULL && errno != 0) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	fts_close(fts);
+
+	return rc;
+}
+
+static int __catalog_write(check_t * check, const char * path)
+{
+	bool std = strcmp(path, "-") == 0;
+
+	FILE * out = std ? stdout : fopen(path, "w");
+	if (out == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	fprintf(out, "{\"version\":%d,\"images\":[\n", CATALOG_VERSION);
+	for (size_t i = 0; i < check->nr; i++)
+		fprintf(out, "%s%s", check->job[i].json,
+			i + 1 < check->nr ? ",\n" : "\n");
+	fprintf(out, "]}\n");
+
+	int rc = 0;
+	if (fflush(out) == EOF || ferror(out)) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	if (!std && fclose(out) == EOF && rc == 0) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int command_check(args_t * args)
+{
+	assert(args != NULL);
+
+	uint32_t threads = 0;
+	if (args->jobs != NULL)
+		if (parse_number(args->jobs, &threads) < 0)
+			return -1;
+	if (threads == 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	off_t offset[strlen(args->poffset) / 2 + 1];
+
+	check_t check = {
+		.args = args,
+		.offset = offset,
+	};
+
+	/* ========================= */
+
+	int __offset(args_t * args __unused__, off_t poffset)
+	{
+		check.offset[check.offset_nr++] = poffset;
+		return 0;
+	}
+
+	/* ========================= */
+
+	if (command(args, __offset) < 0)
+		return -1;
+
+	int rc = __check_walk(&check, args->check);
+
+	if (rc == 0 && 0 < check.nr) {
+		workq_t * wq = workq_create(min((size_t)threads, check.nr));
+		if (wq == NULL)
+			rc = -1;
+
+		for (size_t i = 0; rc == 0 && i < check.nr; i++)
+			rc = workq_add(wq, __check_image, check.job + i);
+
+		if (wq != NULL && workq_delete(wq) < 0)
+			rc = -1;
+	}
+
+	size_t failed = 0;
+
+	for (size_t i = 0; rc == 0 && i < check.nr; i++) {
+		check_job_t * job = check.job + i;
+
+		if (job->failed) {
+			fputs(job->report, stdout);
+			failed++;
+		} else if (args->verbose == f_VERBOSE) {
+			printf("%s: ok\n", job->path);
+		}
+	}
+
+	if (rc == 0 && args->catalog != NULL)
+		rc = __catalog_write(&check, args->catalog);
+
+	for (size_t i = 0; i < check.nr; i++) {
+		free(check.job[i].path);
+		free(check.job[i].json);
+		free(check.job[i].report);
+	}
+	free(check.job);
+
+	if (rc < 0)
+		return -1;
+
+	if (args->verbose == f_VERBOSE)
+		printf("%zu image(s) checked, %zu failed\n", check.nr, failed);
+
+	if (0 < failed) {
+		UNEXPECTED("%zu of %zu image(s) failed the check", failed,
+			   check.nr);
+		return -1;
+	}
+
+	return 0;
+}
@@ -141,7 +141,7 @@ int command_compare(args_t * args)
 			return -1;
 		}
 
-		size_t data_size = src->actual;
+		size_t data_size = __ffs_entry_actual(__in, src);
 		off_t data_offset = 0;
 
 		while (0 < data_size) {
@@ -94,10 +94,12 @@ int command_copy(args_t * args)
 			return 0;
 		}
 
-		__ffs_entry_truncate(__out, full_name, src->actual);
+		size_t actual = __ffs_entry_actual(__in, src);
+
+		__ffs_entry_truncate(__out, full_name, actual);
 		if (args->verbose == f_VERBOSE)
-      			printf("%llx: %s: truncate size '%x'\n",
-				__poffset, full_name, src->actual);
+      			printf("%llx: %s: truncate size '%zx'\n",
+				__poffset, full_name, actual);
 
 		uint32_t src_val, dst_val;
 		for (uint32_t i=0; i<FFS_USER_WORDS; i++) {
@@ -160,7 +162,7 @@ int command_copy(args_t * args)
 			return -1;
 		}
 
-		size_t data_size = src->actual;
+		size_t data_size = actual;
 		off_t data_offset = 0;
 
 		while (0 < data_size) {
@@ -60,33 +60,42 @@ int command_create(args_t * args)
 	assert(args != NULL);
 
 	uint32_t block = 0;
-	uint32_t size = 0;
+	off_t size = 0;
 	uint32_t pad = 0xff;
 
 	if (parse_size(args->block, &block) < 0)
 		return -1;
-	if (parse_size(args->size, &size) < 0)
+	if (parse_offset(args->size, &size) < 0)
 		return -1;
 	if (args->pad != NULL)
 		if (parse_size(args->pad, &pad) < 0)
 			return -1;
 
+	if (block != 0 && UINT32_MAX < size / block) {
+		UNEXPECTED("--size '%llx' exceeds the block count of block "
+			   "size '%x'", (long long)size, block);
+		return -1;
+	}
+
 	struct stat st;
 	if (stat(args->target, &st) < 0) {
 		if (errno == ENOENT) {
-			create_regular_file(args->target, size, (uint8_t)pad);
+			create_regular_file(args->target, size, (uint8_t)pad,
+					    args->sparse == f_SPARSE);
 		} else {
 			ERRNO(errno);
 			return -1;
 		}
 	} else {
 		if (st.st_size != size) {
-			create_regular_file(args->target, size, (uint8_t)pad);
+			create_regular_file(args->target, size, (uint8_t)pad,
+					    args->sparse == f_SPARSE);
 		} else {
 			if (args->force != f_FORCE && st.st_size != size) {
-				UNEXPECTED("--size '%d' differs from actual "
+				UNEXPECTED("--size '%lld' differs from actual "
 					   "size '%lld', use --force to "
-					   "override", size, (long long)st.st_size);
+					   "override", (long long)size,
+					   (long long)st.st_size);
 				return -1;
 			}
 		}
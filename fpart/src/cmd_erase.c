@@ -144,18 +144,27 @@ int command_erase(args_t * args)
 			}
 		}
 
-		RAII(void*, block, malloc(block_size), free);
-		if (block == NULL) {
-			ERRNO(errno);
-			return -1;
-		}
-		memset(block, pad, block_size);
+		size_t entry_size = entry->size * __ffs->hdr->block_size;
+		bool dirty = false;
+
+		for (size_t off = 0; off < entry_size; off += block_size) {
+			/* blocks that already hold the pad are left alone */
+			int blank = __ffs_entry_is_filled(__ffs, full_name,
+							  pad, off, block_size,
+							  NULL);
+			if (blank < 0)
+				return -1;
+			if (blank == 1)
+				continue;
 
-		for (uint32_t i = 0; i < entry->size; i++)
-			if(__ffs_entry_write(__ffs, full_name, block,					     		     i * block_size, block_size) < 0)
+			if (__ffs_entry_fill(__ffs, full_name, pad, off,
+					     block_size) < 0)
 				return -1;
+			dirty = true;
+		}
 
-		__ffs_fsync(__ffs);
+		if (dirty)
+			__ffs_fsync(__ffs);
 
 		if (__ffs_entry_truncate(__ffs, full_name, 0) < 0)
 			return -1;
@@ -183,6 +192,9 @@ int command_erase(args_t * args)
 
 		__ffs = ffs;
 
+		if (__ffs_set_sparse(ffs, args->sparse == f_SPARSE) < 0)
+			return -1;
+
 		int rc = __ffs_iterate_entries(ffs, erase_entry);
 		if (rc == 1)
 			rc = -1;
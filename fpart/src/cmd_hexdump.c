@@ -111,8 +111,9 @@ int command_hexdump(args_t * args)
 			return -1;
 
 		if (args->verbose == f_VERBOSE)
-			printf("%llx: %s: partition actual '%x'\n",
-			       __poffset, full_name, entry->actual);
+			printf("%llx: %s: partition actual '%llx'\n",
+			       __poffset, full_name,
+			       (long long)__ffs_entry_actual(__ffs, entry));
 
 		return 0;
 	}
@@ -74,8 +74,8 @@ int command_list(args_t * args)
 	int __list_entry(ffs_entry_t * entry)
 	{
 
-		uint32_t offset = entry->base * __ffs->hdr->block_size;
-		uint32_t size = entry->size * __ffs->hdr->block_size;
+		off_t offset = (off_t)entry->base * __ffs->hdr->block_size;
+		off_t size = (off_t)entry->size * __ffs->hdr->block_size;
 
                 if (__ffs_entry_name(__ffs, entry, full_name,
 				     sizeof full_name) < 0)
@@ -92,9 +92,10 @@ int command_list(args_t * args)
 		} else if (entry->type == FFS_TYPE_PARTITION) {
 			type ='p';
 		}
-		fprintf(stdout, "%3d [%08x-%08x] [%8x:%8x] ",
-			entry->id, offset, offset+size-1,
-			size, entry->actual);
+		fprintf(stdout, "%3d [%08llx-%08llx] [%8llx:%8llx] ",
+			entry->id, (long long)offset,
+			(long long)(offset + size - 1), (long long)size,
+			(long long)__ffs_entry_actual(__ffs, entry));
 
 		fprintf(stdout, "[%c%c%c%c%c%c] %s\n",
 			type, '-', '-', '-',
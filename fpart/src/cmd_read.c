@@ -130,7 +130,8 @@ int command_read(args_t * args)
 			return -1;
 		}
 
-		size_t data_size = entry.actual;
+		size_t actual = __ffs_entry_actual(ffs, &entry);
+		size_t data_size = actual;
 		off_t data_offset = 0;
 
 		while (0 < data_size) {
@@ -150,8 +151,8 @@ int command_read(args_t * args)
 		}
 
 		if (args->verbose == f_VERBOSE)
-			printf("%llx: %s: wrote '%x' bytes to file '%s'\n",
-			       poffset, args->name, entry.actual, args->path);
+			printf("%llx: %s: wrote '%zx' bytes to file '%s'\n",
+			       poffset, args->name, actual, args->path);
 
 		return 0;
 	}
@@ -0,0 +1,112 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fpart/src/cmd_scan.c $                                        */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_scan.c
+ *  Author:
+ *   Descr: --scan implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <clib/attribute.h>
+#include <clib/misc.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#include "main.h"
+
+int command_scan(args_t * args)
+{
+	assert(args != NULL);
+
+	uint32_t align = FFS_SCAN_ALIGN;
+	if (args->block != NULL)
+		if (parse_size(args->block, &align) < 0)
+			return -1;
+
+	RAII(FILE*, file, fopen_generic(args->target, "r", args->debug),
+	     fclose);
+	if (file == NULL)
+		return -1;
+
+	/* offsets of the tables found, for --partition-offset, 'list' is
+	 * closed (and 'poffset' final) before 'poffset' is freed */
+	size_t poffset_sz = 0;
+	RAII(char*, poffset, NULL, free);
+	RAII(FILE*, list, open_memstream(&poffset, &poffset_sz), fclose);
+	if (list == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	/* ========================= */
+
+	int __scan(off_t offset, const ffs_hdr_t * hdr, void * ctx __unused__)
+	{
+		printf("0x%llx: vers:%04x size:%04x * blk:%06x blk(s):%06x "
+		       "* entsz:%06x ent(s):%06x\n", (long long)offset,
+		       hdr->version, hdr->size, hdr->block_size,
+		       hdr->block_count, hdr->entry_size, hdr->entry_count);
+
+		fprintf(list, "%s0x%llx", ftello(list) ? "," : "",
+			(long long)offset);
+
+		return 0;
+	}
+
+	/* ========================= */
+
+	int nr = __ffs_fscan(file, align, __scan, NULL);
+	if (nr < 0)
+		return -1;
+
+	if (nr == 0) {
+		UNEXPECTED("no partition table found in '%s'", args->target);
+		return -1;
+	}
+
+	if (fflush(list) == EOF) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	if (args->verbose == f_VERBOSE)
+		printf("%d partition table(s), --partition-offset %s\n", nr,
+		       poffset);
+
+	return 0;
+}
@@ -87,17 +87,17 @@ int command_trunc(args_t * args)
 			return 0;
 		}
 
-		uint32_t size = entry->size * __ffs->hdr->block_size;
+		off_t size = (off_t)entry->size * __ffs->hdr->block_size;
 		if (args->size != NULL)
-			if (parse_size(args->size, &size) < 0)
+			if (parse_offset(args->size, &size) < 0)
 				return -1;
 
 		if (__ffs_entry_truncate(__ffs, full_name, size) < 0)
 			return -1;
 
 		if (args->verbose == f_VERBOSE)
-			printf("%llx: %s: truncate size '%x'\n", (long long)__poffset,
-			       full_name, size);
+			printf("%llx: %s: truncate size '%llx'\n", (long long)__poffset,
+			       full_name, (long long)size);
 
 		return 0;
 	}
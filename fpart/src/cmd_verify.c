@@ -0,0 +1,568 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: fpart/src/cmd_verify.c $                                      */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: cmd_verify.c
+ *  Author:
+ *   Descr: --verify implementation
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <clib/attribute.h>
+#include <clib/checksum.h>
+#include <clib/ecc.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/max.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#include "main.h"
+
+#define VERIFY_CHUNK		(4UL << 20)
+#define ECC_WORD		9
+
+/*
+ * The tables are read and checked first, then the data of every partition
+ * that carries a CRC or ECC is read once, in offset order, and each chunk
+ * is handed to every stage it overlaps.  A partition listed by several
+ * tables is a single stage.
+ */
+typedef struct stage stage_t;
+struct stage {
+	off_t table;
+	char * name;
+
+	off_t start, end;
+	bool crc, ecc;
+
+	uint32_t expected, sum;
+
+	uint8_t word[ECC_WORD];
+	size_t word_nr;
+	size_t count[3];	/* per ecc_status_t */
+};
+
+typedef struct verify verify_t;
+struct verify {
+	args_t * args;
+
+	FILE * file;
+	off_t size;
+
+	off_t * offset;
+	ffs_hdr_t ** table;
+	size_t table_nr;
+
+	stage_t * stage;
+	size_t nr, sz;
+
+	size_t errors;
+};
+
+static void verify_delete(verify_t * self)
+{
+	for (size_t i = 0; i < self->table_nr; i++)
+		free(self->table[i]);
+	for (size_t i = 0; i < self->nr; i++)
+		free(self->stage[i].name);
+	free(self->stage);
+}
+
+static void __error(verify_t * self, off_t offset, const char * name,
+		    const char * fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+
+	printf("%8llx: %s: ", (long long)offset, name);
+	vprintf(fmt, ap);
+	printf(" <== [ERROR]\n");
+
+	va_end(ap);
+
+	self->errors++;
+}
+
+static bool is_table_part(ffs_hdr_t * hdr, ffs_entry_t * entry, off_t offset)
+{
+	return entry->type == FFS_TYPE_PARTITION &&
+		(off_t)entry->base * hdr->block_size == offset;
+}
+
+/* bounds and overlap of the entries of one table */
+static int __check_layout(verify_t * self, off_t offset, ffs_hdr_t * hdr)
+{
+	ffs_t ffs = {
+		.hdr = hdr,
+		.offset = offset,
+		.count = hdr->entry_count,
+	};
+
+	uint32_t block_size = hdr->block_size;
+	char name[PATH_MAX], other[PATH_MAX];
+
+	for (uint32_t i = 0; i < hdr->entry_count; i++) {
+		ffs_entry_t * entry = hdr->entries + i;
+
+		if (entry->type == FFS_TYPE_LOGICAL)
+			continue;
+
+		if (__ffs_entry_name(&ffs, entry, name, sizeof name) < 0)
+			return -1;
+
+		off_t base = (off_t)entry->base * block_size;
+		off_t size = (off_t)entry->size * block_size;
+
+		if (hdr->block_count < (uint64_t)entry->base + entry->size)
+			__error(self, offset, name, "blocks %x..%x beyond "
+				"table block count '%x'", entry->base,
+				entry->base + entry->size - 1,
+				hdr->block_count);
+		else if (self->size < base + size)
+			__error(self, offset, name, "ends at '%llx', beyond "
+				"image size '%llx'", (long long)(base + size),
+				(long long)self->size);
+
+		uint64_t actual = __ffs_entry_actual(&ffs, entry);
+		if ((uint64_t)size < actual)
+			__error(self, offset, name, "actual '%llx' exceeds "
+				"size '%llx'", (long long)actual,
+				(long long)size);
+
+		for (uint32_t j = i + 1; j < hdr->entry_count; j++) {
+			ffs_entry_t * next = hdr->entries + j;
+
+			if (next->type == FFS_TYPE_LOGICAL)
+				continue;
+			if (next->base + next->size <= entry->base ||
+			    entry->base + entry->size <= next->base)
+				continue;
+
+			if (__ffs_entry_name(&ffs, next, other,
+					     sizeof other) < 0)
+				return -1;
+
+			__error(self, offset, name, "overlaps '%s'", other);
+		}
+	}
+
+	return 0;
+}
+
+/* every table should list what the first sound one does */
+static int __check_backup(verify_t * self, size_t ref, size_t idx)
+{
+	ffs_hdr_t * a = self->table[ref], * b = self->table[idx];
+	off_t a_off = self->offset[ref], b_off = self->offset[idx];
+
+	if (a->block_size != b->block_size ||
+	    a->block_count != b->block_count ||
+	    a->entry_count != b->entry_count) {
+		__error(self, b_off, "table", "geometry differs from table "
+			"at '%llx'", (long long)a_off);
+		return 0;
+	}
+
+	ffs_t ffs = {
+		.hdr = b,
+		.offset = b_off,
+		.count = b->entry_count,
+	};
+
+	char name[PATH_MAX];
+
+	for (uint32_t i = 0; i < b->entry_count; i++) {
+		ffs_entry_t * x = a->entries + i, * y = b->entries + i;
+
+		/* each table's own partition differs by design */
+		if (is_table_part(a, x, a_off) && is_table_part(b, y, b_off))
+			continue;
+
+		if (memcmp(x, y, offsetof(ffs_entry_t, checksum)) == 0)
+			continue;
+
+		if (__ffs_entry_name(&ffs, y, name, sizeof name) < 0)
+			return -1;
+
+		__error(self, b_off, name, "differs from table at '%llx'",
+			(long long)a_off);
+	}
+
+	return 0;
+}
+
+static int __stage_add(verify_t * self, off_t offset, ffs_hdr_t * hdr,
+		       ffs_entry_t * entry)
+{
+	uint32_t vol = entry->user.data[USER_DATA_VOL];
+
+	bool crc = vol & FFS_ENTRY_INTEG_CRC;
+	bool ecc = vol & FFS_ENTRY_INTEG_ECC;
+	if (entry->type != FFS_TYPE_DATA || (crc || ecc) == false)
+		return 0;
+
+	ffs_t ffs = {
+		.hdr = hdr,
+		.offset = offset,
+		.count = hdr->entry_count,
+	};
+
+	off_t start = (off_t)entry->base * hdr->block_size;
+	off_t size = (off_t)entry->size * hdr->block_size;
+	off_t end = start + min(size, (off_t)__ffs_entry_actual(&ffs, entry));
+
+	/* out of bounds, already reported */
+	if (hdr->block_count < (uint64_t)entry->base + entry->size ||
+	    self->size < start + size)
+		return 0;
+
+	uint32_t expected = entry->user.data[USER_DATA_CRC];
+
+	for (size_t i = 0; i < self->nr; i++) {
+		stage_t * s = self->stage + i;
+		if (s->start == start && s->end == end && s->crc == crc &&
+		    s->ecc == ecc && (!crc || s->expected == expected))
+			return 0;
+	}
+
+	if (self->nr == self->sz) {
+		size_t sz = self->sz ? self->sz * 2 : 64;
+		stage_t * tmp = realloc(self->stage, sz * sizeof(*tmp));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			return -1;
+		}
+		self->stage = tmp, self->sz = sz;
+	}
+
+	char name[PATH_MAX];
+	if (__ffs_entry_name(&ffs, entry, name, sizeof name) < 0)
+		return -1;
+
+	stage_t * s = self->stage + self->nr;
+	memset(s, 0, sizeof(*s));
+
+	s->name = strdup(name);
+	if (s->name == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	s->table = offset;
+	s->start = start, s->end = end;
+	s->crc = crc, s->ecc = ecc;
+	s->expected = expected;
+
+	self->nr++;
+
+	return 0;
+}
+
+static void stage_feed(stage_t * self, const uint8_t * buf, size_t count)
+{
+	if (self->crc)
+		self->sum = crc32c(self->sum, buf, count);
+
+	if (self->ecc == false)
+		return;
+
+	/* complete a word split across two chunks */
+	if (0 < self->word_nr) {
+		size_t n = min(count, ECC_WORD - self->word_nr);
+		memcpy(self->word + self->word_nr, buf, n);
+		self->word_nr += n;
+		buf += n, count -= n;
+
+		if (self->word_nr < ECC_WORD)
+			return;
+
+		p8_ecc_check(self->word, ECC_WORD, self->count);
+		self->word_nr = 0;
+	}
+
+	size_t whole = count - count % ECC_WORD;
+	p8_ecc_check(buf, whole, self->count);
+
+	self->word_nr = count - whole;
+	memcpy(self->word, buf + whole, self->word_nr);
+}
+
+static ssize_t __read(verify_t * self, void * buf, size_t count,
+		      off_t offset)
+{
+	int fd = fileno(self->file);
+	bool sparse = self->args->sparse == f_SPARSE;
+	size_t done = 0;
+
+	if (fd < 0) {
+		/* streams w/o a descriptor (e.g. a compressed image) */
+		if (fseeko(self->file, offset, SEEK_SET) != 0) {
+			ERRNO(errno);
+			return -1;
+		}
+		done = fread(buf, 1, count, self->file);
+		if (done < count && ferror(self->file)) {
+			ERRNO(errno);
+			return -1;
+		}
+		return done;
+	}
+
+	while (done < count) {
+		off_t pos = offset + done;
+		size_t n = count - done;
+
+		/* holes of sparse images read as erased */
+		if (sparse) {
+			off_t data = lseek(fd, pos, SEEK_DATA);
+			if (data < 0 && errno == ENXIO)
+				data = pos + n;
+			if (pos < data) {
+				n = min(n, (size_t)(data - pos));
+				memset((uint8_t *)buf + done,
+				       FFS_SPARSE_FILL, n);
+				done += n;
+				continue;
+			}
+		}
+
+		ssize_t rc = pread(fd, (uint8_t *)buf + done, n, pos);
+		if (rc < 0) {
+			ERRNO(errno);
+			return -1;
+		}
+		if (rc == 0)
+			break;
+		done += rc;
+	}
+
+	return done;
+}
+
+static int stage_cmp(const void * __a, const void * __b)
+{
+	const stage_t * a = __a, * b = __b;
+	return (a->start > b->start) - (a->start < b->start);
+}
+
+/* the one sequential pass over the data of every stage */
+static int __stream(verify_t * self, off_t * done)
+{
+	qsort(self->stage, self->nr, sizeof(*self->stage), stage_cmp);
+
+	int fd = fileno(self->file);
+	if (0 <= fd)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	RAII(uint8_t*, buf, malloc(VERIFY_CHUNK), free);
+	if (buf == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	size_t first = 0;
+
+	while (first < self->nr) {
+		/* a run of overlapping or adjacent stages */
+		off_t start = self->stage[first].start;
+		off_t end = self->stage[first].end;
+
+		size_t last = first + 1;
+		while (last < self->nr && self->stage[last].start <= end)
+			end = max(end, self->stage[last++].end);
+
+		for (off_t pos = start; pos < end; ) {
+			size_t count = min((off_t)VERIFY_CHUNK, end - pos);
+
+			ssize_t rc = __read(self, buf, count, pos);
+			if (rc < 0)
+				return -1;
+			if ((size_t)rc < count) {
+				UNEXPECTED("'%s' short read at '%llx'",
+					   self->args->target,
+					   (long long)(pos + rc));
+				return -1;
+			}
+
+			off_t chunk_end = pos + count;
+
+			for (size_t i = first; i < last; i++) {
+				stage_t * s = self->stage + i;
+
+				off_t lo = max(s->start, pos);
+				off_t hi = min(s->end, chunk_end);
+				if (lo < hi)
+					stage_feed(s, buf + (lo - pos),
+						   hi - lo);
+			}
+
+			*done += count;
+			pos = chunk_end;
+		}
+
+		first = last;
+	}
+
+	return 0;
+}
+
+static void __report(verify_t * self, stage_t * s)
+{
+	args_t * args = self->args;
+
+	if (s->crc && s->sum != s->expected)
+		__error(self, s->table, s->name, "crc %08x, expected %08x",
+			s->sum, s->expected);
+	else if (s->crc && args->verbose == f_VERBOSE)
+		printf("%8llx: %s: crc %08x (ok)\n", (long long)s->table,
+		       s->name, s->sum);
+
+	if (s->ecc == false)
+		return;
+
+	if (0 < s->count[UNCORRECTABLE])
+		__error(self, s->table, s->name, "%zu uncorrectable ECC "
+			"word(s)", s->count[UNCORRECTABLE]);
+
+	if (0 < s->count[CORRECTED])
+		printf("%8llx: %s: %zu correctable ECC word(s) <== "
+		       "[WARNING]\n", (long long)s->table, s->name,
+		       s->count[CORRECTED]);
+	else if (args->verbose == f_VERBOSE)
+		printf("%8llx: %s: %zu ECC word(s) (ok)\n",
+		       (long long)s->table, s->name, s->count[CLEAN]);
+}
+
+int command_verify(args_t * args)
+{
+	assert(args != NULL);
+
+	RAII(FILE*, file, fopen_generic(args->target, "r", args->debug),
+	     fclose);
+	if (file == NULL)
+		return -1;
+
+	if (fseeko(file, 0, SEEK_END) != 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	size_t max_nr = strlen(args->poffset) / 2 + 1;
+	off_t offset[max_nr];
+	ffs_hdr_t * table[max_nr];
+
+	verify_t __verify = {
+		.args = args,
+		.file = file,
+		.size = ftello(file),
+		.offset = offset,
+		.table = table,
+	};
+	RAII(verify_t*, verify, &__verify, verify_delete);
+
+	/* ========================= */
+
+	int __table(args_t * args, off_t poffset)
+	{
+		ffs_hdr_t * hdr = NULL;
+
+		int rc = __ffs_fcheck_table(file, poffset, &hdr);
+		if (rc == -1)
+			return -1;
+
+		verify->offset[verify->table_nr] = poffset;
+		verify->table[verify->table_nr++] = hdr;
+
+		if (rc != 0) {
+			__error(verify, poffset, "table", "%s",
+				check_status(rc));
+			return 0;
+		}
+
+		if (args->verbose == f_VERBOSE)
+			printf("%8llx: table: %u entries (ok)\n",
+			       (long long)poffset, hdr->entry_count);
+
+		return __check_layout(verify, poffset, hdr);
+	}
+
+	/* ========================= */
+
+	if (command(args, __table) < 0)
+		return -1;
+
+	size_t ref = verify->table_nr;
+
+	for (size_t i = 0; i < verify->table_nr; i++) {
+		ffs_hdr_t * hdr = verify->table[i];
+		if (hdr == NULL)
+			continue;
+
+		if (ref == verify->table_nr)
+			ref = i;
+		else if (__check_backup(verify, ref, i) < 0)
+			return -1;
+
+		for (uint32_t j = 0; j < hdr->entry_count; j++)
+			if (__stage_add(verify, verify->offset[i], hdr,
+					hdr->entries + j) < 0)
+				return -1;
+	}
+
+	off_t done = 0;
+	if (__stream(verify, &done) < 0)
+		return -1;
+
+	for (size_t i = 0; i < verify->nr; i++)
+		__report(verify, verify->stage + i);
+
+	if (args->verbose == f_VERBOSE)
+		printf("%zu table(s), %zu partition(s), %llx bytes read\n",
+		       verify->table_nr, verify->nr, (long long)done);
+
+	if (0 < verify->errors) {
+		UNEXPECTED("%zu problem(s) found in '%s'", verify->errors,
+			   args->target);
+		return -1;
+	}
+
+	return 0;
+}
@@ -100,7 +100,7 @@ int command_write(args_t * args)
 			return 0;
 		}
 
-		if (entry->actual < st.st_size) {
+		if (__ffs_entry_actual(__ffs, entry) < (uint64_t)st.st_size) {
 			if (__ffs_entry_truncate(__ffs, full_name,
 						 st.st_size) < 0) {
 				ERRNO(errno);
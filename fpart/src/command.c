@@ -110,7 +110,7 @@ int parse_size(const char *str, uint32_t *size)
 	char *end = NULL;
 
 	errno = 0;
-	*size = strtoul(str, &end, 0);
+	unsigned long long __size = strtoull(str, &end, 0);
 	if (errno != 0) {
 		ERRNO(errno);
 		return -1;
@@ -119,19 +119,26 @@ int parse_size(const char *str, uint32_t *size)
 	if (*end != '\0') {
 		if (!strcmp(end, "KiB") || !strcasecmp(end, "K") ||
 		    !strcasecmp(end, "KB"))
-			*size <<= 10;
+			__size <<= 10;
 		else if (!strcmp(end, "MiB") || !strcasecmp(end, "M") ||
 			 !strcasecmp(end, "MB"))
-			*size <<= 20;
+			__size <<= 20;
 		else if (!strcmp(end, "GiB") || !strcasecmp(end, "G") ||
 			 !strcasecmp(end, "GB"))
-			*size <<= 30;
+			__size <<= 30;
 		else {
 			UNEXPECTED("invalid size specified '%s'", end);
 			return -1;
 		}
 	}
 
+	if (UINT32_MAX < __size) {
+		UNEXPECTED("size '%s' exceeds 32 bits", str);
+		return -1;
+	}
+
+	*size = __size;
+
 	return 0;
 }
 
@@ -168,7 +175,27 @@ bool check_extension(const char *path, const char *ext)
 	    && (strncasecmp(path + len - ext_len, ext, ext_len) == 0);
 }
 
-int create_regular_file(const char *path, size_t size, char pad)
+const char *check_status(int rc)
+{
+	switch (rc) {
+	case 0:
+		return "ok";
+	case FFS_CHECK_HEADER_MAGIC:
+		return "header magic mismatch";
+	case FFS_CHECK_HEADER_CHECKSUM:
+		return "header checksum mismatch";
+	case FFS_CHECK_ENTRY_CHECKSUM:
+		return "entry checksum mismatch";
+	case FFS_CHECK_TRUNCATED:
+		return "truncated";
+	case FFS_CHECK_GEOMETRY:
+		return "invalid geometry";
+	default:
+		return "unknown";
+	}
+}
+
+int create_regular_file(const char *path, size_t size, char pad, bool sparse)
 {
 	assert(path != NULL);
 
@@ -184,6 +211,10 @@ int create_regular_file(const char *path, size_t size, char pad)
 		return -1;
 	}
 
+	/* a sparse image is all holes, which read back as erased */
+	if (sparse && (uint8_t)pad == FFS_SPARSE_FILL)
+		size = 0;
+
 	uint32_t page_size = sysconf(_SC_PAGESIZE);
 	char buf[page_size];
 	memset(buf, pad, page_size);
@@ -255,8 +286,25 @@ FILE *fopen_generic(const char *path, const char *mode, int debug)
 		file = fopen(path, mode);
 	}
 
-	if (file == NULL)
+	if (file == NULL) {
 		ERRNO(errno);
+		return NULL;
+	}
+
+	/* compressed containers read as the image they hold */
+	if (*mode != 'w' && __ffs_zimage_fcheck(file) == 1) {
+		if (strchr(mode, '+') != NULL) {
+			UNEXPECTED("'%s' is a compressed image, which is "
+				   "read-only", path);
+			fclose(file);
+			return NULL;
+		}
+
+		FILE *image = __ffs_zimage_fopen(file);
+		if (image == NULL)
+			fclose(file);
+		file = image;
+	}
 
 	return file;
 }
@@ -80,6 +80,11 @@ static void usage(bool verbose)
 	fprintf(e, "  fpart --user 0 -t nor -n boot0/ipl --value 0xFF500FF5\n");
 	fprintf(e, "  fpart --copy new_nor -t nor -n ipl\n");
 	fprintf(e, "  fpart --compare new_nor -t nor -n bank0\n");
+	fprintf(e, "  fpart --batch layout.txt -t nor -p 0x3f0000,0x7f0000\n");
+	fprintf(e, "  fpart --build layout.conf -t nor\n");
+	fprintf(e, "  fpart --scan -t dump.bin\n");
+	fprintf(e, "  fpart --check-dir images --jobs 8 --catalog images.json\n");
+	fprintf(e, "  fpart --verify -t nor -p 0x3f0000,0x7f0000\n");
 
 	fprintf(e, "\nCommands:\n");
 	fprintf(e, "  -C, --create         [options]\n");
@@ -117,7 +122,49 @@ static void usage(bool verbose)
 	fprintf(e, "  -U, --user    <num>  [options]\n");
 	if (verbose)
 		fprintf(e, "\n  Read or write user words of matching partition"
-			" entry(s) for each\n  specified partition offset.\n");
+			" entry(s) for each\n  specified partition offset.\n\n");
+
+	fprintf(e, "  -B, --batch   <file> [options]\n");
+	if (verbose)
+		fprintf(e, "\n  Apply the --add, --delete, --trunc and --user"
+			" commands listed in <file>\n  (or stdin if '-'), one"
+			" per line, to each specified partition offset.\n"
+			"  Each table is written once, and only if every"
+			" command succeeds.\n\n");
+
+	fprintf(e, "  -I, --build   <file> [options]\n");
+	if (verbose)
+		fprintf(e, "\n  Compose the complete image <target> from the"
+			" layout manifest <file>:\n  image size, block size,"
+			" table offsets, entries and their payload\n  files,"
+			" with optional P8 ECC.  The image is written once,"
+			" replacing\n  <target>.\n\n");
+
+	fprintf(e, "  -S, --scan           [options]\n");
+	if (verbose)
+		fprintf(e, "\n  Search <target> for partition tables at"
+			" unknown offsets, probing every\n  --block-size"
+			" bytes (default 4KiB).  Report each table whose"
+			" header and\n  entry checksums are valid, and its"
+			" geometry.\n\n");
+
+	fprintf(e, "  -K, --check-dir <dir> [options]\n");
+	if (verbose)
+		fprintf(e, "\n  Check every image file under <dir> in"
+			" parallel: the header and entry\n  checksums of each"
+			" specified partition offset and, with --crc, the\n"
+			"  CRC32C of each data partition.  Report the images"
+			" that fail, and\n  optionally write a --catalog of"
+			" all of them.\n\n");
+
+	fprintf(e, "  -V, --verify         [options]\n");
+	if (verbose)
+		fprintf(e, "\n  Verify <target> in one sequential read: the"
+			" header and entry checksums\n  of each specified"
+			" partition offset, that the tables agree, the bounds"
+			"\n  and overlap of the entries, the ECC of 'ecc'"
+			" partitions and the\n  CRC32C recorded in the user"
+			" words of data partitions.\n\n");
 
 	/* =============================== */
 
@@ -176,6 +223,17 @@ static void usage(bool verbose)
 		fprintf(e, "\n  Specifies the partition flags value."
 			"  <value> is a decimal (or hex)\n  number.\n\n");
 
+	fprintf(e, "  -j, --jobs             <value>\n");
+	if (verbose)
+		fprintf(e, "\n  Check up to <value> images in parallel,"
+			" default is one per online CPU.\n\n");
+
+	fprintf(e, "  -c, --catalog          <path>\n");
+	if (verbose)
+		fprintf(e, "\n  Write the JSON catalog of --check-dir (image,"
+			" table offsets, partition\n  names, sizes and"
+			" CRC32C) to <path>, or stdout if '-'.\n\n");
+
 	fprintf(e, "  -a, --pad              <value>\n");
 	if (verbose)
 		fprintf(e,
@@ -195,6 +253,17 @@ static void usage(bool verbose)
 		fprintf(e, "\n  Specifies the partition entry is a logical"
 			" partition instead of a\n  data partition.\n\n");
 
+	fprintf(e, "  -z, --sparse\n");
+	if (verbose)
+		fprintf(e, "\n  Create (or erase) the target as a sparse file,"
+			" erased (0xFF) regions\n  are left as holes.\n\n");
+
+	fprintf(e, "  -k, --crc\n");
+	if (verbose)
+		fprintf(e, "\n  Hash each data partition for --check-dir and"
+			" compare it with the CRC32C\n  recorded in its user"
+			" words, if any.\n\n");
+
 	fprintf(e, "  -v, --verbose\n");
 	if (verbose)
 		fprintf(e, "\n  Write progress messages to stdout\n\n");
@@ -225,6 +294,11 @@ static int process_argument(args_t * args, int opt, const char *optarg)
 	case c_TRUNC:		/* trunc */
 	case c_ERASE:		/* erase */
 	case c_USER:		/* user */
+	case c_BATCH:		/* batch */
+	case c_BUILD:		/* build */
+	case c_SCAN:		/* scan */
+	case c_CHECK:		/* check-dir */
+	case c_VERIFY:		/* verify */
 		if (args->cmd != c_ERROR) {
 			UNEXPECTED("commands '%c' and '%c' are mutually "
 				   "exclusive", args->cmd, opt);
@@ -234,6 +308,12 @@ static int process_argument(args_t * args, int opt, const char *optarg)
 		args->cmd = (cmd_t) opt;
 		if (args->cmd == c_USER)
 			args->user = strdup(optarg);
+		if (args->cmd == c_BATCH)
+			args->batch = strdup(optarg);
+		if (args->cmd == c_BUILD)
+			args->build = strdup(optarg);
+		if (args->cmd == c_CHECK)
+			args->check = strdup(optarg);
 		break;
 	case o_POFFSET:		/* partition-offset */
 		free(args->poffset);
@@ -265,12 +345,26 @@ static int process_argument(args_t * args, int opt, const char *optarg)
 	case o_PAD:		/* pad */
 		args->pad = strdup(optarg);
 		break;
+	case o_JOBS:		/* jobs */
+		free(args->jobs);
+		args->jobs = strdup(optarg);
+		break;
+	case o_CATALOG:		/* catalog */
+		free(args->catalog);
+		args->catalog = strdup(optarg);
+		break;
 	case f_FORCE:		/* force */
 		args->force = (flag_t) opt;
 		break;
 	case f_LOGICAL:		/* logical */
 		args->logical = (flag_t) opt;
 		break;
+	case f_SPARSE:		/* sparse */
+		args->sparse = (flag_t) opt;
+		break;
+	case f_CRC:		/* crc */
+		args->crc = (flag_t) opt;
+		break;
 	case f_VERBOSE:		/* verbose */
 		args->verbose = (flag_t) opt;
 		break;
@@ -408,6 +502,40 @@ static int validate_args(args_t * args)
 		UNSUPPORTED(offset, erase);
 		UNSUPPORTED(flags, erase);
 		UNSUPPORTED(value, erase);
+	} else if (args->cmd == c_BATCH) {
+		UNSUPPORTED(size, batch);
+		UNSUPPORTED(offset, batch);
+		UNSUPPORTED(block, batch);
+		UNSUPPORTED(flags, batch);
+		UNSUPPORTED(value, batch);
+		UNSUPPORTED(pad, batch);
+	} else if (args->cmd == c_BUILD) {
+		UNSUPPORTED(size, build);
+		UNSUPPORTED(offset, build);
+		UNSUPPORTED(block, build);
+		UNSUPPORTED(flags, build);
+		UNSUPPORTED(value, build);
+		UNSUPPORTED(pad, build);
+	} else if (args->cmd == c_SCAN) {
+		UNSUPPORTED(size, scan);
+		UNSUPPORTED(offset, scan);
+		UNSUPPORTED(flags, scan);
+		UNSUPPORTED(value, scan);
+		UNSUPPORTED(pad, scan);
+	} else if (args->cmd == c_CHECK) {
+		UNSUPPORTED(size, check-dir);
+		UNSUPPORTED(offset, check-dir);
+		UNSUPPORTED(block, check-dir);
+		UNSUPPORTED(flags, check-dir);
+		UNSUPPORTED(value, check-dir);
+		UNSUPPORTED(pad, check-dir);
+	} else if (args->cmd == c_VERIFY) {
+		UNSUPPORTED(size, verify);
+		UNSUPPORTED(offset, verify);
+		UNSUPPORTED(block, verify);
+		UNSUPPORTED(flags, verify);
+		UNSUPPORTED(value, verify);
+		UNSUPPORTED(pad, verify);
 	} else if (args->cmd == c_USER) {
 		REQUIRED(name, user);
 
@@ -455,6 +583,21 @@ static int process_args(args_t * args)
 	case c_USER:
 		rc = command_user(args);
 		break;
+	case c_BATCH:
+		rc = command_batch(args);
+		break;
+	case c_BUILD:
+		rc = command_build(args);
+		break;
+	case c_SCAN:
+		rc = command_scan(args);
+		break;
+	case c_CHECK:
+		rc = command_check(args);
+		break;
+	case c_VERIFY:
+		rc = command_verify(args);
+		break;
 	default:
 		UNEXPECTED("NOT IMPLEMENTED YET => '%c'", args->cmd);
 		rc = -1;
@@ -476,6 +619,11 @@ static void free_args(args_t * args)
 	free(args->value);
 	free(args->flags);
 	free(args->pad);
+	free(args->batch);
+	free(args->build);
+	free(args->check);
+	free(args->jobs);
+	free(args->catalog);
 }
 
 static void args_dump(args_t * args)
@@ -506,6 +654,16 @@ static void args_dump(args_t * args)
 		printf("value[%s]\n", args->value);
 	if (args->pad != NULL)
 		printf("pad[%s]\n", args->pad);
+	if (args->batch != NULL)
+		printf("batch[%s]\n", args->batch);
+	if (args->build != NULL)
+		printf("build[%s]\n", args->build);
+	if (args->check != NULL)
+		printf("check[%s]\n", args->check);
+	if (args->jobs != NULL)
+		printf("jobs[%s]\n", args->jobs);
+	if (args->catalog != NULL)
+		printf("catalog[%s]\n", args->catalog);
 	for (int i = 0; i < args->opt_nr; i++) {
 		if (args->opt[i] != NULL)
 			printf("opt%d[%s]\n", i, args->opt[i]);
@@ -516,6 +674,10 @@ static void args_dump(args_t * args)
 		printf("protected[%c]\n", args->protected);
 	if (args->logical != 0)
 		printf("logical[%c]\n", args->logical);
+	if (args->sparse != 0)
+		printf("sparse[%c]\n", args->sparse);
+	if (args->crc != 0)
+		printf("crc[%c]\n", args->crc);
 	if (args->verbose != 0)
 		printf("verbose[%c]\n", args->verbose);
 	if (args->verbose != 0)
@@ -533,6 +695,11 @@ int main(int argc, char *argv[])
 		{"trunc", no_argument, NULL, c_TRUNC},
 		{"erase", no_argument, NULL, c_ERASE},
 		{"user", required_argument, NULL, c_USER},
+		{"batch", required_argument, NULL, c_BATCH},
+		{"build", required_argument, NULL, c_BUILD},
+		{"scan", no_argument, NULL, c_SCAN},
+		{"check-dir", required_argument, NULL, c_CHECK},
+		{"verify", no_argument, NULL, c_VERIFY},
 		/* options */
 		{"partition-offset", required_argument, NULL, o_POFFSET},
 		{"target", required_argument, NULL, o_TARGET},
@@ -543,10 +710,14 @@ int main(int argc, char *argv[])
 		{"value", required_argument, NULL, o_VALUE},
 		{"flags", required_argument, NULL, o_FLAGS},
 		{"pad", required_argument, NULL, o_PAD},
+		{"jobs", required_argument, NULL, o_JOBS},
+		{"catalog", required_argument, NULL, o_CATALOG},
 		/* flags */
 		{"force", no_argument, NULL, f_FORCE},
 		{"protected", no_argument, NULL, f_PROTECTED},
 		{"logical", no_argument, NULL, f_LOGICAL},
+		{"sparse", no_argument, NULL, f_SPARSE},
+		{"crc", no_argument, NULL, f_CRC},
 		{"verbose", no_argument, NULL, f_VERBOSE},
 		{"debug", no_argument, NULL, f_DEBUG},
 		{"help", no_argument, NULL, f_HELP},
@@ -554,7 +725,7 @@ int main(int argc, char *argv[])
 	};
 
 	static const char *short_opt;
-	short_opt = "CADLTEU:p:t:n:o:s:b:u:g:a:frlvdh";
+	short_opt = "CADLTESVU:B:I:K:p:t:n:o:s:b:u:g:a:j:c:frlzkvdh";
 
 	int rc = EXIT_FAILURE;
 
@@ -588,13 +759,12 @@ int main(int argc, char *argv[])
 	if (false) {
 		err_t *err;
 error:
-		err = err_get();
-		assert(err != NULL);
-
-		fprintf(stderr, "%s: %s : %s(%d) : (code=%d) %.*s\n",
-			program_invocation_short_name,
-			err_type_name(err), err_file(err), err_line(err),
-			err_code(err), err_size(err), (char *)err_data(err));
+		while ((err = err_get()) != NULL)
+			fprintf(stderr, "%s: %s : %s(%d) : (code=%d) %.*s\n",
+				program_invocation_short_name,
+				err_type_name(err), err_file(err),
+				err_line(err), err_code(err), err_size(err),
+				(char *)err_data(err));
 	}
 
 	free_args(&args);
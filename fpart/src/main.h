@@ -34,6 +34,7 @@
 #define __MAIN_H__
 
 #include <stdio.h>
+#include <stdbool.h>
 
 #include <ffs/libffs.h>
 
@@ -50,6 +51,11 @@ typedef enum {
 	c_LIST = 'L',
 	c_TRUNC = 'T',
 	c_USER = 'U',
+	c_BATCH = 'B',
+	c_BUILD = 'I',
+	c_SCAN = 'S',
+	c_CHECK = 'K',
+	c_VERIFY = 'V',
 } cmd_t;
 
 typedef enum {
@@ -63,6 +69,8 @@ typedef enum {
 	o_VALUE = 'u',
 	o_FLAGS = 'g',
 	o_PAD = 'a',
+	o_JOBS = 'j',
+	o_CATALOG = 'c',
 } option_t;
 
 typedef enum {
@@ -70,6 +78,8 @@ typedef enum {
 	f_FORCE = 'f',
 	f_PROTECTED = 'r',
 	f_LOGICAL = 'l',
+	f_SPARSE = 'z',
+	f_CRC = 'k',
 	f_VERBOSE = 'v',
 	f_DEBUG = 'd',
 	f_HELP = 'h',
@@ -90,11 +100,16 @@ typedef struct {
 	char *size, *block;
 	char *user, *value;
 	char *flags, *pad;
+	char *batch, *build;
+	char *check, *jobs;
+	char *catalog;
 
 	/* flags */
 	flag_t force, logical;
 	flag_t verbose, debug;
 	flag_t protected;
+	flag_t sparse;
+	flag_t crc;
 
 	const char **opt;
 	int opt_sz, opt_nr;
@@ -114,7 +129,8 @@ extern int parse_size(const char *, uint32_t *);
 extern int parse_number(const char *, uint32_t *);
 
 extern bool check_extension(const char *, const char *);
-extern int create_regular_file(const char *, size_t, char);
+extern const char *check_status(int);
+extern int create_regular_file(const char *, size_t, char, bool);
 extern FILE *fopen_generic(const char *, const char *, int);
 
 extern int command(args_t *, int (*)(args_t *, off_t));
@@ -128,5 +144,10 @@ extern int command_list(args_t *);
 extern int command_trunc(args_t *);
 extern int command_erase(args_t *);
 extern int command_user(args_t *);
+extern int command_batch(args_t *);
+extern int command_build(args_t *);
+extern int command_scan(args_t *);
+extern int command_check(args_t *);
+extern int command_verify(args_t *);
 
 #endif /* __MAIN_H__ */
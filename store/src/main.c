@@ -0,0 +1,419 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: store/src/main.c $                                            */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: main.c
+ *  Author:
+ *   Descr: cmdline tool for the FFS image store
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <libgen.h>
+
+#include <clib/attribute.h>
+#include <clib/misc.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+
+#include "main.h"
+#include "store.h"
+
+args_t args;
+
+static void usage(const char *short_name, bool verbose)
+{
+	const char *n = short_name;
+	FILE *e = stderr;
+
+	fprintf(e, "FFS Image Store v%d.%d.%d\n",
+		STORE_MAJOR, STORE_MINOR, STORE_PATCH);
+
+	fprintf(e, "\nUsage:\n");
+	fprintf(e, "    %s <command> [<arg>] <options>...\n", n);
+
+	fprintf(e, "\nExamples:\n");
+	fprintf(e, "    %s -s /archive --add build42.pnor -o 0x0\n", n);
+	fprintf(e, "    %s -s /archive --get build42.pnor > build42.pnor\n", n);
+	fprintf(e, "    %s -s /archive --delete build41.pnor\n", n);
+	fprintf(e, "    %s -s /archive --gc\n", n);
+
+	fprintf(e, "\nCommands:\n");
+	fprintf(e, "  -A, --add <path> [options]\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Add the image file <path> to the store.  Each "
+			"partition table, partition\n    and gap is cut into "
+			"erase block sized chunks, and only the chunks the\n"
+			"    store does not already hold are written.\n\n");
+
+	fprintf(e, "  -G, --get <name> [options]\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Rebuild image <name> and write it to stdout.\n\n");
+
+	fprintf(e, "  -D, --delete <name> [options]\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Remove image <name> from the store, run --gc to "
+			"reclaim its chunks.\n\n");
+
+	fprintf(e, "  -C, --gc [options]\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Delete the chunks that no image refers to.\n\n");
+
+	fprintf(e, "\nOptions:\n");
+	fprintf(e, "  -s, --store <path>\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Store directory, created if needed.  Defaults to "
+			"$%s.\n\n", STORE_ENV);
+
+	fprintf(e, "  -n, --name <name>\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Name of the image added by --add, default is the "
+			"file name.\n\n");
+
+	fprintf(e, "  -o, --offset <offset[,offset]>\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Comma (,) separated list of partition table "
+			"offsets for --add.\n\n");
+
+	fprintf(e, "  -h, --help\n");
+	if (verbose)
+		fprintf(e, "\n    Write this help text to stderr and exit\n");
+
+	fprintf(e, "\nFlags:\n");
+	fprintf(e, "  -z, --sparse\n");
+	if (verbose)
+		fprintf(e,
+			"\n    Read holes in the image as erased (0xFF) data "
+			"without reading them.\n\n");
+
+	fprintf(e, "  -v, --verbose\n");
+	if (verbose)
+		fprintf(e, "\n    Report chunk and byte counts.\n\n");
+
+	fprintf(e, "\n");
+}
+
+static int process_argument(args_t * args, int opt, const char *optarg)
+{
+	assert(args != NULL);
+
+	switch (opt) {
+	case c_ADD:		/* add */
+	case c_GET:		/* get */
+	case c_DELETE:		/* delete */
+	case c_GC:		/* gc */
+		if (args->cmd != c_ERROR) {
+			UNEXPECTED("commands '%c' and '%c' are mutually "
+				   "exclusive", args->cmd, opt);
+			return -1;
+		}
+
+		args->cmd = (cmd_t) opt;
+		if (optarg != NULL)
+			args->path = strdup(optarg);
+
+		break;
+	case o_STORE:		/* store */
+		args->store = strdup(optarg);
+		break;
+	case o_NAME:		/* name */
+		args->name = strdup(optarg);
+		break;
+	case o_OFFSET:		/* offset */
+		args->offset = strdup(optarg);
+		break;
+	case f_SPARSE:		/* sparse */
+		args->sparse = (flag_t) opt;
+		break;
+	case f_VERBOSE:		/* verbose */
+		args->verbose = (flag_t) opt;
+		break;
+	case f_HELP:		/* help */
+		usage(args->short_name, true);
+		exit(EXIT_SUCCESS);
+		break;
+	case '?':		/* error */
+	default:
+		usage(args->short_name, false);
+		UNEXPECTED("unknown option '%c', please see "
+			   "--help for details\n", opt);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int validate_args(args_t * args)
+{
+	assert(args != NULL);
+
+	if (args->cmd == c_ERROR) {
+		usage(args->short_name, false);
+		UNEXPECTED("no command specified, please see --help "
+			   "for details\n");
+		return -1;
+	}
+
+	if (args->opt_nr != 0) {
+		UNEXPECTED("'%s' unexpected argument, please see --help "
+			   "for details", args->opt[0]);
+		return -1;
+	}
+
+	if (args->store == NULL)
+		args->store = getenv(STORE_ENV);
+	if (args->store == NULL) {
+		UNEXPECTED("--store is required, or set $%s", STORE_ENV);
+		return -1;
+	}
+
+	#define REQUIRED(name,cmd)	({				\
+	if (args->name == NULL) {					\
+		UNEXPECTED("--%s is required for the --%s command",	\
+			   #name, #cmd);				\
+		return -1;						\
+	}								\
+					})
+
+	#define UNSUPPORTED(name,cmd)	({				\
+	if (args->name != NULL) {					\
+		UNEXPECTED("--%s is unsupported for the --%s command",	\
+			   #name, #cmd);				\
+		return -1;						\
+	}								\
+					})
+
+	if (args->cmd == c_ADD) {
+		REQUIRED(offset, add);
+		if (args->name == NULL)
+			args->name = strdup(basename(strdupa(args->path)));
+	} else if (args->cmd == c_GET) {
+		UNSUPPORTED(name, get);
+		UNSUPPORTED(offset, get);
+		if (isatty(fileno(stdout))) {
+			UNEXPECTED("refusing to write an image to a terminal, "
+				   "redirect stdout");
+			return -1;
+		}
+	} else if (args->cmd == c_DELETE) {
+		UNSUPPORTED(name, delete);
+		UNSUPPORTED(offset, delete);
+	} else if (args->cmd == c_GC) {
+		UNSUPPORTED(name, gc);
+		UNSUPPORTED(offset, gc);
+	} else {
+		UNEXPECTED("'%c' invalid command", args->cmd);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int command_add(args_t * args)
+{
+	RAII(store_t*, store, store_open(args->store, false), store_close);
+	if (store == NULL)
+		return -1;
+
+	store_stat_t stat = { 0 };
+	if (store_add(store, args->name, args->path, args->offset,
+		      args->sparse == f_SPARSE, &stat) < 0)
+		return -1;
+
+	if (args->verbose == f_VERBOSE)
+		fprintf(stderr, "%s: %zx bytes, %zu chunks, %zu new (%zx "
+			"bytes written)\n", args->name, stat.bytes,
+			stat.chunks, stat.added, stat.stored);
+
+	return 0;
+}
+
+static int command_get(args_t * args)
+{
+	RAII(store_t*, store, store_open(args->store, false), store_close);
+	if (store == NULL)
+		return -1;
+
+	store_stat_t stat = { 0 };
+	if (store_get(store, args->path, stdout, &stat) < 0)
+		return -1;
+
+	if (args->verbose == f_VERBOSE)
+		fprintf(stderr, "%s: %zx bytes, %zu chunks\n", args->path,
+			stat.bytes, stat.chunks);
+
+	return 0;
+}
+
+static int command_delete(args_t * args)
+{
+	RAII(store_t*, store, store_open(args->store, true), store_close);
+	if (store == NULL)
+		return -1;
+
+	return store_delete(store, args->path);
+}
+
+static int command_gc(args_t * args)
+{
+	RAII(store_t*, store, store_open(args->store, true), store_close);
+	if (store == NULL)
+		return -1;
+
+	store_stat_t stat = { 0 };
+	if (store_gc(store, &stat) < 0)
+		return -1;
+
+	if (args->verbose == f_VERBOSE)
+		fprintf(stderr, "%zu chunks kept, %zu deleted (%zx bytes "
+			"freed)\n", stat.chunks, stat.removed, stat.freed);
+
+	return 0;
+}
+
+static int process_args(args_t * args)
+{
+	assert(args != NULL);
+
+	switch (args->cmd) {
+	case c_ADD:
+		return command_add(args);
+	case c_GET:
+		return command_get(args);
+	case c_DELETE:
+		return command_delete(args);
+	case c_GC:
+		return command_gc(args);
+	default:
+		UNEXPECTED("NOT IMPLEMENTED YET => '%c'", args->cmd);
+		return -1;
+	}
+}
+
+static int process_option(args_t * args, const char *opt)
+{
+	assert(args != NULL);
+	assert(opt != NULL);
+
+	if (args->opt_sz <= args->opt_nr) {
+		args->opt_sz += 5;
+		args->opt = (const char **)realloc(args->opt,
+						   sizeof(*args->opt) *
+						   args->opt_sz);
+		memset(args->opt + args->opt_nr, 0,
+		       sizeof(*args->opt) * (args->opt_sz - args->opt_nr));
+	}
+
+	args->opt[args->opt_nr] = strdup(opt);
+	args->opt_nr++;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option long_opts[] = {
+		/* commands */
+		{"add", required_argument, NULL, c_ADD},
+		{"get", required_argument, NULL, c_GET},
+		{"delete", required_argument, NULL, c_DELETE},
+		{"gc", no_argument, NULL, c_GC},
+		/* options */
+		{"store", required_argument, NULL, o_STORE},
+		{"name", required_argument, NULL, o_NAME},
+		{"offset", required_argument, NULL, o_OFFSET},
+		/* flags */
+		{"sparse", no_argument, NULL, f_SPARSE},
+		{"verbose", no_argument, NULL, f_VERBOSE},
+		{"help", no_argument, NULL, f_HELP},
+		{0, 0, 0, 0}
+	};
+
+	static const char *short_opts = "A:G:D:Cs:n:o:zvh";
+
+	int rc = EXIT_FAILURE;
+
+	if (argc == 1)
+		usage(args.short_name, false), exit(rc);
+
+	int opt = 0, idx = 0;
+	while ((opt = getopt_long(argc, argv, short_opts, long_opts,
+				  &idx)) != -1)
+		if (process_argument(&args, opt, optarg) < 0)
+			goto error;
+
+	/* getopt_long doesn't know what to do with orphans, */
+	/* so we'll scoop them up here, and deal with them later */
+
+	while (optind < argc)
+		if (process_option(&args, argv[optind++]) < 0)
+			goto error;
+
+	if (validate_args(&args) < 0)
+		goto error;
+	if (process_args(&args) < 0)
+		goto error;
+
+	rc = EXIT_SUCCESS;
+
+	if (false) {
+		err_t *err;
+error:
+		err = err_get();
+		assert(err != NULL);
+
+		fprintf(stderr, "%s: %s : %s(%d) : (code=%d) %.*s\n",
+			program_invocation_short_name,
+			err_type_name(err), err_file(err), err_line(err),
+			err_code(err), err_size(err), (char *)err_data(err));
+	}
+
+	return rc;
+}
+
+static void __ctor__(void) __constructor;
+static void __ctor__(void)
+{
+	/* early initialization before main() is called the crt0 */
+	args.short_name = program_invocation_short_name;
+}
@@ -0,0 +1,89 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: store/src/main.h $                                            */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: main.h
+ *  Author:
+ *   Descr: cmdline tool for the FFS image store
+ *    Date: 10/19/2026
+ */
+
+#ifndef __MAIN_H__
+#define __MAIN_H__
+
+#include <stdio.h>
+
+typedef enum {
+    c_ERROR = 0,
+    c_ADD = 'A',
+    c_GET = 'G',
+    c_DELETE = 'D',
+    c_GC = 'C',
+} cmd_t;
+
+typedef enum {
+    o_ERROR = 0,
+    o_STORE = 's',
+    o_NAME = 'n',
+    o_OFFSET = 'o',
+} option_t;
+
+typedef enum {
+    f_ERROR = 0,
+    f_SPARSE = 'z',
+    f_VERBOSE = 'v',
+    f_HELP = 'h',
+} flag_t;
+
+typedef struct {
+    const char * short_name;
+
+    /* target */
+    const char * path;
+
+    /* command */
+    cmd_t cmd;
+
+    /* options */
+    const char * store;
+    const char * name;
+    const char * offset;
+
+    /* flags */
+    flag_t sparse, verbose;
+
+    const char ** opt;
+    int opt_sz, opt_nr;
+} args_t;
+
+extern args_t args;
+
+#define STORE_MAJOR	0x01
+#define STORE_MINOR	0x00
+#define STORE_PATCH	0x00
+
+#define STORE_ENV	"FFS_STORE"
+
+#endif /* __MAIN_H__ */
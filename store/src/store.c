@@ -0,0 +1,887 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: store/src/store.c $                                           */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: store.c
+ *  Author:
+ *   Descr: content addressed image store
+ *    Date: 10/19/2026
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <clib/attribute.h>
+#include <clib/misc.h>
+#include <clib/min.h>
+#include <clib/err.h>
+#include <clib/raii.h>
+#include <clib/sha256.h>
+
+#include <ffs/libffs.h>
+
+#include "store.h"
+
+#define STORE_MAGIC	"ffs-store 1"
+#define STORE_CHUNKS	"chunks"
+#define STORE_IMAGES	"images"
+#define STORE_TMP	"tmp"
+#define STORE_LOCK	"lock"
+
+/*
+ * A store is a directory:
+ *
+ *   chunks/ab/ab12...	one file per distinct chunk, named by its SHA-256
+ *   images/<name>	one recipe per image
+ *   tmp/		chunks and recipes being written, renamed into place
+ *   lock		flock()ed shared by --add and --get, exclusive by
+ *			--delete and --gc
+ *
+ * An image is cut into extents: its partition tables and partitions (from
+ * the entry list of every table) and the gaps between them.  Each extent is
+ * chunked by the erase block size of its table, so a partition that is the
+ * same in two builds is stored once wherever it is in flash.  A recipe is
+ * a text file:
+ *
+ *   ffs-store 1
+ *   image 4000000
+ *   extent 0 10000 part
+ *   <chunk hash>
+ *   extent 10000 f0000 HBB
+ *   <chunk hash>
+ *   ...
+ *
+ * The extents cover the image exactly once, so --get rebuilds it byte for
+ * byte by streaming the chunks in order.
+ */
+
+typedef uint8_t digest_t[SHA256_SIZE];
+
+typedef struct extent extent_t;
+struct extent {
+	off_t offset;
+	off_t length;
+	uint32_t block_size;
+	char label[64];
+};
+
+typedef struct extent_list extent_list_t;
+struct extent_list {
+	extent_t * extent;
+	size_t nr, sz;
+};
+
+static void __hex(char * str, const digest_t md)
+{
+	for (size_t i = 0; i < SHA256_SIZE; i++)
+		sprintf(str + i * 2, "%02x", md[i]);
+}
+
+static int __unhex(const char * str, digest_t md)
+{
+	for (size_t i = 0; i < SHA256_SIZE; i++) {
+		unsigned int x;
+		if (sscanf(str + i * 2, "%2x", &x) != 1)
+			return -1;
+		md[i] = x;
+	}
+	return 0;
+}
+
+static int __path(store_t * self, char * path, const char * dir,
+		  const char * name)
+{
+	int rc = snprintf(path, PATH_MAX, "%s/%s/%s", self->path, dir, name);
+	if (rc < 0 || PATH_MAX <= rc) {
+		UNEXPECTED("'%s/%s/%s' path is too long", self->path, dir,
+			   name);
+		return -1;
+	}
+	return 0;
+}
+
+static int __chunk_path(store_t * self, char * path, const digest_t md)
+{
+	char hex[SHA256_SIZE * 2 + 4];
+
+	__hex(hex + 3, md);
+	hex[0] = hex[3], hex[1] = hex[4], hex[2] = '/';
+
+	return __path(self, path, STORE_CHUNKS, hex);
+}
+
+static int __mkdir(const char * path)
+{
+	if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+		ERRNO(errno);
+		return -1;
+	}
+	return 0;
+}
+
+static int __valid_name(const char * name)
+{
+	if (*name == '\0' || *name == '.' || strchr(name, '/') != NULL) {
+		UNEXPECTED("'%s' invalid image name", name);
+		return -1;
+	}
+	return 0;
+}
+
+store_t * store_open(const char * path, bool exclusive)
+{
+	assert(path != NULL);
+
+	char sub[PATH_MAX];
+
+	if (__mkdir(path) < 0)
+		return NULL;
+
+	const char * dirs[] = { STORE_CHUNKS, STORE_IMAGES, STORE_TMP };
+	for (size_t i = 0; i < sizeof(dirs) / sizeof(*dirs); i++) {
+		snprintf(sub, sizeof sub, "%s/%s", path, dirs[i]);
+		if (__mkdir(sub) < 0)
+			return NULL;
+	}
+
+	store_t * self = calloc(1, sizeof(*self));
+	if (self == NULL) {
+		ERRNO(errno);
+		return NULL;
+	}
+
+	self->path = strdup(path);
+	if (self->path == NULL) {
+		ERRNO(errno);
+		free(self);
+		return NULL;
+	}
+
+	snprintf(sub, sizeof sub, "%s/%s", path, STORE_LOCK);
+	self->lock = open(sub, O_RDWR | O_CREAT, 0644);
+	if (self->lock < 0 ||
+	    flock(self->lock, exclusive ? LOCK_EX : LOCK_SH) < 0) {
+		ERRNO(errno);
+		store_close(self);
+		return NULL;
+	}
+
+	return self;
+}
+
+void store_close(store_t * self)
+{
+	if (self == NULL)
+		return;
+
+	if (0 <= self->lock)
+		close(self->lock);
+	free(self->path);
+	free(self);
+}
+
+/* a new file in tmp/, renamed into place once it is complete */
+static FILE * __tmp_open(store_t * self, char * path)
+{
+	char name[64];
+	snprintf(name, sizeof name, "%d.%u", getpid(), self->tmp++);
+
+	if (__path(self, path, STORE_TMP, name) < 0)
+		return NULL;
+
+	FILE * file = fopen(path, "w");
+	if (file == NULL)
+		ERRNO(errno);
+
+	return file;
+}
+
+static int __tmp_commit(FILE * file, const char * tmp, const char * path)
+{
+	int rc = 0;
+
+	if (fflush(file) == EOF || fdatasync(fileno(file)) < 0) {
+		ERRNO(errno);
+		rc = -1;
+	}
+	if (fclose(file) == EOF && rc == 0) {
+		ERRNO(errno);
+		rc = -1;
+	}
+	if (rc == 0 && rename(tmp, path) < 0) {
+		ERRNO(errno);
+		rc = -1;
+	}
+	if (rc < 0)
+		unlink(tmp);
+
+	return rc;
+}
+
+static int __chunk_put(store_t * self, const void * buf, size_t len,
+		       digest_t md, store_stat_t * stat)
+{
+	sha256(buf, len, md);
+
+	char path[PATH_MAX];
+	if (__chunk_path(self, path, md) < 0)
+		return -1;
+
+	stat->chunks++;
+
+	struct stat st;
+	if (lstat(path, &st) == 0)
+		return 0;
+	if (errno != ENOENT) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	char dir[PATH_MAX];
+	strcpy(dir, path);
+	*strrchr(dir, '/') = '\0';
+	if (__mkdir(dir) < 0)
+		return -1;
+
+	char tmp[PATH_MAX];
+	FILE * file = __tmp_open(self, tmp);
+	if (file == NULL)
+		return -1;
+
+	if (fwrite(buf, 1, len, file) != len) {
+		ERRNO(errno);
+		fclose(file);
+		unlink(tmp);
+		return -1;
+	}
+
+	if (__tmp_commit(file, tmp, path) < 0)
+		return -1;
+
+	stat->added++;
+	stat->stored += len;
+
+	return 0;
+}
+
+static int __extent_add(extent_list_t * list, off_t offset, off_t length,
+			uint32_t block_size, const char * label)
+{
+	if (list->nr == list->sz) {
+		size_t sz = list->sz ? list->sz * 2 : 64;
+		extent_t * tmp = realloc(list->extent, sz * sizeof(*tmp));
+		if (tmp == NULL) {
+			ERRNO(errno);
+			return -1;
+		}
+		list->extent = tmp, list->sz = sz;
+	}
+
+	extent_t * e = list->extent + list->nr++;
+	e->offset = offset;
+	e->length = length;
+	e->block_size = block_size;
+	snprintf(e->label, sizeof e->label, "%s", label);
+
+	return 0;
+}
+
+static int __extent_cmp(const void * __a, const void * __b)
+{
+	const extent_t * a = __a, * b = __b;
+
+	if (a->offset != b->offset)
+		return a->offset < b->offset ? -1 : 1;
+	return a->length < b->length ? 1 : a->length > b->length ? -1 : 0;
+}
+
+/* partitions of one table, from its entry list */
+static int __extents_table(extent_list_t * list, FILE * file, off_t offset)
+{
+	RAII(ffs_t*, ffs, __ffs_fopen(file, offset), __ffs_fclose);
+	if (ffs == NULL)
+		return -1;
+
+	uint32_t block_size = ffs->hdr->block_size;
+
+	ffs_entry_t * entries = NULL;
+	int nr = __ffs_entry_list(ffs, &entries);
+	if (nr < 0)
+		return -1;
+
+	int rc = 0;
+
+	for (int i = 0; i < nr && rc == 0; i++) {
+		ffs_entry_t * entry = entries + i;
+
+		if (entry->type == FFS_TYPE_LOGICAL)
+			continue;
+
+		rc = __extent_add(list, (off_t)entry->base * block_size,
+				  (off_t)entry->size * block_size,
+				  block_size, entry->name);
+	}
+
+	free(entries);
+
+	return rc;
+}
+
+/*
+ * Sort the extents, drop the duplicates (a partition listed by both the
+ * primary and the backup table), clip overlaps and fill the gaps, so
+ * that [0, size) is covered exactly once.
+ */
+static int __extents_plan(extent_list_t * list, extent_list_t * plan,
+			  off_t size, uint32_t block_size)
+{
+	qsort(list->extent, list->nr, sizeof(*list->extent), __extent_cmp);
+
+	off_t offset = 0;
+
+	for (size_t i = 0; i < list->nr && offset < size; i++) {
+		extent_t * e = list->extent + i;
+
+		off_t end = min(e->offset + e->length, size);
+		if (end <= offset)
+			continue;
+
+		if (offset < e->offset) {
+			off_t gap = min(e->offset, size) - offset;
+			if (__extent_add(plan, offset, gap, block_size,
+					 "-") < 0)
+				return -1;
+			offset += gap;
+			if (size <= offset)
+				break;
+		}
+
+		if (__extent_add(plan, offset, end - offset, e->block_size,
+				 e->label) < 0)
+			return -1;
+		offset = end;
+	}
+
+	if (offset < size)
+		if (__extent_add(plan, offset, size - offset, block_size,
+				 "-") < 0)
+			return -1;
+
+	return 0;
+}
+
+int store_add(store_t * self, const char * name, const char * image,
+	      const char * offsets, bool sparse, store_stat_t * stat)
+{
+	assert(self != NULL);
+	assert(name != NULL);
+	assert(image != NULL);
+	assert(offsets != NULL);
+	assert(stat != NULL);
+
+	if (__valid_name(name) < 0)
+		return -1;
+
+	RAII(FILE*, file, fopen(image, "r"), fclose);
+	if (file == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fileno(file), &st) < 0) {
+		ERRNO(errno);
+		return -1;
+	}
+	off_t size = st.st_size;
+
+	extent_list_t list = { NULL, 0, 0 }, plan = { NULL, 0, 0 };
+	uint32_t block_size = 0;
+
+	/* any table will do for raw reads */
+	RAII(ffs_t*, ffs, NULL, __ffs_fclose);
+
+	int rc = 0;
+
+	const char * end = offsets;
+	while (rc == 0 && *end != '\0') {
+		char * next;
+
+		errno = 0;
+		off_t offset = strtoull(end, &next, 0);
+		if (errno != 0 || next == end ||
+		    (*next != ',' && *next != '\0')) {
+			UNEXPECTED("invalid --offset specified '%s'", offsets);
+			rc = -1;
+			break;
+		}
+		end = *next == ',' ? next + 1 : next;
+
+		rc = __extents_table(&list, file, offset);
+
+		if (rc == 0 && ffs == NULL) {
+			ffs = __ffs_fopen(file, offset);
+			if (ffs == NULL)
+				rc = -1;
+			else
+				block_size = ffs->hdr->block_size;
+		}
+	}
+
+	if (rc == 0 && ffs == NULL) {
+		UNEXPECTED("--offset is required for --add");
+		rc = -1;
+	}
+
+	if (rc == 0)
+		rc = __ffs_set_sparse(ffs, sparse);
+	if (rc == 0)
+		rc = __extents_plan(&list, &plan, size, block_size);
+
+	free(list.extent);
+
+	char tmp[PATH_MAX], path[PATH_MAX];
+	FILE * recipe = NULL;
+
+	if (rc == 0 && __path(self, path, STORE_IMAGES, name) < 0)
+		rc = -1;
+	if (rc == 0 && (recipe = __tmp_open(self, tmp)) == NULL)
+		rc = -1;
+
+	if (rc == 0)
+		fprintf(recipe, "%s\nimage %llx\n", STORE_MAGIC,
+			(long long)size);
+
+	void * buf = NULL;
+	size_t buf_size = 0;
+
+	for (size_t i = 0; rc == 0 && i < plan.nr; i++) {
+		extent_t * e = plan.extent + i;
+
+		fprintf(recipe, "extent %llx %llx %s\n", (long long)e->offset,
+			(long long)e->length, e->label);
+
+		if (buf_size < e->block_size) {
+			free(buf);
+			buf_size = e->block_size;
+			buf = malloc(buf_size);
+			if (buf == NULL) {
+				ERRNO(errno);
+				rc = -1;
+				break;
+			}
+		}
+
+		for (off_t done = 0; rc == 0 && done < e->length;
+		     done += e->block_size) {
+			size_t len = min((off_t)e->block_size,
+					 e->length - done);
+
+			ssize_t n = __ffs_pread(ffs, buf, len,
+						e->offset + done);
+			if (n < 0) {
+				rc = -1;
+				break;
+			}
+			if ((size_t)n < len) {
+				UNEXPECTED("'%s' short read at offset '%llx'",
+					   image, (long long)(e->offset +
+							      done));
+				rc = -1;
+				break;
+			}
+
+			digest_t md;
+			char hex[SHA256_SIZE * 2 + 1];
+
+			rc = __chunk_put(self, buf, len, md, stat);
+			__hex(hex, md);
+			fprintf(recipe, "%s\n", hex);
+		}
+
+		stat->bytes += e->length;
+	}
+
+	free(buf);
+	free(plan.extent);
+
+	if (recipe != NULL) {
+		if (rc == 0)
+			rc = __tmp_commit(recipe, tmp, path);
+		else
+			fclose(recipe), unlink(tmp);
+	}
+
+	return rc;
+}
+
+typedef struct recipe recipe_t;
+struct recipe {
+	FILE * file;
+	const char * name;
+	char * line;
+	size_t line_sz;
+	int line_nr;
+	off_t size;
+};
+
+static int __recipe_open(store_t * self, recipe_t * r, const char * name)
+{
+	char path[PATH_MAX];
+	if (__path(self, path, STORE_IMAGES, name) < 0)
+		return -1;
+
+	memset(r, 0, sizeof(*r));
+	r->name = name;
+
+	r->file = fopen(path, "r");
+	if (r->file == NULL) {
+		if (errno == ENOENT)
+			UNEXPECTED("'%s' image not found in store '%s'", name,
+				   self->path);
+		else
+			ERRNO(errno);
+		return -1;
+	}
+
+	unsigned long long size;
+	if (getline(&r->line, &r->line_sz, r->file) == -1 ||
+	    strcmp(r->line, STORE_MAGIC "\n") != 0 ||
+	    getline(&r->line, &r->line_sz, r->file) == -1 ||
+	    sscanf(r->line, "image %llx", &size) != 1) {
+		UNEXPECTED("'%s' malformed recipe", name);
+		return -1;
+	}
+	r->line_nr = 2;
+	r->size = size;
+
+	return 0;
+}
+
+static void __recipe_close(recipe_t * r)
+{
+	if (r->file != NULL)
+		fclose(r->file);
+	free(r->line);
+}
+
+/* next line: 1 and 'md' for a chunk, 2 and 'e' for an extent, 0 at the
+ * end */
+static int __recipe_next(recipe_t * r, digest_t md, extent_t * e)
+{
+	if (getline(&r->line, &r->line_sz, r->file) == -1) {
+		if (ferror(r->file)) {
+			ERRNO(errno);
+			return -1;
+		}
+		return 0;
+	}
+	r->line_nr++;
+
+	unsigned long long offset, length;
+	if (sscanf(r->line, "extent %llx %llx %63s", &offset, &length,
+		   e->label) == 3) {
+		e->offset = offset;
+		e->length = length;
+		return 2;
+	}
+
+	if (__unhex(r->line, md) == 0)
+		return 1;
+
+	UNEXPECTED("'%s' line %d: malformed recipe", r->name, r->line_nr);
+	return -1;
+}
+
+int store_get(store_t * self, const char * name, FILE * out,
+	      store_stat_t * stat)
+{
+	assert(self != NULL);
+	assert(name != NULL);
+	assert(out != NULL);
+	assert(stat != NULL);
+
+	if (__valid_name(name) < 0)
+		return -1;
+
+	recipe_t r;
+	int rc = __recipe_open(self, &r, name);
+
+	void * buf = NULL;
+	size_t buf_size = 0;
+
+	digest_t md;
+	extent_t e;
+	off_t offset = 0;
+
+	while (rc == 0) {
+		int kind = __recipe_next(&r, md, &e);
+		if (kind <= 0) {
+			rc = kind;
+			break;
+		}
+		if (kind == 2)
+			continue;
+
+		char path[PATH_MAX];
+		if (__chunk_path(self, path, md) < 0) {
+			rc = -1;
+			break;
+		}
+
+		FILE * chunk = fopen(path, "r");
+		struct stat st;
+		if (chunk == NULL || fstat(fileno(chunk), &st) < 0) {
+			ERRNO(errno);
+			if (chunk != NULL)
+				fclose(chunk);
+			rc = -1;
+			break;
+		}
+
+		size_t len = st.st_size;
+		if (buf_size < len) {
+			free(buf);
+			buf_size = len;
+			buf = malloc(buf_size);
+		}
+
+		if (buf == NULL || fread(buf, 1, len, chunk) != len) {
+			ERRNO(errno);
+			fclose(chunk);
+			rc = -1;
+			break;
+		}
+		fclose(chunk);
+
+		digest_t check;
+		sha256(buf, len, check);
+		if (memcmp(check, md, SHA256_SIZE) != 0) {
+			UNEXPECTED("'%s' chunk is corrupt", path);
+			rc = -1;
+			break;
+		}
+
+		if (fwrite(buf, 1, len, out) != len) {
+			ERRNO(errno);
+			rc = -1;
+			break;
+		}
+
+		offset += len;
+		stat->chunks++;
+	}
+
+	free(buf);
+
+	if (rc == 0 && offset != r.size) {
+		UNEXPECTED("'%s' recipe covers '%llx' bytes, expected '%llx'",
+			   name, (long long)offset, (long long)r.size);
+		rc = -1;
+	}
+
+	if (rc == 0 && fflush(out) == EOF) {
+		ERRNO(errno);
+		rc = -1;
+	}
+
+	stat->bytes = offset;
+	__recipe_close(&r);
+
+	return rc;
+}
+
+int store_delete(store_t * self, const char * name)
+{
+	assert(self != NULL);
+	assert(name != NULL);
+
+	if (__valid_name(name) < 0)
+		return -1;
+
+	char path[PATH_MAX];
+	if (__path(self, path, STORE_IMAGES, name) < 0)
+		return -1;
+
+	if (unlink(path) < 0) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int __digest_cmp(const void * a, const void * b)
+{
+	return memcmp(a, b, SHA256_SIZE);
+}
+
+/* delete the chunks no recipe refers to, and anything left in tmp/ */
+int store_gc(store_t * self, store_stat_t * stat)
+{
+	assert(self != NULL);
+	assert(stat != NULL);
+
+	digest_t * live = NULL;
+	size_t nr = 0, sz = 0;
+	int rc = 0;
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof path, "%s/%s", self->path, STORE_IMAGES);
+
+	DIR * dir = opendir(path);
+	if (dir == NULL) {
+		ERRNO(errno);
+		return -1;
+	}
+
+	struct dirent * de;
+	while (rc == 0 && (de = readdir(dir)) != NULL) {
+		if (*de->d_name == '.')
+			continue;
+
+		recipe_t r;
+		rc = __recipe_open(self, &r, de->d_name);
+
+		digest_t md;
+		extent_t e;
+		int kind;
+		while (rc == 0 && (kind = __recipe_next(&r, md, &e)) != 0) {
+			if (kind < 0) {
+				rc = -1;
+				break;
+			}
+			if (kind == 2)
+				continue;
+
+			if (nr == sz) {
+				sz = sz ? sz * 2 : 1024;
+				digest_t * tmp = realloc(live,
+							 sz * sizeof(*tmp));
+				if (tmp == NULL) {
+					ERRNO(errno);
+					rc = -1;
+					break;
+				}
+				live = tmp;
+			}
+			memcpy(live[nr++], md, SHA256_SIZE);
+		}
+
+		__recipe_close(&r);
+	}
+	closedir(dir);
+
+	if (rc < 0) {
+		free(live);
+		return -1;
+	}
+
+	qsort(live, nr, sizeof(*live), __digest_cmp);
+
+	snprintf(path, sizeof path, "%s/%s", self->path, STORE_CHUNKS);
+	DIR * top = opendir(path);
+	if (top == NULL) {
+		ERRNO(errno);
+		free(live);
+		return -1;
+	}
+
+	while (rc == 0 && (de = readdir(top)) != NULL) {
+		if (*de->d_name == '.')
+			continue;
+
+		char sub[PATH_MAX + NAME_MAX + 2];
+		snprintf(sub, sizeof sub, "%s/%s", path, de->d_name);
+
+		DIR * d = opendir(sub);
+		if (d == NULL) {
+			ERRNO(errno);
+			rc = -1;
+			break;
+		}
+
+		struct dirent * ce;
+		while ((ce = readdir(d)) != NULL) {
+			digest_t md;
+			if (*ce->d_name == '.' || __unhex(ce->d_name, md) < 0)
+				continue;
+
+			if (bsearch(md, live, nr, sizeof(*live),
+				    __digest_cmp) != NULL) {
+				stat->chunks++;
+				continue;
+			}
+
+			char chunk[PATH_MAX + 2 * NAME_MAX + 4];
+			snprintf(chunk, sizeof chunk, "%s/%s", sub,
+				 ce->d_name);
+
+			struct stat st;
+			if (lstat(chunk, &st) == 0)
+				stat->freed += st.st_size;
+
+			if (unlink(chunk) < 0) {
+				ERRNO(errno);
+				rc = -1;
+				break;
+			}
+			stat->removed++;
+		}
+		closedir(d);
+	}
+	closedir(top);
+
+	free(live);
+
+	/* nothing else holds the lock, so tmp/ is left over from a crash */
+	snprintf(path, sizeof path, "%s/%s", self->path, STORE_TMP);
+	dir = opendir(path);
+	if (rc == 0 && dir != NULL) {
+		while ((de = readdir(dir)) != NULL) {
+			if (*de->d_name == '.')
+				continue;
+			char tmp[PATH_MAX + NAME_MAX + 2];
+			snprintf(tmp, sizeof tmp, "%s/%s", path, de->d_name);
+			unlink(tmp);
+		}
+	}
+	if (dir != NULL)
+		closedir(dir);
+
+	return rc;
+}
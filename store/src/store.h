@@ -0,0 +1,77 @@
+/* IBM_PROLOG_BEGIN_TAG                                                   */
+/* This is an automatically generated prolog.                             */
+/*                                                                        */
+/* $Source: store/src/store.h $                                           */
+/*                                                                        */
+/* OpenPOWER FFS Project                                                  */
+/*                                                                        */
+/* Contributors Listed Below - COPYRIGHT 2014,2015                        */
+/* [+] International Business Machines Corp.                              */
+/*                                                                        */
+/*                                                                        */
+/* Licensed under the Apache License, Version 2.0 (the "License");        */
+/* you may not use this file except in compliance with the License.       */
+/* You may obtain a copy of the License at                                */
+/*                                                                        */
+/*     http://www.apache.org/licenses/LICENSE-2.0                         */
+/*                                                                        */
+/* Unless required by applicable law or agreed to in writing, software    */
+/* distributed under the License is distributed on an "AS IS" BASIS,      */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or        */
+/* implied. See the License for the specific language governing           */
+/* permissions and limitations under the License.                         */
+/*                                                                        */
+/* IBM_PROLOG_END_TAG                                                     */
+
+/*
+ *    File: store.h
+ *  Author:
+ *   Descr: content addressed image store
+ *    Date: 10/19/2026
+ */
+
+#ifndef __STORE_H__
+#define __STORE_H__
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct store store_t;
+struct store {
+	char * path;
+	int lock;			/* flock()ed store/lock */
+	unsigned int tmp;		/* temporary file sequence */
+};
+
+typedef struct store_stat store_stat_t;
+struct store_stat {
+	size_t chunks;			/* referenced */
+	size_t added;			/* new chunks written */
+	size_t bytes;			/* image bytes */
+	size_t stored;			/* chunk bytes written */
+	size_t removed;			/* chunks deleted by gc */
+	size_t freed;			/* chunk bytes deleted by gc */
+};
+
+extern store_t * store_open(const char *, bool)
+/*! @cond */ __nonnull ((1)) /*! @endcond */ ;
+
+extern void store_close(store_t *);
+
+extern int store_add(store_t *, const char *, const char *, const char *,
+		     bool, store_stat_t *)
+/*! @cond */ __nonnull ((1,2,3,4,6)) /*! @endcond */ ;
+
+extern int store_get(store_t *, const char *, FILE *, store_stat_t *)
+/*! @cond */ __nonnull ((1,2,3,4)) /*! @endcond */ ;
+
+extern int store_delete(store_t *, const char *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+extern int store_gc(store_t *, store_stat_t *)
+/*! @cond */ __nonnull ((1,2)) /*! @endcond */ ;
+
+#endif /* __STORE_H__ */
@@ -0,0 +1,186 @@
+#!/bin/bash
+# IBM_PROLOG_BEGIN_TAG
+# This is an automatically generated prolog.
+#
+# $Source: store/store.sh $
+#
+# OpenPOWER FFS Project
+#
+# Contributors Listed Below - COPYRIGHT 2014,2015
+# [+] International Business Machines Corp.
+#
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+# implied. See the License for the specific language governing
+# permissions and limitations under the License.
+#
+# IBM_PROLOG_END_TAG
+#
+#     File: ffs-store cmdline test script
+#   Author:
+#     Date: 10/19/2026
+#
+
+CP=cp
+RM=rm
+FPART=fpart
+FCP=fcp
+STORE=ffs-store
+MKDIR=mkdir
+GREP=grep
+DD=dd
+DIFF=diff
+FIND=find
+
+TARGET=test.nor
+COPY=copy.nor
+TMP=/tmp/store.$$
+URANDOM=/dev/urandom
+OFFSET=0x7F0000
+
+FAIL=1
+PASS=0
+
+KB=$((1*1024))
+MB=$(($KB*1024))
+
+function expect()
+{
+	local expect=${1}
+	shift
+	local command=${*}
+	eval $command
+	local actual=${?}
+
+	if [[ ${expect} -eq ${actual} ]]; then
+		echo "[PASSED] rc: '${command}' ===> expect=${expect}, actual=${actual}" >&2
+	else
+		echo "[FAILED] rc: '${command}' ===> expect=${expect}, actual=${actual}" >&2
+		exit 1
+	fi
+}
+
+function pass()
+{
+	expect ${PASS} ${*}
+}
+
+function fail()
+{
+	expect ${FAIL} ${*}
+}
+
+function chunks()
+{
+	${FIND} ${1}/chunks -type f | wc -l
+}
+
+function setup()
+{
+	local target=${TMP}/${TARGET}
+	local input=${TMP}/${TARGET}.in
+
+	pass ${RM} -rf ${TMP}
+	pass ${MKDIR} -p ${TMP}
+
+	pass ${FPART} -t ${target} -s 8M -b 64K -p ${OFFSET} -C
+
+	for ((i=0; i<4; i++)); do
+		pass ${FPART} -t ${target} -p ${OFFSET} -o $((${i}*${MB})) \
+		     -s ${MB} -g 0 -n entry${i} -A
+	done
+
+	pass ${DD} if=${URANDOM} of=${input} bs=${KB} count=700 2> /dev/null
+	pass ${FCP} -o ${OFFSET} ${input} ${target}:entry0 -W
+	pass ${RM} -f ${input}
+}
+
+function cleanup()
+{
+	pass ${RM} -rf ${TMP}
+}
+
+function add()
+{
+	local store=${TMP}/store
+	local target=${TMP}/${TARGET}
+	local copy=${TMP}/${COPY}
+	local output=${TMP}/add.out
+	local log=${TMP}/add.log
+
+	pass "${STORE} -s ${store} -A ${target} -o ${OFFSET} -v > ${log} 2>&1"
+	pass ${GREP} \"${TARGET}: 800000 bytes, 128 chunks\" ${log} > /dev/null
+	pass "${STORE} -s ${store} -G ${TARGET} > ${output}"
+	pass ${DIFF} ${target} ${output}
+
+	# the same data in another partition only adds the new table block
+	pass ${CP} ${target} ${copy}
+	pass ${FCP} -o ${OFFSET} ${copy}:entry0 ${copy}:entry2 -C
+	local before=$(chunks ${store})
+	pass "${STORE} -s ${store} -A ${copy} -o ${OFFSET} -v > ${log} 2>&1"
+	pass ${GREP} \"${COPY}: 800000 bytes, 128 chunks, 1 new\" ${log} > /dev/null
+	pass "[[ $(chunks ${store}) -eq $((${before}+1)) ]]"
+	pass "${STORE} -s ${store} -G ${COPY} > ${output}"
+	pass ${DIFF} ${copy} ${output}
+
+	# adding an image again writes nothing
+	pass "${STORE} -s ${store} -A ${copy} -o ${OFFSET} -v > ${log} 2>&1"
+	pass ${GREP} \"0 new\" ${log} > /dev/null
+
+	pass ${RM} -f ${copy} ${output} ${log}
+}
+
+function gc()
+{
+	local store=${TMP}/store
+	local target=${TMP}/${TARGET}
+	local copy=${TMP}/${COPY}
+	local output=${TMP}/gc.out
+
+	pass ${CP} ${target} ${copy}
+	pass ${FCP} -o ${OFFSET} ${copy}:entry3 -E 0x00
+	pass ${STORE} -s ${store} -A ${target} -o ${OFFSET}
+	pass ${STORE} -s ${store} -A ${copy} -o ${OFFSET}
+	local before=$(chunks ${store})
+
+	# the chunks of a deleted image stay until --gc
+	pass ${STORE} -s ${store} -D ${COPY}
+	fail "${STORE} -s ${store} -G ${COPY} > /dev/null 2>&1"
+	pass "[[ $(chunks ${store}) -eq ${before} ]]"
+	pass ${STORE} -s ${store} -C
+	pass "[[ $(chunks ${store}) -lt ${before} ]]"
+
+	# and the chunks shared with a live image survive it
+	pass "${STORE} -s ${store} -G ${TARGET} > ${output}"
+	pass ${DIFF} ${target} ${output}
+
+	pass ${RM} -f ${copy} ${output}
+}
+
+function main()
+{
+	add
+	pass ${RM} -rf ${TMP}/store
+	gc
+}
+
+setup
+if [[ -z "${1:-}" ]]; then
+	main
+else
+	case "$1" in
+		add	) add					;;
+		gc	) gc					;;
+		*	) echo "$1 not implemented"; exit 1	;;
+	esac
+	exit 0;
+fi
+cleanup